@@ -0,0 +1,247 @@
+/***************************************************************************
+ * msbench.c
+ *
+ * A simple benchmark of trace assembly with libmseed.
+ *
+ * Generates interleaved records for a number of channels in memory
+ * and times adding them to a MSTraceList with mstl_addmsr() and to a
+ * MSTraceGroup with mst_addmsrtogroup().  By default no data samples
+ * are generated and only time coverage is assembled, optionally
+ * integer samples are included with each record.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <libmseed.h>
+
+#define VERSION "[libmseed " LIBMSEED_VERSION " example]"
+#define PACKAGE "msbench"
+
+static int   channels   = 5000;
+static int   records    = 20;
+static int   gapevery   = 0;
+static flag  skipgroup  = 0;
+static flag  samples    = 0;
+
+static int parameter_proc (int argcount, char **argvec);
+static double elapsed (struct timeval *start);
+static void usage (void);
+
+int
+main (int argc, char **argv)
+{
+  MSRecord *msr = 0;
+  MSTraceList *mstl = 0;
+  MSTraceGroup *mstg = 0;
+  struct timeval start;
+  hptime_t basetime;
+  hptime_t rectime;
+  double seconds;
+  int64_t total;
+  int rec;
+  int chan;
+
+  /* Process given parameters (command line and parameter file) */
+  if (parameter_proc (argc, argv) < 0)
+    return -1;
+
+  if ( ! (msr = msr_init (NULL)) )
+    return 1;
+
+  basetime = ms_seedtimestr2hptime ("2026,001,00:00:00.000000");
+  total = (int64_t) channels * records;
+
+  /* 100 samples at 100 sps, one second of coverage per record */
+  msr->samprate = 100.0;
+  msr->samplecnt = 100;
+  msr->dataquality = 'D';
+  msr->sampletype = 'i';
+  
+  /* Sample values are not significant, only the copying is measured */
+  if ( samples )
+    {
+      if ( ! (msr->datasamples = calloc (100, sizeof(int32_t))) )
+	return 1;
+      msr->numsamples = 100;
+    }
+
+  mstl = mstl_init (NULL);
+  mstg = mst_initgroup (NULL);
+
+  if ( ! mstl || ! mstg )
+    return 1;
+
+  ms_log (0, "Adding %lld records for %d interleaved channels\n",
+	  (long long int) total, channels);
+
+  /* Add records to trace list */
+  gettimeofday (&start, NULL);
+  for ( rec = 0; rec < records; rec++ )
+    {
+      rectime = basetime + (hptime_t) rec * HPTMODULUS;
+
+      /* Leave a gap to start a new segment if requested */
+      if ( gapevery > 0 && rec > 0 && (rec % gapevery) == 0 )
+	rectime += HPTMODULUS;
+
+      for ( chan = 0; chan < channels; chan++ )
+	{
+	  snprintf (msr->network, sizeof(msr->network), "XX");
+	  snprintf (msr->station, sizeof(msr->station), "S%04d", chan / 3);
+	  snprintf (msr->location, sizeof(msr->location), "00");
+	  snprintf (msr->channel, sizeof(msr->channel), "HH%c", "ZNE"[chan % 3]);
+	  msr->starttime = rectime;
+
+	  if ( ! mstl_addmsr (mstl, msr, 0, 1, -1.0, -1.0) )
+	    {
+	      ms_log (2, "Error adding record to trace list\n");
+	      return 1;
+	    }
+	}
+    }
+  seconds = elapsed (&start);
+
+  ms_log (0, "mstl_addmsr():       %8.3f seconds, %10.0f records/second, %d traces\n",
+	  seconds, (seconds > 0.0) ? total / seconds : 0.0, mstl->numtraces);
+
+  /* Add records to trace group */
+  if ( ! skipgroup )
+    {
+      gettimeofday (&start, NULL);
+      for ( rec = 0; rec < records; rec++ )
+	{
+	  rectime = basetime + (hptime_t) rec * HPTMODULUS;
+
+	  if ( gapevery > 0 && rec > 0 && (rec % gapevery) == 0 )
+	    rectime += HPTMODULUS;
+
+	  for ( chan = 0; chan < channels; chan++ )
+	    {
+	      snprintf (msr->network, sizeof(msr->network), "XX");
+	      snprintf (msr->station, sizeof(msr->station), "S%04d", chan / 3);
+	      snprintf (msr->location, sizeof(msr->location), "00");
+	      snprintf (msr->channel, sizeof(msr->channel), "HH%c", "ZNE"[chan % 3]);
+	      msr->starttime = rectime;
+
+	      if ( ! mst_addmsrtogroup (mstg, msr, 0, -1.0, -1.0) )
+		{
+		  ms_log (2, "Error adding record to trace group\n");
+		  return 1;
+		}
+	    }
+	}
+      seconds = elapsed (&start);
+
+      ms_log (0, "mst_addmsrtogroup(): %8.3f seconds, %10.0f records/second, %d traces\n",
+	      seconds, (seconds > 0.0) ? total / seconds : 0.0, mstg->numtraces);
+    }
+
+  mstl_free (&mstl, 0);
+  mst_freegroup (&mstg);
+  msr_free (&msr);
+
+  return 0;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * elapsed():
+ * Return the number of seconds elapsed since the specified time.
+ ***************************************************************************/
+static double
+elapsed (struct timeval *start)
+{
+  struct timeval now;
+
+  gettimeofday (&now, NULL);
+
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}  /* End of elapsed() */
+
+
+/***************************************************************************
+ * parameter_proc():
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+    {
+      if (strcmp (argvec[optind], "-V") == 0)
+	{
+	  ms_log (1, "%s version: %s\n", PACKAGE, VERSION);
+	  exit (0);
+	}
+      else if (strcmp (argvec[optind], "-h") == 0)
+	{
+	  usage();
+	  exit (0);
+	}
+      else if (strcmp (argvec[optind], "-c") == 0 && (optind + 1) < argcount)
+	{
+	  channels = strtol (argvec[++optind], NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-r") == 0 && (optind + 1) < argcount)
+	{
+	  records = strtol (argvec[++optind], NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-g") == 0 && (optind + 1) < argcount)
+	{
+	  gapevery = strtol (argvec[++optind], NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-G") == 0)
+	{
+	  skipgroup = 1;
+	}
+      else if (strcmp (argvec[optind], "-s") == 0)
+	{
+	  samples = 1;
+	}
+      else
+	{
+	  ms_log (2, "Unknown option: %s\n", argvec[optind]);
+	  exit (1);
+	}
+    }
+
+  if ( channels <= 0 || records <= 0 )
+    {
+      ms_log (2, "Channel and record counts must be positive\n");
+      return -1;
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * usage():
+ * Print the usage message and exit.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Usage: %s [options]\n\n", PACKAGE);
+  fprintf (stderr,
+	   " ## Options ##\n"
+	   " -V             Report program version\n"
+	   " -h             Show this usage message\n"
+	   " -c channels    Number of interleaved channels, default 5000\n"
+	   " -r records     Number of records per channel, default 20\n"
+	   " -g count       Insert a time gap every count records per channel\n"
+	   " -G             Skip the MSTraceGroup benchmark\n"
+	   " -s             Include 100 integer samples with each record\n"
+	   "\n");
+}  /* End of usage() */
@@ -0,0 +1,742 @@
+/***************************************************************************
+ * fileindex.c:
+ *
+ * Routines to build, store and use time indexes of Mini-SEED files.
+ *
+ * A file index lists, per network, station, location and channel, the
+ * offset, length, time range and sample count of each record in a
+ * file.  Indexes are built and stored in a sidecar file next to the
+ * data file when the caller asks for it, stored indexes are ignored
+ * when the size or modification time of the data file changes.
+ * Records overlapping a time window are found with a binary search and
+ * read directly.
+ *
+ * modified: 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "libmseed.h"
+
+#if defined(LMP_WIN32)
+  #include <process.h>
+  #define getpid _getpid
+#endif
+
+/* Open bounds for time window selection */
+#define MSFI_TIMEMIN ((hptime_t) (-9223372036854775807LL - 1))
+#define MSFI_TIMEMAX ((hptime_t) 9223372036854775807LL)
+
+/* Sidecar file identifier and byte order indicator */
+#define MSFI_MAGIC     "MSFIDX01"
+#define MSFI_BYTEORDER 0x01020304
+
+/* Sidecar file header, followed by the stream headers and records */
+typedef struct MSFIHeader_s {
+  char     magic[8];
+  uint32_t byteorder;
+  int32_t  streamcount;
+  int64_t  filesize;
+  int64_t  modtime;
+  int64_t  reccount;
+} MSFIHeader;
+
+/* Sidecar stream header */
+typedef struct MSFIStream_s {
+  char     srcname[48];
+  int64_t  reccount;
+} MSFIStream;
+
+/* Record and source name pair used while building an index */
+typedef struct MSFIBuild_s {
+  char          srcname[48];
+  MSIndexRecord record;
+} MSFIBuild;
+
+static int ms_fileindex_stat (const char *msfile, int64_t *filesize, int64_t *modtime);
+static void ms_fileindex_path (const char *msfile, char *path, size_t size);
+static int ms_fileindex_load (MSFileIndex *index, const char *path, flag verbose);
+static int ms_fileindex_build (MSFileIndex *index, int reclen, flag verbose);
+static int ms_fileindex_save (MSFileIndex *index, const char *path, flag verbose);
+static int ms_fileindex_finish (MSFileIndex *index);
+static int ms_fileindex_buildcmp (const void *a, const void *b);
+static int ms_fileindex_offsetcmp (const void *a, const void *b);
+
+
+/***************************************************************************
+ * ms_readfileindex:
+ *
+ * Return a time index of the records in a Mini-SEED file.  The index
+ * is read from the sidecar file if it exists and matches the size and
+ * modification time of the data file.  Otherwise, only if the update
+ * flag is true, the data file is scanned (headers only) to build the
+ * index and the sidecar file is written.  Failure to write the sidecar
+ * file is not an error, the index is still returned.  Without a
+ * current sidecar and the update flag building the index would read
+ * the file once more than reading it sequentially, NULL is returned.
+ *
+ * The sidecar file is named ".<file name>.msidx" in the directory of
+ * the data file.
+ *
+ * Returns a pointer to a MSFileIndex struct on success or NULL on
+ * error or if there is no current sidecar file and update is false.
+ ***************************************************************************/
+MSFileIndex *
+ms_readfileindex (const char *msfile, int reclen, flag update, flag verbose)
+{
+  MSFileIndex *index;
+  char path[600];
+
+  if ( ! msfile )
+    return NULL;
+
+  if ( ! (index = (MSFileIndex *) calloc (1, sizeof(MSFileIndex))) )
+    {
+      ms_log (2, "ms_readfileindex(): Cannot allocate memory\n");
+      return NULL;
+    }
+
+  strncpy (index->filename, msfile, sizeof(index->filename) - 1);
+  index->filename[sizeof(index->filename) - 1] = '\0';
+
+  if ( ms_fileindex_stat (msfile, &index->filesize, &index->modtime) )
+    {
+      ms_freefileindex (&index);
+      return NULL;
+    }
+
+  ms_fileindex_path (msfile, path, sizeof(path));
+
+  /* Use sidecar index if current */
+  if ( ms_fileindex_load (index, path, verbose) == 0 )
+    return index;
+
+  if ( ! update )
+    {
+      ms_freefileindex (&index);
+      return NULL;
+    }
+
+  if ( ms_fileindex_build (index, reclen, verbose) )
+    {
+      ms_freefileindex (&index);
+      return NULL;
+    }
+
+  ms_fileindex_save (index, path, verbose);
+
+  return index;
+}  /* End of ms_readfileindex() */
+
+
+/***************************************************************************
+ * ms_selectfileindex:
+ *
+ * Select the records in a file index that overlap a time window for
+ * reading with ms_readmsr_fileindex().  The start and/or end times
+ * may be HPTERROR to mean "any" time.  A record is selected if any
+ * part of it is within the window.  Selected records are read in file
+ * order.
+ *
+ * Returns the number of selected records on success and -1 on error.
+ ***************************************************************************/
+int64_t
+ms_selectfileindex (MSFileIndex *index, hptime_t starttime, hptime_t endtime)
+{
+  MSIndexStream *stream;
+  hptime_t earliest;
+  hptime_t latest;
+  int64_t low;
+  int64_t high;
+  int64_t mid;
+  int64_t count = 0;
+  int idx;
+
+  if ( ! index )
+    return -1;
+
+  /* Records overlap the window if they start no later than the latest
+   * and end no earlier than the earliest time */
+  earliest = ( starttime != HPTERROR ) ? starttime : MSFI_TIMEMIN;
+  latest = ( endtime != HPTERROR ) ? endtime : MSFI_TIMEMAX;
+
+  if ( ! index->selected && index->reccount > 0 )
+    {
+      if ( ! (index->selected = (MSIndexRecord **) malloc (index->reccount * sizeof(MSIndexRecord *))) )
+	{
+	  ms_log (2, "ms_selectfileindex(): Cannot allocate memory\n");
+	  return -1;
+	}
+    }
+
+  for ( idx = 0; idx < index->streamcount; idx++ )
+    {
+      stream = &index->streams[idx];
+
+      /* Find count of records starting no later than latest */
+      low = 0;
+      high = stream->reccount;
+      while ( low < high )
+	{
+	  mid = low + (high - low) / 2;
+
+	  if ( stream->records[mid].starttime <= latest )
+	    low = mid + 1;
+	  else
+	    high = mid;
+	}
+
+      /* Search back while any earlier record ends late enough */
+      for ( mid = low - 1; mid >= 0 && stream->maxend[mid] >= earliest; mid-- )
+	{
+	  if ( stream->records[mid].endtime >= earliest )
+	    index->selected[count++] = &stream->records[mid];
+	}
+    }
+
+  qsort (index->selected, count, sizeof(MSIndexRecord *), ms_fileindex_offsetcmp);
+
+  index->selectcount = count;
+  index->selectnext = 0;
+
+  return count;
+}  /* End of ms_selectfileindex() */
+
+
+/***************************************************************************
+ * ms_readmsr_fileindex:
+ *
+ * Read the next record selected with ms_selectfileindex() from the
+ * data file of a file index, the record is read directly from its
+ * offset.  If fpos is not NULL it will be set to the offset of the
+ * returned record.  dataflag will be passed directly to msr_unpack().
+ *
+ * Returns MS_NOERROR and populates an MSRecord struct at *ppmsr on
+ * successful read, returns MS_ENDOFFILE when all selected records have
+ * been read, otherwise returns a libmseed error code.
+ ***************************************************************************/
+int
+ms_readmsr_fileindex (MSFileIndex *index, MSRecord **ppmsr, off_t *fpos,
+		      flag dataflag, flag verbose)
+{
+  MSIndexRecord *record;
+
+  if ( ! index || ! ppmsr )
+    return MS_GENERROR;
+
+  if ( index->selectnext >= index->selectcount )
+    return MS_ENDOFFILE;
+
+  record = index->selected[index->selectnext++];
+
+  if ( record->reclen < MINRECLEN || record->reclen > MAXRECLEN )
+    {
+      ms_log (2, "%s: Invalid record length in index: %d\n", index->filename, record->reclen);
+      return MS_GENERROR;
+    }
+
+  if ( ! index->fp )
+    {
+      if ( ! (index->fp = fopen (index->filename, "rb")) )
+	{
+	  ms_log (2, "Cannot open file: %s (%s)\n", index->filename, strerror (errno));
+	  return MS_GENERROR;
+	}
+    }
+
+  if ( ! index->rawrec && ! (index->rawrec = (char *) malloc (MAXRECLEN)) )
+    {
+      ms_log (2, "ms_readmsr_fileindex(): Cannot allocate memory for read buffer\n");
+      return MS_GENERROR;
+    }
+
+  if ( lmp_fseeko (index->fp, (off_t) record->offset, SEEK_SET) )
+    {
+      ms_log (2, "Cannot seek in file: %s (%s)\n", index->filename, strerror (errno));
+      return MS_GENERROR;
+    }
+
+  if ( fread (index->rawrec, record->reclen, 1, index->fp) != 1 )
+    {
+      ms_log (2, "Short read of %d bytes starting from %lld\n",
+	      record->reclen, (long long int) record->offset);
+      return MS_GENERROR;
+    }
+
+  if ( fpos )
+    *fpos = (off_t) record->offset;
+
+  return msr_unpack (index->rawrec, record->reclen, ppmsr, dataflag, verbose);
+}  /* End of ms_readmsr_fileindex() */
+
+
+/***************************************************************************
+ * ms_freefileindex:
+ *
+ * Free all memory associated with a MSFileIndex, close the data file
+ * if open and set the pointer to NULL.
+ ***************************************************************************/
+void
+ms_freefileindex (MSFileIndex **ppindex)
+{
+  MSFileIndex *index;
+
+  if ( ! ppindex || ! *ppindex )
+    return;
+
+  index = *ppindex;
+
+  if ( index->fp )
+    fclose (index->fp);
+
+  if ( index->streams )
+    {
+      free (index->streams[0].records);
+      free (index->streams[0].maxend);
+    }
+
+  free (index->streams);
+  free (index->selected);
+  free (index->rawrec);
+  free (index);
+
+  *ppindex = NULL;
+}  /* End of ms_freefileindex() */
+
+
+/***************************************************************************
+ * ms_fileindex_stat:
+ *
+ * Determine the size and modification time, in nanoseconds where
+ * supported, of a file.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ms_fileindex_stat (const char *msfile, int64_t *filesize, int64_t *modtime)
+{
+  struct stat sbuf;
+
+  if ( stat (msfile, &sbuf) )
+    {
+      ms_log (2, "Cannot stat file: %s (%s)\n", msfile, strerror (errno));
+      return -1;
+    }
+
+  *filesize = (int64_t) sbuf.st_size;
+
+#if defined(LMP_GLIBC2)
+  *modtime = (int64_t) sbuf.st_mtim.tv_sec * 1000000000 + sbuf.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+  *modtime = (int64_t) sbuf.st_mtimespec.tv_sec * 1000000000 + sbuf.st_mtimespec.tv_nsec;
+#else
+  *modtime = (int64_t) sbuf.st_mtime * 1000000000;
+#endif
+
+  return 0;
+}  /* End of ms_fileindex_stat() */
+
+
+/***************************************************************************
+ * ms_fileindex_path:
+ *
+ * Generate the sidecar index file name for a data file:
+ * "<directory>/.<file name>.msidx".
+ ***************************************************************************/
+static void
+ms_fileindex_path (const char *msfile, char *path, size_t size)
+{
+  const char *base = msfile;
+  const char *cp;
+
+  for ( cp = msfile; *cp; cp++ )
+    {
+      if ( *cp == '/' || *cp == '\\' )
+	base = cp + 1;
+    }
+
+  snprintf (path, size, "%.*s.%s.msidx", (int) (base - msfile), msfile, base);
+}  /* End of ms_fileindex_path() */
+
+
+/***************************************************************************
+ * ms_fileindex_load:
+ *
+ * Read a sidecar index file into a MSFileIndex if it matches the size
+ * and modification time of the data file.
+ *
+ * Returns 0 on success and -1 if the index is not current or on error.
+ ***************************************************************************/
+static int
+ms_fileindex_load (MSFileIndex *index, const char *path, flag verbose)
+{
+  FILE *fp;
+  MSFIHeader header;
+  MSFIStream fistream;
+  MSIndexRecord *records = NULL;
+  int64_t offset = 0;
+  int idx;
+
+  if ( ! (fp = fopen (path, "rb")) )
+    return -1;
+
+  if ( fread (&header, sizeof(MSFIHeader), 1, fp) != 1 ||
+       memcmp (header.magic, MSFI_MAGIC, sizeof(header.magic)) ||
+       header.byteorder != MSFI_BYTEORDER ||
+       header.filesize != index->filesize ||
+       header.modtime != index->modtime ||
+       header.streamcount < 0 || header.reccount < 0 )
+    {
+      if ( verbose > 1 )
+	ms_log (1, "Index not current: %s\n", path);
+
+      fclose (fp);
+      return -1;
+    }
+
+  index->streamcount = header.streamcount;
+  index->reccount = header.reccount;
+
+  if ( index->streamcount > 0 )
+    {
+      index->streams = (MSIndexStream *) calloc (index->streamcount, sizeof(MSIndexStream));
+      records = (MSIndexRecord *) malloc ((index->reccount + 1) * sizeof(MSIndexRecord));
+
+      if ( ! index->streams || ! records )
+	{
+	  ms_log (2, "ms_fileindex_load(): Cannot allocate memory\n");
+	  free (index->streams);
+	  free (records);
+	  index->streams = NULL;
+	  index->streamcount = 0;
+	  fclose (fp);
+	  return -1;
+	}
+
+      index->streams[0].records = records;
+    }
+
+  /* Read stream headers */
+  for ( idx = 0; idx < index->streamcount; idx++ )
+    {
+      if ( fread (&fistream, sizeof(MSFIStream), 1, fp) != 1 ||
+	   fistream.reccount < 0 || offset + fistream.reccount > index->reccount )
+	break;
+
+      memcpy (index->streams[idx].srcname, fistream.srcname, sizeof(fistream.srcname));
+      index->streams[idx].srcname[sizeof(index->streams[idx].srcname) - 1] = '\0';
+      index->streams[idx].reccount = fistream.reccount;
+      index->streams[idx].records = records + offset;
+      offset += fistream.reccount;
+    }
+
+  /* Read records */
+  if ( idx != index->streamcount || offset != index->reccount ||
+       (index->reccount > 0 && fread (records, sizeof(MSIndexRecord), index->reccount, fp) != (size_t) index->reccount) )
+    {
+      ms_log (1, "Ignoring truncated or invalid index: %s\n", path);
+
+      free (records);
+      free (index->streams);
+      index->streams = NULL;
+      index->streamcount = 0;
+      index->reccount = 0;
+      fclose (fp);
+      return -1;
+    }
+
+  fclose (fp);
+
+  if ( verbose > 1 )
+    ms_log (1, "Read index of %lld records: %s\n", (long long int) index->reccount, path);
+
+  return ms_fileindex_finish (index);
+}  /* End of ms_fileindex_load() */
+
+
+/***************************************************************************
+ * ms_fileindex_build:
+ *
+ * Scan the headers of all records in the data file of a MSFileIndex
+ * and build the index.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ms_fileindex_build (MSFileIndex *index, int reclen, flag verbose)
+{
+  MSFileParam *msfp = NULL;
+  MSRecord *msr = NULL;
+  MSFIBuild *build = NULL;
+  MSFIBuild *newbuild;
+  MSIndexRecord *records;
+  off_t fpos = 0;
+  int64_t buildcount = 0;
+  int64_t buildsize = 0;
+  int64_t idx;
+  int streamidx;
+  int retcode;
+
+  if ( verbose > 1 )
+    ms_log (1, "Building index: %s\n", index->filename);
+
+  while ( (retcode = ms_readmsr_main (&msfp, &msr, index->filename, reclen, &fpos,
+				      NULL, 1, 0, NULL, verbose)) == MS_NOERROR )
+    {
+      if ( buildcount >= buildsize )
+	{
+	  buildsize = ( buildsize ) ? buildsize * 2 : 1024;
+
+	  if ( ! (newbuild = (MSFIBuild *) realloc (build, buildsize * sizeof(MSFIBuild))) )
+	    {
+	      ms_log (2, "ms_fileindex_build(): Cannot allocate memory\n");
+	      retcode = MS_GENERROR;
+	      break;
+	    }
+
+	  build = newbuild;
+	}
+
+      memset (&build[buildcount], 0, sizeof(MSFIBuild));
+      msr_srcname (msr, build[buildcount].srcname, 0);
+      build[buildcount].record.offset = (int64_t) fpos;
+      build[buildcount].record.reclen = msr->reclen;
+      build[buildcount].record.starttime = msr->starttime;
+      build[buildcount].record.endtime = msr_endtime (msr);
+      build[buildcount].record.samplecnt = msr->samplecnt;
+      buildcount++;
+    }
+
+  /* Cleanup memory and close file */
+  ms_readmsr_main (&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, NULL, 0);
+
+  if ( retcode != MS_ENDOFFILE )
+    {
+      ms_log (2, "Cannot read %s: %s\n", index->filename, ms_errorstr(retcode));
+      free (build);
+      return -1;
+    }
+
+  /* Group records by source name in time order */
+  if ( buildcount > 0 )
+    qsort (build, buildcount, sizeof(MSFIBuild), ms_fileindex_buildcmp);
+
+  for ( idx = 0; idx < buildcount; idx++ )
+    if ( idx == 0 || strcmp (build[idx].srcname, build[idx-1].srcname) )
+      index->streamcount++;
+
+  index->reccount = buildcount;
+
+  if ( buildcount > 0 )
+    {
+      index->streams = (MSIndexStream *) calloc (index->streamcount, sizeof(MSIndexStream));
+      records = (MSIndexRecord *) malloc (buildcount * sizeof(MSIndexRecord));
+
+      if ( ! index->streams || ! records )
+	{
+	  ms_log (2, "ms_fileindex_build(): Cannot allocate memory\n");
+	  free (index->streams);
+	  free (records);
+	  free (build);
+	  index->streams = NULL;
+	  index->streamcount = 0;
+	  return -1;
+	}
+
+      for ( streamidx = -1, idx = 0; idx < buildcount; idx++ )
+	{
+	  if ( idx == 0 || strcmp (build[idx].srcname, build[idx-1].srcname) )
+	    {
+	      streamidx++;
+	      strcpy (index->streams[streamidx].srcname, build[idx].srcname);
+	      index->streams[streamidx].records = records + idx;
+	    }
+
+	  records[idx] = build[idx].record;
+	  index->streams[streamidx].reccount++;
+	}
+    }
+
+  free (build);
+
+  return ms_fileindex_finish (index);
+}  /* End of ms_fileindex_build() */
+
+
+/***************************************************************************
+ * ms_fileindex_save:
+ *
+ * Write a MSFileIndex to a sidecar index file.  The index is written
+ * to a temporary file that is renamed to replace any existing index.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ms_fileindex_save (MSFileIndex *index, const char *path, flag verbose)
+{
+  FILE *fp;
+  MSFIHeader header;
+  MSFIStream fistream;
+  char tmppath[620];
+  int idx;
+
+  snprintf (tmppath, sizeof(tmppath), "%s.%ld", path, (long) getpid());
+
+  if ( ! (fp = fopen (tmppath, "wb")) )
+    {
+      if ( verbose )
+	ms_log (1, "Cannot write index %s: %s\n", tmppath, strerror (errno));
+      return -1;
+    }
+
+  memset (&header, 0, sizeof(MSFIHeader));
+  memcpy (header.magic, MSFI_MAGIC, sizeof(header.magic));
+  header.byteorder = MSFI_BYTEORDER;
+  header.streamcount = index->streamcount;
+  header.filesize = index->filesize;
+  header.modtime = index->modtime;
+  header.reccount = index->reccount;
+
+  if ( fwrite (&header, sizeof(MSFIHeader), 1, fp) != 1 )
+    goto error;
+
+  for ( idx = 0; idx < index->streamcount; idx++ )
+    {
+      memset (&fistream, 0, sizeof(MSFIStream));
+      memcpy (fistream.srcname, index->streams[idx].srcname, sizeof(fistream.srcname));
+      fistream.reccount = index->streams[idx].reccount;
+
+      if ( fwrite (&fistream, sizeof(MSFIStream), 1, fp) != 1 )
+	goto error;
+    }
+
+  if ( index->reccount > 0 &&
+       fwrite (index->streams[0].records, sizeof(MSIndexRecord), index->reccount, fp) != (size_t) index->reccount )
+    goto error;
+
+  if ( fclose (fp) )
+    {
+      fp = NULL;
+      goto error;
+    }
+
+  if ( rename (tmppath, path) )
+    {
+      fp = NULL;
+      goto error;
+    }
+
+  if ( verbose > 1 )
+    ms_log (1, "Wrote index of %lld records: %s\n", (long long int) index->reccount, path);
+
+  return 0;
+
+ error:
+  if ( verbose )
+    ms_log (1, "Cannot write index %s: %s\n", path, strerror (errno));
+
+  if ( fp )
+    fclose (fp);
+
+  remove (tmppath);
+
+  return -1;
+}  /* End of ms_fileindex_save() */
+
+
+/***************************************************************************
+ * ms_fileindex_finish:
+ *
+ * Calculate the running maximum record end times for each stream of
+ * a MSFileIndex, used to limit the search for overlapping records.
+ * The records of all streams must be contiguous starting with the
+ * first stream.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ms_fileindex_finish (MSFileIndex *index)
+{
+  MSIndexStream *stream;
+  hptime_t *maxend;
+  hptime_t recmax;
+  int64_t idx;
+  int streamidx;
+
+  if ( index->streamcount <= 0 )
+    return 0;
+
+  if ( ! (maxend = (hptime_t *) malloc ((index->reccount + 1) * sizeof(hptime_t))) )
+    {
+      ms_log (2, "ms_fileindex_finish(): Cannot allocate memory\n");
+      return -1;
+    }
+
+  for ( streamidx = 0; streamidx < index->streamcount; streamidx++ )
+    {
+      stream = &index->streams[streamidx];
+      stream->maxend = maxend + (stream->records - index->streams[0].records);
+
+      for ( idx = 0; idx < stream->reccount; idx++ )
+	{
+	  recmax = stream->records[idx].endtime;
+
+	  if ( idx > 0 && stream->maxend[idx-1] > recmax )
+	    recmax = stream->maxend[idx-1];
+
+	  stream->maxend[idx] = recmax;
+	}
+    }
+
+  return 0;
+}  /* End of ms_fileindex_finish() */
+
+
+/***************************************************************************
+ * ms_fileindex_buildcmp:
+ *
+ * Compare index build entries by source name, start time and offset
+ * for sorting with qsort().
+ ***************************************************************************/
+static int
+ms_fileindex_buildcmp (const void *a, const void *b)
+{
+  const MSFIBuild *ba = (const MSFIBuild *) a;
+  const MSFIBuild *bb = (const MSFIBuild *) b;
+  int cmp;
+
+  if ( (cmp = strcmp (ba->srcname, bb->srcname)) )
+    return cmp;
+
+  if ( ba->record.starttime != bb->record.starttime )
+    return ( ba->record.starttime < bb->record.starttime ) ? -1 : 1;
+
+  if ( ba->record.offset != bb->record.offset )
+    return ( ba->record.offset < bb->record.offset ) ? -1 : 1;
+
+  return 0;
+}  /* End of ms_fileindex_buildcmp() */
+
+
+/***************************************************************************
+ * ms_fileindex_offsetcmp:
+ *
+ * Compare pointers to index records by file offset for sorting with
+ * qsort().
+ ***************************************************************************/
+static int
+ms_fileindex_offsetcmp (const void *a, const void *b)
+{
+  const MSIndexRecord *ra = *(const MSIndexRecord **) a;
+  const MSIndexRecord *rb = *(const MSIndexRecord **) b;
+
+  if ( ra->offset != rb->offset )
+    return ( ra->offset < rb->offset ) ? -1 : 1;
+
+  return 0;
+}  /* End of ms_fileindex_offsetcmp() */
@@ -18,6 +18,10 @@
 
 #include "libmseed.h"
 
+#if !defined(LMP_WIN32)
+  #include <pthread.h>
+#endif
+
 static int ms_fread (char *buf, int size, int num, FILE *stream);
 
 /* Pack type parameters for the 8 defined types:
@@ -755,6 +759,7 @@ ms_readtraces_timewin (MSTraceGroup **ppmstg, const char *msfile, int reclen,
   selection.srcname[1] = '\0';
   selection.timewindows = &selecttime;
   selection.next = NULL;
+  selection.index = NULL;
   
   selecttime.starttime = starttime;
   selecttime.endtime = endtime;
@@ -881,6 +886,7 @@ ms_readtracelist_timewin (MSTraceList **ppmstl, const char *msfile,
   selection.srcname[1] = '\0';
   selection.timewindows = &selecttime;
   selection.next = NULL;
+  selection.index = NULL;
   
   selecttime.starttime = starttime;
   selecttime.endtime = endtime;
@@ -964,6 +970,278 @@ ms_readtracelist_selection (MSTraceList **ppmstl, const char *msfile,
 }  /* End of ms_readtracelist_selection() */
 
 
+/* File chunk and shared state for ms_readtracelist_parallel() */
+typedef struct MSTLChunk_s {
+  int          first;               /* Index of first file in chunk */
+  int          count;               /* Number of files in chunk */
+  MSTraceList *mstl;                /* Trace list for this chunk */
+  int          retcode;             /* Return code for this chunk */
+} MSTLChunk;
+
+typedef struct MSTLScan_s {
+  char       **msfiles;
+  MSTLChunk   *chunks;
+  int          chunkcount;
+  int          nextchunk;           /* Next chunk to be processed */
+  flag         abort;               /* Stop processing new chunks */
+  int          reclen;
+  double       timetol;
+  double       sampratetol;
+  Selections  *selections;
+  flag         dataquality;
+  flag         skipnotdata;
+  flag         dataflag;
+  flag         verbose;
+#if !defined(LMP_WIN32)
+  pthread_mutex_t lock;
+#endif
+} MSTLScan;
+
+
+/*********************************************************************
+ * ms_scanchunk:
+ *
+ * Read all files in a chunk into the chunk's trace list, stopping at
+ * the first error.  Each file is read with its own MSFileParam so
+ * chunks can be processed concurrently.
+ *
+ * Returns the chunk return code.
+ *********************************************************************/
+static int
+ms_scanchunk (MSTLScan *scan, MSTLChunk *chunk)
+{
+  int idx;
+  
+  chunk->retcode = MS_NOERROR;
+  
+  if ( ! (chunk->mstl = mstl_init (NULL)) )
+    return (chunk->retcode = MS_GENERROR);
+  
+  for ( idx = chunk->first; idx < (chunk->first + chunk->count); idx++ )
+    {
+      if ( scan->verbose >= 2 )
+	ms_log (1, "Processing: %s\n", scan->msfiles[idx]);
+      
+      chunk->retcode = ms_readtracelist_selection (&chunk->mstl, scan->msfiles[idx], scan->reclen,
+						   scan->timetol, scan->sampratetol, scan->selections,
+						   scan->dataquality, scan->skipnotdata,
+						   scan->dataflag, scan->verbose);
+      
+      if ( chunk->retcode != MS_NOERROR )
+	{
+	  ms_log (2, "Cannot read %s: %s\n", scan->msfiles[idx], ms_errorstr(chunk->retcode));
+	  break;
+	}
+    }
+  
+  return chunk->retcode;
+}  /* End of ms_scanchunk() */
+
+
+#if !defined(LMP_WIN32)
+/*********************************************************************
+ * ms_scanthread:
+ *
+ * Thread body for ms_readtracelist_parallel(), claims and processes
+ * chunks until all chunks are claimed or an error has occurred.
+ *********************************************************************/
+static void *
+ms_scanthread (void *arg)
+{
+  MSTLScan *scan = (MSTLScan *) arg;
+  MSTLChunk *chunk;
+  
+  for (;;)
+    {
+      pthread_mutex_lock (&scan->lock);
+      
+      if ( scan->abort || scan->nextchunk >= scan->chunkcount )
+	chunk = NULL;
+      else
+	chunk = &scan->chunks[scan->nextchunk++];
+      
+      pthread_mutex_unlock (&scan->lock);
+      
+      if ( ! chunk )
+	break;
+      
+      if ( ms_scanchunk (scan, chunk) != MS_NOERROR )
+	{
+	  pthread_mutex_lock (&scan->lock);
+	  scan->abort = 1;
+	  pthread_mutex_unlock (&scan->lock);
+	}
+    }
+  
+  return NULL;
+}  /* End of ms_scanthread() */
+#endif
+
+
+/*********************************************************************
+ * ms_readtracelist_parallel:
+ *
+ * Read all Mini-SEED records in a list of files and populate a trace
+ * list using multiple threads.  The file list is divided into
+ * consecutive chunks that are read into separate trace lists by
+ * threads, the chunk trace lists are then merged in file list order
+ * with mstl_addtracelist().  The resulting trace list is the same as
+ * if each file was read in order with ms_readtracelist_selection().
+ *
+ * If threads is less than 2, or threads are not supported on the
+ * platform, the files are read sequentially in the calling thread.
+ *
+ * If a Selections list is supplied it will be used to limit which
+ * records are added to the trace list.  The remaining arguments are
+ * passed to ms_readtracelist_selection().
+ *
+ * Processing stops after the first file that cannot be read.
+ *
+ * Returns MS_NOERROR and populates an MSTraceList struct at *ppmstl
+ * on successful read, otherwise returns the libmseed error code
+ * (listed in libmseed.h) of the first file (in list order) that
+ * could not be read.
+ *********************************************************************/
+int
+ms_readtracelist_parallel (MSTraceList **ppmstl, char **msfiles, int filecount,
+			   int threads, int reclen, double timetol, double sampratetol,
+			   Selections *selections, flag dataquality,
+			   flag skipnotdata, flag dataflag, flag verbose)
+{
+  MSTLScan scan;
+  int chunksize;
+  int idx;
+  int retcode = MS_NOERROR;
+#if !defined(LMP_WIN32)
+  pthread_t *tids = NULL;
+  int started = 0;
+#endif
+  
+  if ( ! ppmstl || ! msfiles || filecount < 0 )
+    return MS_GENERROR;
+  
+  /* Initialize MSTraceList if needed */
+  if ( ! *ppmstl )
+    {
+      *ppmstl = mstl_init (*ppmstl);
+      
+      if ( ! *ppmstl )
+	return MS_GENERROR;
+    }
+  
+  if ( filecount == 0 )
+    return MS_NOERROR;
+  
+#if defined(LMP_WIN32)
+  threads = 1;
+#endif
+  
+  if ( threads < 1 )
+    threads = 1;
+  
+  if ( threads > filecount )
+    threads = filecount;
+  
+  /* Compile selections before they are shared between threads,
+   * ms_matchselect() only reads them */
+  if ( selections && ms_compileselections (selections) )
+    return MS_GENERROR;
+  
+  memset (&scan, 0, sizeof(MSTLScan));
+  scan.msfiles = msfiles;
+  scan.reclen = reclen;
+  scan.timetol = timetol;
+  scan.sampratetol = sampratetol;
+  scan.selections = selections;
+  scan.dataquality = dataquality;
+  scan.skipnotdata = skipnotdata;
+  scan.dataflag = dataflag;
+  scan.verbose = verbose;
+  
+  /* Use more chunks than threads to balance differing file sizes */
+  scan.chunkcount = ( threads > 1 ) ? threads * 4 : 1;
+  if ( scan.chunkcount > filecount )
+    scan.chunkcount = filecount;
+  
+  if ( ! (scan.chunks = (MSTLChunk *) calloc (scan.chunkcount, sizeof(MSTLChunk))) )
+    {
+      ms_log (2, "ms_readtracelist_parallel(): Cannot allocate memory\n");
+      return MS_GENERROR;
+    }
+  
+  /* Divide the file list into consecutive chunks of nearly equal count */
+  chunksize = filecount / scan.chunkcount;
+  for ( idx = 0; idx < scan.chunkcount; idx++ )
+    {
+      scan.chunks[idx].first = (idx) ? scan.chunks[idx-1].first + scan.chunks[idx-1].count : 0;
+      scan.chunks[idx].count = chunksize + ((idx < (filecount % scan.chunkcount)) ? 1 : 0);
+    }
+  
+#if !defined(LMP_WIN32)
+  if ( threads > 1 )
+    {
+      if ( ! (tids = (pthread_t *) malloc (threads * sizeof(pthread_t))) )
+	{
+	  ms_log (2, "ms_readtracelist_parallel(): Cannot allocate memory\n");
+	  free (scan.chunks);
+	  return MS_GENERROR;
+	}
+      
+      pthread_mutex_init (&scan.lock, NULL);
+      
+      for ( started = 0; started < threads; started++ )
+	{
+	  if ( pthread_create (&tids[started], NULL, ms_scanthread, &scan) )
+	    {
+	      ms_log (1, "ms_readtracelist_parallel(): Cannot create thread, using %d\n", started);
+	      break;
+	    }
+	}
+      
+      /* Process all chunks in the calling thread if no threads were started */
+      if ( started == 0 )
+	ms_scanthread (&scan);
+      
+      for ( idx = 0; idx < started; idx++ )
+	pthread_join (tids[idx], NULL);
+      
+      pthread_mutex_destroy (&scan.lock);
+      free (tids);
+    }
+  else
+#endif
+    {
+      for ( idx = 0; idx < scan.chunkcount; idx++ )
+	if ( ms_scanchunk (&scan, &scan.chunks[idx]) != MS_NOERROR )
+	  break;
+    }
+  
+  /* Merge chunk trace lists in file list order, stop at first failed chunk */
+  for ( idx = 0; idx < scan.chunkcount; idx++ )
+    {
+      if ( scan.chunks[idx].mstl && retcode == MS_NOERROR )
+	{
+	  if ( mstl_addtracelist (*ppmstl, scan.chunks[idx].mstl, dataquality,
+				  1, timetol, sampratetol) )
+	    retcode = MS_GENERROR;
+	  else
+	    retcode = scan.chunks[idx].retcode;
+	}
+      else if ( ! scan.chunks[idx].mstl && retcode == MS_NOERROR )
+	{
+	  retcode = MS_GENERROR;
+	}
+      
+      if ( scan.chunks[idx].mstl )
+	mstl_free (&scan.chunks[idx].mstl, 1);
+    }
+  
+  free (scan.chunks);
+  
+  return retcode;
+}  /* End of ms_readtracelist_parallel() */
+
+
 /*********************************************************************
  * ms_fread:
  *
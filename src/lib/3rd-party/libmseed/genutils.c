@@ -1257,6 +1257,53 @@ ms_dabs (double val)
 }  /* End of ms_dabs() */
 
 
+/***************************************************************************
+ * ms_fnv1a32:
+ *
+ * Continue a 32-bit FNV-1a hash with 'length' bytes of 'data', start
+ * hashes with MS_FNV32_INIT.  Hashes of several fields are built by
+ * chaining calls.
+ *
+ * Returns the updated hash.
+ ***************************************************************************/
+uint32_t
+ms_fnv1a32 (uint32_t hash, const void *data, size_t length)
+{
+  const uint8_t *bp = (const uint8_t *) data;
+  
+  while ( length-- )
+    {
+      hash ^= *bp++;
+      hash *= 16777619U;
+    }
+  
+  return hash;
+}  /* End of ms_fnv1a32() */
+
+
+/***************************************************************************
+ * ms_fnv1a64:
+ *
+ * Continue a 64-bit FNV-1a hash with 'length' bytes of 'data', start
+ * hashes with MS_FNV64_INIT.
+ *
+ * Returns the updated hash.
+ ***************************************************************************/
+uint64_t
+ms_fnv1a64 (uint64_t hash, const void *data, size_t length)
+{
+  const uint8_t *bp = (const uint8_t *) data;
+  
+  while ( length-- )
+    {
+      hash ^= *bp++;
+      hash *= 1099511628211ULL;
+    }
+  
+  return hash;
+}  /* End of ms_fnv1a64() */
+
+
 /***************************************************************************
  * ms_gmtime_r:
  *
@@ -436,6 +436,7 @@ MSTrace;
 typedef struct MSTraceGroup_s {
   int32_t           numtraces;       /* Number of MSTraces in the trace chain */
   struct MSTrace_s *traces;          /* Root of the trace chain */
+  struct MSTraceIndex_s *index;      /* Index of traces by identifiers, internal use */
 }
 MSTraceGroup;
 
@@ -446,6 +447,7 @@ typedef struct MSTraceSeg_s {
   double          samprate;          /* Nominal sample rate (Hz) */
   int64_t         samplecnt;         /* Number of samples in trace coverage */
   void           *datasamples;       /* Data samples, 'numsamples' of type 'sampletype'*/
+  size_t          datasize;          /* Size of datasamples buffer in bytes */
   int64_t         numsamples;        /* Number of data samples in datasamples */
   char            sampletype;        /* Sample type code: a, i, f, d */
   void           *prvtptr;           /* Private pointer for general use, unused by libmseed */
@@ -478,6 +480,8 @@ typedef struct MSTraceList_s {
   int32_t             numtraces;     /* Number of traces in list */
   struct MSTraceID_s *traces;        /* Pointer to list of traces */
   struct MSTraceID_s *last;          /* Pointer to last used trace in list */
+  struct MSTraceIDIndex_s *index;    /* Index of trace IDs by source name, internal use */
+  struct MSTracePool_s *pool;        /* Pool of trace IDs and segments, internal use */
 }
 MSTraceList;
 
@@ -493,6 +497,7 @@ typedef struct Selections_s {
   char srcname[100];     /* Matching (globbing) source name: Net_Sta_Loc_Chan_Qual */
   struct SelectTime_s *timewindows;
   struct Selections_s *next;
+  struct SelectIndex_s *index;   /* Compiled selection index, internal use */
 } Selections;
 
 
@@ -596,6 +601,8 @@ extern MSTraceList * mstl_init ( MSTraceList *mstl );
 extern void          mstl_free ( MSTraceList **ppmstl, flag freeprvtptr );
 extern MSTraceSeg *  mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 				   flag autoheal, double timetol, double sampratetol );
+extern int           mstl_addtracelist ( MSTraceList *mstl, MSTraceList *addmstl, flag dataquality,
+					 flag autoheal, double timetol, double sampratetol );
 extern int           mstl_convertsamples ( MSTraceSeg *seg, char type, flag truncate );
 extern void          mstl_printtracelist ( MSTraceList *mstl, flag timeformat,
 					   flag details, flag gaps );
@@ -636,6 +643,46 @@ extern int      ms_readtracelist_timewin (MSTraceList **ppmstl, const char *msfi
 					  hptime_t starttime, hptime_t endtime, flag dataquality, flag skipnotdata, flag dataflag, flag verbose);
 extern int      ms_readtracelist_selection (MSTraceList **ppmstl, const char *msfile, int reclen, double timetol, double sampratetol,
 					    Selections *selections, flag dataquality, flag skipnotdata, flag dataflag, flag verbose);
+extern int      ms_readtracelist_parallel (MSTraceList **ppmstl, char **msfiles, int filecount, int threads,
+					   int reclen, double timetol, double sampratetol, Selections *selections,
+					   flag dataquality, flag skipnotdata, flag dataflag, flag verbose);
+
+/* Time index of a Mini-SEED file, see fileindex.c */
+typedef struct MSIndexRecord_s {
+  int64_t   offset;             /* Offset of record in file */
+  hptime_t  starttime;          /* Time of first sample */
+  hptime_t  endtime;            /* Time of last sample */
+  int64_t   samplecnt;          /* Number of samples in record */
+  int32_t   reclen;             /* Length of record in bytes */
+  int32_t   reserved;
+} MSIndexRecord;
+
+typedef struct MSIndexStream_s {
+  char      srcname[48];        /* Source name (Net_Sta_Loc_Chan) */
+  int64_t   reccount;           /* Number of records */
+  MSIndexRecord *records;       /* Records sorted by start time */
+  hptime_t *maxend;             /* Running maximum record end time */
+} MSIndexStream;
+
+typedef struct MSFileIndex_s {
+  char      filename[512];      /* Data file name */
+  int64_t   filesize;           /* Size of data file when indexed */
+  int64_t   modtime;            /* Modification time of data file when indexed (ns) */
+  int32_t   streamcount;        /* Number of streams */
+  int64_t   reccount;           /* Number of records in all streams */
+  MSIndexStream *streams;       /* Streams sorted by source name */
+  MSIndexRecord **selected;     /* Records selected for reading, internal use */
+  int64_t   selectcount;        /* Number of selected records */
+  int64_t   selectnext;         /* Next selected record to read */
+  FILE     *fp;                 /* Data file, internal use */
+  char     *rawrec;             /* Record buffer, internal use */
+} MSFileIndex;
+
+extern MSFileIndex *ms_readfileindex (const char *msfile, int reclen, flag update, flag verbose);
+extern int64_t  ms_selectfileindex (MSFileIndex *index, hptime_t starttime, hptime_t endtime);
+extern int      ms_readmsr_fileindex (MSFileIndex *index, MSRecord **ppmsr, off_t *fpos,
+				      flag dataflag, flag verbose);
+extern void     ms_freefileindex (MSFileIndex **ppindex);
 
 extern int      msr_writemseed ( MSRecord *msr, const char *msfile, flag overwrite, int reclen,
 				 flag encoding, flag byteorder, flag verbose );
@@ -668,6 +715,12 @@ extern int      ms_genfactmult (double samprate, int16_t *factor, int16_t *multi
 extern int      ms_ratapprox (double real, int *num, int *den, int maxval, double precision);
 extern int      ms_bigendianhost ();
 extern double   ms_dabs (double val);
+extern uint32_t ms_fnv1a32 (uint32_t hash, const void *data, size_t length);
+extern uint64_t ms_fnv1a64 (uint64_t hash, const void *data, size_t length);
+
+/* Offset bases of FNV-1a hashes */
+#define MS_FNV32_INIT 2166136261U
+#define MS_FNV64_INIT 14695981039346656037ULL
 
 
 /* Lookup functions */
@@ -701,6 +754,7 @@ extern MSLogParam *ms_loginit_l (MSLogParam *logp,
 extern Selections *ms_matchselect (Selections *selections, char *srcname,
 				   hptime_t starttime, hptime_t endtime, SelectTime **ppselecttime);
 extern Selections *msr_matchselect (Selections *selections, MSRecord *msr, SelectTime **ppselecttime);
+extern int      ms_compileselections (Selections *selections);
 extern int      ms_addselect (Selections **ppselections, char *srcname,
 			      hptime_t starttime, hptime_t endtime);
 extern int      ms_addselect_comp (Selections **ppselections, char *net, char* sta, char *loc,
@@ -124,7 +124,8 @@ msr_free_blktchain ( MSRecord *msr )
 	    {
 	      nb = bc->next;
 	      
-	      if ( bc->blktdata )
+	      /* Blockette data is usually allocated with the link */
+	      if ( bc->blktdata && bc->blktdata != (void *) (bc + 1) )
 		free (bc->blktdata);
 	      
 	      free (bc);
@@ -153,6 +154,9 @@ msr_free_blktchain ( MSRecord *msr )
  * end of the chain (last blockette), other wise it will be added to
  * the beginning of the chain (first blockette).
  *
+ * The blockette data is stored in the same allocation as the BlktLink
+ * immediately following the structure.
+ *
  * Returns a pointer to the BlktLink added to the chain on success and
  * NULL on error.
  ***************************************************************************/
@@ -171,7 +175,13 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
     {
       if ( chainpos != 0 )
 	{
-	  blkt = (BlktLink *) malloc (sizeof(BlktLink));
+	  blkt = (BlktLink *) malloc (sizeof(BlktLink) + length);
+	  
+	  if ( blkt == NULL )
+	    {
+	      ms_log (2, "msr_addblockette(): Cannot allocate memory\n");
+	      return NULL;
+	    }
 	  
 	  blkt->next = msr->blkts;
 	  msr->blkts = blkt;
@@ -184,21 +194,21 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
 	      blkt = blkt->next;
 	    }
 	  
-	  blkt->next = (BlktLink *) malloc (sizeof(BlktLink));
+	  blkt->next = (BlktLink *) malloc (sizeof(BlktLink) + length);
+	  
+	  if ( blkt->next == NULL )
+	    {
+	      ms_log (2, "msr_addblockette(): Cannot allocate memory\n");
+	      return NULL;
+	    }
 	  
 	  blkt = blkt->next;
 	  blkt->next = 0;
 	}
-      
-      if ( blkt == NULL )
-	{
-	  ms_log (2, "msr_addblockette(): Cannot allocate memory\n");
-	  return NULL;
-	}
     }
   else
     {
-      msr->blkts = (BlktLink *) malloc (sizeof(BlktLink));
+      msr->blkts = (BlktLink *) malloc (sizeof(BlktLink) + length);
       
       if ( msr->blkts == NULL )
 	{
@@ -214,13 +224,7 @@ msr_addblockette (MSRecord *msr, char *blktdata, int length, int blkttype,
   blkt->blkt_type = blkttype;
   blkt->next_blkt = 0;
   
-  blkt->blktdata = (char *) malloc (length);
-  
-  if ( blkt->blktdata == NULL )
-    {
-      ms_log (2, "msr_addblockette(): Cannot allocate memory\n");
-      return NULL;
-    }
+  blkt->blktdata = (char *) (blkt + 1);
   
   memcpy (blkt->blktdata, blktdata, length);
   blkt->blktdatalen = length;
@@ -6,7 +6,7 @@
  * Written by Chad Trabant unless otherwise noted
  *   IRIS Data Management Center
  *
- * modified: 2010.068
+ * modified: 2026.292
  ***************************************************************************/
 
 #include <stdio.h>
@@ -19,6 +19,62 @@
 
 static int ms_globmatch (char *string, char *pattern);
 
+/* Open bounds for compiled time windows */
+#define SELECT_TIMEMIN ((hptime_t) (-9223372036854775807LL - 1))
+#define SELECT_TIMEMAX ((hptime_t) 9223372036854775807LL)
+
+/* Minimum number of entries and time windows in a list to compile */
+#define SELECT_COMPILEMIN 16
+
+/* Compiled time window, windows are sorted by start time and maxend
+ * is the latest end time of this and all previous windows */
+typedef struct SelectWindow_s {
+  hptime_t    start;            /* Start time, SELECT_TIMEMIN if open */
+  hptime_t    end;              /* End time, SELECT_TIMEMAX if open */
+  hptime_t    maxend;           /* Latest end time up to this window */
+  int         order;            /* Position in the time window list */
+  SelectTime *selecttime;       /* Source time window */
+} SelectWindow;
+
+/* Compiled selection entry */
+typedef struct SelectEntry_s {
+  Selections   *selection;      /* Source selection entry */
+  int           order;          /* Position in the selection list */
+  int           windowcount;    /* Number of time windows */
+  SelectWindow *windows;        /* Time windows sorted by start time */
+} SelectEntry;
+
+/* Literal prefix of a globbing source name */
+typedef struct SelectPrefix_s {
+  char        *prefix;          /* Prefix, not terminated */
+  int          length;          /* Length of prefix */
+  SelectEntry *entry;           /* Compiled selection entry */
+} SelectPrefix;
+
+/* Compiled selection list, source names without globbing characters
+ * are found with a hash table and the remaining entries are found by
+ * literal prefix before testing the full pattern */
+struct SelectIndex_s {
+  int           entrycount;     /* Number of entries */
+  SelectEntry  *entries;        /* Entries in list order */
+  SelectWindow *windows;        /* Time windows of all entries */
+  int           hashsize;       /* Number of hash slots, a power of 2 */
+  SelectEntry **hash;           /* Hash slots of exact source names */
+  int           prefixcount;    /* Number of prefixes */
+  SelectPrefix *prefixes;       /* Prefixes sorted by prefix then order */
+};
+
+static int ms_selectcount (Selections *selections, int limit);
+static Selections *ms_matchselectindex (struct SelectIndex_s *index, char *srcname,
+					hptime_t starttime, hptime_t endtime,
+					SelectTime **ppselecttime);
+static void ms_freeselectindex (Selections *selections);
+static uint32_t ms_selecthash (const char *srcname);
+static int ms_selectwindow_cmp (const void *a, const void *b);
+static int ms_selectprefix_cmp (const void *a, const void *b);
+static int ms_selectprefix_search (struct SelectIndex_s *index, char *srcname, int length);
+static SelectWindow *ms_matchselectwindow (SelectEntry *entry, hptime_t earliest, hptime_t latest);
+
 
 /***************************************************************************
  * ms_matchselect:
@@ -27,6 +83,12 @@ static int ms_globmatch (char *string, char *pattern);
  * srcname parameter may contain globbing characters.  The NULL value
  * (matching any times) for the start and end times is HPTERROR.
  *
+ * A list compiled with ms_compileselections() is searched with its
+ * index, other lists in order, the first matching entry and time
+ * window in list order are returned either way.  The list is not
+ * modified so it may be shared between threads.  Lists read with
+ * ms_readselectionsfile() are compiled when large enough.
+ *
  * Return Selections pointer to matching entry on successful match and
  * NULL for no match or error.
  ***************************************************************************/
@@ -38,6 +100,13 @@ ms_matchselect (Selections *selections, char *srcname, hptime_t starttime,
   SelectTime *findst = NULL;
   SelectTime *matchst = NULL;
   
+  /* Use the compiled index if present */
+  if ( selections && selections->index )
+    {
+      return ms_matchselectindex (selections->index, srcname, starttime,
+				  endtime, ppselecttime);
+    }
+  
   if ( selections )
     {
       findsl = selections;
@@ -74,6 +143,432 @@ ms_matchselect (Selections *selections, char *srcname, hptime_t starttime,
 } /* End of ms_matchselect() */
 
 
+/***************************************************************************
+ * ms_selectcount:
+ *
+ * Count the entries and time windows of a selections list up to a
+ * limit.
+ *
+ * Returns the count, at most limit.
+ ***************************************************************************/
+static int
+ms_selectcount (Selections *selections, int limit)
+{
+  SelectTime *selecttime;
+  int count = 0;
+  
+  for ( ; selections && count < limit; selections = selections->next )
+    {
+      count++;
+      
+      for ( selecttime = selections->timewindows;
+	    selecttime && count < limit; selecttime = selecttime->next )
+	count++;
+    }
+  
+  return count;
+} /* End of ms_selectcount() */
+
+
+/***************************************************************************
+ * ms_selecthash:
+ *
+ * Return a FNV-1a hash of a source name string.
+ ***************************************************************************/
+static uint32_t
+ms_selecthash (const char *srcname)
+{
+  return ms_fnv1a32 (MS_FNV32_INIT, srcname, strlen (srcname));
+} /* End of ms_selecthash() */
+
+
+/***************************************************************************
+ * ms_selectwindow_cmp:
+ *
+ * Compare compiled time windows by start time then list order for
+ * sorting with qsort().
+ ***************************************************************************/
+static int
+ms_selectwindow_cmp (const void *a, const void *b)
+{
+  const SelectWindow *wa = (const SelectWindow *) a;
+  const SelectWindow *wb = (const SelectWindow *) b;
+  
+  if ( wa->start != wb->start )
+    return ( wa->start < wb->start ) ? -1 : 1;
+  
+  return wa->order - wb->order;
+} /* End of ms_selectwindow_cmp() */
+
+
+/***************************************************************************
+ * ms_selectprefix_cmpkey:
+ *
+ * Compare a prefix to a key of a specified length, shorter strings
+ * sort before longer strings with the same leading characters.
+ ***************************************************************************/
+static int
+ms_selectprefix_cmpkey (const SelectPrefix *prefix, const char *key, int length)
+{
+  int minlength = ( prefix->length < length ) ? prefix->length : length;
+  int cmp;
+  
+  if ( (cmp = memcmp (prefix->prefix, key, minlength)) )
+    return cmp;
+  
+  return prefix->length - length;
+} /* End of ms_selectprefix_cmpkey() */
+
+
+/***************************************************************************
+ * ms_selectprefix_cmp:
+ *
+ * Compare prefixes by prefix then list order for sorting with qsort().
+ ***************************************************************************/
+static int
+ms_selectprefix_cmp (const void *a, const void *b)
+{
+  const SelectPrefix *pa = (const SelectPrefix *) a;
+  const SelectPrefix *pb = (const SelectPrefix *) b;
+  int cmp;
+  
+  if ( (cmp = ms_selectprefix_cmpkey (pa, pb->prefix, pb->length)) )
+    return cmp;
+  
+  return pa->entry->order - pb->entry->order;
+} /* End of ms_selectprefix_cmp() */
+
+
+/***************************************************************************
+ * ms_selectprefix_search:
+ *
+ * Search the sorted prefixes of a compiled selections list for the
+ * first prefix not less than the first length characters of srcname.
+ *
+ * Returns the index of the prefix, prefixcount if none.
+ ***************************************************************************/
+static int
+ms_selectprefix_search (struct SelectIndex_s *index, char *srcname, int length)
+{
+  int low = 0;
+  int high = index->prefixcount;
+  int mid;
+  
+  while ( low < high )
+    {
+      mid = low + (high - low) / 2;
+      
+      if ( ms_selectprefix_cmpkey (&index->prefixes[mid], srcname, length) < 0 )
+	low = mid + 1;
+      else
+	high = mid;
+    }
+  
+  return low;
+} /* End of ms_selectprefix_search() */
+
+
+/***************************************************************************
+ * ms_matchselectwindow:
+ *
+ * Search the compiled time windows of a selection entry for a window
+ * starting no later than latest and ending no earlier than earliest.
+ * Windows starting after latest are skipped by binary search and the
+ * search stops when no earlier window ends late enough.
+ *
+ * Returns the matching window first in list order or NULL if none.
+ ***************************************************************************/
+static SelectWindow *
+ms_matchselectwindow (SelectEntry *entry, hptime_t earliest, hptime_t latest)
+{
+  SelectWindow *match = NULL;
+  int low = 0;
+  int high = entry->windowcount;
+  int mid;
+  
+  /* Find count of windows starting no later than latest */
+  while ( low < high )
+    {
+      mid = low + (high - low) / 2;
+      
+      if ( entry->windows[mid].start <= latest )
+	low = mid + 1;
+      else
+	high = mid;
+    }
+  
+  for ( mid = low - 1; mid >= 0 && entry->windows[mid].maxend >= earliest; mid-- )
+    {
+      if ( entry->windows[mid].end >= earliest &&
+	   ( ! match || entry->windows[mid].order < match->order ) )
+	match = &entry->windows[mid];
+    }
+  
+  return match;
+} /* End of ms_matchselectwindow() */
+
+
+/***************************************************************************
+ * ms_freeselectindex:
+ *
+ * Free the compiled index of a selections list if present.
+ ***************************************************************************/
+static void
+ms_freeselectindex (Selections *selections)
+{
+  struct SelectIndex_s *index;
+  
+  if ( ! selections || ! selections->index )
+    return;
+  
+  index = selections->index;
+  
+  free (index->entries);
+  free (index->windows);
+  free (index->hash);
+  free (index->prefixes);
+  free (index);
+  
+  selections->index = NULL;
+} /* End of ms_freeselectindex() */
+
+
+/***************************************************************************
+ * ms_compileselections:
+ *
+ * Compile a selections list for faster matching with
+ * ms_matchselect().  Source names without globbing characters are
+ * placed in a hash table, all others are indexed by the literal
+ * prefix before the first globbing character and the time windows of
+ * each entry are sorted by start time.  The compiled index is kept
+ * with the first entry of the list and is released when the list is
+ * modified with ms_addselect() or freed with ms_freeselections().
+ *
+ * Lists built with ms_addselect() or ms_addselect_comp() are not
+ * compiled automatically, this routine should be called once the list
+ * is complete and before it is shared between threads.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+ms_compileselections (Selections *selections)
+{
+  struct SelectIndex_s *index;
+  Selections *select;
+  SelectTime *selecttime;
+  SelectEntry *entry;
+  SelectWindow *window;
+  char *glob;
+  uint32_t slot;
+  int windowcount = 0;
+  int idx;
+  
+  if ( ! selections )
+    return -1;
+  
+  if ( selections->index )
+    return 0;
+  
+  if ( ! (index = (struct SelectIndex_s *) calloc (1, sizeof(struct SelectIndex_s))) )
+    {
+      ms_log (2, "ms_compileselections(): Cannot allocate memory\n");
+      return -1;
+    }
+  
+  /* Count entries and time windows, entries without windows never match */
+  for ( select = selections; select; select = select->next )
+    {
+      if ( ! select->timewindows )
+	continue;
+      
+      index->entrycount++;
+      
+      for ( selecttime = select->timewindows; selecttime; selecttime = selecttime->next )
+	windowcount++;
+    }
+  
+  index->hashsize = 16;
+  while ( index->hashsize < index->entrycount * 2 )
+    index->hashsize *= 2;
+  
+  index->entries = (SelectEntry *) calloc (index->entrycount + 1, sizeof(SelectEntry));
+  index->windows = (SelectWindow *) calloc (windowcount + 1, sizeof(SelectWindow));
+  index->hash = (SelectEntry **) calloc (index->hashsize, sizeof(SelectEntry *));
+  index->prefixes = (SelectPrefix *) calloc (index->entrycount + 1, sizeof(SelectPrefix));
+  
+  if ( ! index->entries || ! index->windows || ! index->hash || ! index->prefixes )
+    {
+      ms_log (2, "ms_compileselections(): Cannot allocate memory\n");
+      free (index->entries);
+      free (index->windows);
+      free (index->hash);
+      free (index->prefixes);
+      free (index);
+      return -1;
+    }
+  
+  entry = index->entries;
+  window = index->windows;
+  
+  for ( select = selections; select; select = select->next )
+    {
+      if ( ! select->timewindows )
+	continue;
+      
+      entry->selection = select;
+      entry->order = entry - index->entries;
+      entry->windows = window;
+      
+      /* Populate time windows with open bounds for HPTERROR */
+      for ( selecttime = select->timewindows; selecttime; selecttime = selecttime->next )
+	{
+	  window->start = ( selecttime->starttime != HPTERROR ) ? selecttime->starttime : SELECT_TIMEMIN;
+	  window->end = ( selecttime->endtime != HPTERROR ) ? selecttime->endtime : SELECT_TIMEMAX;
+	  window->order = entry->windowcount++;
+	  window->selecttime = selecttime;
+	  window++;
+	}
+      
+      qsort (entry->windows, entry->windowcount, sizeof(SelectWindow), ms_selectwindow_cmp);
+      
+      for ( idx = 0; idx < entry->windowcount; idx++ )
+	{
+	  entry->windows[idx].maxend = entry->windows[idx].end;
+	  
+	  if ( idx > 0 && entry->windows[idx-1].maxend > entry->windows[idx].maxend )
+	    entry->windows[idx].maxend = entry->windows[idx-1].maxend;
+	}
+      
+      /* Index by literal prefix if globbing characters are present */
+      if ( (glob = strpbrk (select->srcname, "*?[\\")) )
+	{
+	  index->prefixes[index->prefixcount].prefix = select->srcname;
+	  index->prefixes[index->prefixcount].length = glob - select->srcname;
+	  index->prefixes[index->prefixcount].entry = entry;
+	  index->prefixcount++;
+	}
+      /* Otherwise add to hash table unless an earlier entry is present */
+      else
+	{
+	  slot = ms_selecthash (select->srcname) & (index->hashsize - 1);
+	  
+	  while ( index->hash[slot] && strcmp (index->hash[slot]->selection->srcname, select->srcname) )
+	    slot = (slot + 1) & (index->hashsize - 1);
+	  
+	  if ( ! index->hash[slot] )
+	    index->hash[slot] = entry;
+	}
+      
+      entry++;
+    }
+  
+  qsort (index->prefixes, index->prefixcount, sizeof(SelectPrefix), ms_selectprefix_cmp);
+  
+  selections->index = index;
+  
+  return 0;
+} /* End of ms_compileselections() */
+
+
+/***************************************************************************
+ * ms_matchselectindex:
+ *
+ * Test the specified parameters against a compiled selections list,
+ * see ms_matchselect() for details.  The first matching entry in list
+ * order is returned along with the first matching time window in the
+ * entry's list order.
+ *
+ * Return Selections pointer to matching entry on successful match and
+ * NULL for no match.
+ ***************************************************************************/
+static Selections *
+ms_matchselectindex (struct SelectIndex_s *index, char *srcname,
+		     hptime_t starttime, hptime_t endtime,
+		     SelectTime **ppselecttime)
+{
+  SelectEntry *entry;
+  SelectEntry *matchentry = NULL;
+  SelectWindow *window;
+  SelectWindow *matchwindow = NULL;
+  SelectPrefix *prefix;
+  hptime_t earliest;
+  hptime_t latest;
+  uint32_t slot;
+  int srclen;
+  int length;
+  int idx;
+  
+  /* A time window matches if it starts no later than the latest and
+   * ends no earlier than the earliest of the time range, this is
+   * equivalent to the tests in ms_matchselect() including HPTERROR. */
+  if ( starttime == HPTERROR )
+    latest = SELECT_TIMEMAX;
+  else
+    latest = ( endtime > starttime ) ? endtime : starttime;
+  
+  if ( endtime == HPTERROR )
+    earliest = SELECT_TIMEMIN;
+  else
+    earliest = ( starttime < endtime ) ? starttime : endtime;
+  
+  /* Search for exact source name */
+  slot = ms_selecthash (srcname) & (index->hashsize - 1);
+  while ( (entry = index->hash[slot]) )
+    {
+      if ( ! strcmp (entry->selection->srcname, srcname) )
+	{
+	  if ( (window = ms_matchselectwindow (entry, earliest, latest)) )
+	    {
+	      matchentry = entry;
+	      matchwindow = window;
+	    }
+	  break;
+	}
+      
+      slot = (slot + 1) & (index->hashsize - 1);
+    }
+  
+  /* Search globbing entries with prefixes of the source name */
+  srclen = strlen (srcname);
+  for ( length = 0; length <= srclen && index->prefixcount; length++ )
+    {
+      idx = ms_selectprefix_search (index, srcname, length);
+      
+      /* Stop when no prefix starts with this many characters of srcname */
+      if ( idx >= index->prefixcount || index->prefixes[idx].length < length ||
+	   memcmp (index->prefixes[idx].prefix, srcname, length) )
+	break;
+      
+      /* Test entries with exactly this prefix in list order */
+      for ( ; idx < index->prefixcount; idx++ )
+	{
+	  prefix = &index->prefixes[idx];
+	  
+	  if ( prefix->length != length || memcmp (prefix->prefix, srcname, length) )
+	    break;
+	  
+	  if ( matchentry && prefix->entry->order > matchentry->order )
+	    break;
+	  
+	  if ( ! ms_globmatch (srcname, prefix->entry->selection->srcname) )
+	    continue;
+	  
+	  if ( (window = ms_matchselectwindow (prefix->entry, earliest, latest)) )
+	    {
+	      matchentry = prefix->entry;
+	      matchwindow = window;
+	      break;
+	    }
+	}
+    }
+  
+  if ( ppselecttime )
+    *ppselecttime = ( matchwindow ) ? matchwindow->selecttime : NULL;
+  
+  return ( matchentry ) ? matchentry->selection : NULL;
+} /* End of ms_matchselectindex() */
+
+
 /***************************************************************************
  * msr_matchselect:
  *
@@ -119,6 +614,9 @@ ms_addselect (Selections **ppselections, char *srcname,
   if ( ! ppselections || ! srcname )
     return -1;
   
+  /* Any compiled index is no longer valid */
+  ms_freeselectindex (*ppselections);
+  
   /* Allocate new SelectTime and populate */
   if ( ! (newst = (SelectTime *) calloc (1, sizeof(SelectTime))) )
     {
@@ -420,6 +918,10 @@ ms_readselectionsfile (Selections **ppselections, char *filename)
   if ( fp != stdin )
     fclose (fp);
   
+  /* Compile larger lists, a list that cannot be compiled is searched in order */
+  if ( *ppselections && ms_selectcount (*ppselections, SELECT_COMPILEMIN) >= SELECT_COMPILEMIN )
+    ms_compileselections (*ppselections);
+  
   return selectcount;
 } /* End of ms_readselectionsfile() */
 
@@ -439,6 +941,8 @@ ms_freeselections ( Selections *selections )
   
   if ( selections )
     {
+      ms_freeselectindex (selections);
+      
       select = selections;
       
       while ( select )
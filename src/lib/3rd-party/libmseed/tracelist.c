@@ -16,9 +16,51 @@
 #include "libmseed.h"
 
 
-MSTraceSeg *mstl_msr2seg (MSRecord *msr, hptime_t endtime);
+static MSTraceSeg *mstl_addmsr_int (MSTraceList *mstl, MSRecord *msr, hptime_t endtime,
+				     flag dataquality, flag autoheal, double timetol,
+				     double sampratetol);
+MSTraceSeg *mstl_msr2seg (MSTraceList *mstl, MSRecord *msr, hptime_t endtime);
 MSTraceSeg *mstl_addmsrtoseg (MSTraceSeg *seg, MSRecord *msr, hptime_t endtime, flag whence);
 MSTraceSeg *mstl_addsegtoseg (MSTraceSeg *seg1, MSTraceSeg *seg2);
+static MSTraceID *mstl_findid (MSTraceList *mstl, const char *srcname);
+static int mstl_indexid (MSTraceList *mstl, MSTraceID *id);
+static void *mstl_poolalloc (MSTraceList *mstl, size_t size);
+static void mstl_poolfreeseg (MSTraceList *mstl, MSTraceSeg *seg);
+static int mstl_growsamples (MSTraceSeg *seg, size_t size);
+
+/* Hash index of MSTraceIDs by source name, open addressing with
+ * linear probing.  The index is rebuilt from the trace list when the
+ * number of indexed IDs does not match the list. */
+struct MSTraceIDIndex_s {
+  int32_t     size;             /* Number of slots, a power of 2 */
+  int32_t     count;            /* Number of MSTraceIDs indexed */
+  MSTraceID **slots;            /* Slots of MSTraceID pointers */
+};
+
+/* Initial number of index slots, the index doubles when half full */
+#define MSTL_INDEXSIZE 64
+
+/* Pool of memory blocks from which the MSTraceIDs and MSTraceSegs of
+ * a trace list are allocated, all blocks are released together when
+ * the trace list is freed.  Segments removed from a list are kept for
+ * reuse by later segments. */
+typedef struct MSTracePoolBlock_s {
+  struct MSTracePoolBlock_s *next;  /* Next (older) block */
+  size_t      size;             /* Size of block data in bytes */
+  size_t      used;             /* Bytes of block data allocated */
+} MSTracePoolBlock;
+
+struct MSTracePool_s {
+  MSTracePoolBlock *blocks;     /* Blocks, most recent first */
+  MSTraceSeg *freesegs;         /* Removed segments, linked by next */
+};
+
+/* Size of the first pool block, following blocks double up to the maximum */
+#define MSTL_POOLBLOCK    4096
+#define MSTL_POOLBLOCKMAX 1048576
+
+/* Alignment of pool allocations and start of block data */
+#define MSTL_POOLALIGN(X) (((X) + 15) & ~((size_t) 15))
 
 
 /***************************************************************************
@@ -56,7 +98,10 @@ mstl_init ( MSTraceList *mstl )
  * mstl_free:
  *
  * Free all memory associated with a MSTraceList struct and set the
- * pointer to 0.
+ * pointer to 0.  The MSTraceIDs and MSTraceSegs of the list are
+ * allocated from a pool of blocks owned by the list and are released
+ * together, only data samples and private pointer data are freed
+ * individually.
  *
  * If the freeprvtptr flag is true any private pointer data will also
  * be freed when present.
@@ -94,7 +139,6 @@ mstl_free ( MSTraceList **ppmstl, flag freeprvtptr )
 	      if ( seg->datasamples )
 		free (seg->datasamples);
 	      
-	      free (seg);
 	      seg = nextseg;
 	    }
 	  
@@ -102,10 +146,32 @@ mstl_free ( MSTraceList **ppmstl, flag freeprvtptr )
 	  if ( freeprvtptr && id->prvtptr )
 	    free (id->prvtptr);
 	  
-	  free (id);
 	  id = nextid;
 	}
       
+      /* Free pool blocks, releasing all MSTraceIDs and MSTraceSegs */
+      if ( (*ppmstl)->pool )
+	{
+	  MSTracePoolBlock *block = (*ppmstl)->pool->blocks;
+	  MSTracePoolBlock *nextblock;
+	  
+	  while ( block )
+	    {
+	      nextblock = block->next;
+	      free (block);
+	      block = nextblock;
+	    }
+	  
+	  free ((*ppmstl)->pool);
+	}
+      
+      /* Free trace ID index */
+      if ( (*ppmstl)->index )
+	{
+	  free ((*ppmstl)->index->slots);
+	  free ((*ppmstl)->index);
+	}
+      
       free (*ppmstl);
       
       *ppmstl = NULL;
@@ -139,6 +205,38 @@ mstl_free ( MSTraceList **ppmstl, flag freeprvtptr )
 MSTraceSeg *
 mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 	      flag autoheal, double timetol, double sampratetol )
+{
+  hptime_t endtime;
+  
+  if ( ! mstl || ! msr )
+    return 0;
+  
+  /* Calculate end time for MSRecord */
+  if ( (endtime = msr_endtime (msr)) == HPTERROR )
+    {
+      ms_log (2, "mstl_addmsr(): Error calculating record end time\n");
+      return 0;
+    }
+  
+  return mstl_addmsr_int (mstl, msr, endtime, dataquality, autoheal,
+			  timetol, sampratetol);
+}  /* End of mstl_addmsr() */
+
+
+/***************************************************************************
+ * mstl_addmsr_int:
+ *
+ * Internal version of mstl_addmsr() that uses the supplied end time
+ * for the MSRecord coverage instead of calculating it.  This allows
+ * the coverage of an existing MSTraceSeg to be added as if it were a
+ * single record, see mstl_addtracelist().
+ *
+ * Return a pointer to the MSTraceSeg updated or 0 on error.
+ ***************************************************************************/
+static MSTraceSeg *
+mstl_addmsr_int ( MSTraceList *mstl, MSRecord *msr, hptime_t endtime,
+		  flag dataquality, flag autoheal, double timetol,
+		  double sampratetol )
 {
   MSTraceID *id = 0;
   MSTraceID *searchid = 0;
@@ -150,7 +248,6 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
   MSTraceSeg *segafter = 0;
   MSTraceSeg *followseg = 0;
   
-  hptime_t endtime;
   hptime_t pregap;
   hptime_t postgap;
   hptime_t lastgap;
@@ -172,13 +269,6 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
   if ( ! mstl || ! msr )
     return 0;
   
-  /* Calculate end time for MSRecord */
-  if ( (endtime = msr_endtime (msr)) == HPTERROR )
-    {
-      ms_log (2, "mstl_addmsr(): Error calculating record end time\n");
-      return 0;
-    }
-  
   /* Generate source name string */
   if ( ! msr_srcname (msr, srcname, dataquality) )
     {
@@ -204,10 +294,16 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 	  id = mstl->last;
 	}
       else
+	{
+	  id = mstl_findid (mstl, srcname);
+	}
+      
+      if ( ! id )
 	{
 	  /* Loop through trace ID list searching for a match, simultaneously
 	   * track the source name which is closest but less than the MSRecord
-	   * to allow for later insertion with sort order. */
+	   * to allow for later insertion with sort order.  With the index
+	   * this is only needed for new source names. */
 	  searchid = mstl->traces;
 	  ltcmp = 0;
 	  ltmag = 0;
@@ -259,7 +355,7 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
   /* If no matching ID was found create new MSTraceID and MSTraceSeg entries */
   if ( ! id )
     {
-      if ( ! (id = (MSTraceID *) calloc (1, sizeof(MSTraceID))) )
+      if ( ! (id = (MSTraceID *) mstl_poolalloc (mstl, sizeof(MSTraceID))) )
 	{
 	  ms_log (2, "mstl_addmsr(): Error allocating memory\n");
 	  return 0;
@@ -277,7 +373,7 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
       id->latest = endtime;
       id->numsegments = 1;
       
-      if ( ! (seg = mstl_msr2seg (msr, endtime)) )
+      if ( ! (seg = mstl_msr2seg (mstl, msr, endtime)) )
 	{
 	  return 0;
 	}
@@ -296,6 +392,8 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 	}
       
       mstl->numtraces++;
+      
+      mstl_indexid (mstl, id);
     }
   /* Add data coverage to the matching MSTraceID */
   else
@@ -355,7 +453,7 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
       /* Record coverage is after all other coverage */
       else if ( (msr->starttime - hpdelta - hptimetol) > id->latest )
 	{
-	  if ( ! (seg = mstl_msr2seg (msr, endtime)) )
+	  if ( ! (seg = mstl_msr2seg (mstl, msr, endtime)) )
 	    return 0;
 	  
 	  /* Add to end of list */
@@ -370,7 +468,7 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
       /* Record coverage is before all other coverage */
       else if ( (endtime + hpdelta + hptimetol) < id->earliest )
 	{
-	  if ( ! (seg = mstl_msr2seg (msr, endtime)) )
+	  if ( ! (seg = mstl_msr2seg (mstl, msr, endtime)) )
 	    return 0;
 	  
 	  /* Add to beginning of list */
@@ -481,14 +579,14 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 		  if ( segafter->next )
 		    segafter->next->prev = segafter->prev;
 		  
-		  /* Free data samples, private data and segment structure */
+		  /* Free data samples and private data, keep segment for reuse */
 		  if (segafter->datasamples)
 		    free (segafter->datasamples);
 		  
 		  if (segafter->prvtptr)
 		    free (segafter->prvtptr);
 		  
-		  free (segafter);
+		  mstl_poolfreeseg (mstl, segafter);
 		}
 	      
 	      seg = segbefore;
@@ -507,7 +605,7 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
 	  else
 	    {
 	      /* Create new segment */
-	      if ( ! (seg = mstl_msr2seg (msr, endtime)) )
+	      if ( ! (seg = mstl_msr2seg (mstl, msr, endtime)) )
 		{
 		  return 0;
 		}
@@ -600,23 +698,345 @@ mstl_addmsr ( MSTraceList *mstl, MSRecord *msr, flag dataquality,
   mstl->last = id;
   
   return seg;
-}  /* End of mstl_addmsr() */
+}  /* End of mstl_addmsr_int() */
+
+
+/***************************************************************************
+ * mstl_addtracelist:
+ *
+ * Add all data coverage from the addmstl MSTraceList to mstl.  Each
+ * MSTraceSeg in addmstl is added as if it were a single record using
+ * the same search, insertion and healing logic as mstl_addmsr().
+ *
+ * When trace lists are built from consecutive portions of ordered
+ * input, e.g. a file list divided between threads, merging them in
+ * the same order results in the trace list that would be created by
+ * adding all of the records to a single trace list.
+ *
+ * The dataquality, autoheal, timetol and sampratetol arguments have
+ * the same meaning as for mstl_addmsr() and should match the values
+ * used to build addmstl.  Data samples are copied, addmstl is not
+ * modified and remains the responsibility of the caller.  Private
+ * pointer data is not transferred.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+mstl_addtracelist ( MSTraceList *mstl, MSTraceList *addmstl, flag dataquality,
+		    flag autoheal, double timetol, double sampratetol )
+{
+  MSTraceID *id = 0;
+  MSTraceSeg *seg = 0;
+  MSRecord msr;
+  
+  if ( ! mstl || ! addmstl )
+    return -1;
+  
+  /* A template MSRecord without a fixed header, only the fields used
+   * by mstl_addmsr_int() are populated from each trace segment. */
+  memset (&msr, 0, sizeof(MSRecord));
+  
+  id = addmstl->traces;
+  while ( id )
+    {
+      strcpy (msr.network, id->network);
+      strcpy (msr.station, id->station);
+      strcpy (msr.location, id->location);
+      strcpy (msr.channel, id->channel);
+      msr.dataquality = id->dataquality;
+      
+      seg = id->first;
+      while ( seg )
+	{
+	  msr.starttime = seg->starttime;
+	  msr.samprate = seg->samprate;
+	  msr.samplecnt = seg->samplecnt;
+	  msr.datasamples = seg->datasamples;
+	  msr.numsamples = seg->numsamples;
+	  msr.sampletype = seg->sampletype;
+	  
+	  if ( ! mstl_addmsr_int (mstl, &msr, seg->endtime, dataquality,
+				  autoheal, timetol, sampratetol) )
+	    {
+	      ms_log (2, "mstl_addtracelist(): Error adding segment for %s\n", id->srcname);
+	      return -1;
+	    }
+	  
+	  seg = seg->next;
+	}
+      
+      id = id->next;
+    }
+  
+  return 0;
+}  /* End of mstl_addtracelist() */
+
+
+/***************************************************************************
+ * mstl_hashsrcname:
+ *
+ * Return a FNV-1a hash of a source name string.
+ ***************************************************************************/
+static uint32_t
+mstl_hashsrcname (const char *srcname)
+{
+  return ms_fnv1a32 (MS_FNV32_INIT, srcname, strlen (srcname));
+}  /* End of mstl_hashsrcname() */
+
+
+/***************************************************************************
+ * mstl_indexid:
+ *
+ * Add a MSTraceID to the trace ID index of a MSTraceList.  The index
+ * is allocated when needed and grown by doubling when half full.  If
+ * the index is out of sync with the trace list it is rebuilt from
+ * the list, in which case the MSTraceID should already be in the list.
+ *
+ * Returns 0 on success and -1 on error, on error the index is
+ * removed and lookups fall back to searching the trace list.
+ ***************************************************************************/
+static int
+mstl_indexid (MSTraceList *mstl, MSTraceID *id)
+{
+  struct MSTraceIDIndex_s *index = mstl->index;
+  MSTraceID **slots;
+  MSTraceID *listid;
+  uint32_t slot;
+  int32_t size;
+  
+  /* (Re)build the index when missing, out of sync or half full */
+  if ( ! index || (index->count + 1) != mstl->numtraces ||
+       (index->count + 1) * 2 > index->size )
+    {
+      size = ( index ) ? index->size : MSTL_INDEXSIZE;
+      while ( mstl->numtraces * 2 > size )
+	size *= 2;
+      
+      if ( ! index )
+	{
+	  if ( ! (index = (struct MSTraceIDIndex_s *) calloc (1, sizeof(struct MSTraceIDIndex_s))) )
+	    {
+	      ms_log (2, "mstl_indexid(): Cannot allocate memory\n");
+	      return -1;
+	    }
+	  mstl->index = index;
+	}
+      
+      if ( ! (slots = (MSTraceID **) calloc (size, sizeof(MSTraceID *))) )
+	{
+	  ms_log (2, "mstl_indexid(): Cannot allocate memory\n");
+	  free (index->slots);
+	  free (index);
+	  mstl->index = NULL;
+	  return -1;
+	}
+      
+      free (index->slots);
+      index->slots = slots;
+      index->size = size;
+      index->count = 0;
+      
+      /* Add all IDs in the list, this includes the new ID */
+      for ( listid = mstl->traces; listid; listid = listid->next )
+	{
+	  slot = mstl_hashsrcname (listid->srcname) & (index->size - 1);
+	  while ( index->slots[slot] )
+	    slot = (slot + 1) & (index->size - 1);
+	  
+	  index->slots[slot] = listid;
+	  index->count++;
+	}
+      
+      return 0;
+    }
+  
+  slot = mstl_hashsrcname (id->srcname) & (index->size - 1);
+  while ( index->slots[slot] )
+    slot = (slot + 1) & (index->size - 1);
+  
+  index->slots[slot] = id;
+  index->count++;
+  
+  return 0;
+}  /* End of mstl_indexid() */
+
+
+/***************************************************************************
+ * mstl_findid:
+ *
+ * Search the trace ID index of a MSTraceList for a source name.  The
+ * index is (re)built if it is not in sync with the trace list.
+ *
+ * Returns a pointer to the matching MSTraceID or NULL if not found or
+ * no index is available.
+ ***************************************************************************/
+static MSTraceID *
+mstl_findid (MSTraceList *mstl, const char *srcname)
+{
+  struct MSTraceIDIndex_s *index = mstl->index;
+  MSTraceID *id;
+  uint32_t slot;
+  
+  if ( ! mstl->traces )
+    return NULL;
+  
+  if ( ! index || index->count != mstl->numtraces )
+    {
+      /* Force a rebuild from the trace list */
+      if ( index )
+	index->count = -1;
+      
+      if ( mstl_indexid (mstl, NULL) )
+	return NULL;
+      
+      index = mstl->index;
+    }
+  
+  slot = mstl_hashsrcname (srcname) & (index->size - 1);
+  while ( (id = index->slots[slot]) )
+    {
+      if ( ! strcmp (id->srcname, srcname) )
+	return id;
+      
+      slot = (slot + 1) & (index->size - 1);
+    }
+  
+  return NULL;
+}  /* End of mstl_findid() */
+
+
+/***************************************************************************
+ * mstl_poolalloc:
+ *
+ * Allocate zeroed memory for a MSTraceID or MSTraceSeg from the pool
+ * of a MSTraceList.  Memory is taken from the current block and a new
+ * block is added when it is exhausted.  Block sizes double from
+ * MSTL_POOLBLOCK up to MSTL_POOLBLOCKMAX.
+ *
+ * Returns a pointer to the memory on success and NULL on error.
+ ***************************************************************************/
+static void *
+mstl_poolalloc (MSTraceList *mstl, size_t size)
+{
+  struct MSTracePool_s *pool = mstl->pool;
+  MSTracePoolBlock *block;
+  size_t blocksize;
+  void *ptr;
+  
+  if ( ! pool )
+    {
+      if ( ! (pool = (struct MSTracePool_s *) calloc (1, sizeof(struct MSTracePool_s))) )
+	return NULL;
+      
+      mstl->pool = pool;
+    }
+  
+  size = MSTL_POOLALIGN (size);
+  block = pool->blocks;
+  
+  /* Add a new block if needed */
+  if ( ! block || (block->used + size) > block->size )
+    {
+      blocksize = ( block ) ? block->size * 2 : MSTL_POOLBLOCK;
+      
+      if ( blocksize > MSTL_POOLBLOCKMAX )
+	blocksize = MSTL_POOLBLOCKMAX;
+      
+      if ( blocksize < size )
+	blocksize = size;
+      
+      if ( ! (block = (MSTracePoolBlock *) malloc (MSTL_POOLALIGN (sizeof(MSTracePoolBlock)) + blocksize)) )
+	return NULL;
+      
+      block->size = blocksize;
+      block->used = 0;
+      block->next = pool->blocks;
+      pool->blocks = block;
+    }
+  
+  ptr = (char *) block + MSTL_POOLALIGN (sizeof(MSTracePoolBlock)) + block->used;
+  block->used += size;
+  
+  memset (ptr, 0, size);
+  
+  return ptr;
+}  /* End of mstl_poolalloc() */
+
+
+/***************************************************************************
+ * mstl_poolfreeseg:
+ *
+ * Return a MSTraceSeg removed from a MSTraceList to the pool of the
+ * list for reuse.  Data samples and private data must already be
+ * freed.
+ ***************************************************************************/
+static void
+mstl_poolfreeseg (MSTraceList *mstl, MSTraceSeg *seg)
+{
+  if ( ! mstl->pool )
+    return;
+  
+  seg->prev = NULL;
+  seg->next = mstl->pool->freesegs;
+  mstl->pool->freesegs = seg;
+}  /* End of mstl_poolfreeseg() */
+
+
+/***************************************************************************
+ * mstl_growsamples:
+ *
+ * Ensure the data sample buffer of a MSTraceSeg is at least size
+ * bytes.  The buffer is grown geometrically, at least doubling in
+ * size, to avoid a reallocation for every record added to a segment.
+ * The buffer size is tracked in MSTraceSeg->datasize.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mstl_growsamples (MSTraceSeg *seg, size_t size)
+{
+  void *newdatasamples;
+  size_t newsize;
+  
+  if ( size <= seg->datasize && seg->datasamples )
+    return 0;
+  
+  newsize = seg->datasize * 2;
+  if ( newsize < size )
+    newsize = size;
+  
+  if ( ! (newdatasamples = realloc (seg->datasamples, newsize)) )
+    return -1;
+  
+  seg->datasamples = newdatasamples;
+  seg->datasize = newsize;
+  
+  return 0;
+}  /* End of mstl_growsamples() */
 
 
 /***************************************************************************
  * mstl_msr2seg:
  *
- * Create an MSTraceSeg structure from an MSRecord structure.
+ * Create an MSTraceSeg structure from an MSRecord structure, the
+ * segment is allocated from the pool of the MSTraceList reusing a
+ * previously removed segment if available.
  *
  * Return a pointer to a MSTraceSeg otherwise 0 on error.
  ***************************************************************************/
 MSTraceSeg *
-mstl_msr2seg (MSRecord *msr, hptime_t endtime)
+mstl_msr2seg (MSTraceList *mstl, MSRecord *msr, hptime_t endtime)
 {
   MSTraceSeg *seg = 0;
   int samplesize;
   
-  if ( ! (seg = (MSTraceSeg *) calloc (1, sizeof(MSTraceSeg))) )
+  if ( mstl->pool && mstl->pool->freesegs )
+    {
+      seg = mstl->pool->freesegs;
+      mstl->pool->freesegs = seg->next;
+      memset (seg, 0, sizeof(MSTraceSeg));
+    }
+  else if ( ! (seg = (MSTraceSeg *) mstl_poolalloc (mstl, sizeof(MSTraceSeg))) )
     {
       ms_log (2, "mstl_addmsr(): Error allocating memory\n");
       return 0;
@@ -641,6 +1061,8 @@ mstl_msr2seg (MSRecord *msr, hptime_t endtime)
 	  return 0;
 	}
       
+      seg->datasize = (size_t) (samplesize * msr->numsamples);
+      
       /* Copy data samples from MSRecord to MSTraceSeg */
       memcpy (seg->datasamples, msr->datasamples, (size_t) (samplesize * msr->numsamples));
     }
@@ -665,7 +1087,6 @@ MSTraceSeg *
 mstl_addmsrtoseg (MSTraceSeg *seg, MSRecord *msr, hptime_t endtime, flag whence)
 {
   int samplesize = 0;
-  void *newdatasamples;
   
   if ( ! seg || ! msr )
     return 0;
@@ -686,13 +1107,11 @@ mstl_addmsrtoseg (MSTraceSeg *seg, MSRecord *msr, hptime_t endtime, flag whence)
 	  return 0;
 	}
       
-      if ( ! (newdatasamples = realloc (seg->datasamples, (size_t)((seg->numsamples + msr->numsamples) * samplesize))) )
+      if ( mstl_growsamples (seg, (size_t)((seg->numsamples + msr->numsamples) * samplesize)) )
 	{
 	  ms_log (2, "mstl_addmsrtoseg(): Error allocating memory\n");
 	  return 0;
 	}
-      
-      seg->datasamples = newdatasamples;
     }
   
   /* Add coverage to end of segment */
@@ -750,7 +1169,6 @@ MSTraceSeg *
 mstl_addsegtoseg (MSTraceSeg *seg1, MSTraceSeg *seg2)
 {
   int samplesize = 0;
-  void *newdatasamples;
   
   if ( ! seg1 || ! seg2 )
     return 0;
@@ -771,13 +1189,11 @@ mstl_addsegtoseg (MSTraceSeg *seg1, MSTraceSeg *seg2)
 	  return 0;
 	}
       
-      if ( ! (newdatasamples = realloc (seg1->datasamples, (size_t) ((seg1->numsamples + seg2->numsamples) * samplesize))) )
+      if ( mstl_growsamples (seg1, (size_t) ((seg1->numsamples + seg2->numsamples) * samplesize)) )
 	{
 	  ms_log (2, "mstl_addsegtoseg(): Error allocating memory\n");
 	  return 0;
 	}
-      
-      seg1->datasamples = newdatasamples;
     }
   
   /* Add seg2 coverage to end of seg1 */
@@ -879,6 +1295,8 @@ mstl_convertsamples ( MSTraceSeg *seg, char type, flag truncate )
 	      ms_log (2, "mstl_convertsamples: cannot re-allocate buffer for sample conversion\n");
 	      return -1;
 	    }
+	  
+	  seg->datasize = seg->numsamples * sizeof(int32_t);
 	}
       
       seg->sampletype = 'i';
@@ -903,6 +1321,8 @@ mstl_convertsamples ( MSTraceSeg *seg, char type, flag truncate )
 	      ms_log (2, "mstl_convertsamples: cannot re-allocate buffer after sample conversion\n");
 	      return -1;
 	    }
+	  
+	  seg->datasize = seg->numsamples * sizeof(float);
 	}
           
       seg->sampletype = 'f';
@@ -933,6 +1353,7 @@ mstl_convertsamples ( MSTraceSeg *seg, char type, flag truncate )
 	}
       
       seg->datasamples = ddata;
+      seg->datasize = seg->numsamples * sizeof(double);
       seg->sampletype = 'd';
     }  /* Done converting to 64-bit doubles */
   
@@ -5,7 +5,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center
  *
- * modified: 2013.273
+ * modified: 2026.292
  ***************************************************************************/
 
 #include <stdio.h>
@@ -16,6 +16,38 @@
 #include "libmseed.h"
 
 static int mst_groupsort_cmp ( MSTrace *mst1, MSTrace *mst2, flag quality );
+static int mst_isadjacent ( MSTrace *mst, flag *whence, char dataquality,
+			    char *network, char *station, char *location, char *channel,
+			    double samprate, double sampratetol,
+			    hptime_t starttime, hptime_t endtime, double timetol,
+			    hptime_t hpdelta, hptime_t hptimetol, hptime_t nhptimetol );
+static struct MSTraceIndex_s *mst_checkindex ( MSTraceGroup *mstg );
+static int mst_indextrace ( MSTraceGroup *mstg, MSTrace *mst );
+static uint32_t mst_hashnslc ( char *network, char *station, char *location, char *channel );
+static void mst_freeindex ( MSTraceGroup *mstg );
+
+/* Index entry for a MSTrace, entries in a bucket are in chain order */
+struct MSTraceIndexEntry_s {
+  MSTrace *mst;
+  uint32_t hash;
+  struct MSTraceIndexEntry_s *next;
+};
+
+/* Hash index of the MSTraces in a MSTraceGroup by network, station,
+ * location and channel.  The head, tail and count are used to detect
+ * a trace chain modified outside of the index, in which case the
+ * index is rebuilt. */
+struct MSTraceIndex_s {
+  int32_t size;                         /* Number of buckets, a power of 2 */
+  int32_t count;                        /* Number of MSTraces indexed */
+  MSTrace *head;                        /* First MSTrace in the indexed chain */
+  MSTrace *tail;                        /* Last MSTrace in the indexed chain */
+  struct MSTraceIndexEntry_s **buckets; /* Bucket entry lists */
+  struct MSTraceIndexEntry_s **lasts;   /* Last entry in each bucket */
+};
+
+/* Initial number of index buckets, the index doubles when full */
+#define MST_INDEXSIZE 64
 
 
 /***************************************************************************
@@ -113,6 +145,8 @@ mst_initgroup ( MSTraceGroup *mstg )
 	  mst_free (&mst);
 	  mst = next;
 	}
+      
+      mst_freeindex (mstg);
     }
   else
     {
@@ -154,6 +188,8 @@ mst_freegroup ( MSTraceGroup **ppmstg )
 	  mst = next;
 	}
       
+      mst_freeindex (*ppmstg);
+      
       free (*ppmstg);
       
       *ppmstg = 0;
@@ -278,12 +314,12 @@ mst_findadjacent ( MSTraceGroup *mstg, flag *whence, char dataquality,
 		   hptime_t starttime, hptime_t endtime, double timetol )
 {
   MSTrace *mst = 0;
-  hptime_t pregap;
-  hptime_t postgap;
   hptime_t hpdelta;
   hptime_t hptimetol = 0;
   hptime_t nhptimetol = 0;
-  int idx;
+  struct MSTraceIndex_s *index;
+  struct MSTraceIndexEntry_s *entry;
+  uint32_t hash;
   
   if ( ! mstg )
     return 0;
@@ -301,130 +337,164 @@ mst_findadjacent ( MSTraceGroup *mstg, flag *whence, char dataquality,
   
   nhptimetol = ( hptimetol ) ? -hptimetol : 0;
   
-  mst = mstg->traces;
-  
-  while ( mst )
+  /* Search only the MSTraces with matching identifiers if indexed */
+  if ( (index = mst_checkindex (mstg)) )
     {
-      /* post/pregap are negative when the record overlaps the trace
-       * segment and positive when there is a time gap. */
-      postgap = starttime - mst->endtime - hpdelta;
+      hash = mst_hashnslc (network, station, location, channel);
+      entry = index->buckets[hash & (index->size - 1)];
       
-      pregap = mst->starttime - endtime - hpdelta;
-      
-      /* If not checking the time tolerance decide if beginning or end is a better fit */
-      if ( timetol == -2.0 )
-	{
-	  if ( ms_dabs((double)postgap) < ms_dabs((double)pregap) )
-	    *whence = 1;
-	  else
-	    *whence = 2;
-	}
-      else
+      for ( ; entry; entry = entry->next )
 	{
-	  if ( postgap <= hptimetol && postgap >= nhptimetol )
-	    {
-              /* Span fits right at the end of the trace */
-	      *whence = 1;
-	    }
-	  else if ( pregap <= hptimetol && pregap >= nhptimetol )
-	    {
-              /* Span fits right at the beginning of the trace */
-	      *whence = 2;
-	    }
-          else
-            {
-	      /* Span does not fit with this Trace */
-	      mst = mst->next;
-	      continue;
-            }
+	  if ( entry->hash == hash &&
+	       mst_isadjacent (entry->mst, whence, dataquality,
+			       network, station, location, channel,
+			       samprate, sampratetol, starttime, endtime, timetol,
+			       hpdelta, hptimetol, nhptimetol) )
+	    return entry->mst;
 	}
       
-      /* Perform samprate tolerance check if requested */
-      if ( sampratetol != -2.0 )
-	{ 
-	  /* Perform default samprate tolerance check if requested */
-	  if ( sampratetol == -1.0 )
-	    {
-	      if ( ! MS_ISRATETOLERABLE (samprate, mst->samprate) )
-		{
-		  mst = mst->next;
-		  continue;
-		}
-	    }
-	  /* Otherwise check against the specified sample rate tolerance */
-	  else if ( ms_dabs(samprate - mst->samprate) > sampratetol )
-	    {
-	      mst = mst->next;
-	      continue;
-	    }
-	}
+      return 0;
+    }
+  
+  mst = mstg->traces;
+  
+  while ( mst )
+    {
+      if ( mst_isadjacent (mst, whence, dataquality,
+			   network, station, location, channel,
+			   samprate, sampratetol, starttime, endtime, timetol,
+			   hpdelta, hptimetol, nhptimetol) )
+	break;
+      
+      mst = mst->next;
+    }
+ 
+  return mst;
+} /* End of mst_findadjacent() */
 
-       /* Compare data qualities */
-       if ( dataquality && dataquality != mst->dataquality )
-	{
-	  mst = mst->next;
-	  continue;
-	}
 
-      /* Compare network */
-      idx = 0;
-      while ( network[idx] == mst->network[idx] )
-	{
-	  if ( network[idx] == '\0' )
-	    break;
-	  idx++;
-	}
-      if ( network[idx] != '\0' || mst->network[idx] != '\0' )
-	{
-	  mst = mst->next;
-	  continue;
-	}
-      /* Compare station */
-      idx = 0;
-      while ( station[idx] == mst->station[idx] )
-	{
-	  if ( station[idx] == '\0' )
-	    break;
-	  idx++;
-	}
-      if ( station[idx] != '\0' || mst->station[idx] != '\0' )
+/***************************************************************************
+ * mst_isadjacent:
+ *
+ * Test if a MSTrace matches the given identifiers, sample rate and is
+ * time adjacent to the given time span, see mst_findadjacent() for
+ * details.  The high-precision sample period and time tolerances are
+ * calculated by the caller.
+ *
+ * Return 1 and set the 'whence' flag if the MSTrace matches,
+ * otherwise 0.
+ ***************************************************************************/
+static int
+mst_isadjacent ( MSTrace *mst, flag *whence, char dataquality,
+		 char *network, char *station, char *location, char *channel,
+		 double samprate, double sampratetol,
+		 hptime_t starttime, hptime_t endtime, double timetol,
+		 hptime_t hpdelta, hptime_t hptimetol, hptime_t nhptimetol )
+{
+  hptime_t pregap;
+  hptime_t postgap;
+  int idx;
+  
+  /* post/pregap are negative when the record overlaps the trace
+   * segment and positive when there is a time gap. */
+  postgap = starttime - mst->endtime - hpdelta;
+  
+  pregap = mst->starttime - endtime - hpdelta;
+  
+  /* If not checking the time tolerance decide if beginning or end is a better fit */
+  if ( timetol == -2.0 )
+    {
+      if ( ms_dabs((double)postgap) < ms_dabs((double)pregap) )
+	*whence = 1;
+      else
+	*whence = 2;
+    }
+  else
+    {
+      if ( postgap <= hptimetol && postgap >= nhptimetol )
 	{
-	  mst = mst->next;
-	  continue;
+	  /* Span fits right at the end of the trace */
+	  *whence = 1;
 	}
-      /* Compare location */
-      idx = 0;
-      while ( location[idx] == mst->location[idx] )
+      else if ( pregap <= hptimetol && pregap >= nhptimetol )
 	{
-	  if ( location[idx] == '\0' )
-	    break;
-	  idx++;
+	  /* Span fits right at the beginning of the trace */
+	  *whence = 2;
 	}
-      if ( location[idx] != '\0' || mst->location[idx] != '\0' )
+      else
 	{
-	  mst = mst->next;
-	  continue;
+	  /* Span does not fit with this Trace */
+	  return 0;
 	}
-      /* Compare channel */
-      idx = 0;
-      while ( channel[idx] == mst->channel[idx] )
+    }
+  
+  /* Perform samprate tolerance check if requested */
+  if ( sampratetol != -2.0 )
+    { 
+      /* Perform default samprate tolerance check if requested */
+      if ( sampratetol == -1.0 )
 	{
-	  if ( channel[idx] == '\0' )
-	    break;
-	  idx++;
+	  if ( ! MS_ISRATETOLERABLE (samprate, mst->samprate) )
+	    return 0;
 	}
-      if ( channel[idx] != '\0' || mst->channel[idx] != '\0' )
+      /* Otherwise check against the specified sample rate tolerance */
+      else if ( ms_dabs(samprate - mst->samprate) > sampratetol )
 	{
-	  mst = mst->next;
-	  continue;
+	  return 0;
 	}
-      
-      /* A match was found if we made it this far */
-      break;
     }
- 
-  return mst;
-} /* End of mst_findadjacent() */
+  
+  /* Compare data qualities */
+  if ( dataquality && dataquality != mst->dataquality )
+    return 0;
+  
+  /* Compare network */
+  idx = 0;
+  while ( network[idx] == mst->network[idx] )
+    {
+      if ( network[idx] == '\0' )
+	break;
+      idx++;
+    }
+  if ( network[idx] != '\0' || mst->network[idx] != '\0' )
+    return 0;
+  
+  /* Compare station */
+  idx = 0;
+  while ( station[idx] == mst->station[idx] )
+    {
+      if ( station[idx] == '\0' )
+	break;
+      idx++;
+    }
+  if ( station[idx] != '\0' || mst->station[idx] != '\0' )
+    return 0;
+  
+  /* Compare location */
+  idx = 0;
+  while ( location[idx] == mst->location[idx] )
+    {
+      if ( location[idx] == '\0' )
+	break;
+      idx++;
+    }
+  if ( location[idx] != '\0' || mst->location[idx] != '\0' )
+    return 0;
+  
+  /* Compare channel */
+  idx = 0;
+  while ( channel[idx] == mst->channel[idx] )
+    {
+      if ( channel[idx] == '\0' )
+	break;
+      idx++;
+    }
+  if ( channel[idx] != '\0' || mst->channel[idx] != '\0' )
+    return 0;
+  
+  /* A match was found if we made it this far */
+  return 1;
+} /* End of mst_isadjacent() */
 
 
 /***************************************************************************
@@ -708,21 +778,7 @@ mst_addmsrtogroup ( MSTraceGroup *mstg, MSRecord *msr, flag dataquality,
 	}
       
       /* Link new MSTrace into the end of the chain */
-      if ( ! mstg->traces )
-	{
-	  mstg->traces = mst;
-	}
-      else
-	{
-	  MSTrace *lasttrace = mstg->traces;
-	  
-	  while ( lasttrace->next )
-	    lasttrace = lasttrace->next;
-	  
-	  lasttrace->next = mst;
-	}
-      
-      mstg->numtraces++;
+      mst_addtracetogroup (mstg, mst);
     }
   
   return mst;
@@ -741,6 +797,8 @@ mst_addtracetogroup ( MSTraceGroup *mstg, MSTrace *mst )
 {
   MSTrace *lasttrace;
 
+  struct MSTraceIndex_s *index;
+  
   if ( ! mstg || ! mst )
     return 0;
   
@@ -750,7 +808,11 @@ mst_addtracetogroup ( MSTraceGroup *mstg, MSTrace *mst )
     }
   else
     {
-      lasttrace = mstg->traces;
+      /* Use the tail of the indexed chain if available */
+      if ( (index = mst_checkindex (mstg)) )
+	lasttrace = index->tail;
+      else
+	lasttrace = mstg->traces;
       
       while ( lasttrace->next )
 	lasttrace = lasttrace->next;
@@ -762,6 +824,8 @@ mst_addtracetogroup ( MSTraceGroup *mstg, MSTrace *mst )
   
   mstg->numtraces++;
   
+  mst_indextrace (mstg, mst);
+  
   return mst;
 } /* End of mst_addtracetogroup() */
 
@@ -1021,6 +1085,9 @@ mst_groupsort ( MSTraceGroup *mstg, flag quality )
         {
           mstg->traces = top;
           
+          /* Chain order changed, the index must be rebuilt */
+          mst_freeindex (mstg);
+          
 	  return 0;
         }
       
@@ -1030,6 +1097,216 @@ mst_groupsort ( MSTraceGroup *mstg, flag quality )
 } /* End of mst_groupsort() */
 
 
+/***************************************************************************
+ * mst_hashnslc:
+ *
+ * Return a FNV-1a hash of network, station, location and channel
+ * identifiers.
+ ***************************************************************************/
+static uint32_t
+mst_hashnslc ( char *network, char *station, char *location, char *channel )
+{
+  char *ids[4];
+  uint32_t hash = MS_FNV32_INIT;
+  int idx;
+  
+  ids[0] = network;
+  ids[1] = station;
+  ids[2] = location;
+  ids[3] = channel;
+  
+  for ( idx = 0; idx < 4; idx++ )
+    {
+      hash = ms_fnv1a32 (hash, ids[idx], strlen (ids[idx]));
+      
+      /* Separate identifiers */
+      hash = ms_fnv1a32 (hash, ".", 1);
+    }
+  
+  return hash;
+} /* End of mst_hashnslc() */
+
+
+/***************************************************************************
+ * mst_freeindex:
+ *
+ * Free the MSTrace index of a MSTraceGroup.
+ ***************************************************************************/
+static void
+mst_freeindex ( MSTraceGroup *mstg )
+{
+  struct MSTraceIndex_s *index = mstg->index;
+  struct MSTraceIndexEntry_s *entry;
+  struct MSTraceIndexEntry_s *next;
+  int idx;
+  
+  if ( ! index )
+    return;
+  
+  for ( idx = 0; idx < index->size; idx++ )
+    {
+      for ( entry = index->buckets[idx]; entry; entry = next )
+	{
+	  next = entry->next;
+	  free (entry);
+	}
+    }
+  
+  free (index->buckets);
+  free (index->lasts);
+  free (index);
+  
+  mstg->index = NULL;
+} /* End of mst_freeindex() */
+
+
+/***************************************************************************
+ * mst_addindexentry:
+ *
+ * Add a MSTrace to the end of its bucket in a MSTrace index.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mst_addindexentry ( struct MSTraceIndex_s *index, MSTrace *mst )
+{
+  struct MSTraceIndexEntry_s *entry;
+  uint32_t bucket;
+  
+  if ( ! (entry = (struct MSTraceIndexEntry_s *) malloc (sizeof(struct MSTraceIndexEntry_s))) )
+    {
+      ms_log (2, "mst_addindexentry(): Cannot allocate memory\n");
+      return -1;
+    }
+  
+  entry->mst = mst;
+  entry->hash = mst_hashnslc (mst->network, mst->station, mst->location, mst->channel);
+  entry->next = NULL;
+  
+  bucket = entry->hash & (index->size - 1);
+  
+  if ( index->lasts[bucket] )
+    index->lasts[bucket]->next = entry;
+  else
+    index->buckets[bucket] = entry;
+  
+  index->lasts[bucket] = entry;
+  
+  if ( ! index->head )
+    index->head = mst;
+  
+  index->tail = mst;
+  index->count++;
+  
+  return 0;
+} /* End of mst_addindexentry() */
+
+
+/***************************************************************************
+ * mst_buildindex:
+ *
+ * (Re)build the MSTrace index of a MSTraceGroup from the trace chain.
+ *
+ * Return 0 on success and -1 on error, on error the index is removed
+ * and searches fall back to traversing the trace chain.
+ ***************************************************************************/
+static int
+mst_buildindex ( MSTraceGroup *mstg )
+{
+  struct MSTraceIndex_s *index;
+  MSTrace *mst;
+  int32_t size = MST_INDEXSIZE;
+  
+  mst_freeindex (mstg);
+  
+  while ( mstg->numtraces > size )
+    size *= 2;
+  
+  if ( ! (index = (struct MSTraceIndex_s *) calloc (1, sizeof(struct MSTraceIndex_s))) )
+    {
+      ms_log (2, "mst_buildindex(): Cannot allocate memory\n");
+      return -1;
+    }
+  
+  index->size = size;
+  mstg->index = index;
+  
+  index->buckets = (struct MSTraceIndexEntry_s **) calloc (size, sizeof(struct MSTraceIndexEntry_s *));
+  index->lasts = (struct MSTraceIndexEntry_s **) calloc (size, sizeof(struct MSTraceIndexEntry_s *));
+  
+  if ( ! index->buckets || ! index->lasts )
+    {
+      ms_log (2, "mst_buildindex(): Cannot allocate memory\n");
+      mst_freeindex (mstg);
+      return -1;
+    }
+  
+  for ( mst = mstg->traces; mst; mst = mst->next )
+    {
+      if ( mst_addindexentry (index, mst) )
+	{
+	  mst_freeindex (mstg);
+	  return -1;
+	}
+    }
+  
+  return 0;
+} /* End of mst_buildindex() */
+
+
+/***************************************************************************
+ * mst_checkindex:
+ *
+ * Check that the MSTrace index of a MSTraceGroup matches the trace
+ * chain and (re)build it if needed.
+ *
+ * Return a pointer to the index or NULL if it could not be built.
+ ***************************************************************************/
+static struct MSTraceIndex_s *
+mst_checkindex ( MSTraceGroup *mstg )
+{
+  struct MSTraceIndex_s *index = mstg->index;
+  
+  if ( index && index->count == mstg->numtraces && index->head == mstg->traces &&
+       ( ! index->tail || ! index->tail->next ) )
+    return index;
+  
+  if ( mst_buildindex (mstg) )
+    return NULL;
+  
+  return mstg->index;
+} /* End of mst_checkindex() */
+
+
+/***************************************************************************
+ * mst_indextrace:
+ *
+ * Add a MSTrace just appended to the trace chain of a MSTraceGroup to
+ * the MSTrace index, the index is rebuilt when it is out of sync with
+ * the chain or the number of traces exceeds the number of buckets.
+ *
+ * Return 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mst_indextrace ( MSTraceGroup *mstg, MSTrace *mst )
+{
+  struct MSTraceIndex_s *index = mstg->index;
+  
+  if ( ! index || (index->count + 1) != mstg->numtraces ||
+       index->head != mstg->traces || index->tail->next != mst ||
+       mstg->numtraces > index->size )
+    return mst_buildindex (mstg);
+  
+  if ( mst_addindexentry (index, mst) )
+    {
+      mst_freeindex (mstg);
+      return -1;
+    }
+  
+  return 0;
+} /* End of mst_indextrace() */
+
+
 /***************************************************************************
  * mst_groupsort_cmp:
  *
@@ -40,6 +40,10 @@ int unpackencodingfallback = -2;
 /* A pointer to the srcname of the record being unpacked */
 char *UNPACK_SRCNAME = NULL;
 
+/* Number of samples for which Steim difference values are decoded
+ * into a buffer on the stack instead of an allocated buffer */
+#define MSR_DIFFSTACK 8192
+
 
 /***************************************************************************
  * msr_unpack:
@@ -739,6 +743,7 @@ msr_unpack_data ( MSRecord *msr, int swapflag, flag verbose )
   int     samplesize = 0;       /* size of the data samples in bytes    */
   const char *dbuf;
   int32_t    *diffbuff;
+  int32_t     diffstack[MSR_DIFFSTACK];
   int32_t     x0, xn;
   
   /* Sanity record length */
@@ -869,7 +874,11 @@ msr_unpack_data ( MSRecord *msr, int swapflag, flag verbose )
       break;
       
     case DE_STEIM1:
-      diffbuff = (int32_t *) malloc(unpacksize);
+      if ( msr->samplecnt <= MSR_DIFFSTACK )
+	diffbuff = diffstack;
+      else
+	diffbuff = (int32_t *) malloc(unpacksize);
+      
       if ( diffbuff == NULL )
 	{
 	  ms_log (2, "msr_unpack_data(%s): Cannot allocate diff buffer\n",
@@ -884,11 +893,16 @@ msr_unpack_data ( MSRecord *msr, int swapflag, flag verbose )
 				    (int)msr->samplecnt, msr->datasamples, diffbuff, 
 				    &x0, &xn, swapflag, verbose);
       msr->sampletype = 'i';
-      free (diffbuff);
+      if ( diffbuff != diffstack )
+	free (diffbuff);
       break;
       
     case DE_STEIM2:
-      diffbuff = (int32_t *) malloc(unpacksize);
+      if ( msr->samplecnt <= MSR_DIFFSTACK )
+	diffbuff = diffstack;
+      else
+	diffbuff = (int32_t *) malloc(unpacksize);
+      
       if ( diffbuff == NULL )
 	{
 	  ms_log (2, "msr_unpack_data(%s): Cannot allocate diff buffer\n",
@@ -903,7 +917,8 @@ msr_unpack_data ( MSRecord *msr, int swapflag, flag verbose )
 				    (int)msr->samplecnt, msr->datasamples, diffbuff,
 				    &x0, &xn, swapflag, verbose);
       msr->sampletype = 'i';
-      free (diffbuff);
+      if ( diffbuff != diffstack )
+	free (diffbuff);
       break;
       
     case DE_GEOSCOPE24:
@@ -0,0 +1,375 @@
+/***************************************************************************
+ * arclink.c
+ *
+ * Line oriented connections for the Arclink request protocol.
+ *
+ * Protocol lines are terminated with CR LF, received lines are
+ * accepted with or without the CR.  Binary payloads (downloaded
+ * volumes) are read through the same receive buffer as the lines.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "arclink.h"
+
+
+/***************************************************************************
+ * settimeout:
+ * Set the send and receive timeout of a socket, 0 is no timeout.
+ ***************************************************************************/
+static void
+settimeout (int fd, int timeout)
+{
+  struct timeval tv;
+  
+  tv.tv_sec = timeout;
+  tv.tv_usec = 0;
+  
+  setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt (fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}  /* End of settimeout() */
+
+
+/***************************************************************************
+ * al_connect:
+ * Connect to a server at 'address' given as host[:port], the default
+ * port is AL_DEFAULTPORT.  Socket operations time out after 'timeout'
+ * seconds, 0 is no timeout.
+ *
+ * Returns 0 on success and -1 on failure (errno is set).
+ ***************************************************************************/
+int
+al_connect (ALConn *conn, const char *address, int timeout)
+{
+  struct addrinfo hints;
+  struct addrinfo *addrs = 0;
+  struct addrinfo *ai;
+  char host[256];
+  const char *port = AL_DEFAULTPORT;
+  char *colon;
+  int fd = -1;
+  int one = 1;
+  
+  strncpy (host, address, sizeof(host) - 1);
+  host[sizeof(host) - 1] = '\0';
+  
+  if ( (colon = strrchr (host, ':')) )
+    {
+      *colon = '\0';
+      port = colon + 1;
+    }
+  
+  memset (&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  
+  if ( getaddrinfo ((*host) ? host : "localhost", port, &hints, &addrs) )
+    {
+      errno = EHOSTUNREACH;
+      return -1;
+    }
+  
+  for ( ai = addrs; ai; ai = ai->ai_next )
+    {
+      if ( (fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0 )
+	continue;
+      
+      settimeout (fd, timeout);
+      
+      if ( connect (fd, ai->ai_addr, ai->ai_addrlen) == 0 )
+	break;
+      
+      close (fd);
+      fd = -1;
+    }
+  
+  freeaddrinfo (addrs);
+  
+  if ( fd < 0 )
+    return -1;
+  
+  /* Requests are short lines answered by the server, do not delay them */
+  setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  
+  conn->fd = fd;
+  conn->head = conn->tail = 0;
+  
+  return 0;
+}  /* End of al_connect() */
+
+
+/***************************************************************************
+ * al_attach:
+ * Initialize a connection for an accepted socket.
+ ***************************************************************************/
+void
+al_attach (ALConn *conn, int fd, int timeout)
+{
+  int one = 1;
+  
+  settimeout (fd, timeout);
+  setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  
+  conn->fd = fd;
+  conn->head = conn->tail = 0;
+}  /* End of al_attach() */
+
+
+/***************************************************************************
+ * al_close:
+ * Close the socket of a connection.
+ ***************************************************************************/
+void
+al_close (ALConn *conn)
+{
+  if ( conn->fd >= 0 )
+    close (conn->fd);
+  
+  conn->fd = -1;
+  conn->head = conn->tail = 0;
+}  /* End of al_close() */
+
+
+/***************************************************************************
+ * fillbuffer:
+ * Receive more bytes into the buffer of a connection.
+ *
+ * Returns the number of bytes received, 0 at end of stream and -1 on
+ * error.
+ ***************************************************************************/
+static int
+fillbuffer (ALConn *conn)
+{
+  ssize_t nrecv;
+  
+  if ( conn->head == conn->tail )
+    conn->head = conn->tail = 0;
+  
+  if ( conn->head > 0 && conn->tail == AL_BUFSIZE )
+    {
+      memmove (conn->buf, conn->buf + conn->head, conn->tail - conn->head);
+      conn->tail -= conn->head;
+      conn->head = 0;
+    }
+  
+  do
+    nrecv = recv (conn->fd, conn->buf + conn->tail, AL_BUFSIZE - conn->tail, 0);
+  while ( nrecv < 0 && errno == EINTR );
+  
+  if ( nrecv > 0 )
+    conn->tail += nrecv;
+  
+  return (int) nrecv;
+}  /* End of fillbuffer() */
+
+
+/***************************************************************************
+ * al_readline:
+ * Read a line from a connection into 'line' without the terminating
+ * CR LF.  Lines longer than 'size' - 1 are truncated.
+ *
+ * Returns the length of the line, or -1 on error or end of stream.
+ ***************************************************************************/
+int
+al_readline (ALConn *conn, char *line, int size)
+{
+  char *nl;
+  int length = 0;
+  int count;
+  
+  for (;;)
+    {
+      nl = memchr (conn->buf + conn->head, '\n', conn->tail - conn->head);
+      count = (nl) ? (int)(nl - (conn->buf + conn->head)) : conn->tail - conn->head;
+      
+      if ( length + count > size - 1 )
+	count = size - 1 - length;
+      
+      memcpy (line + length, conn->buf + conn->head, count);
+      length += count;
+      
+      if ( nl )
+	{
+	  conn->head = (int)(nl - conn->buf) + 1;
+	  break;
+	}
+      
+      conn->head += count;
+      
+      if ( fillbuffer (conn) <= 0 )
+	return -1;
+    }
+  
+  if ( length > 0 && line[length - 1] == '\r' )
+    length--;
+  
+  line[length] = '\0';
+  
+  return length;
+}  /* End of al_readline() */
+
+
+/***************************************************************************
+ * al_readn:
+ * Read exactly 'count' bytes from a connection.
+ *
+ * Returns 0 on success and -1 on error or end of stream.
+ ***************************************************************************/
+int
+al_readn (ALConn *conn, char *dest, size_t count)
+{
+  size_t avail;
+  ssize_t nrecv;
+  
+  /* Bytes already buffered */
+  avail = conn->tail - conn->head;
+  if ( avail > count )
+    avail = count;
+  
+  memcpy (dest, conn->buf + conn->head, avail);
+  conn->head += avail;
+  dest += avail;
+  count -= avail;
+  
+  /* Receive the remainder directly into the destination */
+  while ( count > 0 )
+    {
+      nrecv = recv (conn->fd, dest, count, 0);
+      
+      if ( nrecv < 0 && errno == EINTR )
+	continue;
+      if ( nrecv <= 0 )
+	return -1;
+      
+      dest += nrecv;
+      count -= nrecv;
+    }
+  
+  return 0;
+}  /* End of al_readn() */
+
+
+/***************************************************************************
+ * al_writen:
+ * Write 'count' bytes to a connection.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+al_writen (ALConn *conn, const char *src, size_t count)
+{
+  ssize_t nsent;
+  
+  while ( count > 0 )
+    {
+      nsent = send (conn->fd, src, count, MSG_NOSIGNAL);
+      
+      if ( nsent < 0 && errno == EINTR )
+	continue;
+      if ( nsent <= 0 )
+	return -1;
+      
+      src += nsent;
+      count -= nsent;
+    }
+  
+  return 0;
+}  /* End of al_writen() */
+
+
+/***************************************************************************
+ * al_writeline:
+ * Write a formatted line to a connection, CR LF is appended.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+al_writeline (ALConn *conn, const char *format, ...)
+{
+  char line[AL_LINELEN + 2];
+  va_list args;
+  int length;
+  
+  va_start (args, format);
+  length = vsnprintf (line, AL_LINELEN, format, args);
+  va_end (args);
+  
+  if ( length < 0 )
+    return -1;
+  if ( length > AL_LINELEN - 1 )
+    length = AL_LINELEN - 1;
+  
+  line[length++] = '\r';
+  line[length++] = '\n';
+  
+  return al_writen (conn, line, length);
+}  /* End of al_writeline() */
+
+
+/***************************************************************************
+ * al_formattime:
+ * Format a time as used in request lines: YYYY,MM,DD,HH,MM,SS.  Request
+ * times are whole seconds, if 'roundup' is true fractional seconds are
+ * rounded up instead of truncated.
+ *
+ * Returns a pointer to 'timestr' which must hold at least 32 bytes.
+ ***************************************************************************/
+char *
+al_formattime (hptime_t time, char *timestr, int roundup)
+{
+  BTime btime;
+  int month = 0;
+  int mday = 0;
+  hptime_t fraction;
+  
+  fraction = time % HPTMODULUS;
+  if ( fraction < 0 )
+    fraction += HPTMODULUS;
+  
+  time -= fraction;
+  if ( roundup && fraction > 0 )
+    time += HPTMODULUS;
+  
+  ms_hptime2btime (time, &btime);
+  ms_doy2md (btime.year, btime.day, &month, &mday);
+  
+  snprintf (timestr, 32, "%04d,%02d,%02d,%02d,%02d,%02d",
+	    btime.year, month, mday, btime.hour, btime.min, btime.sec);
+  
+  return timestr;
+}  /* End of al_formattime() */
+
+
+/***************************************************************************
+ * al_parsetime:
+ * Parse a request line time: YYYY,MM,DD[,HH[,MM[,SS]]].
+ *
+ * Returns the time or HPTERROR on error.
+ ***************************************************************************/
+hptime_t
+al_parsetime (const char *timestr)
+{
+  int year, month, mday;
+  int hour = 0, min = 0, sec = 0;
+  int jday;
+  
+  if ( sscanf (timestr, "%d,%d,%d,%d,%d,%d", &year, &month, &mday, &hour, &min, &sec) < 3 )
+    return HPTERROR;
+  
+  if ( ms_md2doy (year, month, mday, &jday) )
+    return HPTERROR;
+  
+  return ms_time2hptime (year, jday, hour, min, sec, 0);
+}  /* End of al_parsetime() */
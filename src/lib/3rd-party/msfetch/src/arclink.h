@@ -0,0 +1,47 @@
+/***************************************************************************
+ * arclink.h
+ *
+ * Line oriented connections for the Arclink request protocol, shared by
+ * the msfetch client and the msfetchd test server.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef ARCLINK_H
+#define ARCLINK_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+#include <libmseed.h>
+
+#define AL_DEFAULTPORT "18001"
+#define AL_LINELEN     1024    /* Longest protocol line */
+#define AL_BUFSIZE     65536   /* Receive buffer of a connection */
+
+/* A protocol connection with a receive buffer */
+typedef struct ALConn_s {
+  int    fd;
+  int    head;                 /* Next unread byte of buf */
+  int    tail;                 /* End of received bytes in buf */
+  char   buf[AL_BUFSIZE];
+}
+ALConn;
+
+extern int      al_connect (ALConn *conn, const char *address, int timeout);
+extern void     al_attach (ALConn *conn, int fd, int timeout);
+extern void     al_close (ALConn *conn);
+extern int      al_readline (ALConn *conn, char *line, int size);
+extern int      al_readn (ALConn *conn, char *dest, size_t count);
+extern int      al_writen (ALConn *conn, const char *src, size_t count);
+extern int      al_writeline (ALConn *conn, const char *format, ...);
+extern char    *al_formattime (hptime_t time, char *timestr, int roundup);
+extern hptime_t al_parsetime (const char *timestr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARCLINK_H */
@@ -0,0 +1,554 @@
+/***************************************************************************
+ * chunkcache.c
+ *
+ * A local cache of fetched waveforms stored as content addressed
+ * chunks.
+ *
+ * Fetched records are split by stream (NET.STA.LOC.CHA) and fixed
+ * duration time bucket, a record overlapping two buckets is in the
+ * chunks of both.  Each chunk is stored once under the hash of its
+ * content, so that the same data requested with different channel
+ * selections or by different jobs shares a single file:
+ *
+ *   <cache>/chunks/<xx>/<hash>-<size>.mseed
+ *
+ * The chunks of a station and bucket for a request selection (server,
+ * channels and location) are listed in a small index file, an empty
+ * index file records that the server has no data for the bucket:
+ *
+ *   <cache>/index/<NET>.<STA>/<selection key>/<bucket start>
+ *
+ *   NET.STA.LOC.CHA records chunk firststart laststart firstend
+ *
+ * The times (high precision epoch times) are the earliest and latest
+ * record start and the earliest record end, they tell if a chunk is
+ * within a time window without reading it.  Index files written
+ * without them are still read, the times are then unknown.
+ *
+ * Chunk modification times are updated on use and the least recently
+ * used chunks are removed when the cache grows over its size limit.
+ * An index file listing a removed chunk is a cache miss.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "chunkcache.h"
+
+/* Records of a stream and bucket collected from a fetched volume */
+typedef struct Piece_s {
+  char     stream[50];
+  hptime_t bucket;
+  char    *buffer;
+  size_t   length;
+  size_t   size;
+  long     records;
+  hptime_t firststart;
+  hptime_t laststart;
+  hptime_t firstend;
+  char     name[CC_NAMELEN];
+}
+Piece;
+
+/* A chunk file found when evicting */
+typedef struct ChunkFile_s {
+  char  *path;
+  off_t  size;
+  time_t mtime;
+}
+ChunkFile;
+
+static char     cachedir[1024];
+static char     selkey[17];
+static hptime_t bucketlen = 0;
+
+static ChunkFile *evictfiles = 0;
+static long       evictcount = 0;
+static long long  evictbytes = 0;
+
+static int  mkpath (char *path);
+static int  writefile (const char *path, const char *data, size_t length);
+static int  collectchunk (const char *path, const struct stat *sb, int type, struct FTW *ftwbuf);
+static int  cmpchunkfile (const void *a, const void *b);
+
+
+/***************************************************************************
+ * cc_init:
+ * Set the cache directory, the request selection (server, channels,
+ * location) for which chunks are looked up and stored and the bucket
+ * duration in seconds.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+cc_init (const char *directory, const char *selection, int bucketsecs)
+{
+  char key[1024];
+  uint64_t hash;
+
+  if ( bucketsecs <= 0 || strlen (directory) > sizeof(cachedir) - 100 )
+    return -1;
+
+  strcpy (cachedir, directory);
+  bucketlen = (hptime_t) bucketsecs * HPTMODULUS;
+
+  /* The bucket duration is part of the key, buckets of different
+   * durations are different chunks */
+  snprintf (key, sizeof(key), "%s|%d", selection, bucketsecs);
+  hash = ms_fnv1a64 (MS_FNV64_INIT, key, strlen (key));
+  snprintf (selkey, sizeof(selkey), "%016llx", (unsigned long long) hash);
+
+  return 0;
+}  /* End of cc_init() */
+
+
+/***************************************************************************
+ * cc_bucket:
+ * Returns the start of the bucket containing a time.
+ ***************************************************************************/
+hptime_t
+cc_bucket (hptime_t time)
+{
+  hptime_t offset = time % bucketlen;
+
+  if ( offset < 0 )
+    offset += bucketlen;
+
+  return time - offset;
+}  /* End of cc_bucket() */
+
+
+/***************************************************************************
+ * cc_bucketlen:
+ * Returns the bucket duration.
+ ***************************************************************************/
+hptime_t
+cc_bucketlen (void)
+{
+  return bucketlen;
+}  /* End of cc_bucketlen() */
+
+
+/***************************************************************************
+ * cc_lookup:
+ * Look up the chunks of a station bucket.  On success '*chunks' is an
+ * allocated array of '*chunkcount' chunks (possibly 0 when the server
+ * has no data) to be freed by the caller.  The chunks are marked as
+ * used.
+ *
+ * Returns 0 when the bucket is cached, 1 when it is not and -1 on
+ * error.
+ ***************************************************************************/
+int
+cc_lookup (const char *network, const char *station, hptime_t bucket,
+	   CacheChunk **chunks, int *chunkcount)
+{
+  CacheChunk chunk;
+  char path[1200];
+  char line[256];
+  long long times[3];
+  FILE *fp;
+  int fields;
+  int rv = 0;
+
+  *chunks = 0;
+  *chunkcount = 0;
+
+  snprintf (path, sizeof(path), "%s/index/%s.%s/%s/%lld", cachedir, network, station,
+	    selkey, (long long) MS_HPTIME2EPOCH (bucket));
+
+  if ( (fp = fopen (path, "r")) == NULL )
+    return ( errno == ENOENT ) ? 1 : -1;
+
+  while ( rv == 0 && fgets (line, sizeof(line), fp) )
+    {
+      fields = sscanf (line, "%49s %ld %39s %lld %lld %lld", chunk.stream, &chunk.records,
+		       chunk.name, &times[0], &times[1], &times[2]);
+
+      if ( fields != 3 && fields != 6 )
+	{
+	  rv = 1;
+	  break;
+	}
+
+      chunk.firststart = ( fields == 6 ) ? (hptime_t) times[0] : HPTERROR;
+      chunk.laststart = ( fields == 6 ) ? (hptime_t) times[1] : HPTERROR;
+      chunk.firstend = ( fields == 6 ) ? (hptime_t) times[2] : HPTERROR;
+
+      /* Mark the chunk as used, a removed chunk is a miss */
+      cc_chunkpath (chunk.name, path, sizeof(path));
+      if ( utimes (path, NULL) )
+	{
+	  rv = 1;
+	  break;
+	}
+
+      if ( (*chunks = (CacheChunk *) realloc (*chunks, sizeof(CacheChunk) * (*chunkcount + 1))) == NULL )
+	{
+	  rv = -1;
+	  break;
+	}
+
+      (*chunks)[(*chunkcount)++] = chunk;
+    }
+
+  fclose (fp);
+
+  if ( rv )
+    {
+      free (*chunks);
+      *chunks = 0;
+      *chunkcount = 0;
+    }
+
+  return rv;
+}  /* End of cc_lookup() */
+
+
+/***************************************************************************
+ * cc_store:
+ * Store the records of a volume fetched for the buckets from 'start'
+ * to 'end' (both bucket boundaries) of a station.  A chunk is written
+ * for every stream and bucket with records and an index file for every
+ * bucket.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+int
+cc_store (const char *network, const char *station, hptime_t start,
+	  hptime_t end, char *volume, size_t volumelen, flag verbose)
+{
+  MSRecord *msr = 0;
+  Piece *pieces = 0;
+  Piece *pp;
+  int piececount = 0;
+  char stream[50];
+  char path[1200];
+  char *index = 0;
+  size_t indexlen;
+  size_t offset = 0;
+  hptime_t recend;
+  hptime_t bucket;
+  uint64_t hash;
+  struct stat st;
+  int idx;
+  int rv = 0;
+
+  /* Split the records by stream and bucket */
+  while ( rv == 0 && offset < volumelen )
+    {
+      if ( msr_parse (volume + offset, (int) (volumelen - offset), &msr, -1, 0, verbose - 1) )
+	{
+	  fprintf (stderr, "%s.%s: cannot parse record at byte %zu, not cached\n",
+		   network, station, offset);
+	  rv = -1;
+	  break;
+	}
+
+      snprintf (stream, sizeof(stream), "%s.%s.%s.%s", msr->network, msr->station,
+		msr->location, msr->channel);
+      recend = msr_endtime (msr);
+
+      bucket = cc_bucket (msr->starttime);
+      if ( bucket < start )
+	bucket = start;
+
+      for ( ; bucket < end && bucket <= recend; bucket += bucketlen )
+	{
+	  for ( idx = 0; idx < piececount; idx++ )
+	    if ( pieces[idx].bucket == bucket && ! strcmp (pieces[idx].stream, stream) )
+	      break;
+
+	  if ( idx == piececount )
+	    {
+	      if ( (pieces = (Piece *) realloc (pieces, sizeof(Piece) * (piececount + 1))) == NULL )
+		{
+		  rv = -1;
+		  break;
+		}
+	      memset (&pieces[idx], 0, sizeof(Piece));
+	      strcpy (pieces[idx].stream, stream);
+	      pieces[idx].bucket = bucket;
+	      piececount++;
+	    }
+
+	  pp = &pieces[idx];
+	  if ( ! pp->records || msr->starttime < pp->firststart )
+	    pp->firststart = msr->starttime;
+	  if ( ! pp->records || msr->starttime > pp->laststart )
+	    pp->laststart = msr->starttime;
+	  if ( ! pp->records || recend < pp->firstend )
+	    pp->firstend = recend;
+
+	  if ( pp->length + msr->reclen > pp->size )
+	    {
+	      pp->size = ( pp->size ) ? pp->size * 2 : 65536;
+	      if ( pp->size < pp->length + msr->reclen )
+		pp->size = pp->length + msr->reclen;
+	      if ( (pp->buffer = (char *) realloc (pp->buffer, pp->size)) == NULL )
+		{
+		  rv = -1;
+		  break;
+		}
+	    }
+
+	  memcpy (pp->buffer + pp->length, msr->record, msr->reclen);
+	  pp->length += msr->reclen;
+	  pp->records++;
+	}
+
+      offset += msr->reclen;
+    }
+
+  msr_free (&msr);
+
+  /* Write the chunks, content already in the cache is only marked used */
+  for ( idx = 0; rv == 0 && idx < piececount; idx++ )
+    {
+      pp = &pieces[idx];
+      hash = ms_fnv1a64 (MS_FNV64_INIT, pp->buffer, pp->length);
+      snprintf (pp->name, CC_NAMELEN, "%016llx-%zu", (unsigned long long) hash, pp->length);
+      cc_chunkpath (pp->name, path, sizeof(path));
+
+      if ( stat (path, &st) == 0 && st.st_size == (off_t) pp->length )
+	utimes (path, NULL);
+      else if ( writefile (path, pp->buffer, pp->length) )
+	rv = -1;
+    }
+
+  /* Write the index of every bucket after its chunks */
+  for ( bucket = start; rv == 0 && bucket < end; bucket += bucketlen )
+    {
+      indexlen = 0;
+
+      for ( idx = 0; idx < piececount; idx++ )
+	{
+	  if ( pieces[idx].bucket != bucket )
+	    continue;
+
+	  if ( (index = (char *) realloc (index, indexlen + 256)) == NULL )
+	    {
+	      rv = -1;
+	      break;
+	    }
+	  indexlen += snprintf (index + indexlen, 256, "%s %ld %s %lld %lld %lld\n",
+				pieces[idx].stream, pieces[idx].records, pieces[idx].name,
+				(long long) pieces[idx].firststart, (long long) pieces[idx].laststart,
+				(long long) pieces[idx].firstend);
+	}
+
+      snprintf (path, sizeof(path), "%s/index/%s.%s/%s/%lld", cachedir, network, station,
+		selkey, (long long) MS_HPTIME2EPOCH (bucket));
+
+      if ( rv == 0 && writefile (path, (index) ? index : "", indexlen) )
+	rv = -1;
+    }
+
+  for ( idx = 0; idx < piececount; idx++ )
+    free (pieces[idx].buffer);
+  free (pieces);
+  free (index);
+
+  return rv;
+}  /* End of cc_store() */
+
+
+/***************************************************************************
+ * cc_chunkpath:
+ * Write the path of a chunk file into 'path'.
+ *
+ * Returns 'path'.
+ ***************************************************************************/
+char *
+cc_chunkpath (const char *name, char *path, size_t size)
+{
+  snprintf (path, size, "%s/chunks/%.2s/%s.mseed", cachedir, name, name);
+
+  return path;
+}  /* End of cc_chunkpath() */
+
+
+/***************************************************************************
+ * cc_evict:
+ * Remove the least recently used chunks until the chunks use at most
+ * 'maxbytes'.
+ *
+ * Returns the number of chunks removed or -1 on error.
+ ***************************************************************************/
+int
+cc_evict (long long maxbytes, flag verbose)
+{
+  char path[1100];
+  long idx;
+  int removed = 0;
+
+  evictfiles = 0;
+  evictcount = 0;
+  evictbytes = 0;
+
+  snprintf (path, sizeof(path), "%s/chunks", cachedir);
+
+  if ( nftw (path, collectchunk, 16, FTW_PHYS) && errno != ENOENT )
+    {
+      fprintf (stderr, "Cannot read cache %s: %s\n", path, strerror (errno));
+      return -1;
+    }
+
+  if ( evictbytes > maxbytes )
+    {
+      qsort (evictfiles, evictcount, sizeof(ChunkFile), cmpchunkfile);
+
+      for ( idx = 0; idx < evictcount && evictbytes > maxbytes; idx++ )
+	{
+	  if ( unlink (evictfiles[idx].path) )
+	    continue;
+
+	  evictbytes -= evictfiles[idx].size;
+	  removed++;
+	}
+
+      if ( verbose )
+	fprintf (stderr, "Removed %d chunks from the cache, %lld bytes left\n",
+		 removed, evictbytes);
+    }
+
+  for ( idx = 0; idx < evictcount; idx++ )
+    free (evictfiles[idx].path);
+  free (evictfiles);
+  evictfiles = 0;
+
+  return removed;
+}  /* End of cc_evict() */
+
+
+/***************************************************************************
+ * collectchunk:
+ * nftw() callback collecting the chunk files for cc_evict().
+ ***************************************************************************/
+static int
+collectchunk (const char *path, const struct stat *sb, int type, struct FTW *ftwbuf)
+{
+  if ( type != FTW_F || ! strstr (path, ".mseed") )
+    return 0;
+
+  if ( (evictcount % 1024) == 0 &&
+       (evictfiles = (ChunkFile *) realloc (evictfiles, sizeof(ChunkFile) * (evictcount + 1024))) == NULL )
+    return -1;
+
+  if ( (evictfiles[evictcount].path = strdup (path)) == NULL )
+    return -1;
+
+  evictfiles[evictcount].size = sb->st_size;
+  evictfiles[evictcount].mtime = sb->st_mtime;
+  evictbytes += sb->st_size;
+  evictcount++;
+
+  return 0;
+}  /* End of collectchunk() */
+
+
+/***************************************************************************
+ * cmpchunkfile:
+ * Order chunk files from the least to the most recently used.
+ ***************************************************************************/
+static int
+cmpchunkfile (const void *a, const void *b)
+{
+  const ChunkFile *fa = (const ChunkFile *) a;
+  const ChunkFile *fb = (const ChunkFile *) b;
+
+  if ( fa->mtime != fb->mtime )
+    return ( fa->mtime < fb->mtime ) ? -1 : 1;
+
+  return strcmp (fa->path, fb->path);
+}  /* End of cmpchunkfile() */
+
+
+/***************************************************************************
+ * writefile:
+ * Write a file through a temporary file renamed into place, so that
+ * other processes never read a partial file.  Directories are created
+ * as needed.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+writefile (const char *path, const char *data, size_t length)
+{
+  char tmppath[1200];
+  char *slash;
+  FILE *fp;
+  int rv;
+
+  snprintf (tmppath, sizeof(tmppath), "%s", path);
+  if ( (slash = strrchr (tmppath, '/')) )
+    {
+      *slash = '\0';
+      if ( mkpath (tmppath) )
+	{
+	  fprintf (stderr, "Cannot create directory %s: %s\n", tmppath, strerror (errno));
+	  return -1;
+	}
+    }
+
+  snprintf (tmppath, sizeof(tmppath), "%s.%ld.tmp", path, (long) getpid ());
+
+  if ( (fp = fopen (tmppath, "wb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", tmppath, strerror (errno));
+      return -1;
+    }
+
+  rv = ( length && fwrite (data, length, 1, fp) != 1 );
+  if ( fclose (fp) )
+    rv = 1;
+
+  if ( rv || rename (tmppath, path) )
+    {
+      fprintf (stderr, "Error writing %s: %s\n", path, strerror (errno));
+      unlink (tmppath);
+      return -1;
+    }
+
+  return 0;
+}  /* End of writefile() */
+
+
+/***************************************************************************
+ * mkpath:
+ * Create a directory and its missing parents.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mkpath (char *path)
+{
+  char *slash;
+
+  if ( mkdir (path, 0777) == 0 || errno == EEXIST )
+    return 0;
+
+  if ( errno != ENOENT || (slash = strrchr (path, '/')) == NULL || slash == path )
+    return -1;
+
+  *slash = '\0';
+  if ( mkpath (path) )
+    {
+      *slash = '/';
+      return -1;
+    }
+  *slash = '/';
+
+  return ( mkdir (path, 0777) == 0 || errno == EEXIST ) ? 0 : -1;
+}  /* End of mkpath() */
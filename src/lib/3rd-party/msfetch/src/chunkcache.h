@@ -0,0 +1,46 @@
+/***************************************************************************
+ * chunkcache.h
+ *
+ * A local cache of fetched waveforms stored as content addressed
+ * chunks, one chunk for each stream and fixed duration time bucket.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libmseed.h>
+
+#define CC_NAMELEN 40
+
+/* A chunk of a bucket: the records of one stream overlapping the bucket */
+typedef struct CacheChunk_s {
+  char  stream[50];            /* NET.STA.LOC.CHA */
+  char  name[CC_NAMELEN];      /* Content hash and size, the chunk file name */
+  long  records;
+  hptime_t firststart;         /* Earliest record start, HPTERROR if unknown */
+  hptime_t laststart;          /* Latest record start */
+  hptime_t firstend;           /* Earliest record end */
+}
+CacheChunk;
+
+extern int   cc_init (const char *directory, const char *selection, int bucketsecs);
+extern hptime_t cc_bucket (hptime_t time);
+extern hptime_t cc_bucketlen (void);
+extern int   cc_lookup (const char *network, const char *station, hptime_t bucket,
+			CacheChunk **chunks, int *chunkcount);
+extern int   cc_store (const char *network, const char *station, hptime_t start,
+		       hptime_t end, char *volume, size_t volumelen, flag verbose);
+extern char *cc_chunkpath (const char *name, char *path, size_t size);
+extern int   cc_evict (long long maxbytes, flag verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHUNKCACHE_H */
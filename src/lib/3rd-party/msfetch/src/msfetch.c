@@ -0,0 +1,1433 @@
+/***************************************************************************
+ * msfetch.c
+ *
+ * Fetch Mini-SEED waveforms of many stations from an Arclink server
+ * with concurrent requests.
+ *
+ * Each station is requested with all of its channels in a single
+ * request.  Requests are run by a bounded number of fetch threads,
+ * each with its own persistent connection, and failed requests are
+ * retried with an exponential backoff.  Fetched volumes are passed to
+ * the main thread which parses the records, writes them out and reports
+ * the station on standard output while the other stations are still
+ * being fetched.
+ *
+ * With a cache directory (-c) fetched records are kept as chunks of
+ * fixed duration buckets (see chunkcache.c).  Cached buckets are not
+ * requested again and are referenced from the output directory with
+ * links instead of being copied.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#include <libmseed.h>
+
+#include "arclink.h"
+#include "chunkcache.h"
+
+#define VERSION "1.1"
+#define PACKAGE "msfetch"
+
+#define MAXBACKOFF   30000   /* Longest retry delay in milliseconds */
+#define MAXPOLL      1000    /* Longest request status poll interval */
+
+/* Result of a station request */
+#define FETCH_PENDING  0
+#define FETCH_OK       1
+#define FETCH_NODATA   2
+#define FETCH_FAILED   3
+
+/* A time span of a station, either buckets found in the cache or a
+ * window requested from the server */
+typedef struct Span_s {
+  hptime_t start;
+  hptime_t end;
+  flag     cached;          /* Buckets in the cache, not requested */
+  flag     store;           /* Requested buckets to add to the cache */
+  flag     fetched;
+  char    *volume;          /* Fetched Mini-SEED volume */
+  size_t   volumelen;
+}
+Span;
+
+typedef struct Station_s {
+  char   network[11];
+  char   station[11];
+  int    status;
+  int    attempts;
+  Span  *spans;
+  int    spancount;
+  struct Station_s *next;   /* Link in the completed station queue */
+}
+Station;
+
+static int  parameter_proc (int argcount, char **argvec);
+static char *getoptval (int argcount, char **argvec, int argopt);
+static int  addstation (const char *network, const char *station);
+static int  addstationlist (char *list);
+static int  addstationfile (const char *filename);
+static void *fetchthread (void *arg);
+static int  buildspans (Station *stp);
+static int  addspan (Station *stp, hptime_t start, hptime_t end, flag cached, flag store);
+static int  fetchstation (ALConn *conn, Station *stp);
+static int  fetchspan (ALConn *conn, Station *stp, Span *sp);
+static int  opensession (ALConn *conn);
+static void sleepms (int msecs);
+static void completestation (Station *stp);
+static Station *nextcompleted (void);
+static int  writestation (Station *stp);
+static long writerecords (Station *stp, char *volume, size_t volumelen,
+			  hptime_t unitstart, FILE *fp, const char *path);
+static int  writechunks (Station *stp, hptime_t bucket, FILE *fp, const char *path,
+			 char ***files, int *filecount, long long *records);
+static int  readfile (const char *path, char **data, size_t *length);
+static char **addfile (char **files, int *filecount, const char *path);
+static void usage (void);
+static void term_handler (int sig);
+
+static flag   verbose     = 0;
+static char  *server      = "localhost:" AL_DEFAULTPORT;
+static char  *user        = "sdp";
+static char  *password    = 0;
+static char  *location    = "*";
+static char **channels    = 0;     /* Channel codes requested for each station */
+static int    channelcount = 0;
+static hptime_t starttime = HPTERROR;
+static hptime_t endtime   = HPTERROR;
+static int    connections = 4;     /* Concurrent requests */
+static int    retries     = 3;     /* Retries of a failed station request */
+static int    backoff     = 1000;  /* First retry delay in milliseconds */
+static int    timeout     = 60;    /* Socket and request timeout in seconds */
+static char  *outputdir   = 0;     /* Write a file for each station */
+static char  *outputfile  = 0;     /* Write all stations to a single file */
+static FILE  *outfp       = 0;
+static char  *cachedir    = 0;     /* Cache of fetched buckets */
+static int    bucketsecs  = 3600;  /* Duration of cache buckets */
+static int    cachelatency = 3600; /* Buckets more recent than this are not cached */
+static long long cachesize = 2048; /* Cache size limit in megabytes */
+
+static Station *stations    = 0;
+static int      stationcount = 0;
+static atomic_int nextstation;     /* Next station to fetch */
+
+static volatile sig_atomic_t stopsig = 0; /* Termination signal received */
+
+/* Fetched stations waiting to be written, in completion order.  The
+ * queue is bounded so that fetch threads wait for the writer instead
+ * of holding more volumes in memory than there are connections. */
+static Station        *queuehead  = 0;
+static Station        *queuetail  = 0;
+static int             queuecount = 0;
+static pthread_mutex_t queuelock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queuecond  = PTHREAD_COND_INITIALIZER;
+
+
+int
+main (int argc, char **argv)
+{
+  pthread_t *threads;
+  Station *stp;
+  long long int failed = 0;
+  int idx;
+  int done;
+
+  /* Signal handling, use POSIX calls with standardized semantics */
+  struct sigaction sa;
+
+  /* No SA_RESTART, termination signals should interrupt blocking calls */
+  sa.sa_flags = 0;
+  sigemptyset (&sa.sa_mask);
+
+  sa.sa_handler = term_handler;
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGQUIT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+
+  sa.sa_handler = SIG_IGN;
+  sigaction (SIGHUP, &sa, NULL);
+  sigaction (SIGPIPE, &sa, NULL);
+
+  /* Process given parameters (command line and parameter file) */
+  if ( parameter_proc (argc, argv) < 0 )
+    return 1;
+
+  if ( outputfile && (outfp = fopen (outputfile, "wb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open output file %s: %s\n", outputfile, strerror (errno));
+      return 1;
+    }
+
+  if ( connections > stationcount )
+    connections = stationcount;
+
+  if ( (threads = (pthread_t *) malloc (sizeof(pthread_t) * connections)) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return 1;
+    }
+
+  atomic_init (&nextstation, 0);
+
+  for ( idx = 0; idx < connections; idx++ )
+    if ( pthread_create (&threads[idx], NULL, fetchthread, NULL) )
+      {
+	fprintf (stderr, "Cannot create fetch thread\n");
+	return 1;
+      }
+
+  /* Write stations as they are fetched */
+  for ( done = 0; done < stationcount; done++ )
+    {
+      if ( (stp = nextcompleted ()) == NULL )
+	break;
+
+      if ( writestation (stp) )
+	failed++;
+
+      for ( idx = 0; idx < stp->spancount; idx++ )
+	free (stp->spans[idx].volume);
+      free (stp->spans);
+      stp->spans = 0;
+      stp->spancount = 0;
+    }
+
+  for ( idx = 0; idx < connections; idx++ )
+    pthread_join (threads[idx], NULL);
+
+  /* Stations not fetched after a termination signal */
+  failed += stationcount - done;
+
+  if ( outfp && fclose (outfp) )
+    {
+      fprintf (stderr, "Error writing %s: %s\n", outputfile, strerror (errno));
+      failed++;
+    }
+
+  /* Chunks linked to output directories stay there when removed */
+  if ( cachedir && cachesize > 0 )
+    cc_evict (cachesize * 1024 * 1024, verbose);
+
+  if ( verbose )
+    fprintf (stderr, "Fetched %d stations, %lld failed\n", done, failed);
+
+  free (threads);
+
+  return ( failed ) ? 1 : 0;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * fetchthread:
+ * Fetch stations until all are taken by the fetch threads.  Each
+ * thread keeps its connection open between stations and reconnects
+ * after a failed request.
+ ***************************************************************************/
+static void *
+fetchthread (void *arg)
+{
+  ALConn *conn;
+  Station *stp;
+  unsigned int seed;
+  int idx;
+  int delay;
+  int rv;
+
+  /* Without a connection all remaining stations fail */
+  if ( (conn = (ALConn *) malloc (sizeof(ALConn))) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      stopsig = 1;
+    }
+  else
+    {
+      conn->fd = -1;
+    }
+
+  seed = (unsigned int) time (NULL) ^ (unsigned int) (size_t) conn;
+
+  while ( (idx = atomic_fetch_add (&nextstation, 1)) < stationcount )
+    {
+      stp = &stations[idx];
+
+      if ( ! stopsig && buildspans (stp) )
+	stopsig = 1;
+
+      /* Stations not fetched before a termination signal fail */
+      while ( ! stopsig )
+	{
+	  stp->attempts++;
+
+	  if ( fetchstation (conn, stp) == 0 )
+	    {
+	      stp->status = FETCH_OK;
+	      break;
+	    }
+
+	  al_close (conn);
+
+	  if ( stp->attempts > retries )
+	    break;
+
+	  /* Exponential backoff with jitter so that failed requests of
+	   * the threads are not retried all at once */
+	  delay = backoff;
+	  for ( rv = 1; rv < stp->attempts && delay < MAXBACKOFF; rv++ )
+	    delay *= 2;
+	  if ( delay > MAXBACKOFF )
+	    delay = MAXBACKOFF;
+	  delay = delay / 2 + rand_r (&seed) % (delay / 2 + 1);
+
+	  if ( verbose )
+	    fprintf (stderr, "%s.%s: retrying in %d ms\n", stp->network, stp->station, delay);
+
+	  sleepms (delay);
+	}
+
+      if ( stp->status == FETCH_PENDING )
+	stp->status = FETCH_FAILED;
+
+      completestation (stp);
+    }
+
+  if ( conn )
+    {
+      if ( conn->fd >= 0 )
+	al_writeline (conn, "BYE");
+
+      al_close (conn);
+      free (conn);
+    }
+
+  return NULL;
+}  /* End of fetchthread() */
+
+
+/***************************************************************************
+ * opensession:
+ * Connect to the server and identify the user.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+opensession (ALConn *conn)
+{
+  char line[AL_LINELEN];
+
+  if ( al_connect (conn, server, timeout) )
+    {
+      fprintf (stderr, "Cannot connect to %s: %s\n", server, strerror (errno));
+      return -1;
+    }
+
+  /* Server greeting is the version and the institution */
+  if ( al_writeline (conn, "HELLO") ||
+       al_readline (conn, line, sizeof(line)) < 0 ||
+       al_readline (conn, line, sizeof(line)) < 0 )
+    {
+      fprintf (stderr, "No greeting from %s\n", server);
+      return -1;
+    }
+
+  if ( password )
+    al_writeline (conn, "USER %s %s", user, password);
+  else
+    al_writeline (conn, "USER %s", user);
+
+  if ( al_readline (conn, line, sizeof(line)) < 0 || strcmp (line, "OK") )
+    {
+      fprintf (stderr, "User %s not accepted by %s\n", user, server);
+      return -1;
+    }
+
+  return 0;
+}  /* End of opensession() */
+
+
+/***************************************************************************
+ * buildspans:
+ * Divide the time window of a station into spans: without a cache the
+ * whole window is requested.  With a cache, cached buckets are not
+ * requested, consecutive missing buckets are requested together and
+ * stored, and the buckets too recent to be complete at the server are
+ * requested for the remainder of the window without being stored.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+buildspans (Station *stp)
+{
+  CacheChunk *chunks;
+  Span *last;
+  hptime_t bucket;
+  hptime_t bucketlen;
+  hptime_t limit;
+  int chunkcount;
+
+  if ( ! cachedir )
+    return addspan (stp, starttime, endtime, 0, 0);
+
+  bucketlen = cc_bucketlen ();
+  limit = MS_EPOCH2HPTIME ((hptime_t) (time (NULL) - cachelatency));
+
+  for ( bucket = cc_bucket (starttime); bucket < endtime; bucket += bucketlen )
+    {
+      if ( bucket + bucketlen > limit )
+	return addspan (stp, ( bucket > starttime ) ? bucket : starttime, endtime, 0, 0);
+
+      if ( cc_lookup (stp->network, stp->station, bucket, &chunks, &chunkcount) == 0 )
+	{
+	  free (chunks);
+	  if ( addspan (stp, bucket, bucket + bucketlen, 1, 0) )
+	    return -1;
+	  continue;
+	}
+
+      last = ( stp->spancount ) ? &stp->spans[stp->spancount - 1] : 0;
+
+      if ( last && last->store && last->end == bucket )
+	last->end += bucketlen;
+      else if ( addspan (stp, bucket, bucket + bucketlen, 0, 1) )
+	return -1;
+    }
+
+  return 0;
+}  /* End of buildspans() */
+
+
+/***************************************************************************
+ * addspan:
+ * Add a span to the spans of a station.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+addspan (Station *stp, hptime_t start, hptime_t end, flag cached, flag store)
+{
+  Span *sp;
+
+  if ( (sp = (Span *) realloc (stp->spans, sizeof(Span) * (stp->spancount + 1))) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return -1;
+    }
+
+  stp->spans = sp;
+  sp = &stp->spans[stp->spancount++];
+  memset (sp, 0, sizeof(Span));
+  sp->start = start;
+  sp->end = end;
+  sp->cached = cached;
+  sp->store = store;
+
+  return 0;
+}  /* End of addspan() */
+
+
+/***************************************************************************
+ * fetchstation:
+ * Request the spans of a station not in the cache and not fetched by a
+ * previous attempt.
+ *
+ * Returns 0 on success and -1 on error (the station can be retried).
+ ***************************************************************************/
+static int
+fetchstation (ALConn *conn, Station *stp)
+{
+  Span *sp;
+  int idx;
+
+  for ( idx = 0; idx < stp->spancount; idx++ )
+    {
+      sp = &stp->spans[idx];
+
+      if ( sp->cached || sp->fetched )
+	continue;
+
+      if ( fetchspan (conn, stp, sp) < 0 )
+	return -1;
+
+      sp->fetched = 1;
+    }
+
+  return 0;
+}  /* End of fetchstation() */
+
+
+/***************************************************************************
+ * fetchspan:
+ * Request all channels of a station over a span, wait for the request
+ * to be processed by the server and download the resulting volume.
+ *
+ * Returns 0 when data was fetched, 1 when the server has no data and
+ * -1 on error (the request can be retried).
+ ***************************************************************************/
+static int
+fetchspan (ALConn *conn, Station *stp, Span *sp)
+{
+  char line[AL_LINELEN];
+  char stime[32];
+  char etime[32];
+  char reqid[AL_LINELEN];
+  size_t length;
+  time_t deadline;
+  int ready = 0;
+  int poll = 20;
+  int idx;
+  int rv;
+
+  if ( conn->fd < 0 && opensession (conn) )
+    return -1;
+
+  al_formattime (sp->start, stime, 0);
+  al_formattime (sp->end, etime, 1);
+
+  if ( al_writeline (conn, "REQUEST WAVEFORM format=MSEED") )
+    return -1;
+
+  for ( idx = 0; idx < channelcount; idx++ )
+    if ( al_writeline (conn, "%s %s %s %s %s %s", stime, etime, stp->network,
+		       stp->station, channels[idx], location) )
+      return -1;
+
+  /* The server answers the end of a request with the request ID */
+  if ( al_writeline (conn, "END") ||
+       al_readline (conn, reqid, sizeof(reqid)) <= 0 ||
+       ! strcmp (reqid, "ERROR") )
+    {
+      fprintf (stderr, "%s.%s: request not accepted\n", stp->network, stp->station);
+      return -1;
+    }
+
+  /* Poll the request status until processed, the interval grows so
+   * that short requests are downloaded early without flooding the
+   * server with status requests for long ones */
+  deadline = time (NULL) + timeout;
+
+  while ( ! ready )
+    {
+      if ( al_writeline (conn, "STATUS %s", reqid) )
+	return -1;
+
+      /* The status is an XML document terminated by an END line */
+      while ( (rv = al_readline (conn, line, sizeof(line))) >= 0 )
+	{
+	  if ( ! strcmp (line, "END") )
+	    break;
+	  if ( ! strcmp (line, "ERROR") )
+	    return -1;
+	  if ( strstr (line, "ready=\"true\"") )
+	    ready = 1;
+	}
+
+      if ( rv < 0 || stopsig )
+	return -1;
+
+      if ( ! ready )
+	{
+	  if ( time (NULL) >= deadline )
+	    {
+	      fprintf (stderr, "%s.%s: request %s not processed in %d seconds\n",
+		       stp->network, stp->station, reqid, timeout);
+	      return -1;
+	    }
+
+	  sleepms (poll);
+	  if ( (poll *= 2) > MAXPOLL )
+	    poll = MAXPOLL;
+	}
+    }
+
+  /* The volume is preceded by its length, ERROR means no data */
+  if ( al_writeline (conn, "DOWNLOAD %s", reqid) ||
+       al_readline (conn, line, sizeof(line)) <= 0 )
+    return -1;
+
+  if ( ! strcmp (line, "ERROR") )
+    {
+      al_writeline (conn, "PURGE %s", reqid);
+      if ( al_readline (conn, line, sizeof(line)) < 0 )
+	al_close (conn);
+      return 1;
+    }
+
+  length = strtoull (line, NULL, 10);
+
+  if ( length == 0 )
+    {
+      fprintf (stderr, "%s.%s: invalid download length: %s\n", stp->network, stp->station, line);
+      return -1;
+    }
+
+  free (sp->volume);
+  if ( (sp->volume = (char *) malloc (length)) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate %zu bytes\n", length);
+      return -1;
+    }
+
+  if ( al_readn (conn, sp->volume, length) ||
+       al_readline (conn, line, sizeof(line)) < 0 ||
+       strcmp (line, "END") )
+    {
+      fprintf (stderr, "%s.%s: download of request %s interrupted\n",
+	       stp->network, stp->station, reqid);
+      free (sp->volume);
+      sp->volume = 0;
+      return -1;
+    }
+
+  sp->volumelen = length;
+
+  /* The volume is complete, a failed purge only loses the connection */
+  if ( al_writeline (conn, "PURGE %s", reqid) ||
+       al_readline (conn, line, sizeof(line)) < 0 )
+    al_close (conn);
+
+  return 0;
+}  /* End of fetchspan() */
+
+
+/***************************************************************************
+ * completestation:
+ * Add a station to the completed station queue, waiting while the
+ * queue is full.
+ ***************************************************************************/
+static void
+completestation (Station *stp)
+{
+  pthread_mutex_lock (&queuelock);
+
+  while ( queuecount >= connections )
+    pthread_cond_wait (&queuecond, &queuelock);
+
+  stp->next = 0;
+  if ( queuetail )
+    queuetail->next = stp;
+  else
+    queuehead = stp;
+  queuetail = stp;
+  queuecount++;
+
+  pthread_cond_broadcast (&queuecond);
+  pthread_mutex_unlock (&queuelock);
+}  /* End of completestation() */
+
+
+/***************************************************************************
+ * nextcompleted:
+ * Remove the next station from the completed station queue, waiting
+ * for a station to be completed.
+ *
+ * Returns the station.
+ ***************************************************************************/
+static Station *
+nextcompleted (void)
+{
+  Station *stp;
+
+  pthread_mutex_lock (&queuelock);
+
+  while ( queuecount == 0 )
+    pthread_cond_wait (&queuecond, &queuelock);
+
+  stp = queuehead;
+  queuehead = stp->next;
+  if ( ! queuehead )
+    queuetail = 0;
+  queuecount--;
+
+  pthread_cond_broadcast (&queuecond);
+  pthread_mutex_unlock (&queuelock);
+
+  return stp;
+}  /* End of nextcompleted() */
+
+
+/***************************************************************************
+ * writestation:
+ * Write the records of a station within the time window and report the
+ * station on standard output as:
+ *
+ *   OK|NODATA|FAILED NET.STA records file [file ...]
+ *
+ * Fetched buckets are first added to the cache.  With an output
+ * directory cached chunks are linked or written trimmed into it, other
+ * records are written to dir/NET.STA.mseed, and the files of a failed
+ * station are removed.  With a single output file all records are
+ * written to it.
+ *
+ * Returns 0 on success and -1 when the station failed.
+ ***************************************************************************/
+static int
+writestation (Station *stp)
+{
+  Span *sp;
+  FILE *fp = outfp;
+  char path[1024];
+  char **files = 0;
+  int filecount = 0;
+  long long int records = 0;
+  long written;
+  long count;
+  hptime_t bucket;
+  int idx;
+
+  path[0] = '\0';
+
+  if ( outputdir )
+    snprintf (path, sizeof(path), "%s/%s.%s.mseed", outputdir, stp->network, stp->station);
+  else
+    snprintf (path, sizeof(path), "%s", outputfile);
+
+  for ( idx = 0; stp->status == FETCH_OK && idx < stp->spancount; idx++ )
+    {
+      sp = &stp->spans[idx];
+
+      /* Add fetched buckets to the cache, written directly on failure */
+      if ( sp->store && cc_store (stp->network, stp->station, sp->start, sp->end,
+				  sp->volume, sp->volumelen, verbose) == 0 )
+	sp->cached = 1;
+
+      if ( sp->cached )
+	{
+	  for ( bucket = sp->start; bucket < sp->end; bucket += cc_bucketlen () )
+	    if ( writechunks (stp, bucket, outfp, path, &files, &filecount, &records) )
+	      {
+		stp->status = FETCH_FAILED;
+		break;
+	      }
+	  continue;
+	}
+
+      if ( ! sp->volumelen )
+	continue;
+
+      if ( ! fp && (fp = fopen (path, "wb")) == NULL )
+	{
+	  fprintf (stderr, "Cannot open output file %s: %s\n", path, strerror (errno));
+	  stp->status = FETCH_FAILED;
+	  break;
+	}
+
+      if ( (count = writerecords (stp, sp->volume, sp->volumelen, sp->start, fp, path)) < 0 )
+	{
+	  stp->status = FETCH_FAILED;
+	  break;
+	}
+
+      records += count;
+    }
+
+  /* The station file of an output directory */
+  if ( fp && fp != outfp )
+    {
+      written = ftell (fp);
+
+      if ( fclose (fp) && stp->status == FETCH_OK )
+	{
+	  fprintf (stderr, "Error writing %s: %s\n", path, strerror (errno));
+	  stp->status = FETCH_FAILED;
+	}
+
+      if ( stp->status == FETCH_OK && written > 0 )
+	files = addfile (files, &filecount, path);
+      else
+	unlink (path);
+    }
+
+  if ( outfp && records > 0 )
+    files = addfile (files, &filecount, outputfile);
+
+  /* Remove the chunk files of a failed station */
+  for ( idx = 0; idx < filecount && outputdir && stp->status == FETCH_FAILED; idx++ )
+    unlink (files[idx]);
+
+  if ( stp->status == FETCH_OK && records == 0 )
+    stp->status = FETCH_NODATA;
+
+  fprintf (stdout, "%s %s.%s %lld",
+	   ( stp->status == FETCH_OK ) ? "OK" :
+	   ( stp->status == FETCH_NODATA ) ? "NODATA" : "FAILED",
+	   stp->network, stp->station, records);
+
+  for ( idx = 0; idx < filecount && stp->status == FETCH_OK; idx++ )
+    fprintf (stdout, " %s", files[idx]);
+
+  fprintf (stdout, "%s\n", ( stp->status == FETCH_OK ) ? "" : " -");
+  fflush (stdout);
+
+  if ( verbose && stp->status == FETCH_FAILED )
+    fprintf (stderr, "%s.%s: failed after %d attempts\n", stp->network, stp->station, stp->attempts);
+
+  for ( idx = 0; idx < filecount; idx++ )
+    free (files[idx]);
+  free (files);
+
+  return ( stp->status == FETCH_FAILED ) ? -1 : 0;
+}  /* End of writestation() */
+
+
+/***************************************************************************
+ * writerecords:
+ * Write the records of a volume within the time window.  Records
+ * starting before 'unitstart', unless it is the start of the window,
+ * are skipped: they overlap the previous bucket or span and were
+ * written with it.  If 'fp' is NULL the records are only counted.
+ *
+ * Returns the number of records written or -1 on error.
+ ***************************************************************************/
+static long
+writerecords (Station *stp, char *volume, size_t volumelen, hptime_t unitstart,
+	      FILE *fp, const char *path)
+{
+  MSRecord *msr = 0;
+  size_t offset = 0;
+  long records = 0;
+  int rv;
+
+  while ( offset < volumelen )
+    {
+      rv = msr_parse (volume + offset, (int) (volumelen - offset), &msr, -1, 0, verbose - 1);
+
+      if ( rv != MS_NOERROR )
+	{
+	  fprintf (stderr, "%s.%s: %s at byte %zu of the volume\n", stp->network, stp->station,
+		   ( rv > 0 ) ? "truncated record" : ms_errorstr (rv), offset);
+	  break;
+	}
+
+      /* Servers return whole records, drop those outside the window */
+      if ( msr_endtime (msr) >= starttime && msr->starttime <= endtime &&
+	   (unitstart <= starttime || msr->starttime >= unitstart) )
+	{
+	  if ( fp && fwrite (msr->record, msr->reclen, 1, fp) != 1 )
+	    {
+	      fprintf (stderr, "Error writing %s: %s\n", path, strerror (errno));
+	      records = -1;
+	      break;
+	    }
+	  records++;
+	}
+
+      offset += msr->reclen;
+    }
+
+  msr_free (&msr);
+
+  return records;
+}  /* End of writerecords() */
+
+
+/***************************************************************************
+ * writechunks:
+ * Output the cached chunks of a station bucket.  With an output
+ * directory each chunk is output as dir/NET.STA.LOC.CHA.<bucket>.mseed
+ * and added to 'files': a chunk whose records are all within the time
+ * window and start in the bucket, according to the times of the cache
+ * index, is linked (a symbolic link is used when the cache is on
+ * another file system) and counted from the index, other chunks are
+ * written trimmed as by writerecords().  With a single output file the
+ * records of the chunks are written to 'fp'.  A file of the bucket
+ * that could not be completely output is removed.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+writechunks (Station *stp, hptime_t bucket, FILE *fp, const char *path,
+	     char ***files, int *filecount, long long *records)
+{
+  CacheChunk *chunks = 0;
+  CacheChunk *chunk;
+  FILE *chunkfp;
+  char chunkpath[1200];
+  char linkpath[1200];
+  char realchunk[PATH_MAX];
+  char *volume = 0;
+  size_t volumelen;
+  long count = 0;
+  int chunkcount;
+  int idx;
+  int rv = 0;
+
+  /* A chunk removed by another process since the spans were built */
+  if ( cc_lookup (stp->network, stp->station, bucket, &chunks, &chunkcount) )
+    {
+      fprintf (stderr, "%s.%s: cached bucket %lld is no longer in the cache\n",
+	       stp->network, stp->station, (long long) MS_HPTIME2EPOCH (bucket));
+      return -1;
+    }
+
+  for ( idx = 0; rv == 0 && idx < chunkcount; idx++ )
+    {
+      chunk = &chunks[idx];
+      cc_chunkpath (chunk->name, chunkpath, sizeof(chunkpath));
+
+      if ( ! outputdir )
+	{
+	  if ( readfile (chunkpath, &volume, &volumelen) ||
+	       (count = writerecords (stp, volume, volumelen, bucket, fp, path)) < 0 )
+	    rv = -1;
+	  else
+	    *records += count;
+
+	  free (volume);
+	  volume = 0;
+	  continue;
+	}
+
+      snprintf (linkpath, sizeof(linkpath), "%s/%s.%lld.mseed", outputdir,
+		chunk->stream, (long long) MS_HPTIME2EPOCH (bucket));
+      unlink (linkpath);
+
+      /* Link a chunk that would be written whole, see writerecords() */
+      if ( chunk->firststart != HPTERROR &&
+	   chunk->firstend >= starttime && chunk->laststart <= endtime &&
+	   (bucket <= starttime || chunk->firststart >= bucket) )
+	{
+	  if ( link (chunkpath, linkpath) &&
+	       (! realpath (chunkpath, realchunk) || symlink (realchunk, linkpath)) )
+	    {
+	      fprintf (stderr, "Cannot link %s to %s: %s\n", linkpath, chunkpath, strerror (errno));
+	      rv = -1;
+	      break;
+	    }
+
+	  *files = addfile (*files, filecount, linkpath);
+	  *records += chunk->records;
+	  continue;
+	}
+
+      /* Otherwise write the records of the chunk in the window */
+      if ( readfile (chunkpath, &volume, &volumelen) )
+	rv = -1;
+      else if ( (chunkfp = fopen (linkpath, "wb")) == NULL )
+	{
+	  fprintf (stderr, "Cannot open output file %s: %s\n", linkpath, strerror (errno));
+	  rv = -1;
+	}
+      else
+	{
+	  count = writerecords (stp, volume, volumelen, bucket, chunkfp, linkpath);
+
+	  if ( fclose (chunkfp) && count >= 0 )
+	    {
+	      fprintf (stderr, "Error writing %s: %s\n", linkpath, strerror (errno));
+	      count = -1;
+	    }
+
+	  if ( count < 0 )
+	    rv = -1;
+	  else if ( count > 0 )
+	    {
+	      *files = addfile (*files, filecount, linkpath);
+	      *records += count;
+	    }
+	}
+
+      /* Partial files and files without records are not kept */
+      if ( rv || count == 0 )
+	unlink (linkpath);
+
+      free (volume);
+      volume = 0;
+    }
+
+  free (chunks);
+
+  return rv;
+}  /* End of writechunks() */
+
+
+/***************************************************************************
+ * readfile:
+ * Read a whole file into an allocated buffer.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+readfile (const char *path, char **data, size_t *length)
+{
+  struct stat st;
+  FILE *fp;
+  int rv = 0;
+
+  *data = 0;
+  *length = 0;
+
+  if ( (fp = fopen (path, "rb")) == NULL || fstat (fileno (fp), &st) )
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", path, strerror (errno));
+      if ( fp )
+	fclose (fp);
+      return -1;
+    }
+
+  if ( st.st_size > 0 &&
+       ((*data = (char *) malloc (st.st_size)) == NULL ||
+	fread (*data, st.st_size, 1, fp) != 1) )
+    {
+      fprintf (stderr, "Cannot read %s\n", path);
+      rv = -1;
+    }
+  else
+    {
+      *length = st.st_size;
+    }
+
+  fclose (fp);
+
+  return rv;
+}  /* End of readfile() */
+
+
+/***************************************************************************
+ * addfile:
+ * Append a copy of a path to a list of files.
+ *
+ * Returns the list.
+ ***************************************************************************/
+static char **
+addfile (char **files, int *filecount, const char *path)
+{
+  char **list;
+
+  if ( (list = (char **) realloc (files, sizeof(char *) * (*filecount + 1))) == NULL ||
+       (list[*filecount] = strdup (path)) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      exit (1);
+    }
+
+  (*filecount)++;
+
+  return list;
+}  /* End of addfile() */
+
+
+/***************************************************************************
+ * sleepms:
+ * Sleep for a number of milliseconds, a termination signal ends the
+ * sleep early.
+ ***************************************************************************/
+static void
+sleepms (int msecs)
+{
+  struct timespec ts;
+
+  ts.tv_sec = msecs / 1000;
+  ts.tv_nsec = (long) (msecs % 1000) * 1000000;
+
+  nanosleep (&ts, NULL);
+}  /* End of sleepms() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+  char *chanlist = "*";
+  char *channelstr;
+  char *tptr;
+  char selection[1024];
+  struct stat st;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+    {
+      if (strcmp (argvec[optind], "-V") == 0)
+	{
+	  fprintf (stderr, "%s version: %s\n", PACKAGE, VERSION);
+	  exit (0);
+	}
+      else if (strcmp (argvec[optind], "-h") == 0)
+	{
+	  usage ();
+	  exit (0);
+	}
+      else if (strncmp (argvec[optind], "-v", 2) == 0)
+	{
+	  verbose += strspn (&argvec[optind][1], "v");
+	}
+      else if (strcmp (argvec[optind], "-S") == 0)
+	{
+	  server = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-u") == 0)
+	{
+	  user = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-p") == 0)
+	{
+	  password = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-ts") == 0)
+	{
+	  starttime = ms_timestr2hptime (getoptval(argcount, argvec, optind++));
+	  if ( starttime == HPTERROR )
+	    return -1;
+	}
+      else if (strcmp (argvec[optind], "-te") == 0)
+	{
+	  endtime = ms_timestr2hptime (getoptval(argcount, argvec, optind++));
+	  if ( endtime == HPTERROR )
+	    return -1;
+	}
+      else if (strcmp (argvec[optind], "-s") == 0)
+	{
+	  if ( addstationlist (getoptval(argcount, argvec, optind++)) )
+	    return -1;
+	}
+      else if (strcmp (argvec[optind], "-l") == 0)
+	{
+	  if ( addstationfile (getoptval(argcount, argvec, optind++)) )
+	    return -1;
+	}
+      else if (strcmp (argvec[optind], "-C") == 0)
+	{
+	  chanlist = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-L") == 0)
+	{
+	  location = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-j") == 0)
+	{
+	  connections = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-r") == 0)
+	{
+	  retries = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-b") == 0)
+	{
+	  backoff = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-T") == 0)
+	{
+	  timeout = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-o") == 0)
+	{
+	  outputdir = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-O") == 0)
+	{
+	  outputfile = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-c") == 0)
+	{
+	  cachedir = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-cb") == 0)
+	{
+	  bucketsecs = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-cl") == 0)
+	{
+	  cachelatency = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-cs") == 0)
+	{
+	  cachesize = strtoll (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else
+	{
+	  fprintf (stderr, "Unknown option: %s\n", argvec[optind]);
+	  exit (1);
+	}
+    }
+
+  if ( starttime == HPTERROR || endtime == HPTERROR )
+    {
+      fprintf (stderr, "A time window is required, specify -ts and -te\n");
+      fprintf (stderr, "Try %s -h for usage\n", PACKAGE);
+      exit (1);
+    }
+
+  if ( endtime <= starttime )
+    {
+      fprintf (stderr, "The end time must follow the start time\n");
+      exit (1);
+    }
+
+  if ( stationcount == 0 )
+    {
+      fprintf (stderr, "No stations specified, use -s or -l\n");
+      fprintf (stderr, "Try %s -h for usage\n", PACKAGE);
+      exit (1);
+    }
+
+  if ( (outputdir == 0) == (outputfile == 0) )
+    {
+      fprintf (stderr, "Specify one output, either -o or -O\n");
+      exit (1);
+    }
+
+  if ( outputdir && (stat (outputdir, &st) || ! S_ISDIR (st.st_mode)) )
+    {
+      fprintf (stderr, "Output directory %s does not exist\n", outputdir);
+      exit (1);
+    }
+
+  if ( connections < 1 || retries < 0 || backoff < 1 || timeout < 1 )
+    {
+      fprintf (stderr, "Invalid -j, -r, -b or -T value\n");
+      exit (1);
+    }
+
+  if ( bucketsecs < 60 || cachelatency < 0 || cachesize < 0 )
+    {
+      fprintf (stderr, "Invalid -cb, -cl or -cs value\n");
+      exit (1);
+    }
+
+  if ( ! *location )
+    location = "*";
+
+  /* Cached buckets are only valid for the same server and channels */
+  if ( cachedir )
+    {
+      snprintf (selection, sizeof(selection), "%s|%s|%s", server, chanlist, location);
+
+      if ( cc_init (cachedir, selection, bucketsecs) )
+	{
+	  fprintf (stderr, "Invalid cache directory: %s\n", cachedir);
+	  exit (1);
+	}
+    }
+
+  /* Split the channel list */
+  if ( (channelstr = strdup (chanlist)) == NULL )
+    return -1;
+
+  for ( tptr = strtok (channelstr, ","); tptr; tptr = strtok (NULL, ",") )
+    {
+      if ( (channels = (char **) realloc (channels, sizeof(char *) * (channelcount + 1))) == NULL )
+	{
+	  fprintf (stderr, "Cannot allocate memory\n");
+	  return -1;
+	}
+      channels[channelcount++] = tptr;
+    }
+
+  if ( channelcount == 0 )
+    {
+      fprintf (stderr, "No channels specified with -C\n");
+      exit (1);
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * getoptval:
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: argument list
+ * argopt: index of option to process, value is expected to be at +1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+getoptval (int argcount, char **argvec, int argopt)
+{
+  if ( argvec == NULL || argvec[argopt] == NULL ) {
+    fprintf (stderr, "getoptval(): NULL option requested\n");
+    exit (1);
+  }
+
+  if ( (argopt+1) < argcount && *argvec[argopt+1] != '-' )
+    return argvec[argopt+1];
+
+  fprintf (stderr, "Option %s requires a value\n", argvec[argopt]);
+  exit (1);
+}  /* End of getoptval() */
+
+
+/***************************************************************************
+ * addstation:
+ * Add a station to the list of stations to fetch.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+addstation (const char *network, const char *station)
+{
+  Station *stp;
+
+  if ( ! *network || ! *station || strlen (network) > 10 || strlen (station) > 10 )
+    {
+      fprintf (stderr, "Invalid station: '%s.%s'\n", network, station);
+      return -1;
+    }
+
+  if ( (stations = (Station *) realloc (stations, sizeof(Station) * (stationcount + 1))) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return -1;
+    }
+
+  stp = &stations[stationcount++];
+  memset (stp, 0, sizeof(Station));
+  strcpy (stp->network, network);
+  strcpy (stp->station, station);
+
+  return 0;
+}  /* End of addstation() */
+
+
+/***************************************************************************
+ * addstationlist:
+ * Add a comma separated list of NET.STA stations.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+addstationlist (char *list)
+{
+  char *saveptr = 0;
+  char *entry;
+  char *dot;
+
+  for ( entry = strtok_r (list, ",", &saveptr); entry; entry = strtok_r (NULL, ",", &saveptr) )
+    {
+      if ( (dot = strchr (entry, '.')) == NULL )
+	{
+	  fprintf (stderr, "Invalid station, expected NET.STA: '%s'\n", entry);
+	  return -1;
+	}
+
+      *dot = '\0';
+      if ( addstation (entry, dot + 1) )
+	return -1;
+    }
+
+  return 0;
+}  /* End of addstationlist() */
+
+
+/***************************************************************************
+ * addstationfile:
+ * Add the stations listed in a file, one station per line as either
+ * "NET STA" or "NET.STA".  Empty lines and lines starting with '#' are
+ * skipped.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+addstationfile (const char *filename)
+{
+  FILE *fp;
+  char line[256];
+  char network[64];
+  char station[64];
+  char *dot;
+  int count;
+  int rv = 0;
+
+  if ( (fp = fopen (filename, "r")) == NULL )
+    {
+      fprintf (stderr, "Cannot open station list %s: %s\n", filename, strerror (errno));
+      return -1;
+    }
+
+  while ( rv == 0 && fgets (line, sizeof(line), fp) )
+    {
+      if ( (count = sscanf (line, "%63s %63s", network, station)) < 1 || *network == '#' )
+	continue;
+
+      if ( count == 1 )
+	{
+	  if ( (dot = strchr (network, '.')) == NULL )
+	    {
+	      fprintf (stderr, "%s: invalid station line: %s", filename, line);
+	      rv = -1;
+	      break;
+	    }
+	  *dot = '\0';
+	  strcpy (station, dot + 1);
+	}
+
+      rv = addstation (network, station);
+    }
+
+  fclose (fp);
+
+  return rv;
+}  /* End of addstationfile() */
+
+
+/***************************************************************************
+ * usage:
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Fetch Mini-SEED waveforms of many stations from an Arclink server.\n\n");
+  fprintf (stderr, "Usage: %s [options] -ts start -te end -s NET.STA[,...] -o dir\n\n", PACKAGE);
+  fprintf (stderr,
+	   " ## Options ##\n"
+	   " -V             Report program version\n"
+	   " -h             Show this usage message\n"
+	   " -v             Be more verbose, multiple flags can be used\n"
+	   " -S host:port   Arclink server, default localhost:%s\n"
+	   " -u user        User name, default 'sdp'\n"
+	   " -p password    User password\n"
+	   " -ts time       Start of the time window, YYYY-MM-DDThh:mm:ss\n"
+	   " -te time       End of the time window, YYYY-MM-DDThh:mm:ss\n"
+	   " -s NET.STA     Stations to fetch, comma separated, can be used multiple times\n"
+	   " -l file        File listing stations to fetch, one NET STA per line\n"
+	   " -C chans       Channels of each station, comma separated, default '*'\n"
+	   " -L loc         Location code of the channels, default '*'\n"
+	   " -j conns       Number of concurrent requests, default 4\n"
+	   " -r retries     Retries of a failed station request, default 3\n"
+	   " -b msecs       Delay before the first retry, doubled for every retry, default 1000\n"
+	   " -T secs        Timeout of socket operations and requests, default 60\n"
+	   " -o dir         Write the records of each station to dir/NET.STA.mseed\n"
+	   " -O file        Write the records of all stations to a single file\n"
+	   " -c dir         Cache fetched data in dir, cached data is linked with -o\n"
+	   " -cb secs       Duration of cache buckets, default 3600\n"
+	   " -cl secs       Do not cache buckets ending less than secs ago, default 3600\n"
+	   " -cs MB         Cache size limit in megabytes, default 2048, 0 is no limit\n"
+	   "\n"
+	   "A line is written on standard output when a station is complete:\n"
+	   "  OK|NODATA|FAILED NET.STA records file [file ...]\n"
+	   "\n", AL_DEFAULTPORT);
+}  /* End of usage() */
+
+
+/***************************************************************************
+ * term_handler:
+ * Signal handler routine, stop fetching.  Requests in progress fail
+ * and the stations fetched so far are written.
+ ***************************************************************************/
+static void
+term_handler (int sig)
+{
+  stopsig = 1;
+}  /* End of term_handler() */
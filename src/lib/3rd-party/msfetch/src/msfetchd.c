@@ -0,0 +1,656 @@
+/***************************************************************************
+ * msfetchd.c
+ *
+ * A local stand-in for an Arclink server, serving waveform requests
+ * from Mini-SEED files held in memory.
+ *
+ * It implements the part of the protocol used by msfetch and the ObsPy
+ * Arclink client (HELLO, USER, REQUEST WAVEFORM, STATUS, DOWNLOAD,
+ * PURGE and BYE) so that fetching can be tested and timed without
+ * network access.  A processing delay and dropped connections can be
+ * configured to reproduce slow or unreliable servers.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fnmatch.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <libmseed.h>
+
+#include "arclink.h"
+
+#define VERSION "1.0"
+#define PACKAGE "msfetchd"
+
+#define MAXLINES  1000   /* Request lines accepted in a request */
+
+/* A record held in memory */
+typedef struct Record_s {
+  char     network[11];
+  char     station[11];
+  char     location[11];
+  char     channel[11];
+  hptime_t starttime;
+  hptime_t endtime;
+  int      reclen;
+  char    *record;
+}
+Record;
+
+/* A request of a client connection */
+typedef struct Request_s {
+  long      id;
+  char     *volume;
+  size_t    volumelen;
+  int       lines;
+  struct timespec ready;     /* Time the request is processed */
+  struct Request_s *next;
+}
+Request;
+
+static int  parameter_proc (int argcount, char **argvec);
+static char *getoptval (int argcount, char **argvec, int argopt);
+static int  loadfile (const char *filename);
+static void *clientthread (void *arg);
+static int  readrequest (ALConn *conn, Request **requests);
+static int  addrecords (Request *rqp, char *line);
+static int  isready (Request *rqp);
+static Request *findrequest (Request *requests, const char *idstr);
+static void usage (void);
+static void term_handler (int sig);
+
+static flag  verbose   = 0;
+static int   port      = 18001;
+static int   delay     = 0;      /* Processing delay of requests in milliseconds */
+static int   dropevery = 0;      /* Drop the connection of every Nth request */
+static int   timeout   = 300;    /* Idle client timeout in seconds */
+
+static Record *records     = 0;
+static long    recordcount = 0;
+
+static atomic_long requestcount;  /* Requests received, also the request IDs */
+
+static volatile sig_atomic_t stopsig = 0; /* Termination signal received */
+
+
+int
+main (int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  pthread_attr_t attr;
+  pthread_t thread;
+  int one = 1;
+  int listenfd;
+  int fd;
+
+  /* Signal handling, use POSIX calls with standardized semantics */
+  struct sigaction sa;
+
+  /* No SA_RESTART, termination signals should interrupt accept() */
+  sa.sa_flags = 0;
+  sigemptyset (&sa.sa_mask);
+
+  sa.sa_handler = term_handler;
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGQUIT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+
+  sa.sa_handler = SIG_IGN;
+  sigaction (SIGHUP, &sa, NULL);
+  sigaction (SIGPIPE, &sa, NULL);
+
+  /* Process given parameters (command line and parameter file) */
+  if ( parameter_proc (argc, argv) < 0 )
+    return 1;
+
+  atomic_init (&requestcount, 0);
+
+  if ( (listenfd = socket (AF_INET, SOCK_STREAM, 0)) < 0 )
+    {
+      fprintf (stderr, "Cannot create socket: %s\n", strerror (errno));
+      return 1;
+    }
+
+  setsockopt (listenfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  /* Only local clients, this is a test server */
+  memset (&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = htons (port);
+
+  if ( bind (listenfd, (struct sockaddr *) &addr, sizeof(addr)) ||
+       listen (listenfd, 64) )
+    {
+      fprintf (stderr, "Cannot listen on port %d: %s\n", port, strerror (errno));
+      return 1;
+    }
+
+  if ( verbose )
+    fprintf (stderr, "Serving %ld records on port %d\n", recordcount, port);
+
+  pthread_attr_init (&attr);
+  pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+  while ( ! stopsig )
+    {
+      if ( (fd = accept (listenfd, NULL, NULL)) < 0 )
+	{
+	  if ( errno != EINTR )
+	    fprintf (stderr, "Cannot accept connection: %s\n", strerror (errno));
+	  continue;
+	}
+
+      if ( pthread_create (&thread, &attr, clientthread, (void *) (long) fd) )
+	{
+	  fprintf (stderr, "Cannot create client thread\n");
+	  close (fd);
+	}
+    }
+
+  close (listenfd);
+
+  return 0;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * clientthread:
+ * Serve the commands of a client connection until BYE or the end of
+ * the connection.
+ ***************************************************************************/
+static void *
+clientthread (void *arg)
+{
+  ALConn *conn;
+  Request *requests = 0;
+  Request *rqp;
+  Request **rqpp;
+  char line[AL_LINELEN];
+  char *args;
+  int ready;
+  int rv = 0;
+
+  if ( (conn = (ALConn *) malloc (sizeof(ALConn))) == NULL )
+    {
+      close ((int) (long) arg);
+      return NULL;
+    }
+
+  al_attach (conn, (int) (long) arg, timeout);
+
+  while ( rv == 0 && al_readline (conn, line, sizeof(line)) >= 0 )
+    {
+      if ( verbose > 1 )
+	fprintf (stderr, "[%d] %s\n", conn->fd, line);
+
+      if ( (args = strchr (line, ' ')) )
+	*args++ = '\0';
+      else
+	args = "";
+
+      if ( ! strcmp (line, "HELLO") )
+	{
+	  rv = al_writeline (conn, "ArcLink v1.2 (%s %s)", PACKAGE, VERSION);
+	  if ( ! rv )
+	    rv = al_writeline (conn, "SDP test server");
+	}
+      else if ( ! strcmp (line, "USER") || ! strcmp (line, "INSTITUTION") ||
+		! strcmp (line, "LABEL") )
+	{
+	  rv = al_writeline (conn, "OK");
+	}
+      else if ( ! strcmp (line, "REQUEST") )
+	{
+	  if ( strncmp (args, "WAVEFORM", 8) )
+	    {
+	      /* Read and refuse other request types */
+	      while ( (rv = al_readline (conn, line, sizeof(line))) >= 0 && strcmp (line, "END") );
+	      rv = ( rv < 0 ) ? -1 : al_writeline (conn, "ERROR");
+	    }
+	  else
+	    {
+	      rv = readrequest (conn, &requests);
+	    }
+	}
+      else if ( ! strcmp (line, "STATUS") )
+	{
+	  if ( (rqp = findrequest (requests, args)) == NULL )
+	    {
+	      rv = al_writeline (conn, "ERROR");
+	      continue;
+	    }
+
+	  ready = isready (rqp);
+
+	  al_writeline (conn, "<?xml version=\"1.0\"?>");
+	  al_writeline (conn, "<arclink>");
+	  al_writeline (conn, "<request id=\"%ld\" type=\"WAVEFORM\" ready=\"%s\" size=\"%zu\" "
+			"message=\"\">", rqp->id, ( ready ) ? "true" : "false",
+			rqp->volumelen);
+	  if ( ready )
+	    al_writeline (conn, "<volume id=\"SDP\" status=\"%s\" size=\"%zu\" message=\"\"/>",
+			  ( rqp->volumelen ) ? "OK" : "NODATA", rqp->volumelen);
+	  al_writeline (conn, "</request>");
+	  al_writeline (conn, "</arclink>");
+	  rv = al_writeline (conn, "END");
+	}
+      else if ( ! strcmp (line, "DOWNLOAD") )
+	{
+	  rqp = findrequest (requests, args);
+
+	  if ( ! rqp || ! isready (rqp) || ! rqp->volumelen )
+	    {
+	      rv = al_writeline (conn, "ERROR");
+	      continue;
+	    }
+
+	  rv = al_writeline (conn, "%zu", rqp->volumelen);
+	  if ( ! rv )
+	    rv = al_writen (conn, rqp->volume, rqp->volumelen);
+	  if ( ! rv )
+	    rv = al_writeline (conn, "END");
+	}
+      else if ( ! strcmp (line, "PURGE") )
+	{
+	  for ( rqpp = &requests; *rqpp; rqpp = &(*rqpp)->next )
+	    if ( (*rqpp)->id == strtol (args, NULL, 10) )
+	      break;
+
+	  if ( (rqp = *rqpp) == NULL )
+	    {
+	      rv = al_writeline (conn, "ERROR");
+	      continue;
+	    }
+
+	  *rqpp = rqp->next;
+	  free (rqp->volume);
+	  free (rqp);
+	  rv = al_writeline (conn, "OK");
+	}
+      else if ( ! strcmp (line, "BYE") )
+	{
+	  break;
+	}
+      else
+	{
+	  rv = al_writeline (conn, "ERROR");
+	}
+    }
+
+  while ( requests )
+    {
+      rqp = requests->next;
+      free (requests->volume);
+      free (requests);
+      requests = rqp;
+    }
+
+  al_close (conn);
+  free (conn);
+
+  return NULL;
+}  /* End of clientthread() */
+
+
+/***************************************************************************
+ * readrequest:
+ * Read the lines of a waveform request up to END and collect the
+ * matching records into a new request.  The request ID is sent to the
+ * client, except for every -E Nth request for which the connection is
+ * dropped.
+ *
+ * Returns 0 on success and -1 when the connection is to be closed.
+ ***************************************************************************/
+static int
+readrequest (ALConn *conn, Request **requests)
+{
+  Request *rqp;
+  char line[AL_LINELEN];
+  int rv = 0;
+
+  if ( (rqp = (Request *) calloc (1, sizeof(Request))) == NULL )
+    return -1;
+
+  while ( (rv = al_readline (conn, line, sizeof(line))) >= 0 && strcmp (line, "END") )
+    {
+      if ( rv == 0 )
+	continue;
+
+      if ( ++rqp->lines > MAXLINES || addrecords (rqp, line) )
+	rv = -2;
+    }
+
+  rqp->id = atomic_fetch_add (&requestcount, 1) + 1;
+
+  if ( rv == -1 || (dropevery > 0 && rqp->id % dropevery == 0) )
+    {
+      if ( verbose )
+	fprintf (stderr, "Dropping connection at request %ld\n", rqp->id);
+
+      free (rqp->volume);
+      free (rqp);
+      return -1;
+    }
+
+  if ( rv == -2 )
+    {
+      free (rqp->volume);
+      free (rqp);
+      return al_writeline (conn, "ERROR");
+    }
+
+  /* The request is processed after the configured delay */
+  clock_gettime (CLOCK_MONOTONIC, &rqp->ready);
+  rqp->ready.tv_sec += delay / 1000;
+  rqp->ready.tv_nsec += (long) (delay % 1000) * 1000000;
+  if ( rqp->ready.tv_nsec >= 1000000000 )
+    {
+      rqp->ready.tv_sec++;
+      rqp->ready.tv_nsec -= 1000000000;
+    }
+
+  if ( verbose )
+    fprintf (stderr, "Request %ld: %d lines, %zu bytes\n", rqp->id, rqp->lines, rqp->volumelen);
+
+  rqp->next = *requests;
+  *requests = rqp;
+
+  return al_writeline (conn, "%ld", rqp->id);
+}  /* End of readrequest() */
+
+
+/***************************************************************************
+ * addrecords:
+ * Append the records matching a request line to the volume of a
+ * request.  Request lines are:
+ *
+ *   start end network station channel [location]
+ *
+ * with times as YYYY,MM,DD,HH,MM,SS and codes which may include the
+ * '*' and '?' wildcards.
+ *
+ * Returns 0 on success and -1 for an invalid line.
+ ***************************************************************************/
+static int
+addrecords (Request *rqp, char *line)
+{
+  char stime[64], etime[64];
+  char net[64], sta[64], cha[64], loc[64];
+  hptime_t starttime;
+  hptime_t endtime;
+  char *volume;
+  long idx;
+
+  strcpy (loc, "*");
+
+  if ( sscanf (line, "%63s %63s %63s %63s %63s %63s", stime, etime, net, sta, cha, loc) < 5 )
+    return -1;
+
+  if ( (starttime = al_parsetime (stime)) == HPTERROR ||
+       (endtime = al_parsetime (etime)) == HPTERROR )
+    return -1;
+
+  /* Empty location codes */
+  if ( ! strcmp (loc, ".") || ! strcmp (loc, "--") )
+    loc[0] = '\0';
+
+  for ( idx = 0; idx < recordcount; idx++ )
+    {
+      if ( records[idx].endtime < starttime || records[idx].starttime > endtime ||
+	   fnmatch (net, records[idx].network, 0) ||
+	   fnmatch (sta, records[idx].station, 0) ||
+	   fnmatch (cha, records[idx].channel, 0) ||
+	   fnmatch (loc, records[idx].location, 0) )
+	continue;
+
+      if ( (volume = (char *) realloc (rqp->volume, rqp->volumelen + records[idx].reclen)) == NULL )
+	return -1;
+
+      memcpy (volume + rqp->volumelen, records[idx].record, records[idx].reclen);
+      rqp->volume = volume;
+      rqp->volumelen += records[idx].reclen;
+    }
+
+  return 0;
+}  /* End of addrecords() */
+
+
+/***************************************************************************
+ * isready:
+ * Returns 1 if the processing delay of a request has passed.
+ ***************************************************************************/
+static int
+isready (Request *rqp)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+
+  return ( now.tv_sec > rqp->ready.tv_sec ||
+	   (now.tv_sec == rqp->ready.tv_sec && now.tv_nsec >= rqp->ready.tv_nsec) );
+}  /* End of isready() */
+
+
+/***************************************************************************
+ * findrequest:
+ * Returns the request of a connection with the ID in 'idstr' or NULL.
+ ***************************************************************************/
+static Request *
+findrequest (Request *requests, const char *idstr)
+{
+  long id = strtol (idstr, NULL, 10);
+
+  while ( requests && requests->id != id )
+    requests = requests->next;
+
+  return requests;
+}  /* End of findrequest() */
+
+
+/***************************************************************************
+ * loadfile:
+ * Read the records of a Mini-SEED file into memory.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+loadfile (const char *filename)
+{
+  MSFileParam *msfp = 0;
+  MSRecord *msr = 0;
+  Record *rp;
+  int retcode;
+
+  while ( (retcode = ms_readmsr_r (&msfp, &msr, (char *) filename, 0, NULL, NULL,
+				   1, 0, verbose - 1)) == MS_NOERROR )
+    {
+      if ( (recordcount % 4096) == 0 &&
+	   (records = (Record *) realloc (records, sizeof(Record) * (recordcount + 4096))) == NULL )
+	{
+	  fprintf (stderr, "Cannot allocate memory\n");
+	  return -1;
+	}
+
+      rp = &records[recordcount];
+      strcpy (rp->network, msr->network);
+      strcpy (rp->station, msr->station);
+      strcpy (rp->location, msr->location);
+      strcpy (rp->channel, msr->channel);
+      rp->starttime = msr->starttime;
+      rp->endtime = msr_endtime (msr);
+      rp->reclen = msr->reclen;
+
+      if ( (rp->record = (char *) malloc (msr->reclen)) == NULL )
+	{
+	  fprintf (stderr, "Cannot allocate memory\n");
+	  return -1;
+	}
+
+      memcpy (rp->record, msr->record, msr->reclen);
+      recordcount++;
+    }
+
+  ms_readmsr_r (&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+
+  if ( retcode != MS_ENDOFFILE )
+    {
+      fprintf (stderr, "Error reading %s: %s\n", filename, ms_errorstr (retcode));
+      return -1;
+    }
+
+  return 0;
+}  /* End of loadfile() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ *
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+  int files = 0;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+    {
+      if (strcmp (argvec[optind], "-V") == 0)
+	{
+	  fprintf (stderr, "%s version: %s\n", PACKAGE, VERSION);
+	  exit (0);
+	}
+      else if (strcmp (argvec[optind], "-h") == 0)
+	{
+	  usage ();
+	  exit (0);
+	}
+      else if (strncmp (argvec[optind], "-v", 2) == 0)
+	{
+	  verbose += strspn (&argvec[optind][1], "v");
+	}
+      else if (strcmp (argvec[optind], "-P") == 0)
+	{
+	  port = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-d") == 0)
+	{
+	  delay = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-E") == 0)
+	{
+	  dropevery = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-T") == 0)
+	{
+	  timeout = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strncmp (argvec[optind], "-", 1) == 0 &&
+	       strlen (argvec[optind]) > 1 )
+	{
+	  fprintf(stderr, "Unknown option: %s\n", argvec[optind]);
+	  exit (1);
+	}
+      else
+	{
+	  if ( loadfile (argvec[optind]) )
+	    return -1;
+	  files++;
+	}
+    }
+
+  if ( files == 0 )
+    {
+      fprintf (stderr, "No input files were specified\n\n");
+      fprintf (stderr, "%s version %s\n\n", PACKAGE, VERSION);
+      fprintf (stderr, "Try %s -h for usage\n", PACKAGE);
+      exit (1);
+    }
+
+  if ( port <= 0 || port > 65535 || delay < 0 || dropevery < 0 || timeout < 1 )
+    {
+      fprintf (stderr, "Invalid -P, -d, -E or -T value\n");
+      exit (1);
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * getoptval:
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: argument list
+ * argopt: index of option to process, value is expected to be at +1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+getoptval (int argcount, char **argvec, int argopt)
+{
+  if ( argvec == NULL || argvec[argopt] == NULL ) {
+    fprintf (stderr, "getoptval(): NULL option requested\n");
+    exit (1);
+  }
+
+  if ( (argopt+1) < argcount && *argvec[argopt+1] != '-' )
+    return argvec[argopt+1];
+
+  fprintf (stderr, "Option %s requires a value\n", argvec[argopt]);
+  exit (1);
+}  /* End of getoptval() */
+
+
+/***************************************************************************
+ * usage:
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Serve Arclink waveform requests from Mini-SEED files, for testing.\n\n");
+  fprintf (stderr, "Usage: %s [options] file1 [file2 file3 ...]\n\n", PACKAGE);
+  fprintf (stderr,
+	   " ## Options ##\n"
+	   " -V             Report program version\n"
+	   " -h             Show this usage message\n"
+	   " -v             Be more verbose, multiple flags can be used\n"
+	   " -P port        Port to listen on (local connections only), default 18001\n"
+	   " -d msecs       Processing delay of each request, default 0\n"
+	   " -E count       Drop the connection of every Nth request, default never\n"
+	   " -T secs        Close connections idle for this long, default 300\n"
+	   "\n"
+	   " file(s)        File(s) of Mini-SEED records to serve\n"
+	   "\n");
+}  /* End of usage() */
+
+
+/***************************************************************************
+ * term_handler:
+ * Signal handler routine, stop accepting connections.
+ ***************************************************************************/
+static void
+term_handler (int sig)
+{
+  stopsig = 1;
+}  /* End of term_handler() */
@@ -10,7 +10,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center.
  *
- * modified 2011.332
+ * modified 2026.292
  ***************************************************************************/
 
 #include <stdio.h>
@@ -29,9 +29,10 @@ static int readregexfile (char *regexfile, char **pppattern);
 static int lisnumber (char *number);
 static int addfile (char *filename);
 static int addlistfile (char *filename);
+static int parallelscan (MSTraceList **ppmstl);
 static void usage (void);
 
-#define VERSION "3.5"
+#define VERSION "3.6"
 #define PACKAGE "msi"
 
 static flag    verbose      = 0;
@@ -47,6 +48,8 @@ static flag    tracegaps    = 0;    /* Controls printing of gaps with a trace li
 static flag    timeformat   = 0;    /* Time string format for trace or gap lists */
 static flag    dataquality  = 0;    /* Control matching of data qualities */
 static flag    skipnotdata  = 1;    /* Controls skipping of non-SEED data */
+static flag    useindex     = 1;    /* Controls use of file time indexes with -ts/-te */
+static flag    writeindex   = 0;    /* Controls writing of file time index sidecars */
 static double  timetol      = -1.0; /* Time tolerance for continuous traces */
 static double  sampratetol  = -1.0; /* Sample rate tolerance for continuous traces */
 static double  mingap       = 0;    /* Minimum gap/overlap seconds when printing gap list */
@@ -55,6 +58,7 @@ static double  maxgap       = 0;    /* Maximum gap/overlap seconds when printing
 static double *maxgapptr    = NULL;
 static int     reccntdown   = -1;
 static int     reclen       = -1;
+static int     threads      = 0;    /* Threads for parallel trace/gap list scans */
 static char   *encodingstr  = 0;
 static char   *binfile      = 0;
 static char   *outfile      = 0;
@@ -79,12 +83,14 @@ main (int argc, char **argv)
   struct filelink *flp;
   MSRecord *msr = 0;
   MSTraceList *mstl = 0;
+  MSFileIndex *index = 0;
   FILE *bfp = 0;
   FILE *ofp = 0;
   int retcode = MS_NOERROR;
   
   char envvariable[100];
   int dataflag = 0;
+  int scanned = 0;
   long long int totalrecs  = 0;
   long long int totalsamps = 0;
   long long int totalfiles = 0;
@@ -148,7 +154,18 @@ main (int argc, char **argv)
   if ( tracegapsum || tracegaponly )
     mstl = mstl_init (NULL);
   
-  flp = filelist;
+  /* Build trace/gap lists with multiple threads if possible */
+  if ( threads > 1 && tracegaponly )
+    {
+      if ( (scanned = parallelscan (&mstl)) < 0 )
+        {
+          mstl_free (&mstl, 0);
+          return 1;
+        }
+    }
+  
+  /* Skip record-by-record processing if the trace list was built */
+  flp = ( scanned > 0 ) ? 0 : filelist;
   
   while ( flp != 0 )
     {
@@ -163,11 +180,25 @@ main (int argc, char **argv)
       /* Set starting byte offset if supplied as negative file position */
       filepos = - flp->offset;
       
+      /* Read only records in the time window using a file time index, from
+       * a current sidecar or built with -wi, otherwise read sequentially */
+      if ( useindex && skipnotdata && (starttime != HPTERROR || endtime != HPTERROR) &&
+	   ! flp->offset && strcmp (flp->filename, "-") )
+	{
+	  if ( (index = ms_readfileindex (flp->filename, reclen, writeindex, verbose)) )
+	    ms_selectfileindex (index, starttime, endtime);
+	}
+      
       /* Loop over the input file */
       while ( reccntdown != 0 )
 	{
-	  if ( (retcode = ms_readmsr (&msr, flp->filename, reclen, &filepos,
-				      NULL, skipnotdata, 0, verbose)) != MS_NOERROR )
+	  if ( index )
+	    retcode = ms_readmsr_fileindex (index, &msr, &filepos, 0, verbose);
+	  else
+	    retcode = ms_readmsr (&msr, flp->filename, reclen, &filepos,
+				  NULL, skipnotdata, 0, verbose);
+	  
+	  if ( retcode != MS_NOERROR )
 	    break;
 	  
 	  /* Check if record matches start/end time criteria */
@@ -352,11 +383,13 @@ main (int argc, char **argv)
 	{
 	  ms_log (2, "Cannot read %s: %s\n", flp->filename, ms_errorstr(retcode));
 	  ms_readmsr (&msr, NULL, 0, NULL, NULL, 0, 0, 0);
+	  ms_freefileindex (&index);
 	  exit (1);
 	}
       
       /* Make sure everything is cleaned up */
       ms_readmsr (&msr, NULL, 0, NULL, NULL, 0, 0, 0);
+      ms_freefileindex (&index);
       
       totalfiles++;
       flp = flp->next;
@@ -461,6 +494,14 @@ processparam (int argcount, char **argvec)
 	{
 	  skipnotdata = 0;
 	}
+      else if (strcmp (argvec[optind], "-ni") == 0)
+	{
+	  useindex = 0;
+	}
+      else if (strcmp (argvec[optind], "-wi") == 0)
+	{
+	  writeindex = 1;
+	}
       else if (strncmp (argvec[optind], "-p", 2) == 0)
 	{
 	  ppackets += strspn (&argvec[optind][1], "p");
@@ -539,6 +580,10 @@ processparam (int argcount, char **argvec)
 	{
 	  dataquality = 1;
 	}
+      else if (strcmp (argvec[optind], "-j") == 0)
+	{
+	  threads = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
       else if (strcmp (argvec[optind], "-tf") == 0)
 	{
 	  timeformat = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
@@ -952,6 +997,84 @@ addlistfile (char *filename)
 }  /* End of addlistfile() */
 
 
+/***************************************************************************
+ * parallelscan:
+ *
+ * Build the trace list from all input files using multiple threads
+ * with ms_readtracelist_parallel().  Only trace and gap list output
+ * can be produced this way, when options that require record-by-record
+ * processing are specified nothing is done and the input files should
+ * be processed sequentially.
+ *
+ * Returns 1 when the trace list was built, 0 if the options do not
+ * allow a parallel scan and -1 on error.
+ ***************************************************************************/
+static int
+parallelscan (MSTraceList **ppmstl)
+{
+  struct filelink *flp;
+  Selections *selections = 0;
+  char **files;
+  int filecount = 0;
+  int idx;
+  int retcode;
+  
+  /* Options that depend on the record-by-record loop */
+  if ( match || reject || basicsum || outfile || binfile || reccntdown >= 0 )
+    {
+      if ( verbose )
+        ms_log (1, "Selected options require sequential processing, ignoring -j\n");
+      return 0;
+    }
+  
+  for ( flp = filelist; flp; flp = flp->next )
+    {
+      /* Starting offsets and stdin are not supported */
+      if ( flp->offset || ! strcmp (flp->filename, "-") )
+        {
+          if ( verbose )
+            ms_log (1, "Input offsets and stdin require sequential processing, ignoring -j\n");
+          return 0;
+        }
+      
+      filecount++;
+    }
+  
+  if ( ! (files = (char **) malloc (filecount * sizeof(char *))) )
+    {
+      ms_log (2, "Cannot allocate memory\n");
+      return -1;
+    }
+  
+  for ( idx = 0, flp = filelist; flp; flp = flp->next )
+    files[idx++] = flp->filename;
+  
+  /* The start and end time limits have the same semantics as a selection window */
+  if ( starttime != HPTERROR || endtime != HPTERROR )
+    {
+      if ( ms_addselect (&selections, "*", starttime, endtime) )
+        {
+          free (files);
+          return -1;
+        }
+    }
+  
+  if ( verbose )
+    ms_log (1, "Scanning %d file(s) with %d threads\n", filecount, threads);
+  
+  retcode = ms_readtracelist_parallel (ppmstl, files, filecount, threads, reclen,
+                                       timetol, sampratetol, selections, dataquality,
+                                       skipnotdata, 0, verbose);
+  
+  if ( selections )
+    ms_freeselections (selections);
+  
+  free (files);
+  
+  return ( retcode == MS_NOERROR ) ? 1 : -1;
+}  /* End of parallelscan() */
+
+
 /***************************************************************************
  * usage():
  * Print the usage message.
@@ -973,6 +1096,8 @@ usage (void)
 	   " -ts time     Limit to records that start after time\n"
 	   " -te time     Limit to records that end before time\n"
 	   "                time format: 'YYYY[,DDD,HH,MM,SS,FFFFFF]' delimiters: [,:.]\n"
+	   " -ni          Do not use file time indexes for -ts and -te\n"
+	   " -wi          Build file time indexes and write '.<file>.msidx' sidecars\n"
 	   " -M match     Limit to records matching the specified regular expression\n"
 	   " -R reject    Limit to records not matching the specfied regular expression\n"
 	   "                Regular expressions are applied to: 'NET_STA_LOC_CHAN_QUAL'\n"
@@ -1002,6 +1127,7 @@ usage (void)
 	   " -Q           Additionally group traces by data quality\n"
 	   " -tf format   Specify a time string format for trace and gap lists\n"
 	   "                format: 0 = SEED time, 1 = ISO time, 2 = epoch time\n"
+	   " -j threads   Scan files with multiple threads for -T, -G and -S output\n"
 	   "\n"
 	   " ## Data output options ##\n"
 	   " -b binfile   Unpack/decompress data and write binary samples to binfile\n"
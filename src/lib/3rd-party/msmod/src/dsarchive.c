@@ -10,7 +10,7 @@
  * file.  The definition of the groups is implied by the format of the
  * archive.
  *
- * modified: 2008.162
+ * modified: 2026.292
  ***************************************************************************/
 
 #include <stdio.h>
@@ -19,6 +19,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/resource.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
@@ -28,19 +29,70 @@
 
 #include "dsarchive.h"
 
-/* For a linked list of strings, as filled by strparse() */
-typedef struct strlist_s {
-  char             *element;
-  struct strlist_s *next;
-} strlist;
+/* Compiled layout operation, see ds_compilelayout() */
+typedef struct DSLayoutOp_s {
+  char        code;     /* Format code, 0 for literal text or '/' for a directory */
+  char        def;      /* Value is part of the definition key ('%' codes) */
+  int         length;   /* Length of literal text */
+  const char *text;     /* Literal text, not NULL terminated */
+} DSLayoutOp;
+
+/* Compiled layout and cache of existing directories for a DataStream */
+struct DataStreamLayout_s {
+  DSLayoutOp *ops;      /* Layout operations in order */
+  int         opcount;  /* Number of layout operations */
+  char       *text;     /* Storage for literal text of operations */
+  char      **dirs;     /* Hash set of directories known to exist */
+  int         dirsize;  /* Number of directory slots, a power of 2 */
+  int         dircount; /* Number of directories in the set */
+};
+
+/* Hash table of DataStreamGroups by definition key with chaining,
+ * the groups are also linked in order of use from grouproot (least
+ * recently used) to tail (most recently used). */
+struct DataStreamIndex_s {
+  DataStreamGroup **buckets;    /* Hash buckets, linked by hashnext */
+  int               size;       /* Number of buckets, a power of 2 */
+  int               count;      /* Number of groups in the table */
+  DataStreamGroup  *tail;       /* Most recently used group */
+};
+
+/* Initial number of hash buckets, the table doubles when the number
+ * of groups exceeds the number of buckets */
+#define DS_INDEXSIZE 256
+
+/* Initial number of record key slots for a DataStreamGroup, the set
+ * doubles when it is half full */
+#define DS_RECKEYSIZE 1024
+
+/* Initial number of directory cache slots and the maximum number of
+ * cached directories, the cache is cleared when the maximum is reached */
+#define DS_DIRCACHESIZE 256
+#define DS_DIRCACHEMAX  65536
 
 /* Functions internal to this source file */
 static DataStreamGroup *ds_getstream (DataStream *datastream, MSRecord *msr,
 				      const char *defkey, const char *filename);
 static int ds_openfile (DataStream *datastream, const char *filename);
 static int ds_closeidle (DataStream *datastream, int idletimeout);
-static void ds_shutdown (DataStream *datastream);
-static int strparse (const char *string, const char *delim, strlist **list);
+static int ds_shutdown (DataStream *datastream);
+static unsigned int ds_hashkey (const char *defkey);
+static int ds_indexgroup (DataStream *datastream, DataStreamGroup *group);
+static void ds_removegroup (DataStream *datastream, DataStreamGroup *group);
+static int ds_writegroup (DataStream *datastream, DataStreamGroup *group,
+			  const void *data, size_t length);
+static int ds_flushgroup (DataStreamGroup *group, const void *data, size_t length);
+static int ds_closegroup (DataStream *datastream, DataStreamGroup *group);
+static uint64_t ds_recordkey (const char *record);
+static int ds_findreckey (DataStreamGroup *group, uint64_t key, int add);
+static int ds_loadreckeys (DataStreamGroup *group, const char *filename);
+static struct DataStreamLayout_s *ds_compilelayout (const char *path);
+static void ds_freelayout (struct DataStreamLayout_s *layout);
+static void ds_append (char *buf, size_t size, size_t *length,
+		       const char *value, size_t valuelength);
+static int ds_mkdirs (DataStream *datastream, const char *filename);
+static int ds_dircached (struct DataStreamLayout_s *layout, const char *dir, int add);
+static void ds_dirclear (struct DataStreamLayout_s *layout);
 
 static int dsverbose;
 
@@ -50,26 +102,39 @@ static int dsverbose;
  * Save MiniSEED records in a custom directory/file structure.  The
  * appropriate directories and files are created if nesecessary.  If
  * files already exist they are appended to.  If 'msr' is NULL then
- * ds_shutdown() will be called to close all open files and free all
- * associated memory.
+ * ds_shutdown() will be called to write buffered data, close all open
+ * files and free all associated memory, the return value then reports
+ * if any stream file could not be written or closed, including files
+ * that were closed earlier because they were idle.
+ *
+ * The path layout is compiled on first use and the file name and
+ * definition key are generated from the compiled layout for each
+ * record.  Directories are created when a file is opened.
  *
  * This version has been modified from others to add the add the suffix
  * integer supplied with ds_streamproc() to the defkey and file name.
  *
+ * If DataStream.uniqueflag is set data records that are already in
+ * the file, or were written to it before, are skipped, see
+ * ds_recordkey().
+ *
  * Returns 0 on success, -1 on error.
  ***************************************************************************/
 extern int
 ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
 {
   DataStreamGroup *foundgroup = NULL;
+  DSLayoutOp *op;
   BTime stime;
-  strlist *fnlist, *fnptr;
   char net[3], sta[6], loc[3], chan[4];
   char filename[400];
   char definition[400];
-  char pathformat[600];
   char tstr[20];
-  int fnlen = 0;
+  const char *value;
+  size_t fnlen = 0;
+  size_t deflen = 0;
+  int tdy;
+  int idx;
   
   /* Set Verbosity for ds_ functions */
   dsverbose = verbose;
@@ -80,8 +145,7 @@ ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
       if ( dsverbose >= 1 )
         fprintf (stderr, "Closing archiving for: %s\n", datastream->path );
       
-      ds_shutdown ( datastream );
-      return 0;
+      return ds_shutdown ( datastream );
     }
   
   if ( ! msr->fsdh )
@@ -90,243 +154,109 @@ ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
       return -1;
     }
   
-  /* Build file path and name from datastream->path */
-  filename[0] = '\0';
-  definition[0] = '\0';
-  snprintf (pathformat, sizeof(pathformat), "%s", datastream->path);
-  strparse (pathformat, "/", &fnlist);
-
-  fnptr = fnlist;
-
-  /* Special case of an absolute path (first entry is empty) */
-  if ( *fnptr->element == '\0' )
+  /* Compile the path layout on first use */
+  if ( ! datastream->layout )
     {
-      if ( fnptr->next != 0 )
-	{
-	  strncat (filename, "/", sizeof(filename));
-	  fnptr = fnptr->next;
-	}
-      else
-	{
-	  fprintf (stderr, "ds_streamproc(): empty path format\n");
-	  strparse (NULL, NULL, &fnlist);
-	  return -1;
-	}
+      if ( ! (datastream->layout = ds_compilelayout (datastream->path)) )
+	return -1;
     }
   
   /* Convert normalized starttime to BTime structure */
   if ( ms_hptime2btime (msr->starttime, &stime) )
     {
       fprintf (stderr, "ds_streamproc(): cannot convert start time to separate fields\n");
-      strparse (NULL, NULL, &fnlist);
       return -1;
     }
   
-  while ( fnptr != 0 )
+  /* Build file path and name from the compiled layout */
+  filename[0] = '\0';
+  definition[0] = '\0';
+  
+  for ( idx = 0; idx < datastream->layout->opcount; idx++ )
     {
-      int tdy;
-      char *w, *p, def;
-
-      p = fnptr->element;
-
-      /* Special case of no file given */
-      if ( *p == '\0' && fnptr->next == 0 )
-	{
-	  fprintf (stderr, "ds_streamproc(): no file name specified, only %s\n",
-		   filename);
-	  strparse (NULL, NULL, &fnlist);
-	  return -1;
-	}
-
-      while ( (w = strpbrk (p, "%#")) != NULL )
-	{
-	  def = ( *w == '%' );
-	  *w = '\0';
-	  strncat (filename, p, (sizeof(filename) - fnlen));
-	  fnlen = strlen (filename);
-
-	  w += 1;
-
-	  switch ( *w )
-	    {
-	    case 'n' :
-	      ms_strncpclean (net, msr->fsdh->network, 2);
-	      strncat (filename, net, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, net, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 's' :
-	      ms_strncpclean (sta, msr->fsdh->station, 5);
-	      strncat (filename, sta, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, sta, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'l' :
-	      ms_strncpclean (loc, msr->fsdh->location, 2);
-	      strncat (filename, loc, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, loc, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'c' :
-	      ms_strncpclean (chan, msr->fsdh->channel, 3);
-	      strncat (filename, chan, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, chan, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'Y' :
-	      snprintf (tstr, sizeof(tstr), "%04d", (int) stime.year);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'y' :
-	      tdy = (int) stime.year;
-	      while ( tdy > 100 )
-		{
-		  tdy -= 100;
-		}
-	      snprintf (tstr, sizeof(tstr), "%02d", tdy);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'j' :
-	      snprintf (tstr, sizeof(tstr), "%03d", (int) stime.day);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'H' :
-	      snprintf (tstr, sizeof(tstr), "%02d", (int) stime.hour);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'M' :
-	      snprintf (tstr, sizeof(tstr), "%02d", (int) stime.min);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'S' :
-	      snprintf (tstr, sizeof(tstr), "%02d", (int) stime.sec);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'F' :
-	      snprintf (tstr, sizeof(tstr), "%04d", (int) stime.fract);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'q' :
-	      snprintf (tstr, sizeof(tstr), "%c", msr->dataquality);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'L' :
-	      snprintf (tstr, sizeof(tstr), "%d", msr->reclen);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'r' :
-	      snprintf (tstr, sizeof(tstr), "%ld", (long int) (msr->samprate+0.5));
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case 'R' :
-	      snprintf (tstr, sizeof(tstr), "%.6f", msr->samprate);
-	      strncat (filename, tstr, (sizeof(filename) - fnlen));
-	      if ( def ) strncat (definition, tstr, (sizeof(definition) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case '%' :
-	      strncat (filename, "%", (sizeof(filename) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    case '#' :
-	      strncat (filename, "#", (sizeof(filename) - fnlen));
-	      fnlen = strlen (filename);
-	      p = w + 1;
-	      break;
-	    default :
-	      fprintf (stderr, "Unknown layout format code: '%c'\n", *w);
-	      p = w;
-	      break;
-	    }
-	}
+      op = &datastream->layout->ops[idx];
+      value = tstr;
       
-      strncat (filename, p, (sizeof(filename) - fnlen));
-      fnlen = strlen (filename);
-
-      /* If not the last entry then it should be a directory */
-      if ( fnptr->next != 0 )
+      switch ( op->code )
 	{
-	  if ( access (filename, F_OK) )
+	case 0 :
+	  ds_append (filename, sizeof(filename), &fnlen, op->text, op->length);
+	  continue;
+	case '/' :
+	  ds_append (filename, sizeof(filename), &fnlen, "/", 1);
+	  continue;
+	case 'n' :
+	  ms_strncpclean (net, msr->fsdh->network, 2);
+	  value = net;
+	  break;
+	case 's' :
+	  ms_strncpclean (sta, msr->fsdh->station, 5);
+	  value = sta;
+	  break;
+	case 'l' :
+	  ms_strncpclean (loc, msr->fsdh->location, 2);
+	  value = loc;
+	  break;
+	case 'c' :
+	  ms_strncpclean (chan, msr->fsdh->channel, 3);
+	  value = chan;
+	  break;
+	case 'Y' :
+	  snprintf (tstr, sizeof(tstr), "%04d", (int) stime.year);
+	  break;
+	case 'y' :
+	  tdy = (int) stime.year;
+	  while ( tdy > 100 )
 	    {
-	      if ( errno == ENOENT )
-		{
-		  if ( dsverbose >= 1 )
-		    fprintf (stderr, "Creating directory: %s\n", filename);
-
-		  if (mkdir
-		      (filename, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH))
-		    {
-		      fprintf (stderr, "ds_streamproc: mkdir(%s) %s\n", filename, strerror (errno));
-		      strparse (NULL, NULL, &fnlist);
-		      return -1;
-		    }
-		}
-	      else
-		{
-		  fprintf (stderr, "%s: access denied, %s\n", filename, strerror(errno));
-		  strparse (NULL, NULL, &fnlist);
-		  return -1;
-		}
+	      tdy -= 100;
 	    }
-
-	  strncat (filename, "/", (sizeof(filename) - fnlen));
-	  fnlen++;
+	  snprintf (tstr, sizeof(tstr), "%02d", tdy);
+	  break;
+	case 'j' :
+	  snprintf (tstr, sizeof(tstr), "%03d", (int) stime.day);
+	  break;
+	case 'H' :
+	  snprintf (tstr, sizeof(tstr), "%02d", (int) stime.hour);
+	  break;
+	case 'M' :
+	  snprintf (tstr, sizeof(tstr), "%02d", (int) stime.min);
+	  break;
+	case 'S' :
+	  snprintf (tstr, sizeof(tstr), "%02d", (int) stime.sec);
+	  break;
+	case 'F' :
+	  snprintf (tstr, sizeof(tstr), "%04d", (int) stime.fract);
+	  break;
+	case 'q' :
+	  snprintf (tstr, sizeof(tstr), "%c", msr->dataquality);
+	  break;
+	case 'L' :
+	  snprintf (tstr, sizeof(tstr), "%d", msr->reclen);
+	  break;
+	case 'r' :
+	  snprintf (tstr, sizeof(tstr), "%ld", (long int) (msr->samprate+0.5));
+	  break;
+	case 'R' :
+	  snprintf (tstr, sizeof(tstr), "%.6f", msr->samprate);
+	  break;
+	default :
+	  continue;
 	}
-
-      fnptr = fnptr->next;
+      
+      ds_append (filename, sizeof(filename), &fnlen, value, strlen (value));
+      
+      if ( op->def )
+	ds_append (definition, sizeof(definition), &deflen, value, strlen (value));
     }
-
-  strparse (NULL, NULL, &fnlist);
-
+  
   /* Add ".suffix" to filename and definition if suffix is not 0 */
   if ( suffix )
     {
       snprintf (tstr, sizeof(tstr), ".%ld", suffix);
-      strncat (filename, tstr, (sizeof(filename) - fnlen));
-      strncat (definition, tstr, (sizeof(definition) - fnlen));
-      fnlen = strlen (filename);
+      ds_append (filename, sizeof(filename), &fnlen, tstr, strlen (tstr));
+      ds_append (definition, sizeof(definition), &deflen, tstr, strlen (tstr));
     }
-
-  /* Make sure the filename and definition are NULL terminated */
-  *(filename + sizeof(filename) - 1) = '\0';
-  *(definition + sizeof(definition) -1) = '\0';
-
+  
   /* Check for previously used stream entry, otherwise create it */
   foundgroup = ds_getstream (datastream, msr, definition, filename);
 
@@ -338,9 +268,11 @@ ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
 	  if ( dsverbose >= 3 )
 	    fprintf (stderr, "Writing binary data samples to data stream file %s\n", filename);
 	  
-	  if ( !write (foundgroup->filed, msr->datasamples, msr->numsamples * ms_samplesize(msr->sampletype)) )
+	  if ( ds_writegroup (datastream, foundgroup, msr->datasamples,
+			      (size_t) (msr->numsamples * ms_samplesize(msr->sampletype))) )
 	    {
 	      fprintf (stderr, "ds_streamproc: failed to write binary data samples\n");
+	      foundgroup->modtime = time (NULL);
 	      return -1;
 	    }
 	  else
@@ -351,12 +283,26 @@ ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
       /* Write the data record to the appropriate file */ 
       else
 	{
+	  if ( datastream->uniqueflag &&
+	       ds_findreckey (foundgroup, ds_recordkey (msr->record), 1) )
+	    {
+	      if ( dsverbose >= 2 )
+		fprintf (stderr, "Skipping duplicate data record for file %s\n", filename);
+	      
+	      datastream->skipped++;
+	      
+	      /* The stream is no longer in use, allow ds_closeidle to close it */
+	      foundgroup->modtime = time (NULL);
+	      return 0;
+	    }
+	  
 	  if ( dsverbose >= 3 )
 	    fprintf (stderr, "Writing data record to data stream file %s\n", filename);
 	  
-	  if ( !write (foundgroup->filed, msr->record, msr->reclen) )
+	  if ( ds_writegroup (datastream, foundgroup, msr->record, (size_t) msr->reclen) )
 	    {
 	      fprintf (stderr, "ds_streamproc: failed to write data record\n");
+	      foundgroup->modtime = time (NULL);
 	      return -1;
 	    }
 	  else
@@ -372,12 +318,45 @@ ds_streamproc (DataStream *datastream, MSRecord *msr, long suffix, int verbose)
 }  /* End of ds_streamproc() */
 
 
+/***************************************************************************
+ * ds_isdefining:
+ *
+ * Check if a layout format code is used as a defining flag (with the
+ * '%' modifier) in an archive path layout.
+ *
+ * Returns 1 if the code is defining and 0 otherwise.
+ ***************************************************************************/
+extern int
+ds_isdefining (const char *path, char code)
+{
+  const char *p;
+  
+  for ( p = path; *p; p++ )
+    {
+      if ( *p != '%' && *p != '#' )
+	continue;
+      
+      if ( *(p+1) == '\0' )
+	break;
+      
+      if ( *p == '%' && *(p+1) == code && code != '%' && code != '#' )
+	return 1;
+      
+      /* Skip code character, including escaped '%' and '#' */
+      p++;
+    }
+  
+  return 0;
+}  /* End of ds_isdefining() */
+
+
 /***************************************************************************
  * ds_getstream:
  *
  * Find the DataStreamGroup entry that matches the definition key, if
  * no matching entries are found allocate a new entry and open the
- * given file.
+ * given file.  Entries are found in a hash table by definition key
+ * and the returned entry becomes the most recently used.
  *
  * Resource maintenance is performed here: the modification time of
  * each stream, modtime, is compared to the current time.  If the
@@ -391,69 +370,69 @@ ds_getstream (DataStream *datastream, MSRecord *msr,
 	      const char *defkey, const char *filename)
 {
   DataStreamGroup *foundgroup  = NULL;
-  DataStreamGroup *searchgroup = NULL;
-  DataStreamGroup *prevgroup   = NULL;
+  unsigned int keyhash;
   time_t curtime;
   
-  searchgroup = datastream->grouproot;
   curtime = time (NULL);
+  keyhash = ds_hashkey (defkey);
   
-  /* Traverse the stream chain looking for matching streams */
-  while (searchgroup != NULL)
+  /* Search the hash table for a matching stream */
+  if ( datastream->index )
     {
-      DataStreamGroup *nextgroup  = (DataStreamGroup *) searchgroup->next;
+      foundgroup = datastream->index->buckets[keyhash & (datastream->index->size - 1)];
       
-      if ( !strcmp (searchgroup->defkey, defkey) )
+      while ( foundgroup && (foundgroup->keyhash != keyhash || strcmp (foundgroup->defkey, defkey)) )
+	foundgroup = foundgroup->hashnext;
+    }
+  
+  if ( foundgroup )
+    {
+      if ( dsverbose >= 3 )
+	fprintf (stderr, "Found data stream entry for key %s\n", defkey);
+      
+      /* Keep ds_closeidle from closing this stream */
+      if ( foundgroup->modtime > 0 )
 	{
-	  if ( dsverbose >= 3 )
-	    fprintf (stderr, "Found data stream entry for key %s\n", defkey);
-	  
-	  foundgroup = searchgroup;
-	  
-	  /* Keep ds_closeidle from closing this stream */
-	  if ( foundgroup->modtime > 0 )
-	    {
-	      foundgroup->modtime *= -1;
-	    }
-
-	  break;
+	  foundgroup->modtime *= -1;
 	}
       
-      prevgroup = searchgroup;
-      searchgroup = nextgroup;
+      /* Move to the end of the use order */
+      if ( foundgroup != datastream->index->tail )
+	{
+	  ds_removegroup (datastream, foundgroup);
+	  
+	  if ( ds_indexgroup (datastream, foundgroup) )
+	    return NULL;
+	}
     }
-
   /* If not found, create a stream entry */
-  if ( foundgroup == NULL )
+  else
     {
       if ( dsverbose >= 2 )
 	fprintf (stderr, "Creating data stream entry for key %s\n", defkey);
 
-      foundgroup = (DataStreamGroup *) malloc (sizeof (DataStreamGroup));
+      if ( ! (foundgroup = (DataStreamGroup *) calloc (1, sizeof (DataStreamGroup))) )
+	{
+	  fprintf (stderr, "ds_getstream(): cannot allocate memory\n");
+	  return NULL;
+	}
 
       foundgroup->defkey = strdup (defkey);
+      foundgroup->keyhash = keyhash;
       foundgroup->filed = 0;
-      foundgroup->modtime = curtime;
-      foundgroup->next = NULL;
-
-      /* Set the stream root if this is the first entry */
-      if (datastream->grouproot == NULL)
-	{
-	  datastream->grouproot = foundgroup;
-	}
-      /* Otherwise add to the end of the chain */
-      else if (prevgroup != NULL)
-	{
-	  prevgroup->next = foundgroup;
-	}
-      else
+      
+      /* Keep ds_closeidle from closing this stream */
+      foundgroup->modtime = -curtime;
+      
+      if ( ds_indexgroup (datastream, foundgroup) )
 	{
-	  fprintf (stderr, "stream chain is broken!\n");
+	  free (foundgroup->defkey);
+	  free (foundgroup);
 	  return NULL;
 	}
     }
   
-  /* Close idle stream files */
+  /* Close idle stream files, failures are reported by ds_shutdown() */
   ds_closeidle (datastream, datastream->idletimeout);
   
   /* If no file is open, well, open it */
@@ -464,7 +443,23 @@ ds_getstream (DataStream *datastream, MSRecord *msr,
       if ( dsverbose >= 1 )
 	fprintf (stderr, "Opening data stream file %s\n", filename);
       
-      if ( (foundgroup->filed = ds_openfile (datastream, filename)) == -1 )
+      if ( ds_mkdirs (datastream, filename) )
+	return NULL;
+      
+      foundgroup->filed = ds_openfile (datastream, filename);
+      
+      /* Directories may have been removed since they were cached */
+      if ( foundgroup->filed == -1 && errno == ENOENT )
+	{
+	  ds_dirclear (datastream->layout);
+	  
+	  if ( ds_mkdirs (datastream, filename) )
+	    return NULL;
+	  
+	  foundgroup->filed = ds_openfile (datastream, filename);
+	}
+      
+      if ( foundgroup->filed == -1 )
 	{
 	  fprintf (stderr, "cannot open data stream file, %s\n", strerror (errno));
 	  return NULL;
@@ -475,6 +470,10 @@ ds_getstream (DataStream *datastream, MSRecord *msr,
 	  fprintf (stderr, "cannot seek in data stream file, %s\n", strerror (errno));
 	  return NULL;
 	}      
+      
+      /* Load the keys of the records in the file to skip duplicates */
+      if ( datastream->uniqueflag && filepos > 0 )
+	ds_loadreckeys (foundgroup, filename);
     }
   
   return foundgroup;
@@ -569,16 +568,20 @@ ds_openfile (DataStream *datastream, const char *filename)
  * ds_closeidle:
  *
  * Close all stream files that have not been active for the specified
- * idletimeout.
+ * idletimeout.  Streams are checked in order of use starting with the
+ * least recently used, the search stops at the first stream that is
+ * not idle.  Streams in use (negative modtime) are skipped.  Files
+ * that cannot be written or closed are counted in
+ * DataStream.closefailed.
  *
- * Return the number of files closed.
+ * Return the number of files closed or -1 if any file failed to close.
  ***************************************************************************/
 static int
 ds_closeidle (DataStream *datastream, int idletimeout)
 {
   int count = 0;
+  int failed = 0;
   DataStreamGroup *searchgroup = NULL;
-  DataStreamGroup *prevgroup   = NULL;
   DataStreamGroup *nextgroup   = NULL;
   time_t curtime;
   
@@ -595,51 +598,487 @@ ds_closeidle (DataStream *datastream, int idletimeout)
 	  if ( dsverbose >= 2 )
 	    fprintf (stderr, "Closing idle stream with key %s\n", searchgroup->defkey);
 	  
-	  /* Re-link the stream chain */
-	  if ( prevgroup != NULL )
-	    {
-	      if ( searchgroup->next != NULL )
-		prevgroup->next = searchgroup->next;
-	      else
-		prevgroup->next = NULL;
-	    }
-	  else
-	    {
-	      if ( searchgroup->next != NULL )
-		datastream->grouproot = searchgroup->next;
-	      else
-		datastream->grouproot = NULL;
-	    }
+	  /* Unlink from the stream chain and hash table */
+	  ds_removegroup (datastream, searchgroup);
 	  
-	  /* Close the associated file */
-	  if ( close (searchgroup->filed) )
-	    fprintf (stderr, "ds_closeidle(), closing data stream file, %s\n",
-		    strerror (errno));
+	  /* Write buffered data and close the associated file */
+	  if ( ds_closegroup (datastream, searchgroup) )
+	    failed++;
 	  else
 	    count++;
 	  
 	  free (searchgroup->defkey); 
 	  free (searchgroup);
 	}
-      else
+      else if ( searchgroup->modtime > 0 )
 	{
-	  prevgroup = searchgroup;
+	  /* Streams are in order of use, following streams are not idle */
+	  break;
 	}
       
       searchgroup = nextgroup;
     }
   
+  if ( failed )
+    {
+      datastream->closefailed += failed;
+      return -1;
+    }
+  
   return count;
 }  /* End of ds_closeidle() */
 
 
 /***************************************************************************
- * ds_shutdown:
+ * ds_hashkey:
  *
- * Close all stream files and release all of the DataStreamGroup memory
- * structures.
+ * Return a FNV-1a hash of a definition key.
+ ***************************************************************************/
+static unsigned int
+ds_hashkey (const char *defkey)
+{
+  return ms_fnv1a32 (MS_FNV32_INIT, defkey, strlen (defkey));
+}  /* End of ds_hashkey() */
+
+
+/***************************************************************************
+ * ds_indexgroup:
+ *
+ * Add a DataStreamGroup to the hash table and to the end of the use
+ * order of a DataStream.  The hash table is allocated when needed and
+ * doubled when the number of groups exceeds the number of buckets.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_indexgroup (DataStream *datastream, DataStreamGroup *group)
+{
+  struct DataStreamIndex_s *index = datastream->index;
+  DataStreamGroup **buckets;
+  DataStreamGroup *rehash;
+  unsigned int bucket;
+  int size;
+  
+  if ( ! index )
+    {
+      if ( ! (index = (struct DataStreamIndex_s *) calloc (1, sizeof (struct DataStreamIndex_s))) )
+	{
+	  fprintf (stderr, "ds_indexgroup(): cannot allocate memory\n");
+	  return -1;
+	}
+      
+      datastream->index = index;
+    }
+  
+  /* Allocate or grow the hash table, rehashing from the use order */
+  if ( ! index->buckets || index->count >= index->size )
+    {
+      size = ( index->buckets ) ? index->size * 2 : DS_INDEXSIZE;
+      
+      if ( ! (buckets = (DataStreamGroup **) calloc (size, sizeof (DataStreamGroup *))) )
+	{
+	  fprintf (stderr, "ds_indexgroup(): cannot allocate memory\n");
+	  return -1;
+	}
+      
+      for ( rehash = datastream->grouproot; rehash; rehash = rehash->next )
+	{
+	  bucket = rehash->keyhash & (size - 1);
+	  rehash->hashnext = buckets[bucket];
+	  buckets[bucket] = rehash;
+	}
+      
+      if ( index->buckets )
+	free (index->buckets);
+      
+      index->buckets = buckets;
+      index->size = size;
+    }
+  
+  bucket = group->keyhash & (index->size - 1);
+  group->hashnext = index->buckets[bucket];
+  index->buckets[bucket] = group;
+  index->count++;
+  
+  /* Add to the end of the use order */
+  group->next = NULL;
+  group->prev = index->tail;
+  
+  if ( index->tail )
+    index->tail->next = group;
+  else
+    datastream->grouproot = group;
+  
+  index->tail = group;
+  
+  return 0;
+}  /* End of ds_indexgroup() */
+
+
+/***************************************************************************
+ * ds_removegroup:
+ *
+ * Remove a DataStreamGroup from the hash table and the use order of a
+ * DataStream.  The group itself is not freed.
  ***************************************************************************/
 static void
+ds_removegroup (DataStream *datastream, DataStreamGroup *group)
+{
+  struct DataStreamIndex_s *index = datastream->index;
+  DataStreamGroup **link;
+  
+  link = &index->buckets[group->keyhash & (index->size - 1)];
+  while ( *link && *link != group )
+    link = &(*link)->hashnext;
+  
+  if ( *link )
+    {
+      *link = group->hashnext;
+      index->count--;
+    }
+  
+  if ( group->prev )
+    group->prev->next = group->next;
+  else
+    datastream->grouproot = group->next;
+  
+  if ( group->next )
+    group->next->prev = group->prev;
+  else
+    index->tail = group->prev;
+  
+  group->next = group->prev = group->hashnext = NULL;
+}  /* End of ds_removegroup() */
+
+
+/***************************************************************************
+ * ds_writegroup:
+ *
+ * Write data to the file of a DataStreamGroup.  If DataStream.bufsize
+ * is greater than 0 data is collected in a buffer of that size for
+ * each group and written when the buffer would overflow, when the
+ * stream is closed as idle and at shutdown.  Data are always written
+ * in the order given.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_writegroup (DataStream *datastream, DataStreamGroup *group,
+	       const void *data, size_t length)
+{
+  if ( datastream->bufsize > 0 )
+    {
+      /* Allocate buffer on first write, write directly if not possible */
+      if ( ! group->buffer )
+	group->buffer = (char *) malloc (datastream->bufsize);
+      
+      if ( group->buffer && (group->buflen + length) <= (size_t) datastream->bufsize )
+	{
+	  memcpy (group->buffer + group->buflen, data, length);
+	  group->buflen += length;
+	  
+	  return 0;
+	}
+    }
+  
+  /* Write buffered data followed by the new data */
+  return ds_flushgroup (group, data, length);
+}  /* End of ds_writegroup() */
+
+
+/***************************************************************************
+ * ds_flushgroup:
+ *
+ * Write any buffered data of a DataStreamGroup followed by length
+ * bytes of data, which may be NULL if length is 0.  Partial writes
+ * are continued until all data is written.  On error the buffered
+ * data is discarded.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_flushgroup (DataStreamGroup *group, const void *data, size_t length)
+{
+  struct iovec iov[2];
+  int iovcnt = 0;
+  int first = 0;
+  ssize_t written;
+  
+  if ( group->buflen > 0 )
+    {
+      iov[iovcnt].iov_base = group->buffer;
+      iov[iovcnt].iov_len = group->buflen;
+      iovcnt++;
+    }
+  
+  if ( length > 0 )
+    {
+      iov[iovcnt].iov_base = (void *) data;
+      iov[iovcnt].iov_len = length;
+      iovcnt++;
+    }
+  
+  group->buflen = 0;
+  
+  while ( first < iovcnt )
+    {
+      written = writev (group->filed, &iov[first], iovcnt - first);
+      
+      if ( written < 0 )
+	{
+	  if ( errno == EINTR )
+	    continue;
+	  
+	  fprintf (stderr, "ds_flushgroup(): error writing data stream file for key %s, %s\n",
+		   group->defkey, strerror (errno));
+	  return -1;
+	}
+      
+      /* Skip completely written vectors and advance into a partial one */
+      while ( first < iovcnt && (size_t) written >= iov[first].iov_len )
+	{
+	  written -= iov[first].iov_len;
+	  first++;
+	}
+      
+      if ( first < iovcnt )
+	{
+	  iov[first].iov_base = (char *) iov[first].iov_base + written;
+	  iov[first].iov_len -= written;
+	}
+    }
+  
+  return 0;
+}  /* End of ds_flushgroup() */
+
+
+/***************************************************************************
+ * ds_closegroup:
+ *
+ * Write any buffered data of a DataStreamGroup, synchronize the file
+ * to disk if DataStream.syncflag is set and close the file.  The
+ * buffer and record keys are freed, the group itself is not.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_closegroup (DataStream *datastream, DataStreamGroup *group)
+{
+  int retval = 0;
+  
+  if ( group->buflen > 0 && ds_flushgroup (group, NULL, 0) )
+    retval = -1;
+  
+  if ( group->buffer )
+    {
+      free (group->buffer);
+      group->buffer = NULL;
+    }
+  
+  if ( group->reckeys )
+    {
+      free (group->reckeys);
+      group->reckeys = NULL;
+      group->reckeysize = 0;
+      group->reckeycount = 0;
+    }
+  
+  if ( group->filed > 0 )
+    {
+      if ( datastream->syncflag && fsync (group->filed) )
+	{
+	  fprintf (stderr, "ds_closegroup(), synchronizing data stream file, %s\n",
+		   strerror (errno));
+	  retval = -1;
+	}
+      
+      if ( close (group->filed) )
+	{
+	  fprintf (stderr, "ds_closegroup(), closing data stream file, %s\n",
+		   strerror (errno));
+	  retval = -1;
+	}
+    }
+  
+  group->filed = 0;
+  
+  return retval;
+}  /* End of ds_closegroup() */
+
+
+/***************************************************************************
+ * ds_recordkey:
+ *
+ * Return a 64-bit FNV-1a hash of the fixed section of data header of a
+ * data record, excluding the sequence number: quality indicator,
+ * NSLC codes, start time, sample count and sample rate.  Records with
+ * the same key are considered duplicates.  0 is never returned.
+ ***************************************************************************/
+static uint64_t
+ds_recordkey (const char *record)
+{
+  uint64_t hash = ms_fnv1a64 (MS_FNV64_INIT, record + 6, 30);
+  
+  return ( hash ) ? hash : 1;
+}  /* End of ds_recordkey() */
+
+
+/***************************************************************************
+ * ds_findreckey:
+ *
+ * Search the record key set of a DataStreamGroup for a key and add it
+ * if not found and 'add' is set.  The set uses open addressing, it is
+ * allocated when needed and doubled when half full.
+ *
+ * Returns 1 if the key was found and 0 otherwise.
+ ***************************************************************************/
+static int
+ds_findreckey (DataStreamGroup *group, uint64_t key, int add)
+{
+  uint64_t *keys;
+  unsigned int slot;
+  int size;
+  int idx;
+  
+  if ( group->reckeys )
+    {
+      slot = (unsigned int) key & (group->reckeysize - 1);
+      
+      while ( group->reckeys[slot] )
+	{
+	  if ( group->reckeys[slot] == key )
+	    return 1;
+	  
+	  slot = (slot + 1) & (group->reckeysize - 1);
+	}
+    }
+  
+  if ( ! add )
+    return 0;
+  
+  /* Allocate or grow the set, rehashing the keys */
+  if ( ! group->reckeys || (group->reckeycount + 1) * 2 > group->reckeysize )
+    {
+      size = ( group->reckeys ) ? group->reckeysize * 2 : DS_RECKEYSIZE;
+      
+      if ( ! (keys = (uint64_t *) calloc (size, sizeof (uint64_t))) )
+	{
+	  fprintf (stderr, "ds_findreckey(): cannot allocate memory\n");
+	  return 0;
+	}
+      
+      for ( idx = 0; idx < group->reckeysize; idx++ )
+	{
+	  if ( ! group->reckeys[idx] )
+	    continue;
+	  
+	  slot = (unsigned int) group->reckeys[idx] & (size - 1);
+	  while ( keys[slot] )
+	    slot = (slot + 1) & (size - 1);
+	  keys[slot] = group->reckeys[idx];
+	}
+      
+      if ( group->reckeys )
+	free (group->reckeys);
+      
+      group->reckeys = keys;
+      group->reckeysize = size;
+    }
+  
+  slot = (unsigned int) key & (group->reckeysize - 1);
+  while ( group->reckeys[slot] )
+    slot = (slot + 1) & (group->reckeysize - 1);
+  
+  group->reckeys[slot] = key;
+  group->reckeycount++;
+  
+  return 0;
+}  /* End of ds_findreckey() */
+
+
+/***************************************************************************
+ * ds_loadreckeys:
+ *
+ * Read the data records in the file of a DataStreamGroup and add the
+ * key of each record to the record key set.  Reading stops at the
+ * first data that is not a data record, the keys loaded until then
+ * are kept.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_loadreckeys (DataStreamGroup *group, const char *filename)
+{
+  char *buffer;
+  off_t offset = 0;
+  ssize_t nread;
+  ssize_t pos;
+  int reclen;
+  int retval = 0;
+  
+  if ( ! (buffer = (char *) malloc (MAXRECLEN)) )
+    {
+      fprintf (stderr, "ds_loadreckeys(): cannot allocate memory\n");
+      return -1;
+    }
+  
+  for (;;)
+    {
+      if ( (nread = pread (group->filed, buffer, MAXRECLEN, offset)) < 0 )
+	{
+	  if ( errno == EINTR )
+	    continue;
+	  
+	  fprintf (stderr, "ds_loadreckeys(): error reading %s, %s\n",
+		   filename, strerror (errno));
+	  retval = -1;
+	  break;
+	}
+      
+      /* Add the key of each complete record in the buffer */
+      for ( pos = 0; pos + MINRECLEN <= nread; pos += reclen )
+	{
+	  if ( (reclen = ms_detect (buffer + pos, (int) (nread - pos))) <= 0 ||
+	       pos + reclen > nread )
+	    break;
+	  
+	  ds_findreckey (group, ds_recordkey (buffer + pos), 1);
+	}
+      
+      offset += pos;
+      
+      /* Stop at the end of the file or at data that is not a record */
+      if ( pos == 0 || nread < MAXRECLEN )
+	{
+	  if ( pos < nread )
+	    {
+	      fprintf (stderr, "ds_loadreckeys(): %s contains data that are not records at byte %lld, "
+		       "duplicates are only skipped before it\n", filename, (long long int) offset);
+	      retval = -1;
+	    }
+	  break;
+	}
+    }
+  
+  if ( dsverbose >= 2 )
+    fprintf (stderr, "Loaded %d record keys from %s\n", group->reckeycount, filename);
+  
+  free (buffer);
+  
+  return retval;
+}  /* End of ds_loadreckeys() */
+
+
+/***************************************************************************
+ * ds_shutdown:
+ *
+ * Write buffered data, close all stream files and release all of the
+ * DataStreamGroup memory structures.
+ *
+ * Returns 0 on success and -1 if any stream file could not be written
+ * or closed, also by an earlier ds_closeidle().
+ ***************************************************************************/
+static int
 ds_shutdown (DataStream *datastream)
 {
   DataStreamGroup *curgroup = NULL;
@@ -655,97 +1094,355 @@ ds_shutdown (DataStream *datastream)
       if ( dsverbose >= 2 )
 	fprintf (stderr, "Shutting down stream with key: %s\n", prevgroup->defkey);
 
-      if ( close (prevgroup->filed) )
-	fprintf (stderr, "ds_shutdown(), closing data stream file, %s\n",
-		 strerror (errno));
+      if ( ds_closegroup (datastream, prevgroup) )
+	datastream->closefailed++;
       
       free (prevgroup->defkey);
       free (prevgroup);
     }
+  
+  datastream->grouproot = NULL;
+  
+  if ( datastream->skipped && dsverbose >= 1 )
+    fprintf (stderr, "Skipped %ld duplicate data record(s) for %s\n",
+	     datastream->skipped, datastream->path);
+  
+  if ( datastream->index )
+    {
+      if ( datastream->index->buckets )
+	free (datastream->index->buckets);
+      free (datastream->index);
+      datastream->index = NULL;
+    }
+  
+  ds_freelayout (datastream->layout);
+  datastream->layout = NULL;
+  
+  if ( datastream->closefailed )
+    {
+      fprintf (stderr, "Failed to write or close %ld data stream file(s) for %s\n",
+	       datastream->closefailed, datastream->path);
+      return -1;
+    }
+  
+  return 0;
 }  /* End of ds_shutdown() */
 
 
 /***************************************************************************
- * strparse:
+ * ds_compilelayout:
  *
- * splits a 'string' on 'delim' and puts each part into a linked list
- * pointed to by 'list' (a pointer to a pointer).  The last entry has
- * it's 'next' set to 0.  All elements are NULL terminated strings.
- * If both 'string' and 'delim' are NULL then the linked list is
- * traversed and the memory used is free'd and the list pointer is
- * set to NULL.
+ * Compile a path layout into a list of operations: literal text,
+ * directory separators and format codes.  Format codes prefixed with
+ * '%' are included in the definition key, codes prefixed with '#' are
+ * only included in the file name.
  *
- * Returns the number of elements added to the list, or 0 when freeing
- * the linked list.
+ * Returns a pointer to the compiled layout on success or NULL on error.
  ***************************************************************************/
-static int
-strparse (const char *string, const char *delim, strlist **list)
+static struct DataStreamLayout_s *
+ds_compilelayout (const char *path)
 {
-  const char *beg;			/* beginning of element */
-  const char *del;			/* delimiter */
-  int stop = 0;
-  int count = 0;
-  int total;
+  struct DataStreamLayout_s *layout;
+  DSLayoutOp *op;
+  char *text;
+  char *p;
+  char *literal;
+  size_t pathlen;
+  
+  pathlen = strlen (path);
+  
+  if ( pathlen == 0 || (pathlen == 1 && *path == '/') )
+    {
+      fprintf (stderr, "ds_streamproc(): empty path format\n");
+      return NULL;
+    }
+  
+  if ( path[pathlen - 1] == '/' )
+    {
+      fprintf (stderr, "ds_streamproc(): no file name specified, only %s\n", path);
+      return NULL;
+    }
+  
+  if ( ! (layout = (struct DataStreamLayout_s *) calloc (1, sizeof (struct DataStreamLayout_s))) )
+    {
+      fprintf (stderr, "ds_compilelayout(): cannot allocate memory\n");
+      return NULL;
+    }
+  
+  /* At most one literal and one code or separator per path character */
+  layout->text = strdup (path);
+  layout->ops = (DSLayoutOp *) calloc (2 * pathlen + 1, sizeof (DSLayoutOp));
+  
+  if ( ! layout->text || ! layout->ops )
+    {
+      fprintf (stderr, "ds_compilelayout(): cannot allocate memory\n");
+      ds_freelayout (layout);
+      return NULL;
+    }
+  
+  text = layout->text;
+  literal = text;
+  p = text;
+  
+  while ( *p )
+    {
+      if ( *p != '/' && *p != '%' && *p != '#' )
+	{
+	  p++;
+	  continue;
+	}
+      
+      /* Add literal text preceding separator or code */
+      if ( p > literal )
+	{
+	  op = &layout->ops[layout->opcount++];
+	  op->text = literal;
+	  op->length = (int) (p - literal);
+	}
+      
+      if ( *p == '/' )
+	{
+	  op = &layout->ops[layout->opcount++];
+	  op->code = '/';
+	  literal = ++p;
+	  continue;
+	}
+      
+      op = &layout->ops[layout->opcount];
+      op->def = ( *p == '%' );
+      p++;
+      
+      switch ( *p )
+	{
+	case 'n': case 's': case 'l': case 'c':
+	case 'Y': case 'y': case 'j': case 'H': case 'M': case 'S': case 'F':
+	case 'q': case 'L': case 'r': case 'R':
+	  op->code = *p;
+	  layout->opcount++;
+	  literal = ++p;
+	  break;
+	case '%' :
+	case '#' :
+	  /* Escaped code character, literal text */
+	  op->def = 0;
+	  literal = p++;
+	  break;
+	default :
+	  fprintf (stderr, "Unknown layout format code: '%c'\n", *p);
+	  /* Unknown code character is kept as literal text */
+	  op->def = 0;
+	  literal = p;
+	  break;
+	}
+    }
+  
+  /* Add trailing literal text */
+  if ( p > literal )
+    {
+      op = &layout->ops[layout->opcount++];
+      op->text = literal;
+      op->length = (int) (p - literal);
+    }
+  
+  return layout;
+}  /* End of ds_compilelayout() */
 
-  strlist *curlist = 0;
-  strlist *tmplist = 0;
 
-  if (string != NULL && delim != NULL)
-    {
-      total = strlen (string);
-      beg = string;
+/***************************************************************************
+ * ds_freelayout:
+ *
+ * Free a compiled layout and the associated directory cache.
+ ***************************************************************************/
+static void
+ds_freelayout (struct DataStreamLayout_s *layout)
+{
+  if ( ! layout )
+    return;
+  
+  ds_dirclear (layout);
+  
+  if ( layout->dirs )
+    free (layout->dirs);
+  if ( layout->ops )
+    free (layout->ops);
+  if ( layout->text )
+    free (layout->text);
+  
+  free (layout);
+}  /* End of ds_freelayout() */
 
-      while (!stop)
-	{
-	  /* Find delimiter */
-	  del = strstr (beg, delim);
-	  
-	  /* Delimiter not found or empty */
-	  if (del == NULL || strlen (delim) == 0)
-	    {
-	      del = string + strlen (string);
-	      stop = 1;
-	    }
 
-	  tmplist = (strlist *) malloc (sizeof (strlist));
-	  tmplist->next = 0;
+/***************************************************************************
+ * ds_append:
+ *
+ * Append valuelength bytes of value to a NULL terminated string in
+ * buf of size bytes and update the string length.  The string is
+ * truncated if the buffer is full.
+ ***************************************************************************/
+static void
+ds_append (char *buf, size_t size, size_t *length,
+	   const char *value, size_t valuelength)
+{
+  if ( *length + valuelength >= size )
+    valuelength = size - *length - 1;
+  
+  memcpy (buf + *length, value, valuelength);
+  *length += valuelength;
+  buf[*length] = '\0';
+}  /* End of ds_append() */
 
-	  tmplist->element = (char *) malloc (del - beg + 1);
-	  strncpy (tmplist->element, beg, (del - beg));
-	  tmplist->element[(del - beg)] = '\0';
 
-	  /* Add this to the list */
-	  if (count++ == 0)
-	    {
-	      curlist = tmplist;
-	      *list = curlist;
-	    }
-	  else
+/***************************************************************************
+ * ds_mkdirs:
+ *
+ * Create the directories in the path of a file name if they do not
+ * exist.  Directories that have been checked or created are cached
+ * and not checked again.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+ds_mkdirs (DataStream *datastream, const char *filename)
+{
+  char dir[400];
+  char *p;
+  
+  snprintf (dir, sizeof(dir), "%s", filename);
+  
+  /* Check each directory component, skipping a leading separator */
+  for ( p = strchr (dir + 1, '/'); p; p = strchr (p + 1, '/') )
+    {
+      *p = '\0';
+      
+      if ( ! ds_dircached (datastream->layout, dir, 0) )
+	{
+	  if ( access (dir, F_OK) )
 	    {
-	      curlist->next = tmplist;
-	      curlist = curlist->next;
+	      if ( errno == ENOENT )
+		{
+		  if ( dsverbose >= 1 )
+		    fprintf (stderr, "Creating directory: %s\n", dir);
+		  
+		  if ( mkdir (dir, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) &&
+		       errno != EEXIST )
+		    {
+		      fprintf (stderr, "ds_streamproc: mkdir(%s) %s\n", dir, strerror (errno));
+		      return -1;
+		    }
+		}
+	      else
+		{
+		  fprintf (stderr, "%s: access denied, %s\n", dir, strerror(errno));
+		  return -1;
+		}
 	    }
-
-	  /* Update 'beg' */
-	  beg = (del + strlen (delim));
-	  if ((beg - string) > total)
-	    break;
+	  
+	  ds_dircached (datastream->layout, dir, 1);
 	}
+      
+      *p = '/';
+    }
+  
+  return 0;
+}  /* End of ds_mkdirs() */
 
-      return count;
+
+/***************************************************************************
+ * ds_dircached:
+ *
+ * Search the directory cache of a layout for a directory and add it
+ * if not found and the add flag is true.  The cache is a hash set
+ * with linear probing that doubles when half full and is cleared
+ * when DS_DIRCACHEMAX directories are cached.
+ *
+ * Returns 1 if the directory was found in the cache and 0 otherwise.
+ ***************************************************************************/
+static int
+ds_dircached (struct DataStreamLayout_s *layout, const char *dir, int add)
+{
+  char **dirs;
+  uint32_t hash = ms_fnv1a32 (MS_FNV32_INIT, dir, strlen (dir));
+  uint32_t slot;
+  int size;
+  int idx;
+  
+  if ( layout->dirs )
+    {
+      slot = hash & (layout->dirsize - 1);
+      while ( layout->dirs[slot] )
+	{
+	  if ( ! strcmp (layout->dirs[slot], dir) )
+	    return 1;
+	  
+	  slot = (slot + 1) & (layout->dirsize - 1);
+	}
     }
-  else
+  
+  if ( ! add )
+    return 0;
+  
+  if ( layout->dircount >= DS_DIRCACHEMAX )
+    ds_dirclear (layout);
+  
+  /* Allocate or grow the set when half full */
+  if ( ! layout->dirs || (layout->dircount + 1) * 2 > layout->dirsize )
     {
-      curlist = *list;
-      while (curlist != NULL)
+      size = ( layout->dirs ) ? layout->dirsize * 2 : DS_DIRCACHESIZE;
+      
+      if ( ! (dirs = (char **) calloc (size, sizeof(char *))) )
+	return 0;
+      
+      for ( idx = 0; layout->dirs && idx < layout->dirsize; idx++ )
 	{
-	  tmplist = curlist->next;
-	  free (curlist->element);
-	  free (curlist);
-	  curlist = tmplist;
+	  if ( ! layout->dirs[idx] )
+	    continue;
+	  
+	  hash = ms_fnv1a32 (MS_FNV32_INIT, layout->dirs[idx], strlen (layout->dirs[idx]));
+	  slot = hash & (size - 1);
+	  while ( dirs[slot] )
+	    slot = (slot + 1) & (size - 1);
+	  
+	  dirs[slot] = layout->dirs[idx];
 	}
-      *list = NULL;
+      
+      if ( layout->dirs )
+	free (layout->dirs);
+      
+      layout->dirs = dirs;
+      layout->dirsize = size;
+      
+      return ds_dircached (layout, dir, add);
+    }
+  
+  slot = hash & (layout->dirsize - 1);
+  while ( layout->dirs[slot] )
+    slot = (slot + 1) & (layout->dirsize - 1);
+  
+  if ( (layout->dirs[slot] = strdup (dir)) )
+    layout->dircount++;
+  
+  return 0;
+}  /* End of ds_dircached() */
 
-      return 0;
+
+/***************************************************************************
+ * ds_dirclear:
+ *
+ * Remove all directories from the directory cache of a layout.
+ ***************************************************************************/
+static void
+ds_dirclear (struct DataStreamLayout_s *layout)
+{
+  int idx;
+  
+  for ( idx = 0; layout->dirs && idx < layout->dirsize; idx++ )
+    {
+      if ( layout->dirs[idx] )
+	{
+	  free (layout->dirs[idx]);
+	  layout->dirs[idx] = NULL;
+	}
     }
-}  /* End of strparse() */
+  
+  layout->dircount = 0;
+}  /* End of ds_dirclear() */
@@ -11,12 +11,24 @@
 #define BUDLAYOUT   "%n/%s/%s.%n.%l.%c.%Y.%j"
 #define CSSLAYOUT   "%Y/%j/%s.%c.%Y:%j:#H:#M:#S"
 
+/* Default size of DataStreamGroup write buffers in bytes, a buffer is
+ * kept for each open file so this is small */
+#define DS_BUFSIZE  16384
+
 typedef struct DataStreamGroup_s
 {
   char   *defkey;
   int     filed;
   time_t  modtime;
-  struct  DataStreamGroup_s *next;
+  unsigned int keyhash;                 /* Hash of defkey */
+  char   *buffer;                       /* Write buffer, see DataStream.bufsize */
+  size_t  buflen;                       /* Bytes of data in write buffer */
+  uint64_t *reckeys;                    /* Hash set of record keys, see DataStream.uniqueflag */
+  int     reckeysize;                   /* Number of record key slots, a power of 2 */
+  int     reckeycount;                  /* Number of record keys in the set */
+  struct  DataStreamGroup_s *next;      /* Next group in order of use */
+  struct  DataStreamGroup_s *prev;      /* Previous group in order of use */
+  struct  DataStreamGroup_s *hashnext;  /* Next group in hash bucket */
 }
 DataStreamGroup;
 
@@ -24,11 +36,19 @@ typedef struct DataStream_s
 {
   char   *path;
   int     idletimeout;
+  int     bufsize;                      /* Size of group write buffers, 0 for no buffering */
+  int     syncflag;                     /* Synchronize files to disk when closed */
+  int     uniqueflag;                   /* Skip records already in the files */
+  long    skipped;                      /* Number of duplicate records skipped */
+  long    closefailed;                  /* Number of files that failed to write or close */
   struct  DataStreamGroup_s *grouproot;
+  struct  DataStreamLayout_s *layout;   /* Compiled path layout, internal use */
+  struct  DataStreamIndex_s *index;     /* Hash table of groups by defkey, internal use */
 }
 DataStream;
 
 extern int ds_streamproc (DataStream *datastream, MSRecord *msr,
                           long suffix, int verbose);
+extern int ds_isdefining (const char *path, char code);
 
 #endif /* DSARCHIVE_H */
@@ -6,7 +6,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center.
  *
- * modified 2010.132
+ * modified 2026.292
  ***************************************************************************/
 
 /* Note to future hackers:
@@ -37,7 +37,7 @@
 
 #include "dsarchive.h"
 
-#define VERSION "1.0"
+#define VERSION "1.1"
 #define PACKAGE "msmod"
 
 /* A simple bitwise AND test to return 0 or 1 */
@@ -70,6 +70,8 @@ static flag     basicsum       = 0;    /* Controls printing of basic summary */
 static int      reclen         = -1;   /* Input data record length, autodetected in most cases */
 static hptime_t starttime      = HPTERROR;  /* Limit to records after starttime */
 static hptime_t endtime        = HPTERROR;  /* Limit to records before endtime */
+static flag     useindex       = 1;    /* Use file time indexes with starttime/endtime */
+static flag     writeindex     = 0;    /* Write file time index sidecars */
 static regex_t *match          = 0;    /* Compiled match regex */
 static regex_t *reject         = 0;    /* Compiled reject regex */
 static char    *outputfile     = 0;    /* Single output file */
@@ -104,9 +106,11 @@ main ( int argc, char **argv )
 {
   Filelink *flp;
   MSRecord *msr = 0;
+  MSFileIndex *index = 0;
   int retcode = MS_NOERROR;
   FILE *ofp = 0;
   flag stopflag = 0;
+  flag closefailed = 0;
   off_t filepos = 0;
 
   long long int totalfiles = 0;
@@ -156,11 +160,25 @@ main ( int argc, char **argv )
 	    }
 	}
       
+      /* Read only records in the time window using a file time index, from
+       * a current sidecar or built with -wi, otherwise read sequentially */
+      if ( useindex && (starttime != HPTERROR || endtime != HPTERROR) &&
+           strcmp (flp->filename, "-") )
+        {
+          if ( (index = ms_readfileindex (flp->filename, reclen, writeindex, verbose)) )
+            ms_selectfileindex (index, starttime, endtime);
+        }
+      
       /* Loop over the input file */
       for (;;)
         {
-          if ( (retcode = ms_readmsr (&msr, flp->filename, reclen, &filepos,
-                                      NULL, 1, 0, verbose)) != MS_NOERROR )
+          if ( index )
+            retcode = ms_readmsr_fileindex (index, &msr, &filepos, 0, verbose);
+          else
+            retcode = ms_readmsr (&msr, flp->filename, reclen, &filepos,
+                                  NULL, 1, 0, verbose);
+          
+          if ( retcode != MS_NOERROR )
             break;
           
           /* Check if record matches start/end time criteria */
@@ -306,6 +324,7 @@ main ( int argc, char **argv )
       
       /* Make sure everything is cleaned up */
       ms_readmsr (&msr, NULL, 0, NULL, NULL, 0, 0, 0);
+      ms_freefileindex (&index);
       
       totalfiles++;
       flp = flp->next;
@@ -314,12 +333,21 @@ main ( int argc, char **argv )
   if ( outputfile )
     fclose (ofp);
   
+  /* Close each Archive, writing any buffered data */
+  arch = archiveroot;
+  while ( arch )
+    {
+      if ( ds_streamproc (&arch->datastream, NULL, 0, verbose-1) )
+	closefailed = 1;
+      arch = arch->next;
+    }
+  
   if ( basicsum )
     printf ("Files: %lld, Records: %lld\n", totalfiles, totalrecs);
   
   freefilelist();
 
-  return 0;
+  return ( closefailed ) ? 1 : 0;
 }  /* End of main() */
 
 
@@ -570,6 +598,14 @@ processparam (int argcount, char **argvec)
 	  if ( endtime == HPTERROR )
 	    return -1;
 	}
+      else if (strcmp (argvec[optind], "-ni") == 0)
+	{
+	  useindex = 0;
+	}
+      else if (strcmp (argvec[optind], "-wi") == 0)
+	{
+	  writeindex = 1;
+	}
       else if (strcmp (argvec[optind], "-M") == 0)
 	{
 	  matchpattern = getoptval(argcount, argvec, optind++);
@@ -1011,6 +1047,14 @@ addarchive ( const char *path, const char *layout )
     snprintf (newarch->datastream.path, pathlayout, "%s", path);
   
   newarch->datastream.grouproot = NULL;
+  newarch->datastream.layout = NULL;
+  newarch->datastream.index = NULL;
+  newarch->datastream.idletimeout = 300;
+  newarch->datastream.bufsize = DS_BUFSIZE;
+  newarch->datastream.syncflag = 0;
+  newarch->datastream.uniqueflag = 0;
+  newarch->datastream.skipped = 0;
+  newarch->datastream.closefailed = 0;
   
   if ( newarch->datastream.path == NULL )
     {
@@ -1139,6 +1183,8 @@ usage (int level)
 	   " -ts time     Limit to records that start after time\n"
 	   " -te time     Limit to records that end before time\n"
 	   "                time format: 'YYYY[,DDD,HH,MM,SS,FFFFFF]' delimiters: [,:.]\n"
+	   " -ni          Do not use file time indexes for -ts and -te\n"
+	   " -wi          Build file time indexes and write '.<file>.msidx' sidecars\n"
 	   " -M match     Limit to records matching the specified regular expression\n"
 	   " -R reject    Limit to records not matchint the specfied regular expression\n"
 	   "                Regular expressions are applied to: 'NET_STA_LOC_CHAN_QUAL'\n"
@@ -0,0 +1,616 @@
+/***************************************************************************
+ * manifest.c
+ * Routines to maintain an ingest manifest of routed input files.
+ *
+ * The manifest is a text file with one line for each input file that
+ * was completely routed:
+ *
+ * <inode> <size> <mtime> <hash> <path>
+ *
+ * where hash is a 64-bit hash of the file content in hexadecimal.
+ * Lines are appended as files are routed, a later line for the same
+ * path replaces an earlier one.  The file is rewritten without the
+ * replaced lines when it is closed if they are the majority.
+ *
+ * A file is considered routed if an entry for its path has the same
+ * inode, size and modification time, without reading the file, or if
+ * any entry has the same size and content hash, in which case the
+ * entry for the path is updated.  The content hash is computed with
+ * 64-bit words in host byte order, manifests are not portable between
+ * hosts of different byte order.
+ *
+ * modified: 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libmseed.h>
+
+#include "manifest.h"
+
+/* Initial number of hash buckets, the tables double when the number
+ * of entries exceeds the number of buckets */
+#define MF_INDEXSIZE 1024
+
+/* Size of the buffer used to read files for the content hash */
+#define MF_READSIZE 65536
+
+/* Functions internal to this source file */
+static ManifestEntry *mf_find (Manifest *manifest, const char *path,
+			       unsigned int pathhash);
+static ManifestEntry *mf_findhash (Manifest *manifest, const ManifestFile *file);
+static int mf_insert (Manifest *manifest, const char *path,
+		      const ManifestFile *file);
+static int mf_grow (Manifest *manifest);
+static int mf_write (FILE *fp, const char *path, const ManifestFile *file);
+static int mf_rewrite (Manifest *manifest);
+static int mf_hashfile (const char *path, uint64_t *hash);
+static unsigned int mf_hashpath (const char *path);
+
+
+/***************************************************************************
+ * mf_open:
+ *
+ * Load the entries of a manifest file, if it exists, and open it for
+ * appending new entries.  Malformed lines are skipped.
+ *
+ * Returns a pointer to the Manifest on success or NULL on error.
+ ***************************************************************************/
+extern Manifest *
+mf_open (const char *filename, int verbose)
+{
+  Manifest *manifest;
+  ManifestFile file;
+  FILE *fp;
+  char line[2048];
+  char *path;
+  size_t length;
+  int pathoffset;
+  int skipped = 0;
+
+  if ( ! (manifest = (Manifest *) calloc (1, sizeof (Manifest))) ||
+       ! (manifest->filename = strdup (filename)) )
+    {
+      fprintf (stderr, "mf_open(): cannot allocate memory\n");
+      free (manifest);
+      return NULL;
+    }
+
+  if ( (fp = fopen (filename, "r")) )
+    {
+      while ( fgets (line, sizeof(line), fp) )
+	{
+	  length = strlen (line);
+
+	  if ( line[0] == '#' || length == 0 )
+	    continue;
+
+	  if ( line[length-1] != '\n' )
+	    {
+	      /* Skip the rest of a line that is too long */
+	      while ( fgets (line, sizeof(line), fp) && line[strlen (line)-1] != '\n' );
+	      skipped++;
+	      continue;
+	    }
+
+	  line[length-1] = '\0';
+	  memset (&file, 0, sizeof (ManifestFile));
+	  pathoffset = 0;
+
+	  if ( sscanf (line, "%llu %lld %lld %llx %n", &file.inode, &file.size,
+		       &file.mtime, (unsigned long long *) &file.hash, &pathoffset) < 4 ||
+	       pathoffset == 0 || line[pathoffset] == '\0' )
+	    {
+	      skipped++;
+	      continue;
+	    }
+
+	  path = line + pathoffset;
+	  file.hashed = 1;
+
+	  if ( mf_insert (manifest, path, &file) )
+	    {
+	      fclose (fp);
+	      mf_close (manifest, 0);
+	      return NULL;
+	    }
+
+	  manifest->lines++;
+	}
+
+      fclose (fp);
+
+      if ( skipped )
+	fprintf (stderr, "Skipped %d malformed line(s) in manifest %s\n", skipped, filename);
+
+      if ( verbose )
+	fprintf (stderr, "Loaded %d manifest entries from %s\n", manifest->count, filename);
+    }
+  else if ( errno != ENOENT )
+    {
+      fprintf (stderr, "Cannot read manifest %s: %s\n", filename, strerror (errno));
+      mf_close (manifest, 0);
+      return NULL;
+    }
+
+  if ( ! (manifest->fp = fopen (filename, "a")) )
+    {
+      fprintf (stderr, "Cannot open manifest %s: %s\n", filename, strerror (errno));
+      mf_close (manifest, 0);
+      return NULL;
+    }
+
+  if ( ftell (manifest->fp) == 0 )
+    fprintf (manifest->fp, "# inode size mtime hash path\n");
+
+  return manifest;
+}  /* End of mf_open() */
+
+
+/***************************************************************************
+ * mf_check:
+ *
+ * Determine the identity of an input file and check if it has already
+ * been routed according to the manifest.  The content hash is only
+ * computed when the path, inode, size and modification time do not
+ * match an entry.  When the content matches an entry with a different
+ * identity, e.g. a renamed or touched file, the entry for the path is
+ * updated.  The identity is returned in 'file' for use with mf_add().
+ *
+ * Returns 1 if the file has been routed, 0 if not and -1 on error.
+ ***************************************************************************/
+extern int
+mf_check (Manifest *manifest, const char *path, ManifestFile *file, int verbose)
+{
+  ManifestEntry *entry;
+  struct stat st;
+
+  memset (file, 0, sizeof (ManifestFile));
+
+  if ( stat (path, &st) )
+    {
+      fprintf (stderr, "Cannot stat %s: %s\n", path, strerror (errno));
+      return -1;
+    }
+
+  file->inode = (unsigned long long) st.st_ino;
+  file->size = (long long) st.st_size;
+  file->mtime = (long long) st.st_mtime;
+
+  entry = mf_find (manifest, path, mf_hashpath (path));
+
+  if ( entry && entry->file.inode == file->inode &&
+       entry->file.size == file->size && entry->file.mtime == file->mtime )
+    {
+      file->hash = entry->file.hash;
+      file->hashed = 1;
+      return 1;
+    }
+
+  if ( mf_hashfile (path, &file->hash) )
+    return -1;
+
+  file->hashed = 1;
+
+  if ( (entry = mf_findhash (manifest, file)) )
+    {
+      if ( verbose )
+	fprintf (stderr, "Content of %s already routed from %s\n", path, entry->path);
+
+      if ( mf_add (manifest, path, file) )
+	return -1;
+
+      return 1;
+    }
+
+  return 0;
+}  /* End of mf_check() */
+
+
+/***************************************************************************
+ * mf_add:
+ *
+ * Add or replace the entry for a routed input file and append it to
+ * the manifest file.  The line is flushed so the manifest is current
+ * if the process is terminated.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+extern int
+mf_add (Manifest *manifest, const char *path, const ManifestFile *file)
+{
+  if ( ! file->hashed )
+    return -1;
+
+  /* Paths are stored on one line */
+  if ( strchr (path, '\n') || strlen (path) > 1900 )
+    {
+      fprintf (stderr, "Path cannot be stored in manifest: %s\n", path);
+      return -1;
+    }
+
+  if ( mf_insert (manifest, path, file) )
+    return -1;
+
+  if ( mf_write (manifest->fp, path, file) || fflush (manifest->fp) )
+    {
+      fprintf (stderr, "Error writing manifest %s: %s\n", manifest->filename, strerror (errno));
+      return -1;
+    }
+
+  manifest->lines++;
+
+  return 0;
+}  /* End of mf_add() */
+
+
+/***************************************************************************
+ * mf_close:
+ *
+ * Close the manifest file, rewriting it without replaced lines if they
+ * are more than the entries, and free all associated memory.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+extern int
+mf_close (Manifest *manifest, int verbose)
+{
+  ManifestEntry *entry;
+  ManifestEntry *next;
+  int retval = 0;
+  int idx;
+
+  if ( ! manifest )
+    return 0;
+
+  if ( manifest->fp )
+    {
+      if ( fclose (manifest->fp) )
+	{
+	  fprintf (stderr, "Error closing manifest %s: %s\n", manifest->filename, strerror (errno));
+	  retval = -1;
+	}
+      else if ( manifest->lines > manifest->count * 2 )
+	{
+	  if ( verbose )
+	    fprintf (stderr, "Compacting manifest %s, %d lines for %d entries\n",
+		     manifest->filename, manifest->lines, manifest->count);
+
+	  if ( mf_rewrite (manifest) )
+	    retval = -1;
+	}
+    }
+
+  for ( idx = 0; idx < manifest->size; idx++ )
+    {
+      for ( entry = manifest->pathbuckets[idx]; entry; entry = next )
+	{
+	  next = entry->pathnext;
+	  free (entry->path);
+	  free (entry);
+	}
+    }
+
+  free (manifest->pathbuckets);
+  free (manifest->hashbuckets);
+  free (manifest->filename);
+  free (manifest);
+
+  return retval;
+}  /* End of mf_close() */
+
+
+/***************************************************************************
+ * mf_find:
+ *
+ * Find the entry for a path.
+ *
+ * Returns a pointer to the entry or NULL if not found.
+ ***************************************************************************/
+static ManifestEntry *
+mf_find (Manifest *manifest, const char *path, unsigned int pathhash)
+{
+  ManifestEntry *entry;
+
+  if ( ! manifest->pathbuckets )
+    return NULL;
+
+  entry = manifest->pathbuckets[pathhash & (manifest->size - 1)];
+
+  while ( entry && (entry->pathhash != pathhash || strcmp (entry->path, path)) )
+    entry = entry->pathnext;
+
+  return entry;
+}  /* End of mf_find() */
+
+
+/***************************************************************************
+ * mf_findhash:
+ *
+ * Find an entry with the same size and content hash as a file.
+ *
+ * Returns a pointer to the entry or NULL if not found.
+ ***************************************************************************/
+static ManifestEntry *
+mf_findhash (Manifest *manifest, const ManifestFile *file)
+{
+  ManifestEntry *entry;
+
+  if ( ! manifest->hashbuckets )
+    return NULL;
+
+  entry = manifest->hashbuckets[(unsigned int) file->hash & (manifest->size - 1)];
+
+  while ( entry && (entry->file.hash != file->hash || entry->file.size != file->size) )
+    entry = entry->hashnext;
+
+  return entry;
+}  /* End of mf_findhash() */
+
+
+/***************************************************************************
+ * mf_insert:
+ *
+ * Add an entry for a path to the hash tables or replace the identity
+ * of an existing entry.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mf_insert (Manifest *manifest, const char *path, const ManifestFile *file)
+{
+  ManifestEntry *entry;
+  ManifestEntry **link;
+  unsigned int pathhash;
+  unsigned int bucket;
+
+  pathhash = mf_hashpath (path);
+
+  if ( (entry = mf_find (manifest, path, pathhash)) )
+    {
+      /* Remove from the content hash bucket, it may change */
+      link = &manifest->hashbuckets[(unsigned int) entry->file.hash & (manifest->size - 1)];
+      while ( *link != entry )
+	link = &(*link)->hashnext;
+      *link = entry->hashnext;
+    }
+  else
+    {
+      if ( manifest->count >= manifest->size && mf_grow (manifest) )
+	return -1;
+
+      if ( ! (entry = (ManifestEntry *) calloc (1, sizeof (ManifestEntry))) ||
+	   ! (entry->path = strdup (path)) )
+	{
+	  fprintf (stderr, "mf_insert(): cannot allocate memory\n");
+	  free (entry);
+	  return -1;
+	}
+
+      entry->pathhash = pathhash;
+      bucket = pathhash & (manifest->size - 1);
+      entry->pathnext = manifest->pathbuckets[bucket];
+      manifest->pathbuckets[bucket] = entry;
+      manifest->count++;
+    }
+
+  entry->file = *file;
+  bucket = (unsigned int) file->hash & (manifest->size - 1);
+  entry->hashnext = manifest->hashbuckets[bucket];
+  manifest->hashbuckets[bucket] = entry;
+
+  return 0;
+}  /* End of mf_insert() */
+
+
+/***************************************************************************
+ * mf_grow:
+ *
+ * Allocate or double the hash tables and rehash all entries.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mf_grow (Manifest *manifest)
+{
+  ManifestEntry **pathbuckets;
+  ManifestEntry **hashbuckets;
+  ManifestEntry *entry;
+  ManifestEntry *next;
+  unsigned int bucket;
+  int size;
+  int idx;
+
+  size = ( manifest->pathbuckets ) ? manifest->size * 2 : MF_INDEXSIZE;
+
+  pathbuckets = (ManifestEntry **) calloc (size, sizeof (ManifestEntry *));
+  hashbuckets = (ManifestEntry **) calloc (size, sizeof (ManifestEntry *));
+
+  if ( ! pathbuckets || ! hashbuckets )
+    {
+      fprintf (stderr, "mf_grow(): cannot allocate memory\n");
+      free (pathbuckets);
+      free (hashbuckets);
+      return -1;
+    }
+
+  for ( idx = 0; idx < manifest->size; idx++ )
+    {
+      for ( entry = manifest->pathbuckets[idx]; entry; entry = next )
+	{
+	  next = entry->pathnext;
+
+	  bucket = entry->pathhash & (size - 1);
+	  entry->pathnext = pathbuckets[bucket];
+	  pathbuckets[bucket] = entry;
+
+	  bucket = (unsigned int) entry->file.hash & (size - 1);
+	  entry->hashnext = hashbuckets[bucket];
+	  hashbuckets[bucket] = entry;
+	}
+    }
+
+  free (manifest->pathbuckets);
+  free (manifest->hashbuckets);
+
+  manifest->pathbuckets = pathbuckets;
+  manifest->hashbuckets = hashbuckets;
+  manifest->size = size;
+
+  return 0;
+}  /* End of mf_grow() */
+
+
+/***************************************************************************
+ * mf_write:
+ *
+ * Write a manifest line for a file.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mf_write (FILE *fp, const char *path, const ManifestFile *file)
+{
+  if ( fprintf (fp, "%llu %lld %lld %016llx %s\n", file->inode, file->size,
+		file->mtime, (unsigned long long) file->hash, path) < 0 )
+    return -1;
+
+  return 0;
+}  /* End of mf_write() */
+
+
+/***************************************************************************
+ * mf_rewrite:
+ *
+ * Write all entries to a temporary file and rename it to the manifest
+ * file name, so the manifest is complete at any time.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mf_rewrite (Manifest *manifest)
+{
+  ManifestEntry *entry;
+  FILE *fp;
+  char tmpname[1024];
+  int retval = 0;
+  int idx;
+
+  if ( snprintf (tmpname, sizeof(tmpname), "%s.tmp", manifest->filename) >= (int) sizeof(tmpname) )
+    return -1;
+
+  if ( ! (fp = fopen (tmpname, "w")) )
+    {
+      fprintf (stderr, "Cannot create %s: %s\n", tmpname, strerror (errno));
+      return -1;
+    }
+
+  fprintf (fp, "# inode size mtime hash path\n");
+
+  for ( idx = 0; idx < manifest->size && ! retval; idx++ )
+    for ( entry = manifest->pathbuckets[idx]; entry && ! retval; entry = entry->pathnext )
+      retval = mf_write (fp, entry->path, &entry->file);
+
+  if ( fclose (fp) || retval || rename (tmpname, manifest->filename) )
+    {
+      fprintf (stderr, "Error writing %s: %s\n", tmpname, strerror (errno));
+      unlink (tmpname);
+      return -1;
+    }
+
+  manifest->lines = manifest->count;
+
+  return 0;
+}  /* End of mf_rewrite() */
+
+
+/***************************************************************************
+ * mf_hashfile:
+ *
+ * Compute a 64-bit hash of the content of a file.  The file is read
+ * in 64-bit words, each word is mixed into the hash with a multiply
+ * and shift, the remaining bytes and the length are mixed in last.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+mf_hashfile (const char *path, uint64_t *hash)
+{
+  unsigned char buffer[MF_READSIZE];
+  uint64_t h = MS_FNV64_INIT;
+  uint64_t word;
+  uint64_t total = 0;
+  ssize_t nread;
+  ssize_t rret;
+  size_t pos;
+  int fd;
+
+  if ( (fd = open (path, O_RDONLY)) < 0 )
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", path, strerror (errno));
+      return -1;
+    }
+
+  for (;;)
+    {
+      /* Fill the buffer so words are aligned to the start of the file */
+      for ( nread = 0, rret = 1; nread < (ssize_t) sizeof(buffer) && rret > 0; )
+	{
+	  if ( (rret = read (fd, buffer + nread, sizeof(buffer) - nread)) > 0 )
+	    nread += rret;
+	  else if ( rret < 0 && errno == EINTR )
+	    rret = 1;
+	}
+
+      if ( rret < 0 )
+	{
+	  fprintf (stderr, "Cannot read %s: %s\n", path, strerror (errno));
+	  close (fd);
+	  return -1;
+	}
+
+      for ( pos = 0; pos + 8 <= (size_t) nread; pos += 8 )
+	{
+	  memcpy (&word, buffer + pos, 8);
+	  h ^= word;
+	  h *= 0x9E3779B97F4A7C15ULL;
+	  h ^= h >> 32;
+	}
+
+      h = ms_fnv1a64 (h, buffer + pos, nread - pos);
+
+      total += nread;
+
+      if ( rret == 0 )
+	break;
+    }
+
+  close (fd);
+
+  h ^= total;
+  h *= 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 29;
+
+  *hash = h;
+
+  return 0;
+}  /* End of mf_hashfile() */
+
+
+/***************************************************************************
+ * mf_hashpath:
+ *
+ * Return a FNV-1a hash of a path.
+ ***************************************************************************/
+static unsigned int
+mf_hashpath (const char *path)
+{
+  return ms_fnv1a32 (MS_FNV32_INIT, path, strlen (path));
+}  /* End of mf_hashpath() */
@@ -0,0 +1,48 @@
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdint.h>
+
+/* Identity of an input file: path, inode, size, modification time and
+ * a hash of the content */
+typedef struct ManifestFile_s
+{
+  unsigned long long inode;
+  long long  size;
+  long long  mtime;
+  uint64_t   hash;
+  int        hashed;                    /* Content hash has been computed */
+}
+ManifestFile;
+
+typedef struct ManifestEntry_s
+{
+  char        *path;
+  ManifestFile file;
+  unsigned int pathhash;                /* Hash of path */
+  struct ManifestEntry_s *pathnext;     /* Next entry in path bucket */
+  struct ManifestEntry_s *hashnext;     /* Next entry in content hash bucket */
+}
+ManifestEntry;
+
+typedef struct Manifest_s
+{
+  char  *filename;
+  FILE  *fp;                            /* Manifest opened for appending */
+  ManifestEntry **pathbuckets;          /* Hash table of entries by path */
+  ManifestEntry **hashbuckets;          /* Hash table of entries by content hash */
+  int    size;                          /* Number of buckets, a power of 2 */
+  int    count;                         /* Number of entries */
+  int    lines;                         /* Number of entry lines in the file */
+}
+Manifest;
+
+extern Manifest *mf_open (const char *filename, int verbose);
+extern int mf_check (Manifest *manifest, const char *path,
+		     ManifestFile *file, int verbose);
+extern int mf_add (Manifest *manifest, const char *path,
+		   const ManifestFile *file);
+extern int mf_close (Manifest *manifest, int verbose);
+
+#endif /* MANIFEST_H */
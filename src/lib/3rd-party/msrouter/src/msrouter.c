@@ -7,7 +7,7 @@
  *
  * Written by Chad Trabant, IRIS Data Management Center
  *
- * modified 2007.030
+ * modified 2026.292
  ***************************************************************************/
 
 #include <stdio.h>
@@ -16,20 +16,36 @@
 #include <time.h>
 #include <errno.h>
 #include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
 
 #include <libmseed.h>
 
 #include "dsarchive.h"
+#include "manifest.h"
 
-#define VERSION "2.1"
+#define VERSION "2.2"
 #define PACKAGE "msrouter"
 
 static int parameter_proc (int argcount, char **argvec);
 static char *getoptval (int argcount, char **argvec, int argopt);
 static int  addarchive(const char *path, const char *layout);
 static void addfile (char *filename);
+static int  adddir (const char *dirname);
+static void reportprogress (flag final);
+static int  checkmanifest (void);
+static void updatemanifest (void);
 static void usage (int level);
 static void term_handler (int sig);
+static long segmentsuffix (MSTraceGroup *mstg, MSRecord *msr);
+static int  routeparallel (void);
+static void *readerthread (void *arg);
+static void *writerthread (void *arg);
 
 /* A chain of archive definitions */
 typedef struct Archive_s {
@@ -40,6 +56,9 @@ Archive;
 
 typedef struct FileLink_s {
   char *filename;
+  ManifestFile ident;       /* Identity for the manifest, see checkmanifest() */
+  flag  ingested;           /* Read to the end and all records archived and closed */
+  flag  failed;             /* Error archiving a record of the file */
   struct FileLink_s *next;
 }
 FileLink;
@@ -52,24 +71,100 @@ static double timetol     = -1.0; /* Time tolerance for continuous traces */
 static double sampratetol = -1.0; /* Sample rate tolerance for continuous traces */
 static char restampqind   = 0;    /* Re-stamp data record/quality indicator */
 static char deleteinput   = 0;    /* Delete each input file after processing */
+static int  bufsize       = DS_BUFSIZE; /* Size of archive stream write buffers */
+static flag syncfiles     = 0;    /* Synchronize archive files to disk when closed */
+static flag uniquerecs    = 0;    /* Skip records already in the archive files */
+static char *manifestfile = 0;    /* Ingest manifest of routed input files */
+static Manifest *manifest = 0;
+
+static volatile sig_atomic_t stopsig = 0; /* Termination signal received */
 
 static FileLink *filelist    = 0;
+static FileLink *filetail    = 0;    /* Last entry of filelist */
+static FileLink *dirlist     = 0;    /* Directories to search for input files */
 static Archive  *archiveroot = 0;
 
+static flag  progress     = 0;    /* Report progress on standard output */
+static char *filematch    = "*";  /* File name pattern for directory searches */
+static int   filecount    = 0;    /* Number of input files */
+static atomic_int       filesdone;    /* Number of input files read */
+static atomic_llong     recordsdone;  /* Number of records read */
+static pthread_mutex_t  progresslock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Parallel routing: reader threads read input files and pass records
+ * to writer threads through bounded lock-free queues, one queue for
+ * each reader and writer pair.  Records are assigned to writers by a
+ * hash of the NSLC codes that are defining in all archive layouts so
+ * each output file and each stream is written by a single writer. */
+#define ROUTE_QUEUESIZE 1024  /* Records per queue, a power of 2 */
+
+/* A record passed from a reader to a writer, a NULL record marks
+ * the end of an input file */
+typedef struct RouteItem_s {
+  char *record;
+  int   reclen;
+}
+RouteItem;
+
+/* Single producer (reader), single consumer (writer) ring buffer,
+ * the indexes are padded to separate cache lines */
+typedef struct RouteQueue_s {
+  RouteItem   *items;
+  char         pad1[64];
+  atomic_uint  head;        /* Next item to remove, updated by the writer */
+  char         pad2[64];
+  atomic_uint  tail;        /* Next item to add, updated by the reader */
+  char         pad3[64];
+}
+RouteQueue;
+
+/* A writer thread and its copy of each archive */
+typedef struct RouteWriter_s {
+  int          id;
+  DataStream  *streams;
+  int          streamcount;
+  flag        *failed;      /* Input files with a record that failed to archive */
+  flag         closefailed; /* An archive file could not be written or closed */
+  pthread_t    tid;
+}
+RouteWriter;
+
+typedef struct RouteReader_s {
+  int          id;
+  pthread_t    tid;
+}
+RouteReader;
+
+static int  writers       = 1;    /* Number of writer threads, 1 for no threads */
+static int  readers       = 0;    /* Number of reader threads, 0 for automatic */
+static flag keynet        = 1;    /* NSLC codes included in the writer hash */
+static flag keysta        = 1;
+static flag keyloc        = 1;
+static flag keychan       = 1;
+
+static FileLink  **routefiles = 0;  /* Input files in order */
+static int         routecount = 0;  /* Number of input files */
+static flag       *routedone  = 0;  /* Input file completely read */
+static RouteQueue *routequeues = 0; /* Queues, [reader][writer] */
+static atomic_int  routeabort;      /* Stop routing after an error */
+
 int
 main (int argc, char **argv)
 {
   MSRecord *msr = 0;
   MSTraceGroup *mstg = 0;
   FileLink *flp;
+  FileLink *dlp;
   Archive *arch;
+  flag closefailed = 0;
   long suffix;
   int retcode;
   
   /* Signal handling, use POSIX calls with standardized semantics */
   struct sigaction sa;
   
-  sa.sa_flags = SA_RESTART;
+  /* No SA_RESTART, termination signals should interrupt blocking reads */
+  sa.sa_flags = 0;
   sigemptyset (&sa.sa_mask);
   
   sa.sa_handler = term_handler;
@@ -85,13 +180,22 @@ main (int argc, char **argv)
   if (parameter_proc (argc, argv) < 0)
     return -1;
   
+  /* Route records with reader and writer threads */
+  if ( writers > 1 )
+    {
+      retcode = routeparallel ();
+      updatemanifest ();
+      return ( retcode ) ? 1 : 0;
+    }
+  
   if ( segments )
     mstg = mst_initgroup (NULL);
 
   flp = filelist;
   
-  /* Read each input file record by record */
-  while ( flp )
+  /* Read each input file record by record until all files are
+   * processed or a termination signal is received */
+  while ( flp && ! stopsig )
     {
       if ( verbose )
 	fprintf (stderr, "Reading %s\n", flp->filename);
@@ -99,6 +203,8 @@ main (int argc, char **argv)
       while ( (retcode = ms_readmsr (&msr, flp->filename, reclen, NULL, NULL,
 				     1, bindata, verbose-1)) == MS_NOERROR )
 	{
+	  atomic_fetch_add (&recordsdone, 1);
+	  
 	  if ( verbose )
 	    msr_print (msr, 0);
 	  
@@ -115,30 +221,7 @@ main (int argc, char **argv)
           /* If continuous segment files */
           if ( segments )
             {
-              MSTrace *mst = 0;
-              MSTrace *mstmatch = 0;
-              long nmatched = 0;
-
-              mst = mst_addmsrtogroup (mstg, msr, 0, timetol, sampratetol);
-
-              /* If the trace is new (num of samples match) count matching */
-              if ( msr->samplecnt > 0 && msr->samplecnt == mst->samplecnt )
-                {
-                   mstmatch = mstg->traces;
-                   while ( mstmatch )
-                     {
-		       mstmatch = mst_findmatch (mstmatch, 0, msr->network, msr->station, msr->location, msr->channel);
-		       nmatched++;
-		       mstmatch = mstmatch->next; 
-                     }
-		   
-		   if ( nmatched > 1 )
-		     {
-		       mst->prvtptr = (void *) nmatched;
-		     }
-		}
-
-	      suffix = (long) mst->prvtptr;
+	      suffix = segmentsuffix (mstg, msr);
             }
 	  else
 	    {
@@ -149,42 +232,594 @@ main (int argc, char **argv)
 	  arch = archiveroot;
 	  while ( arch )
 	    {
-	      ds_streamproc (&arch->datastream, msr, suffix, verbose);
+	      if ( ds_streamproc (&arch->datastream, msr, suffix, verbose) )
+		flp->failed = 1;
 	      arch = arch->next;
 	    }
+	  
+	  if ( stopsig )
+	    break;
 	}
       
-      if ( retcode != MS_ENDOFFILE )
+      if ( retcode != MS_ENDOFFILE && retcode != MS_NOERROR && ! stopsig )
 	fprintf (stderr, "Error reading %s: %s\n", flp->filename, ms_errorstr(retcode));
       
+      flp->ingested = ( retcode == MS_ENDOFFILE && ! flp->failed );
+      
       /* Make sure everything is cleaned up */
       ms_readmsr (&msr, NULL, 0, NULL, NULL, 0, 0, 0);
       
-      /* Delete the input file if requested */
-      if ( deleteinput )
-	{
-	  if ( verbose )
-	    fprintf (stderr, "Deleting input file: %s\n", flp->filename);
-	  
-	  if ( unlink (flp->filename) )
-	    fprintf (stderr, "Error deleting file: %s\n", flp->filename);
-	}
+      atomic_fetch_add (&filesdone, 1);
+      reportprogress (0);
+      
+      /* An interrupted file is left as the first file not processed */
+      if ( stopsig )
+	break;
       
       flp = flp->next;
     }
 
-  /* Close each Archive */
+  if ( stopsig && verbose )
+    fprintf (stderr, "Termination signal received, closing archives\n");
+  
+  /* Close each Archive, writing any buffered data */
   arch = archiveroot;
   while ( arch )
     {
-      ds_streamproc (&arch->datastream, NULL, 0, verbose);
+      if ( ds_streamproc (&arch->datastream, NULL, 0, verbose) )
+	closefailed = 1;
       arch = arch->next;
     }
   
-  return 0;
+  reportprogress (1);
+  
+  /* Records of any file may not have been written if a file failed */
+  if ( closefailed )
+    for ( dlp = filelist; dlp; dlp = dlp->next )
+      dlp->ingested = 0;
+  
+  /* Delete the input files if requested and completely processed, only
+   * after all buffered records have been written and the files closed */
+  for ( dlp = filelist; dlp != flp && deleteinput && ! closefailed; dlp = dlp->next )
+    {
+      if ( verbose )
+	fprintf (stderr, "Deleting input file: %s\n", dlp->filename);
+      
+      if ( unlink (dlp->filename) )
+	fprintf (stderr, "Error deleting file: %s\n", dlp->filename);
+    }
+  
+  updatemanifest ();
+  
+  return ( closefailed ) ? 1 : 0;
 }  /* End of main() */
 
 
+/***************************************************************************
+ * segmentsuffix:
+ *
+ * Add a record to the continuous segment trace group and determine
+ * the file suffix for the segment: 0 for the first segment of a
+ * channel and the number of segments of the channel for each new
+ * segment after that.  The suffix only depends on the records of the
+ * same channel and the order they are added in.
+ *
+ * Returns the suffix for the record.
+ ***************************************************************************/
+static long
+segmentsuffix (MSTraceGroup *mstg, MSRecord *msr)
+{
+  MSTrace *mst = 0;
+  MSTrace *mstmatch = 0;
+  long nmatched = 0;
+  
+  mst = mst_addmsrtogroup (mstg, msr, 0, timetol, sampratetol);
+  
+  if ( ! mst )
+    return 0;
+  
+  /* If the trace is new (num of samples match) count matching */
+  if ( msr->samplecnt > 0 && msr->samplecnt == mst->samplecnt )
+    {
+      mstmatch = mstg->traces;
+      while ( mstmatch )
+	{
+	  mstmatch = mst_findmatch (mstmatch, 0, msr->network, msr->station, msr->location, msr->channel);
+	  if ( ! mstmatch )
+	    break;
+	  nmatched++;
+	  mstmatch = mstmatch->next; 
+	}
+      
+      if ( nmatched > 1 )
+	{
+	  mst->prvtptr = (void *) nmatched;
+	}
+    }
+  
+  return (long) mst->prvtptr;
+}  /* End of segmentsuffix() */
+
+
+/***************************************************************************
+ * queuepush:
+ *
+ * Add an item to a route queue, waiting while the queue is full.
+ *
+ * Returns 0 on success and -1 if routing was aborted.
+ ***************************************************************************/
+static int
+queuepush (RouteQueue *queue, const RouteItem *item)
+{
+  unsigned int tail = atomic_load_explicit (&queue->tail, memory_order_relaxed);
+  struct timespec pause = { 0, 100000 };
+  int spins = 0;
+  
+  while ( (tail - atomic_load_explicit (&queue->head, memory_order_acquire)) >= ROUTE_QUEUESIZE )
+    {
+      if ( atomic_load (&routeabort) )
+	return -1;
+      
+      if ( spins++ < 100 )
+	sched_yield ();
+      else
+	nanosleep (&pause, NULL);
+    }
+  
+  queue->items[tail & (ROUTE_QUEUESIZE - 1)] = *item;
+  atomic_store_explicit (&queue->tail, tail + 1, memory_order_release);
+  
+  return 0;
+}  /* End of queuepush() */
+
+
+/***************************************************************************
+ * queuepop:
+ *
+ * Remove the next item from a route queue, waiting while the queue
+ * is empty.
+ *
+ * Returns 0 on success and -1 if routing was aborted.
+ ***************************************************************************/
+static int
+queuepop (RouteQueue *queue, RouteItem *item)
+{
+  unsigned int head = atomic_load_explicit (&queue->head, memory_order_relaxed);
+  struct timespec pause = { 0, 100000 };
+  int spins = 0;
+  
+  while ( atomic_load_explicit (&queue->tail, memory_order_acquire) == head )
+    {
+      if ( atomic_load (&routeabort) )
+	return -1;
+      
+      if ( spins++ < 100 )
+	sched_yield ();
+      else
+	nanosleep (&pause, NULL);
+    }
+  
+  *item = queue->items[head & (ROUTE_QUEUESIZE - 1)];
+  atomic_store_explicit (&queue->head, head + 1, memory_order_release);
+  
+  return 0;
+}  /* End of queuepop() */
+
+
+/***************************************************************************
+ * routewriter:
+ *
+ * Determine the writer for a record from a hash (FNV-1a) of the NSLC
+ * codes that are defining in all archive layouts.  Records of the
+ * same channel are always routed to the same writer.
+ *
+ * Returns the writer index.
+ ***************************************************************************/
+static int
+routewriter (MSRecord *msr)
+{
+  const char *codes[4];
+  uint32_t hash = MS_FNV32_INIT;
+  int count = 0;
+  int idx;
+  
+  if ( keynet )  codes[count++] = msr->network;
+  if ( keysta )  codes[count++] = msr->station;
+  if ( keyloc )  codes[count++] = msr->location;
+  if ( keychan ) codes[count++] = msr->channel;
+  
+  for ( idx = 0; idx < count; idx++ )
+    {
+      hash = ms_fnv1a32 (hash, codes[idx], strlen (codes[idx]));
+      
+      /* Separate the codes */
+      hash = ms_fnv1a32 (hash, "_", 1);
+    }
+  
+  return (int) (hash % (uint32_t) writers);
+}  /* End of routewriter() */
+
+
+/***************************************************************************
+ * readerthread:
+ *
+ * Read the input files assigned to a reader (every readers'th file
+ * starting with the reader index) in order, decoding only the record
+ * headers, and pass a copy of each record to the writer determined
+ * by routewriter().  After each file an end of file marker is passed
+ * to every writer, also for files that are not read after a
+ * termination signal.
+ ***************************************************************************/
+static void *
+readerthread (void *arg)
+{
+  RouteReader *reader = (RouteReader *) arg;
+  RouteQueue *queues = &routequeues[reader->id * writers];
+  MSFileParam *msfp = NULL;
+  MSRecord *msr = NULL;
+  RouteItem item;
+  int retcode;
+  int fidx;
+  int widx;
+  
+  for ( fidx = reader->id; fidx < routecount; fidx += readers )
+    {
+      if ( ! stopsig && ! atomic_load (&routeabort) )
+	{
+	  if ( verbose )
+	    fprintf (stderr, "Reading %s\n", routefiles[fidx]->filename);
+	  
+	  while ( (retcode = ms_readmsr_r (&msfp, &msr, routefiles[fidx]->filename, reclen,
+					   NULL, NULL, 1, 0, verbose-1)) == MS_NOERROR )
+	    {
+	      if ( ! (item.record = (char *) malloc (msr->reclen)) )
+		{
+		  fprintf (stderr, "Cannot allocate memory for record from %s\n",
+			   routefiles[fidx]->filename);
+		  atomic_store (&routeabort, 1);
+		  break;
+		}
+	      
+	      memcpy (item.record, msr->record, msr->reclen);
+	      item.reclen = msr->reclen;
+	      
+	      /* Re-stamp quality indicator if specified */
+	      if ( restampqind )
+		item.record[6] = restampqind;
+	      
+	      atomic_fetch_add (&recordsdone, 1);
+	      
+	      if ( queuepush (&queues[routewriter (msr)], &item) )
+		{
+		  free (item.record);
+		  break;
+		}
+	      
+	      if ( stopsig )
+		break;
+	    }
+	  
+	  if ( retcode != MS_ENDOFFILE && retcode != MS_NOERROR && ! stopsig )
+	    fprintf (stderr, "Error reading %s: %s\n", routefiles[fidx]->filename, ms_errorstr(retcode));
+	  
+	  routedone[fidx] = ( ! stopsig && ! atomic_load (&routeabort) );
+	  routefiles[fidx]->ingested = ( routedone[fidx] && retcode == MS_ENDOFFILE );
+	  
+	  /* Make sure everything is cleaned up */
+	  ms_readmsr_r (&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+	  
+	  atomic_fetch_add (&filesdone, 1);
+	  reportprogress (0);
+	}
+      
+      /* Mark the end of the file for each writer */
+      item.record = NULL;
+      item.reclen = 0;
+      
+      for ( widx = 0; widx < writers; widx++ )
+	if ( queuepush (&queues[widx], &item) )
+	  return NULL;
+    }
+  
+  return NULL;
+}  /* End of readerthread() */
+
+
+/***************************************************************************
+ * writerthread:
+ *
+ * Write the records routed to a writer to its copy of each archive.
+ * Records are taken from the queues of the readers in input file
+ * order so the records of each stream are written in the same order
+ * as when routing without threads.  Continuous segment suffixes are
+ * tracked per writer, all records of a channel are routed to the
+ * same writer.  After a termination signal records following the
+ * first file that was not completely read are discarded.
+ ***************************************************************************/
+static void *
+writerthread (void *arg)
+{
+  RouteWriter *writer = (RouteWriter *) arg;
+  MSTraceGroup *mstg = NULL;
+  MSRecord *msr = NULL;
+  RouteItem item;
+  flag discard = 0;
+  long suffix = 0;
+  int retcode;
+  int fidx;
+  int aidx;
+  
+  if ( segments )
+    mstg = mst_initgroup (NULL);
+  
+  for ( fidx = 0; fidx < routecount; fidx++ )
+    {
+      RouteQueue *queue = &routequeues[(fidx % readers) * writers + writer->id];
+      
+      while ( ! queuepop (queue, &item) && item.record )
+	{
+	  if ( discard )
+	    {
+	      free (item.record);
+	      continue;
+	    }
+	  
+	  if ( (retcode = msr_unpack (item.record, item.reclen, &msr, bindata, verbose-1)) != MS_NOERROR )
+	    {
+	      fprintf (stderr, "Error unpacking record from %s: %s\n",
+		       routefiles[fidx]->filename, ms_errorstr(retcode));
+	    }
+	  else
+	    {
+	      if ( verbose )
+		msr_print (msr, 0);
+	      
+	      if ( segments )
+		suffix = segmentsuffix (mstg, msr);
+	      
+	      for ( aidx = 0; aidx < writer->streamcount; aidx++ )
+		if ( ds_streamproc (&writer->streams[aidx], msr, suffix, verbose) )
+		  writer->failed[fidx] = 1;
+	    }
+	  
+	  free (item.record);
+	}
+      
+      if ( atomic_load (&routeabort) )
+	break;
+      
+      /* After an interrupted file the records of following files, which
+       * readers may already have queued, are discarded so the archives
+       * contain the same records as when routing without threads */
+      if ( ! routedone[fidx] )
+	discard = 1;
+    }
+  
+  /* Close each archive, writing any buffered data */
+  for ( aidx = 0; aidx < writer->streamcount; aidx++ )
+    if ( ds_streamproc (&writer->streams[aidx], NULL, 0, verbose) )
+      writer->closefailed = 1;
+  
+  if ( msr )
+    {
+      msr->record = NULL;
+      msr_free (&msr);
+    }
+  
+  /* Segment counts are stored in the private pointers, not allocated */
+  if ( mstg )
+    {
+      MSTrace *mst;
+      
+      for ( mst = mstg->traces; mst; mst = mst->next )
+	mst->prvtptr = NULL;
+      
+      mst_freegroup (&mstg);
+    }
+  
+  return NULL;
+}  /* End of writerthread() */
+
+
+/***************************************************************************
+ * routeparallel:
+ *
+ * Route all input files with reader and writer threads, each writer
+ * uses its own copy of each archive.  Input files are deleted after
+ * all threads have finished if requested and if they were completely
+ * read.
+ *
+ * Returns 0 on success and -1 on error.
+ ***************************************************************************/
+static int
+routeparallel (void)
+{
+  RouteWriter *writerlist = NULL;
+  RouteReader *readerlist = NULL;
+  FileLink *flp;
+  Archive *arch;
+  int archcount = 0;
+  int wstarted = 0;
+  int rstarted = 0;
+  int retval = 0;
+  int idx;
+  int aidx;
+  int fidx;
+  
+  for ( flp = filelist; flp; flp = flp->next )
+    routecount++;
+  
+  for ( arch = archiveroot; arch; arch = arch->next )
+    archcount++;
+  
+  if ( readers <= 0 )
+    readers = writers;
+  if ( readers > routecount )
+    readers = routecount;
+  
+  routefiles = (FileLink **) malloc (routecount * sizeof (FileLink *));
+  routedone = (flag *) calloc (routecount, sizeof (flag));
+  routequeues = (RouteQueue *) calloc (readers * writers, sizeof (RouteQueue));
+  writerlist = (RouteWriter *) calloc (writers, sizeof (RouteWriter));
+  readerlist = (RouteReader *) calloc (readers, sizeof (RouteReader));
+  
+  if ( ! routefiles || ! routedone || ! routequeues || ! writerlist || ! readerlist )
+    {
+      fprintf (stderr, "routeparallel(): cannot allocate memory\n");
+      retval = -1;
+      goto cleanup;
+    }
+  
+  for ( idx = 0, flp = filelist; flp; flp = flp->next )
+    routefiles[idx++] = flp;
+  
+  atomic_init (&routeabort, 0);
+  
+  for ( idx = 0; idx < readers * writers; idx++ )
+    {
+      atomic_init (&routequeues[idx].head, 0);
+      atomic_init (&routequeues[idx].tail, 0);
+      
+      if ( ! (routequeues[idx].items = (RouteItem *) malloc (ROUTE_QUEUESIZE * sizeof (RouteItem))) )
+	{
+	  fprintf (stderr, "routeparallel(): cannot allocate memory\n");
+	  retval = -1;
+	  goto cleanup;
+	}
+    }
+  
+  /* Copy the archive definitions for each writer, in archive order */
+  for ( idx = 0; idx < writers; idx++ )
+    {
+      writerlist[idx].id = idx;
+      writerlist[idx].streamcount = archcount;
+      
+      writerlist[idx].streams = (DataStream *) calloc (archcount + 1, sizeof (DataStream));
+      writerlist[idx].failed = (flag *) calloc (routecount, sizeof (flag));
+      
+      if ( ! writerlist[idx].streams || ! writerlist[idx].failed )
+	{
+	  fprintf (stderr, "routeparallel(): cannot allocate memory\n");
+	  retval = -1;
+	  goto cleanup;
+	}
+      
+      for ( aidx = 0, arch = archiveroot; arch; arch = arch->next, aidx++ )
+	{
+	  writerlist[idx].streams[aidx] = arch->datastream;
+	  writerlist[idx].streams[aidx].grouproot = NULL;
+	  writerlist[idx].streams[aidx].layout = NULL;
+	  writerlist[idx].streams[aidx].index = NULL;
+	}
+    }
+  
+  if ( verbose )
+    fprintf (stderr, "Routing %d file(s) with %d reader and %d writer threads\n",
+	     routecount, readers, writers);
+  
+  for ( idx = 0; idx < writers; idx++, wstarted++ )
+    {
+      if ( pthread_create (&writerlist[idx].tid, NULL, writerthread, &writerlist[idx]) )
+	{
+	  fprintf (stderr, "routeparallel(): cannot create writer thread\n");
+	  atomic_store (&routeabort, 1);
+	  break;
+	}
+    }
+  
+  for ( idx = 0; idx < readers && ! atomic_load (&routeabort); idx++, rstarted++ )
+    {
+      readerlist[idx].id = idx;
+      
+      if ( pthread_create (&readerlist[idx].tid, NULL, readerthread, &readerlist[idx]) )
+	{
+	  fprintf (stderr, "routeparallel(): cannot create reader thread\n");
+	  atomic_store (&routeabort, 1);
+	  break;
+	}
+    }
+  
+  for ( idx = 0; idx < rstarted; idx++ )
+    pthread_join (readerlist[idx].tid, NULL);
+  
+  for ( idx = 0; idx < wstarted; idx++ )
+    pthread_join (writerlist[idx].tid, NULL);
+  
+  /* Combine the per writer flags once no thread is running */
+  for ( idx = 0; idx < wstarted; idx++ )
+    {
+      if ( writerlist[idx].closefailed )
+	retval = -1;
+      
+      for ( fidx = 0; fidx < routecount; fidx++ )
+	if ( writerlist[idx].failed[fidx] )
+	  routefiles[fidx]->failed = 1;
+    }
+  
+  if ( atomic_load (&routeabort) )
+    retval = -1;
+  else if ( stopsig && verbose )
+    fprintf (stderr, "Termination signal received, archives closed\n");
+  
+  reportprogress (1);
+  
+  /* Records of files after an interrupted file were discarded, after
+   * an error or an archive file failing to close no file is known to
+   * be completely archived */
+  for ( idx = 0; idx < routecount && routedone[idx] && ! retval; idx++ );
+  for ( ; idx < routecount; idx++ )
+    routefiles[idx]->ingested = 0;
+  
+  for ( idx = 0; idx < routecount; idx++ )
+    if ( routefiles[idx]->failed )
+      routefiles[idx]->ingested = 0;
+  
+  /* Delete the input files if requested and completely processed */
+  for ( idx = 0; idx < routecount && deleteinput && ! retval; idx++ )
+    {
+      if ( ! routedone[idx] )
+	continue;
+      
+      if ( verbose )
+	fprintf (stderr, "Deleting input file: %s\n", routefiles[idx]->filename);
+      
+      if ( unlink (routefiles[idx]->filename) )
+	fprintf (stderr, "Error deleting file: %s\n", routefiles[idx]->filename);
+    }
+  
+ cleanup:
+  /* Free records remaining in the queues after an abort */
+  for ( idx = 0; routequeues && idx < readers * writers; idx++ )
+    {
+      RouteQueue *queue = &routequeues[idx];
+      unsigned int pos;
+      
+      if ( ! queue->items )
+	continue;
+      
+      for ( pos = atomic_load (&queue->head); pos != atomic_load (&queue->tail); pos++ )
+	if ( queue->items[pos & (ROUTE_QUEUESIZE - 1)].record )
+	  free (queue->items[pos & (ROUTE_QUEUESIZE - 1)].record);
+      
+      free (queue->items);
+    }
+  
+  for ( idx = 0; writerlist && idx < writers; idx++ )
+    {
+      free (writerlist[idx].streams);
+      free (writerlist[idx].failed);
+    }
+  
+  free (writerlist);
+  free (readerlist);
+  free (routequeues);
+  free (routedone);
+  free (routefiles);
+  
+  return retval;
+}  /* End of routeparallel() */
+
+
 /***************************************************************************
  * parameter_proc:
  * Process the command line parameters.
@@ -259,6 +894,51 @@ parameter_proc (int argcount, char **argvec)
 	{
 	  idletimeout = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
 	}
+      else if (strcmp (argvec[optind], "-d") == 0)
+	{
+	  FileLink *newlp = (FileLink *) malloc (sizeof (FileLink));
+	  
+	  if ( ! newlp || ! (newlp->filename = strdup (getoptval(argcount, argvec, optind++))) )
+	    {
+	      fprintf (stderr, "Cannot allocate memory for directory name\n");
+	      return -1;
+	    }
+	  
+	  newlp->next = dirlist;
+	  dirlist = newlp;
+	}
+      else if (strcmp (argvec[optind], "-m") == 0)
+	{
+	  filematch = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-P") == 0)
+	{
+	  progress = 1;
+	}
+      else if (strcmp (argvec[optind], "-M") == 0)
+	{
+	  manifestfile = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-U") == 0)
+	{
+	  uniquerecs = 1;
+	}
+      else if (strcmp (argvec[optind], "-t") == 0)
+	{
+	  writers = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-tr") == 0)
+	{
+	  readers = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-wb") == 0)
+	{
+	  bufsize = strtol (getoptval(argcount, argvec, optind++), NULL, 10);
+	}
+      else if (strcmp (argvec[optind], "-sync") == 0)
+	{
+	  syncfiles = 1;
+	}
       else if (strcmp (argvec[optind], "-A") == 0)
 	{
 	  if ( addarchive(getoptval(argcount, argvec, optind++), NULL) == -1 )
@@ -300,8 +980,35 @@ parameter_proc (int argcount, char **argvec)
   if ( verbose )
     fprintf (stderr, "%s version: %s\n", PACKAGE, VERSION);
   
+  /* Add the files found in each directory, in the order specified */
+  if ( dirlist )
+    {
+      FileLink *reversed = 0;
+      FileLink *nextlp;
+      
+      while ( dirlist )
+	{
+	  nextlp = dirlist->next;
+	  dirlist->next = reversed;
+	  reversed = dirlist;
+	  dirlist = nextlp;
+	}
+      
+      for ( dirlist = reversed; dirlist; dirlist = nextlp )
+	{
+	  if ( adddir (dirlist->filename) < 0 )
+	    return -1;
+	  
+	  nextlp = dirlist->next;
+	  free (dirlist->filename);
+	  free (dirlist);
+	}
+      
+      if ( verbose )
+	fprintf (stderr, "Found %d input file(s)\n", filecount);
+    }
   /* Make sure input file(s) specified */
-  if ( filelist == 0 )
+  else if ( filelist == 0 )
     {
       if ( verbose )
 	fprintf (stderr, "Reading from standard input\n");
@@ -322,10 +1029,39 @@ parameter_proc (int argcount, char **argvec)
       while ( curarch != NULL )
 	{
 	  curarch->datastream.idletimeout = idletimeout;
+	  curarch->datastream.bufsize = ( bufsize > 0 ) ? bufsize : 0;
+	  curarch->datastream.syncflag = syncfiles;
+	  curarch->datastream.uniqueflag = uniquerecs;
+	  
+	  /* Route on the NSLC codes that are defining in all archives */
+	  keynet  = keynet  && ds_isdefining (curarch->datastream.path, 'n');
+	  keysta  = keysta  && ds_isdefining (curarch->datastream.path, 's');
+	  keyloc  = keyloc  && ds_isdefining (curarch->datastream.path, 'l');
+	  keychan = keychan && ds_isdefining (curarch->datastream.path, 'c');
+	  
 	  curarch = curarch->next;
 	}
     }
   
+  /* Skip input files that were routed before */
+  if ( manifestfile )
+    {
+      if ( ! (manifest = mf_open (manifestfile, verbose)) )
+	return -1;
+      
+      checkmanifest ();
+    }
+  
+  if ( writers < 1 )
+    writers = 1;
+  
+  if ( writers > 1 && ! keynet && ! keysta && ! keyloc && ! keychan )
+    {
+      if ( verbose )
+	fprintf (stderr, "Archive layouts do not separate channels, writing with one thread\n");
+      writers = 1;
+    }
+  
   return 0;
 }  /* End of parameter_proc() */
 
@@ -398,6 +1134,13 @@ addarchive( const char *path, const char *layout )
     snprintf (newarch->datastream.path, pathlayout, "%s", path);
   
   newarch->datastream.grouproot = NULL;
+  newarch->datastream.layout = NULL;
+  newarch->datastream.index = NULL;
+  newarch->datastream.bufsize = 0;
+  newarch->datastream.syncflag = 0;
+  newarch->datastream.uniqueflag = 0;
+  newarch->datastream.skipped = 0;
+  newarch->datastream.closefailed = 0;
   
   if ( newarch->datastream.path == NULL )
     {
@@ -422,7 +1165,7 @@ addarchive( const char *path, const char *layout )
 static void
 addfile (char *filename)
 {
-  FileLink *lastlp, *newlp;
+  FileLink *newlp;
   
   if ( filename == NULL )
     {
@@ -430,27 +1173,202 @@ addfile (char *filename)
       return;
     }
   
-  lastlp = filelist;
-  while ( lastlp != 0 )
-    {
-      if ( lastlp->next == 0 )
-        break;
-      
-      lastlp = lastlp->next;
-    }
-  
-  newlp = (FileLink *) malloc (sizeof (FileLink));
+  newlp = (FileLink *) calloc (1, sizeof (FileLink));
   newlp->filename = strdup(filename);
   newlp->next = 0;
   
-  if ( lastlp == 0 )
+  if ( filetail == 0 )
     filelist = newlp;
   else
-    lastlp->next = newlp;
+    filetail->next = newlp;
+  
+  filetail = newlp;
+  filecount++;
   
 }  /* End of addfile() */
 
 
+/***************************************************************************
+ * adddir:
+ *
+ * Search a directory tree and add each file with a name matching the
+ * file name pattern (-m) to the end of the global file list.  Entries
+ * are added in name order, hidden entries (starting with '.') are
+ * skipped and symbolic links to directories are not followed.
+ *
+ * Returns the number of files added or -1 on error.
+ ***************************************************************************/
+static int
+adddir (const char *dirname)
+{
+  struct dirent **entries = NULL;
+  struct stat st;
+  char path[1024];
+  int entrycount;
+  int added = 0;
+  int subadded;
+  int idx;
+  
+  if ( (entrycount = scandir (dirname, &entries, NULL, alphasort)) < 0 )
+    {
+      fprintf (stderr, "Cannot read directory %s: %s\n", dirname, strerror (errno));
+      return -1;
+    }
+  
+  for ( idx = 0; idx < entrycount; idx++ )
+    {
+      const char *name = entries[idx]->d_name;
+      
+      if ( name[0] == '.' )
+	{
+	  free (entries[idx]);
+	  continue;
+	}
+      
+      if ( snprintf (path, sizeof(path), "%s/%s", dirname, name) >= (int) sizeof(path) )
+	{
+	  fprintf (stderr, "Path name too long, skipping: %s/%s\n", dirname, name);
+	}
+      else if ( lstat (path, &st) )
+	{
+	  fprintf (stderr, "Cannot stat %s: %s\n", path, strerror (errno));
+	}
+      else if ( S_ISDIR (st.st_mode) )
+	{
+	  if ( (subadded = adddir (path)) > 0 )
+	    added += subadded;
+	}
+      else if ( (S_ISREG (st.st_mode) || (S_ISLNK (st.st_mode) && ! stat (path, &st) && S_ISREG (st.st_mode)))
+		&& ! fnmatch (filematch, name, 0) )
+	{
+	  addfile (path);
+	  added++;
+	}
+      
+      free (entries[idx]);
+    }
+  
+  free (entries);
+  
+  return added;
+}  /* End of adddir() */
+
+
+/***************************************************************************
+ * reportprogress:
+ *
+ * Print the number of input files and records read on standard output
+ * if progress reporting (-P) is enabled, at most once a second unless
+ * 'final' is set.  The line format is:
+ *
+ * PROGRESS files=<read>/<total> records=<read>
+ ***************************************************************************/
+static void
+reportprogress (flag final)
+{
+  static time_t lastreport = 0;
+  time_t now;
+  
+  if ( ! progress )
+    return;
+  
+  pthread_mutex_lock (&progresslock);
+  
+  now = time (NULL);
+  
+  if ( final || now != lastreport )
+    {
+      lastreport = now;
+      printf ("PROGRESS files=%d/%d records=%lld\n", atomic_load (&filesdone),
+	      filecount, (long long int) atomic_load (&recordsdone));
+      fflush (stdout);
+    }
+  
+  pthread_mutex_unlock (&progresslock);
+}  /* End of reportprogress() */
+
+
+/***************************************************************************
+ * checkmanifest:
+ *
+ * Remove the input files that have already been routed according to
+ * the ingest manifest (-M) from the global file list.  The identity
+ * of each remaining file is kept for updatemanifest().  Standard
+ * input and files that cannot be checked are always routed.
+ *
+ * Returns the number of files removed.
+ ***************************************************************************/
+static int
+checkmanifest (void)
+{
+  FileLink **link = &filelist;
+  FileLink *flp;
+  int removed = 0;
+  
+  filetail = 0;
+  
+  while ( (flp = *link) )
+    {
+      if ( strcmp (flp->filename, "-") &&
+	   mf_check (manifest, flp->filename, &flp->ident, verbose) == 1 )
+	{
+	  if ( verbose > 1 )
+	    fprintf (stderr, "Skipping routed file %s\n", flp->filename);
+	  
+	  *link = flp->next;
+	  free (flp->filename);
+	  free (flp);
+	  filecount--;
+	  removed++;
+	  continue;
+	}
+      
+      filetail = flp;
+      link = &flp->next;
+    }
+  
+  if ( verbose )
+    fprintf (stderr, "Skipping %d input file(s) listed in manifest, %d file(s) to route\n",
+	     removed, filecount);
+  
+  return removed;
+}  /* End of checkmanifest() */
+
+
+/***************************************************************************
+ * updatemanifest:
+ *
+ * Add each input file that was completely read and archived to the
+ * ingest manifest and close it.  This is done after all archives are
+ * closed so files are only listed when their records are written, no
+ * file is marked ingested if any archive file failed to close.
+ ***************************************************************************/
+static void
+updatemanifest (void)
+{
+  FileLink *flp;
+  int added = 0;
+  
+  if ( ! manifest )
+    return;
+  
+  for ( flp = filelist; flp; flp = flp->next )
+    {
+      if ( ! flp->ingested || ! flp->ident.hashed )
+	continue;
+      
+      if ( mf_add (manifest, flp->filename, &flp->ident) == 0 )
+	added++;
+    }
+  
+  if ( verbose )
+    fprintf (stderr, "Added %d file(s) to manifest %s\n", added, manifestfile);
+  
+  mf_close (manifest, verbose);
+  manifest = 0;
+}  /* End of updatemanifest() */
+
+
 /***************************************************************************
  * usage:
  * Print the usage message and exit.
@@ -475,6 +1393,15 @@ usage (int level)
            " -rt diff       Specify a sample rate tolerance for continuous segments\n"
 	   " -r reclen      Specify input record length in bytes, default is autodetection\n"
 	   " -i timeout     Idle stream entries might be closed (seconds), default 300\n"
+	   " -d dir         Read all files in a directory tree, can be used multiple times\n"
+	   " -m pattern     File name pattern for files found with -d, default '*'\n"
+	   " -P             Report progress counts on standard output\n"
+	   " -M file        Skip input files listed in an ingest manifest, add routed files\n"
+	   " -U             Skip records that are already in the archive files\n"
+	   " -wb bytes      Size of write buffer for each open file, default 16384, 0 disables\n"
+	   " -sync          Synchronize each file to disk when it is closed\n"
+	   " -t threads     Number of writer threads, default 1 (no threads)\n"
+	   " -tr threads    Number of reader threads with -t, default same as writers\n"
 	   " -A format      Write all records is a custom directory/file layout (try -H)\n"
 	   "\n"
 	   " # Preset format layouts #\n"
@@ -484,7 +1411,7 @@ usage (int level)
 
 	   " -CSS CSSdir    Write all records in a CSS-like file layout\n"
 	   "\n"
-	   " file(s)        File(s) of input Mini-SEED, default is stdin\n"
+	   " file(s)        File(s) of input Mini-SEED, default is stdin unless -d is used\n"
 	   "\n");
 
   if  ( level )
@@ -524,10 +1451,11 @@ usage (int level)
 
 /***************************************************************************
  * term_handler:
- * Signal handler routine.
+ * Signal handler routine, stop reading input so that buffered data
+ * is written and the archives are closed.
  ***************************************************************************/
 static void
 term_handler (int sig)
 {
-  exit (0);
+  stopsig = 1;
 }
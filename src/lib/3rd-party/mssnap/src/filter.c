@@ -0,0 +1,266 @@
+/***************************************************************************
+ * filter.c
+ *
+ * Butterworth filters of snapshot samples.
+ *
+ * The filters are the ones applied by detection scripts (ObsPy's
+ * lowpass, highpass and bandpass with 4 corners, not zero phase): the
+ * analog Butterworth prototype is transformed to the requested band,
+ * mapped to a digital filter with the bilinear transform and applied as
+ * a cascade of second order sections.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+#include "filter.h"
+
+#define CORNERS   4        /* Order of the prototype */
+#define MAXPOLES  (2 * CORNERS)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* A second order section, a0 is 1 */
+typedef struct Section_s {
+  double b0, b1, b2;
+  double a1, a2;
+}
+Section;
+
+static int  design (const Filter *filter, double samprate, Section *sections, double *gain);
+static double warp (double freq, double nyquist);
+
+
+/***************************************************************************
+ * flt_parse:
+ * Parse a filter specification.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+flt_parse (const char *spec, Filter *filter)
+{
+  memset (filter, 0, sizeof(Filter));
+
+  if ( ! strcmp (spec, "none") )
+    {
+      filter->type = FLT_NONE;
+      return 0;
+    }
+
+  if ( sscanf (spec, "lowpass:%lf", &filter->freqmax) == 1 && filter->freqmax > 0.0 )
+    {
+      filter->type = FLT_LOWPASS;
+      return 0;
+    }
+
+  if ( sscanf (spec, "highpass:%lf", &filter->freqmin) == 1 && filter->freqmin > 0.0 )
+    {
+      filter->type = FLT_HIGHPASS;
+      return 0;
+    }
+
+  if ( sscanf (spec, "bandpass:%lf:%lf", &filter->freqmin, &filter->freqmax) == 2 &&
+       filter->freqmin > 0.0 && filter->freqmax > filter->freqmin )
+    {
+      filter->type = FLT_BANDPASS;
+      return 0;
+    }
+
+  fprintf (stderr, "Invalid filter: %s\n", spec);
+  return -1;
+}  /* End of flt_parse() */
+
+
+/***************************************************************************
+ * flt_apply:
+ * Filter samples in place.  Missing samples (NaN) are filtered as zeros
+ * and stay missing.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+flt_apply (const Filter *filter, double samprate, double *samples, long count)
+{
+  Section sections[CORNERS];
+  double state[CORNERS][2];
+  double gain;
+  double x, y;
+  long idx;
+  int nsections;
+  int sec;
+
+  if ( filter->type == FLT_NONE )
+    return 0;
+
+  if ( (nsections = design (filter, samprate, sections, &gain)) < 0 )
+    return -1;
+
+  memset (state, 0, sizeof(state));
+
+  /* Transposed direct form II */
+  for ( idx = 0; idx < count; idx++ )
+    {
+      x = ( isfinite (samples[idx]) ) ? samples[idx] * gain : 0.0;
+
+      for ( sec = 0; sec < nsections; sec++ )
+	{
+	  y = sections[sec].b0 * x + state[sec][0];
+	  state[sec][0] = sections[sec].b1 * x - sections[sec].a1 * y + state[sec][1];
+	  state[sec][1] = sections[sec].b2 * x - sections[sec].a2 * y;
+	  x = y;
+	}
+
+      if ( isfinite (samples[idx]) )
+	samples[idx] = x;
+    }
+
+  return 0;
+}  /* End of flt_apply() */
+
+
+/***************************************************************************
+ * design:
+ * Compute the second order sections of a filter.
+ *
+ * Returns the number of sections, and -1 on failure
+ ***************************************************************************/
+static int
+design (const Filter *filter, double samprate, Section *sections, double *gain)
+{
+  double complex proto[CORNERS];
+  double complex poles[MAXPOLES];
+  double complex zeros[MAXPOLES];
+  double complex num = 1.0;
+  double complex den = 1.0;
+  double complex lp, root;
+  double nyquist = samprate / 2.0;
+  double fs2 = 4.0;             /* Twice the sampling rate of the normalized filter */
+  double wlow, whigh, bw, wo;
+  double k = 1.0;
+  int npoles = 0;
+  int nzeros = 0;
+  int nsections = 0;
+  int used[MAXPOLES];
+  int idx, jdx;
+
+  if ( samprate <= 0.0 )
+    return -1;
+
+  for ( idx = 0; idx < CORNERS; idx++ )
+    proto[idx] = cexp (I * M_PI * (2 * idx + CORNERS + 1) / (2.0 * CORNERS));
+
+  switch ( filter->type )
+    {
+    case FLT_LOWPASS:
+      wo = warp (filter->freqmax, nyquist);
+      for ( idx = 0; idx < CORNERS; idx++ )
+	poles[npoles++] = wo * proto[idx];
+      k = pow (wo, CORNERS);
+      break;
+
+    case FLT_HIGHPASS:
+      wo = warp (filter->freqmin, nyquist);
+      for ( idx = 0; idx < CORNERS; idx++ )
+	{
+	  poles[npoles++] = wo / proto[idx];
+	  zeros[nzeros++] = 0.0;
+	}
+      k = 1.0;
+      break;
+
+    case FLT_BANDPASS:
+      wlow = warp (filter->freqmin, nyquist);
+      whigh = warp (filter->freqmax, nyquist);
+      bw = whigh - wlow;
+      wo = sqrt (wlow * whigh);
+      for ( idx = 0; idx < CORNERS; idx++ )
+	{
+	  lp = proto[idx] * bw / 2.0;
+	  root = csqrt (lp * lp - wo * wo);
+	  poles[npoles++] = lp + root;
+	  poles[npoles++] = lp - root;
+	  zeros[nzeros++] = 0.0;
+	}
+      k = pow (bw, CORNERS);
+      break;
+
+    default:
+      return -1;
+    }
+
+  /* Bilinear transform, zeros at infinity are mapped to -1 */
+  for ( idx = 0; idx < nzeros; idx++ )
+    {
+      num *= fs2 - zeros[idx];
+      zeros[idx] = (fs2 + zeros[idx]) / (fs2 - zeros[idx]);
+    }
+  for ( idx = 0; idx < npoles; idx++ )
+    {
+      den *= fs2 - poles[idx];
+      poles[idx] = (fs2 + poles[idx]) / (fs2 - poles[idx]);
+    }
+  while ( nzeros < npoles )
+    zeros[nzeros++] = -1.0;
+
+  *gain = k * creal (num / den);
+
+  /* Pair each pole with its conjugate, or real poles together */
+  memset (used, 0, sizeof(used));
+  for ( idx = 0; idx < npoles; idx++ )
+    {
+      if ( used[idx] )
+	continue;
+      used[idx] = 1;
+
+      for ( jdx = idx + 1; jdx < npoles; jdx++ )
+	if ( ! used[jdx] && cabs (poles[jdx] - conj (poles[idx])) < 1e-9 * (1.0 + cabs (poles[idx])) )
+	  break;
+
+      if ( jdx == npoles )
+	for ( jdx = idx + 1; jdx < npoles; jdx++ )
+	  if ( ! used[jdx] && fabs (cimag (poles[jdx])) < 1e-12 && fabs (cimag (poles[idx])) < 1e-12 )
+	    break;
+
+      if ( jdx == npoles )
+	{
+	  fprintf (stderr, "Cannot pair filter poles\n");
+	  return -1;
+	}
+      used[jdx] = 1;
+
+      sections[nsections].a1 = -creal (poles[idx] + poles[jdx]);
+      sections[nsections].a2 = creal (poles[idx] * poles[jdx]);
+      sections[nsections].b0 = 1.0;
+      sections[nsections].b1 = -creal (zeros[2 * nsections] + zeros[2 * nsections + 1]);
+      sections[nsections].b2 = creal (zeros[2 * nsections] * zeros[2 * nsections + 1]);
+      nsections++;
+    }
+
+  return nsections;
+}  /* End of design() */
+
+
+/***************************************************************************
+ * warp:
+ * Pre-warp a frequency in Hz for the bilinear transform of a filter
+ * normalized to a sampling rate of 2.  Frequencies above Nyquist are
+ * limited to just below it.
+ ***************************************************************************/
+static double
+warp (double freq, double nyquist)
+{
+  double w = freq / nyquist;
+
+  if ( w > 0.999 )
+    w = 0.999;
+
+  return 4.0 * tan (M_PI * w / 2.0);
+}  /* End of warp() */
@@ -0,0 +1,37 @@
+/***************************************************************************
+ * filter.h
+ *
+ * Butterworth filters of snapshot samples.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef FILTER_H
+#define FILTER_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLT_NONE      0
+#define FLT_LOWPASS   1
+#define FLT_HIGHPASS  2
+#define FLT_BANDPASS  3
+
+/* A filter as given on requests: none, lowpass:f, highpass:f or
+ * bandpass:fmin:fmax with frequencies in Hz */
+typedef struct Filter_s {
+  int     type;
+  double  freqmin;
+  double  freqmax;
+}
+Filter;
+
+extern int flt_parse (const char *spec, Filter *filter);
+extern int flt_apply (const Filter *filter, double samprate, double *samples, long count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILTER_H */
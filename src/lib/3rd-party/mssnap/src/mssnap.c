@@ -0,0 +1,578 @@
+/***************************************************************************
+ * mssnap.c
+ *
+ * Render trigger snapshots, the waveform of a triggered stream with the
+ * trigger on and off markers over its spectrogram, as PNG images.
+ *
+ * Snapshot requests are read from standard input (or a file), each a
+ * text line followed by the samples of the stream:
+ *
+ *   SNAP rate on off count title path
+ *
+ * rate is the sampling rate, on and off the trigger times in seconds
+ * after the first sample, count the number of samples which follow the
+ * line as little endian 64 bit floats, title the text drawn over the
+ * waveform (no spaces) and path, the rest of the line, the image file.
+ *
+ * Requests may also reference the Mini-SEED files holding the stream,
+ * one line with tab separated fields:
+ *
+ *   REF start end on off NET.STA.LOC.CHA filter path file [file ...]
+ *
+ * start and end are the epoch times of the window to draw, on and off
+ * the trigger times in seconds after start and filter the filter the
+ * detection applied (none, lowpass:f, highpass:f or bandpass:fmin:fmax).
+ * Detection runs record these lines and images are drawn when they are
+ * first viewed.
+ *
+ * The main thread reads the requests and a pool of threads reads the
+ * referenced data, draws and encodes the images, so that a detection
+ * script only pays for writing the samples.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "render.h"
+#include "png.h"
+#include "filter.h"
+#include "source.h"
+
+#define VERSION "1.1"
+#define PACKAGE "mssnap"
+
+#define LINELEN 65536
+#define MAXFILES 256
+
+/* A queued snapshot request, with either samples or data files */
+typedef struct Job_s {
+  Snapshot     snap;
+  char        *path;
+  char        *stream;          /* NET.STA.LOC.CHA of data files */
+  char       **files;
+  int          filecount;
+  double       start;           /* Window of data files */
+  double       end;
+  Filter       filter;
+  struct Job_s *next;
+}
+Job;
+
+static int  parameter_proc (int argcount, char **argvec);
+static char *getoptval (int argcount, char **argvec, int argopt);
+static Job *readjob (FILE *input);
+static int  parseref (char *line, Job *job);
+static int  readsamples (FILE *input, double *samples, long count);
+static void freejob (Job *job);
+static void *renderthread (void *arg);
+static void usage (void);
+
+static int    verbose     = 0;
+static char  *inputfile   = 0;     /* Requests file, standard input by default */
+static int    threadcount = 0;     /* Render threads, one per CPU by default */
+static int    width       = 800;   /* Image size in pixels */
+static int    height      = 600;
+static int    level       = 1;     /* zlib compression level, speed over size */
+static int    skipexisting = 0;    /* Skip requests whose image exists */
+
+/* Requests waiting for a render thread.  The queue is bounded so that
+ * the reader does not hold the samples of more streams than can be
+ * drawn at once. */
+static Job            *queuehead  = 0;
+static Job            *queuetail  = 0;
+static int             queuecount = 0;
+static int             queuesize  = 0;
+static int             queueclosed = 0;
+static pthread_mutex_t queuelock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queuecond  = PTHREAD_COND_INITIALIZER;
+
+static long            failed     = 0;
+
+
+int
+main (int argc, char **argv)
+{
+  pthread_t *threads;
+  FILE *input = stdin;
+  Job *job;
+  int idx;
+  int rv = 0;
+
+  /* Process given parameters (command line and parameter file) */
+  if ( parameter_proc (argc, argv) < 0 )
+    return 1;
+
+  if ( inputfile && (input = fopen (inputfile, "rb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", inputfile, strerror (errno));
+      return 1;
+    }
+
+  if ( threadcount <= 0 )
+    {
+      threadcount = (int) sysconf (_SC_NPROCESSORS_ONLN);
+      if ( threadcount <= 0 )
+	threadcount = 1;
+    }
+
+  queuesize = 2 * threadcount;
+
+  if ( (threads = (pthread_t *) malloc (sizeof(pthread_t) * threadcount)) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return 1;
+    }
+
+  for ( idx = 0; idx < threadcount; idx++ )
+    if ( pthread_create (&threads[idx], NULL, renderthread, NULL) )
+      {
+	fprintf (stderr, "Cannot create render thread\n");
+	return 1;
+      }
+
+  /* Queue requests until the end of the input */
+  while ( (job = readjob (input)) != NULL )
+    {
+      pthread_mutex_lock (&queuelock);
+      while ( queuecount >= queuesize )
+	pthread_cond_wait (&queuecond, &queuelock);
+
+      if ( queuetail )
+	queuetail->next = job;
+      else
+	queuehead = job;
+      queuetail = job;
+      queuecount++;
+
+      pthread_cond_broadcast (&queuecond);
+      pthread_mutex_unlock (&queuelock);
+    }
+
+  if ( ferror (input) || ! feof (input) )
+    rv = 1;
+
+  pthread_mutex_lock (&queuelock);
+  queueclosed = 1;
+  pthread_cond_broadcast (&queuecond);
+  pthread_mutex_unlock (&queuelock);
+
+  for ( idx = 0; idx < threadcount; idx++ )
+    pthread_join (threads[idx], NULL);
+
+  free (threads);
+
+  if ( input != stdin )
+    fclose (input);
+
+  if ( failed )
+    {
+      fprintf (stderr, "%ld snapshot(s) could not be written\n", failed);
+      rv = 1;
+    }
+
+  return rv;
+}  /* End of main() */
+
+
+/***************************************************************************
+ * renderthread:
+ * Draw and write queued snapshots until the queue is closed and empty.
+ ***************************************************************************/
+static void *
+renderthread (void *arg)
+{
+  Image img;
+  Job *job;
+  int rv;
+
+  if ( rd_alloc (&img, width, height) )
+    fprintf (stderr, "Cannot allocate memory\n");
+
+  for ( ;; )
+    {
+      pthread_mutex_lock (&queuelock);
+      while ( ! queuehead && ! queueclosed )
+	pthread_cond_wait (&queuecond, &queuelock);
+
+      if ( (job = queuehead) == NULL )
+	{
+	  pthread_mutex_unlock (&queuelock);
+	  break;
+	}
+
+      if ( (queuehead = job->next) == NULL )
+	queuetail = 0;
+      queuecount--;
+
+      pthread_cond_broadcast (&queuecond);
+      pthread_mutex_unlock (&queuelock);
+
+      if ( skipexisting && access (job->path, F_OK) == 0 )
+	{
+	  freejob (job);
+	  continue;
+	}
+
+      rv = ( img.pixels ) ? 0 : -1;
+
+      if ( rv == 0 && job->files )
+	{
+	  rv = src_read (job->files, job->filecount, job->stream,
+			 job->start, job->end, &job->snap, verbose);
+	  if ( rv == 0 )
+	    rv = flt_apply (&job->filter, job->snap.samprate, job->snap.samples, job->snap.count);
+	}
+
+      if ( rv == 0 )
+	rv = rd_snapshot (&job->snap, &img);
+
+      if ( rv == 0 )
+	rv = png_write (job->path, &img, level);
+
+      if ( rv )
+	{
+	  pthread_mutex_lock (&queuelock);
+	  failed++;
+	  pthread_mutex_unlock (&queuelock);
+	}
+      else if ( verbose )
+	fprintf (stderr, "Wrote %s\n", job->path);
+
+      freejob (job);
+    }
+
+  rd_free (&img);
+
+  return NULL;
+}  /* End of renderthread() */
+
+
+/***************************************************************************
+ * readjob:
+ * Read the next snapshot request and its samples.
+ *
+ * Returns a new request, or NULL at the end of the input or on error
+ * in which case the error is reported.
+ ***************************************************************************/
+static Job *
+readjob (FILE *input)
+{
+  char line[LINELEN];
+  char *path;
+  size_t length;
+  Job *job;
+  int offset = 0;
+
+  for ( ;; )
+    {
+      if ( ! fgets (line, sizeof(line), input) )
+	return NULL;
+
+      if ( (job = (Job *) calloc (1, sizeof(Job))) == NULL )
+	{
+	  fprintf (stderr, "Cannot allocate memory\n");
+	  return NULL;
+	}
+
+      if ( strncmp (line, "REF\t", 4) )
+	break;
+
+      /* Requests referencing data stand alone, invalid ones are skipped */
+      if ( parseref (line, job) == 0 )
+	return job;
+
+      freejob (job);
+      pthread_mutex_lock (&queuelock);
+      failed++;
+      pthread_mutex_unlock (&queuelock);
+    }
+
+  if ( sscanf (line, "SNAP %lf %lf %lf %ld %63s %n", &job->snap.samprate,
+	       &job->snap.on, &job->snap.off, &job->snap.count,
+	       job->snap.title, &offset) != 5 || ! offset ||
+       job->snap.count < 0 )
+    {
+      fprintf (stderr, "Invalid request: %s", line);
+      free (job);
+      return NULL;
+    }
+
+  path = line + offset;
+  length = strlen (path);
+  while ( length && (path[length - 1] == '\n' || path[length - 1] == '\r') )
+    path[--length] = '\0';
+
+  if ( ! length || (job->path = strdup (path)) == NULL ||
+       (job->snap.samples = (double *) malloc (sizeof(double) * (job->snap.count + 1))) == NULL )
+    {
+      fprintf (stderr, "Invalid request or cannot allocate memory: %s\n", line);
+      freejob (job);
+      return NULL;
+    }
+
+  if ( readsamples (input, job->snap.samples, job->snap.count) )
+    {
+      fprintf (stderr, "%s: missing samples\n", job->path);
+      freejob (job);
+      return NULL;
+    }
+
+  return job;
+}  /* End of readjob() */
+
+
+/***************************************************************************
+ * parseref:
+ * Parse a request referencing data files.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parseref (char *line, Job *job)
+{
+  char *fields[8 + MAXFILES];
+  char *field;
+  char *next;
+  char *end;
+  int count = 0;
+  int idx;
+
+  if ( (end = strpbrk (line, "\r\n")) != NULL )
+    *end = '\0';
+
+  for ( field = line; field && count < 8 + MAXFILES; field = next )
+    {
+      if ( (next = strchr (field, '\t')) != NULL )
+	*next++ = '\0';
+      if ( *field )
+	fields[count++] = field;
+    }
+
+  if ( count < 9 ||
+       sscanf (fields[1], "%lf", &job->start) != 1 || sscanf (fields[2], "%lf", &job->end) != 1 ||
+       sscanf (fields[3], "%lf", &job->snap.on) != 1 || sscanf (fields[4], "%lf", &job->snap.off) != 1 ||
+       job->end < job->start || flt_parse (fields[6], &job->filter) )
+    {
+      fprintf (stderr, "Invalid request: %s\n", line);
+      return -1;
+    }
+
+  /* Trigger times are given from the start of the window */
+  strncpy (job->snap.title, fields[5], RD_TITLELEN - 1);
+  for ( end = job->snap.title; *end; end++ )
+    if ( *end == '.' )
+      *end = '-';
+
+  job->filecount = count - 8;
+  if ( (job->stream = strdup (fields[5])) == NULL ||
+       (job->path = strdup (fields[7])) == NULL ||
+       (job->files = (char **) calloc (job->filecount, sizeof(char *))) == NULL )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      return -1;
+    }
+
+  for ( idx = 0; idx < job->filecount; idx++ )
+    if ( (job->files[idx] = strdup (fields[8 + idx])) == NULL )
+      {
+	fprintf (stderr, "Cannot allocate memory\n");
+	return -1;
+      }
+
+  return 0;
+}  /* End of parseref() */
+
+
+/***************************************************************************
+ * readsamples:
+ * Read little endian 64 bit floats into host order.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+readsamples (FILE *input, double *samples, long count)
+{
+  const union { unsigned short s; unsigned char c[2]; } order = { 1 };
+  unsigned char *bytes;
+  unsigned char tmp;
+  long idx;
+  int k;
+
+  if ( count && fread (samples, sizeof(double), count, input) != (size_t) count )
+    return -1;
+
+  /* Swap on big endian hosts */
+  if ( order.c[0] == 0 )
+    for ( idx = 0; idx < count; idx++ )
+      {
+	bytes = (unsigned char *) &samples[idx];
+	for ( k = 0; k < 4; k++ )
+	  {
+	    tmp = bytes[k];
+	    bytes[k] = bytes[7 - k];
+	    bytes[7 - k] = tmp;
+	  }
+      }
+
+  return 0;
+}  /* End of readsamples() */
+
+
+/***************************************************************************
+ * freejob:
+ * Free a snapshot request.
+ ***************************************************************************/
+static void
+freejob (Job *job)
+{
+  int idx;
+
+  if ( job->files )
+    for ( idx = 0; idx < job->filecount; idx++ )
+      free (job->files[idx]);
+
+  free (job->files);
+  free (job->stream);
+  free (job->snap.samples);
+  free (job->path);
+  free (job);
+}  /* End of freejob() */
+
+
+/***************************************************************************
+ * parameter_proc:
+ * Process the command line parameters.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+parameter_proc (int argcount, char **argvec)
+{
+  int optind;
+
+  /* Process all command line arguments */
+  for (optind = 1; optind < argcount; optind++)
+    {
+      if (strcmp (argvec[optind], "-V") == 0)
+	{
+	  fprintf (stderr, "%s version: %s\n", PACKAGE, VERSION);
+	  exit (0);
+	}
+      else if (strcmp (argvec[optind], "-h") == 0)
+	{
+	  usage ();
+	  exit (0);
+	}
+      else if (strncmp (argvec[optind], "-v", 2) == 0)
+	{
+	  verbose += strspn (&argvec[optind][1], "v");
+	}
+      else if (strcmp (argvec[optind], "-i") == 0)
+	{
+	  inputfile = getoptval(argcount, argvec, optind++);
+	}
+      else if (strcmp (argvec[optind], "-n") == 0)
+	{
+	  skipexisting = 1;
+	}
+      else if (strcmp (argvec[optind], "-j") == 0)
+	{
+	  threadcount = atoi (getoptval(argcount, argvec, optind++));
+	}
+      else if (strcmp (argvec[optind], "-W") == 0)
+	{
+	  width = atoi (getoptval(argcount, argvec, optind++));
+	}
+      else if (strcmp (argvec[optind], "-H") == 0)
+	{
+	  height = atoi (getoptval(argcount, argvec, optind++));
+	}
+      else if (strcmp (argvec[optind], "-z") == 0)
+	{
+	  level = atoi (getoptval(argcount, argvec, optind++));
+	}
+      else
+	{
+	  fprintf (stderr, "Unknown option: %s\n", argvec[optind]);
+	  return -1;
+	}
+    }
+
+  if ( width < 64 || height < 96 || width > 16384 || height > 16384 )
+    {
+      fprintf (stderr, "Invalid image size: %dx%d\n", width, height);
+      return -1;
+    }
+
+  if ( level < 0 || level > 9 )
+    {
+      fprintf (stderr, "Invalid compression level: %d\n", level);
+      return -1;
+    }
+
+  return 0;
+}  /* End of parameter_proc() */
+
+
+/***************************************************************************
+ * getoptval:
+ * Return the value to a command line option; checking that the value is
+ * itself not an option (starting with '-') and is not past the end of
+ * the argument list.
+ *
+ * argcount: total arguments in argvec
+ * argvec: argument list
+ * argopt: index of option to process, value is expected to be at +1
+ *
+ * Returns value on success and exits with error message on failure
+ ***************************************************************************/
+static char *
+getoptval (int argcount, char **argvec, int argopt)
+{
+  if ( argvec == NULL || argvec[argopt] == NULL ) {
+    fprintf (stderr, "getoptval(): NULL option requested\n");
+    exit (1);
+  }
+
+  if ( (argopt+1) < argcount && *argvec[argopt+1] != '-' )
+    return argvec[argopt+1];
+
+  fprintf (stderr, "Option %s requires a value\n", argvec[argopt]);
+  exit (1);
+}  /* End of getoptval() */
+
+
+/***************************************************************************
+ * usage:
+ * Print the usage message.
+ ***************************************************************************/
+static void
+usage (void)
+{
+  fprintf (stderr, "%s version: %s\n\n", PACKAGE, VERSION);
+  fprintf (stderr, "Render trigger snapshots as PNG images.\n\n");
+  fprintf (stderr, "Usage: %s [options] < requests\n\n", PACKAGE);
+  fprintf (stderr,
+	   " ## Options ##\n"
+	   " -V             Report program version\n"
+	   " -h             Show this usage message\n"
+	   " -v             Report every written image\n"
+	   " -i file        Read requests from file instead of standard input\n"
+	   " -n             Skip requests whose image already exists\n"
+	   " -j threads     Number of render threads, default one per CPU\n"
+	   " -W width       Image width in pixels, default 800\n"
+	   " -H height      Image height in pixels, default 600\n"
+	   " -z level       zlib compression level, 0 to 9, default 1\n"
+	   "\n"
+	   "Each request is a line followed by count little endian 64 bit floats:\n"
+	   "  SNAP rate on off count title path\n"
+	   "or a line of tab separated fields referencing Mini-SEED files:\n"
+	   "  REF start end on off NET.STA.LOC.CHA filter path file [file ...]\n"
+	   "\n");
+}  /* End of usage() */
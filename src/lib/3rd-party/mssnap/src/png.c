@@ -0,0 +1,165 @@
+/***************************************************************************
+ * png.c
+ *
+ * PNG encoding of RGB images with zlib.
+ *
+ * Rows are written with the Sub filter which suits the flat areas and
+ * color ramps of snapshots.  The file is written under a temporary name
+ * and renamed so that readers never see a partial image.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "png.h"
+
+static int writechunk (FILE *fp, const char *type, const unsigned char *data, size_t length);
+static void putuint32 (unsigned char *dest, unsigned long value);
+
+
+/***************************************************************************
+ * png_write:
+ * Write an image to a PNG file with the given zlib compression level.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+png_write (const char *path, const Image *img, int level)
+{
+  static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  unsigned char header[13];
+  unsigned char *raw;
+  unsigned char *dest;
+  const unsigned char *src;
+  unsigned char *row;
+  size_t stride = (size_t) img->width * 3;
+  size_t rawlen = (stride + 1) * img->height;
+  uLongf destlen = compressBound (rawlen);
+  char tmppath[1024];
+  FILE *fp;
+  size_t idx;
+  int y;
+  int rv = 0;
+
+  raw = (unsigned char *) malloc (rawlen);
+  dest = (unsigned char *) malloc (destlen);
+
+  if ( ! raw || ! dest )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      free (raw);
+      free (dest);
+      return -1;
+    }
+
+  for ( y = 0; y < img->height; y++ )
+    {
+      row = raw + (stride + 1) * y;
+      src = img->pixels + stride * y;
+
+      row[0] = 1;   /* Sub filter, difference to the pixel on the left */
+      memcpy (row + 1, src, 3);
+      for ( idx = 3; idx < stride; idx++ )
+	row[1 + idx] = (unsigned char) (src[idx] - src[idx - 3]);
+    }
+
+  if ( compress2 (dest, &destlen, raw, rawlen, level) != Z_OK )
+    {
+      fprintf (stderr, "%s: cannot compress image\n", path);
+      free (raw);
+      free (dest);
+      return -1;
+    }
+
+  free (raw);
+
+  putuint32 (header, img->width);
+  putuint32 (header + 4, img->height);
+  header[8] = 8;     /* Bit depth */
+  header[9] = 2;     /* RGB */
+  header[10] = 0;    /* Deflate */
+  header[11] = 0;    /* Adaptive filtering */
+  header[12] = 0;    /* No interlace */
+
+  snprintf (tmppath, sizeof(tmppath), "%s.%ld.tmp", path, (long) getpid ());
+
+  if ( (fp = fopen (tmppath, "wb")) == NULL )
+    {
+      fprintf (stderr, "Cannot open %s: %s\n", tmppath, strerror (errno));
+      free (dest);
+      return -1;
+    }
+
+  if ( fwrite (signature, sizeof(signature), 1, fp) != 1 ||
+       writechunk (fp, "IHDR", header, sizeof(header)) ||
+       writechunk (fp, "IDAT", dest, destlen) ||
+       writechunk (fp, "IEND", NULL, 0) )
+    rv = -1;
+
+  if ( fclose (fp) )
+    rv = -1;
+
+  free (dest);
+
+  if ( rv == 0 && rename (tmppath, path) )
+    rv = -1;
+
+  if ( rv )
+    {
+      fprintf (stderr, "Cannot write %s: %s\n", path, strerror (errno));
+      unlink (tmppath);
+    }
+
+  return rv;
+}  /* End of png_write() */
+
+
+/***************************************************************************
+ * writechunk:
+ * Write a PNG chunk, length, type, data and CRC.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+writechunk (FILE *fp, const char *type, const unsigned char *data, size_t length)
+{
+  unsigned char buf[4];
+  uLong crc;
+
+  crc = crc32 (0L, (const Bytef *) type, 4);
+  if ( length )
+    crc = crc32 (crc, data, length);
+
+  putuint32 (buf, length);
+  if ( fwrite (buf, 4, 1, fp) != 1 || fwrite (type, 4, 1, fp) != 1 )
+    return -1;
+
+  if ( length && fwrite (data, length, 1, fp) != 1 )
+    return -1;
+
+  putuint32 (buf, crc);
+  if ( fwrite (buf, 4, 1, fp) != 1 )
+    return -1;
+
+  return 0;
+}  /* End of writechunk() */
+
+
+/***************************************************************************
+ * putuint32:
+ * Store a value as a big endian 32 bit integer.
+ ***************************************************************************/
+static void
+putuint32 (unsigned char *dest, unsigned long value)
+{
+  dest[0] = (unsigned char) (value >> 24);
+  dest[1] = (unsigned char) (value >> 16);
+  dest[2] = (unsigned char) (value >> 8);
+  dest[3] = (unsigned char) value;
+}  /* End of putuint32() */
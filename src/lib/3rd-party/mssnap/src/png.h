@@ -0,0 +1,24 @@
+/***************************************************************************
+ * png.h
+ *
+ * PNG encoding of RGB images.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef PNG_H
+#define PNG_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "render.h"
+
+extern int png_write (const char *path, const Image *img, int level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PNG_H */
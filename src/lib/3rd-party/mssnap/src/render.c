@@ -0,0 +1,574 @@
+/***************************************************************************
+ * render.c
+ *
+ * Drawing of trigger snapshots.
+ *
+ * The image holds a title, the waveform pane and the spectrogram pane
+ * with a time axis in seconds below it.  The waveform is decimated to
+ * the minimum and maximum of the samples of each pixel column so that
+ * drawing costs one pass over the samples whatever their count.  The
+ * spectrogram is computed with Hann windowed FFTs over half overlapping
+ * segments, the power of the segments falling in the same pixel column
+ * is averaged and drawn in dB with a jet color map.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "render.h"
+
+#define MARGIN    8        /* Image border */
+#define GAP       8        /* Space between the panes */
+#define TITLEH    22       /* Height of the title band */
+#define LABELH    16       /* Height of the time axis band */
+#define NFFT      256      /* Longest spectrogram segment */
+#define DBRANGE   100.0    /* Dynamic range of the spectrogram */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* 5x7 glyphs, one byte per row, bit 4 is the leftmost column */
+static const char glyphchars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ-.:_";
+static const unsigned char glyphs[][7] = {
+  {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}, {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E},
+  {0x0E,0x11,0x01,0x02,0x04,0x08,0x1F}, {0x1F,0x02,0x04,0x02,0x01,0x11,0x0E},
+  {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}, {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E},
+  {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}, {0x1F,0x01,0x02,0x04,0x08,0x08,0x08},
+  {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}, {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C},
+  {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}, {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E},
+  {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}, {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C},
+  {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}, {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10},
+  {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}, {0x11,0x11,0x11,0x1F,0x11,0x11,0x11},
+  {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}, {0x07,0x02,0x02,0x02,0x02,0x12,0x0C},
+  {0x11,0x12,0x14,0x18,0x14,0x12,0x11}, {0x10,0x10,0x10,0x10,0x10,0x10,0x1F},
+  {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}, {0x11,0x11,0x19,0x15,0x13,0x11,0x11},
+  {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10},
+  {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}, {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11},
+  {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}, {0x1F,0x04,0x04,0x04,0x04,0x04,0x04},
+  {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}, {0x11,0x11,0x11,0x11,0x11,0x0A,0x04},
+  {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}, {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11},
+  {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}, {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F},
+  {0x00,0x00,0x00,0x1F,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00,0x00,0x0C,0x0C},
+  {0x00,0x0C,0x0C,0x00,0x0C,0x0C,0x00}, {0x00,0x00,0x00,0x00,0x00,0x00,0x1F}
+};
+
+static const unsigned char black[3] = { 0, 0, 0 };
+static const unsigned char white[3] = { 255, 255, 255 };
+static const unsigned char frame[3] = { 160, 160, 160 };
+static const unsigned char red[3]   = { 255, 0, 0 };
+static const unsigned char blue[3]  = { 0, 0, 255 };
+
+static void fillrect (Image *img, int x, int y, int w, int h, const unsigned char *color);
+static void drawframe (Image *img, int x, int y, int w, int h);
+static int  drawtext (Image *img, int x, int y, int scale, const char *text,
+		      const unsigned char *color);
+static void drawwaveform (Image *img, const Snapshot *snap, int x0, int y0, int w, int h);
+static void drawmarker (Image *img, const Snapshot *snap, double secs,
+			int x0, int y0, int w, int h, const unsigned char *color);
+static int  drawspectrogram (Image *img, const Snapshot *snap, int x0, int y0, int w, int h);
+static void drawtimeaxis (Image *img, const Snapshot *snap, int x0, int y0, int w);
+static void fft (double *re, double *im, int n);
+static void jet (double t, unsigned char *rgb);
+
+
+/***************************************************************************
+ * rd_alloc:
+ * Allocate the pixels of an image.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+rd_alloc (Image *img, int width, int height)
+{
+  img->width = width;
+  img->height = height;
+  img->pixels = (unsigned char *) malloc ((size_t) width * height * 3);
+
+  return ( img->pixels ) ? 0 : -1;
+}  /* End of rd_alloc() */
+
+
+/***************************************************************************
+ * rd_free:
+ * Free the pixels of an image.
+ ***************************************************************************/
+void
+rd_free (Image *img)
+{
+  free (img->pixels);
+  img->pixels = 0;
+}  /* End of rd_free() */
+
+
+/***************************************************************************
+ * rd_snapshot:
+ * Draw a snapshot into an allocated image.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+rd_snapshot (const Snapshot *snap, Image *img)
+{
+  int x0 = MARGIN;
+  int w = img->width - 2 * MARGIN;
+  int avail = img->height - 2 * MARGIN - TITLEH - GAP - LABELH;
+  int waveh = avail / 2;
+  int spech = avail - waveh;
+  int wavey = MARGIN + TITLEH;
+  int specy = wavey + waveh + GAP;
+
+  if ( w < 16 || waveh < 16 )
+    {
+      fprintf (stderr, "Image of %dx%d is too small\n", img->width, img->height);
+      return -1;
+    }
+
+  if ( snap->count < 1 || snap->samprate <= 0.0 )
+    {
+      fprintf (stderr, "%s: no samples to draw\n", snap->title);
+      return -1;
+    }
+
+  fillrect (img, 0, 0, img->width, img->height, white);
+
+  drawtext (img, x0, MARGIN, 2, snap->title, black);
+
+  drawwaveform (img, snap, x0, wavey, w, waveh);
+  drawmarker (img, snap, snap->on, x0, wavey, w, waveh, red);
+  drawmarker (img, snap, snap->off, x0, wavey, w, waveh, blue);
+  drawframe (img, x0, wavey, w, waveh);
+
+  if ( drawspectrogram (img, snap, x0, specy, w, spech) )
+    return -1;
+  drawframe (img, x0, specy, w, spech);
+
+  drawtimeaxis (img, snap, x0, specy + spech + 1, w);
+
+  return 0;
+}  /* End of rd_snapshot() */
+
+
+/***************************************************************************
+ * fillrect:
+ * Fill a rectangle clipped to the image.
+ ***************************************************************************/
+static void
+fillrect (Image *img, int x, int y, int w, int h, const unsigned char *color)
+{
+  unsigned char *px;
+  int row, col;
+
+  if ( x < 0 ) { w += x; x = 0; }
+  if ( y < 0 ) { h += y; y = 0; }
+  if ( x + w > img->width ) w = img->width - x;
+  if ( y + h > img->height ) h = img->height - y;
+
+  for ( row = y; row < y + h; row++ )
+    {
+      px = img->pixels + ((size_t) row * img->width + x) * 3;
+      for ( col = 0; col < w; col++, px += 3 )
+	{
+	  px[0] = color[0];
+	  px[1] = color[1];
+	  px[2] = color[2];
+	}
+    }
+}  /* End of fillrect() */
+
+
+/***************************************************************************
+ * drawframe:
+ * Draw a frame just outside of a pane.
+ ***************************************************************************/
+static void
+drawframe (Image *img, int x, int y, int w, int h)
+{
+  fillrect (img, x - 1, y - 1, w + 2, 1, frame);
+  fillrect (img, x - 1, y + h, w + 2, 1, frame);
+  fillrect (img, x - 1, y, 1, h, frame);
+  fillrect (img, x + w, y, 1, h, frame);
+}  /* End of drawframe() */
+
+
+/***************************************************************************
+ * drawtext:
+ * Draw a text with the 5x7 font, lower case letters are drawn as upper
+ * case and characters without a glyph as blanks.
+ *
+ * Returns the width of the text in pixels.
+ ***************************************************************************/
+static int
+drawtext (Image *img, int x, int y, int scale, const char *text,
+	  const unsigned char *color)
+{
+  const char *gc;
+  int start = x;
+  int row, col;
+  int ch;
+
+  for ( ; *text; text++, x += 6 * scale )
+    {
+      ch = *text;
+      if ( ch >= 'a' && ch <= 'z' )
+	ch -= 'a' - 'A';
+
+      if ( ch == '\0' || (gc = strchr (glyphchars, ch)) == NULL )
+	continue;
+
+      for ( row = 0; row < 7; row++ )
+	for ( col = 0; col < 5; col++ )
+	  if ( glyphs[gc - glyphchars][row] & (0x10 >> col) )
+	    fillrect (img, x + col * scale, y + row * scale, scale, scale, color);
+    }
+
+  return ( x > start ) ? x - start - scale : 0;
+}  /* End of drawtext() */
+
+
+/***************************************************************************
+ * drawwaveform:
+ * Draw the samples with one vertical span per pixel column between the
+ * minimum and the maximum of the samples of the column.  The last
+ * sample of the previous column is included so that the spans join.
+ * Streams with fewer samples than columns are drawn as lines between
+ * the samples.
+ ***************************************************************************/
+static void
+drawwaveform (Image *img, const Snapshot *snap, int x0, int y0, int w, int h)
+{
+  double vmin = HUGE_VAL;
+  double vmax = -HUGE_VAL;
+  double cmin, cmax;
+  double scale;
+  double pos, value, prev;
+  long first, last;
+  long idx;
+  int col;
+  int top, bottom;
+
+  for ( idx = 0; idx < snap->count; idx++ )
+    {
+      if ( ! isfinite (snap->samples[idx]) )
+	continue;
+      if ( snap->samples[idx] < vmin ) vmin = snap->samples[idx];
+      if ( snap->samples[idx] > vmax ) vmax = snap->samples[idx];
+    }
+
+  if ( vmin > vmax )
+    return;
+
+  scale = ( vmax > vmin ) ? (h - 1) / (vmax - vmin) : 0.0;
+  prev = HUGE_VAL;
+
+  for ( col = 0; col < w; col++ )
+    {
+      cmin = HUGE_VAL;
+      cmax = -HUGE_VAL;
+
+      if ( snap->count < w )
+	{
+	  /* Fewer samples than columns, join linearly interpolated values */
+	  pos = ( w > 1 ) ? (double) col * (snap->count - 1) / (w - 1) : 0.0;
+	  idx = (long) pos;
+	  value = snap->samples[idx];
+	  if ( idx + 1 < snap->count )
+	    value += (pos - idx) * (snap->samples[idx + 1] - value);
+
+	  if ( isfinite (value) )
+	    {
+	      cmin = cmax = value;
+	      if ( prev < cmin ) cmin = prev;
+	      if ( prev > cmax && prev != HUGE_VAL ) cmax = prev;
+	    }
+	  prev = ( isfinite (value) ) ? value : HUGE_VAL;
+	}
+      else
+	{
+	  first = (long) ((double) col * snap->count / w);
+	  last = (long) ((double) (col + 1) * snap->count / w);
+	  if ( first > 0 )
+	    first--;
+
+	  for ( idx = first; idx < last && idx < snap->count; idx++ )
+	    {
+	      if ( ! isfinite (snap->samples[idx]) )
+		continue;
+	      if ( snap->samples[idx] < cmin ) cmin = snap->samples[idx];
+	      if ( snap->samples[idx] > cmax ) cmax = snap->samples[idx];
+	    }
+	}
+
+      if ( cmin > cmax )
+	continue;
+
+      if ( scale > 0.0 )
+	{
+	  top = y0 + (int) lround ((vmax - cmax) * scale);
+	  bottom = y0 + (int) lround ((vmax - cmin) * scale);
+	}
+      else
+	top = bottom = y0 + h / 2;
+
+      fillrect (img, x0 + col, top, 1, bottom - top + 1, black);
+    }
+}  /* End of drawwaveform() */
+
+
+/***************************************************************************
+ * drawmarker:
+ * Draw a trigger marker over the waveform pane, markers outside of the
+ * samples are not drawn.
+ ***************************************************************************/
+static void
+drawmarker (Image *img, const Snapshot *snap, double secs,
+	    int x0, int y0, int w, int h, const unsigned char *color)
+{
+  double pos = secs * snap->samprate / snap->count;
+  int x;
+
+  if ( ! (pos >= 0.0 && pos <= 1.0) )
+    return;
+
+  x = x0 + (int) (pos * (w - 1));
+  fillrect (img, x, y0, ( x + 1 < x0 + w ) ? 2 : 1, h, color);
+}  /* End of drawmarker() */
+
+
+/***************************************************************************
+ * drawspectrogram:
+ * Draw the spectrogram of the samples, low frequencies at the bottom.
+ *
+ * Segments of NFFT samples (less for short streams) overlap by half.
+ * With more segments than pixel columns the power of the segments of a
+ * column is averaged, with less a segment spans several columns.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+static int
+drawspectrogram (Image *img, const Snapshot *snap, int x0, int y0, int w, int h)
+{
+  double *window;
+  double *re, *im;
+  double *power;            /* rows x bins averaged power */
+  int    *hits;
+  double  mean, db;
+  double  pmin = HUGE_VAL;
+  double  pmax = -HUGE_VAL;
+  unsigned char rgb[3];
+  unsigned char *px;
+  long segments, seg;
+  long idx;
+  int nfft = NFFT;
+  int bins, rows;
+  int row, bin, col, y;
+
+  while ( nfft > 16 && nfft > snap->count )
+    nfft /= 2;
+
+  if ( nfft > snap->count )
+    return 0;
+
+  bins = nfft / 2 + 1;
+  segments = (snap->count - nfft) / (nfft / 2) + 1;
+  rows = ( segments < w ) ? (int) segments : w;
+
+  window = (double *) malloc (sizeof(double) * nfft * 3);
+  power = (double *) calloc ((size_t) rows * bins, sizeof(double));
+  hits = (int *) calloc (rows, sizeof(int));
+
+  if ( ! window || ! power || ! hits )
+    {
+      fprintf (stderr, "Cannot allocate memory\n");
+      free (window);
+      free (power);
+      free (hits);
+      return -1;
+    }
+
+  re = window + nfft;
+  im = re + nfft;
+
+  for ( idx = 0; idx < nfft; idx++ )
+    window[idx] = 0.5 - 0.5 * cos (2.0 * M_PI * idx / nfft);
+
+  for ( seg = 0; seg < segments; seg++ )
+    {
+      const double *samples = snap->samples + seg * (nfft / 2);
+
+      mean = 0.0;
+      for ( idx = 0; idx < nfft; idx++ )
+	mean += ( isfinite (samples[idx]) ) ? samples[idx] : 0.0;
+      mean /= nfft;
+
+      for ( idx = 0; idx < nfft; idx++ )
+	{
+	  re[idx] = (( isfinite (samples[idx]) ) ? samples[idx] - mean : 0.0) * window[idx];
+	  im[idx] = 0.0;
+	}
+
+      fft (re, im, nfft);
+
+      row = (int) (seg * rows / segments);
+      for ( bin = 0; bin < bins; bin++ )
+	power[(size_t) row * bins + bin] += re[bin] * re[bin] + im[bin] * im[bin];
+      hits[row]++;
+    }
+
+  for ( row = 0; row < rows; row++ )
+    for ( bin = 0; bin < bins; bin++ )
+      {
+	db = 10.0 * log10 (power[(size_t) row * bins + bin] / (hits[row] ? hits[row] : 1) + 1e-30);
+	power[(size_t) row * bins + bin] = db;
+	if ( db < pmin ) pmin = db;
+	if ( db > pmax ) pmax = db;
+      }
+
+  if ( pmin < pmax - DBRANGE )
+    pmin = pmax - DBRANGE;
+
+  for ( y = 0; y < h; y++ )
+    {
+      bin = ( h > 1 ) ? (int) lround ((double) (h - 1 - y) * (bins - 1) / (h - 1)) : 0;
+      px = img->pixels + ((size_t) (y0 + y) * img->width + x0) * 3;
+
+      for ( col = 0; col < w; col++, px += 3 )
+	{
+	  row = (int) ((long) col * rows / w);
+	  db = power[(size_t) row * bins + bin];
+	  jet ( ( pmax > pmin ) ? (db - pmin) / (pmax - pmin) : 0.0, rgb);
+	  px[0] = rgb[0];
+	  px[1] = rgb[1];
+	  px[2] = rgb[2];
+	}
+    }
+
+  free (window);
+  free (power);
+  free (hits);
+
+  return 0;
+}  /* End of drawspectrogram() */
+
+
+/***************************************************************************
+ * drawtimeaxis:
+ * Draw ticks and labels in seconds from the first sample below a pane,
+ * with a 1, 2 or 5 times a power of ten step for about eight ticks.
+ ***************************************************************************/
+static void
+drawtimeaxis (Image *img, const Snapshot *snap, int x0, int y0, int w)
+{
+  double duration = snap->count / snap->samprate;
+  double step, magnitude, secs;
+  char label[32];
+  int labelw;
+  int x, k;
+
+  if ( duration <= 0.0 )
+    return;
+
+  step = duration / 8.0;
+  magnitude = pow (10.0, floor (log10 (step)));
+  step /= magnitude;
+  if ( step < 1.5 )      step = 1.0;
+  else if ( step < 3.5 ) step = 2.0;
+  else if ( step < 7.5 ) step = 5.0;
+  else                   step = 10.0;
+  step *= magnitude;
+
+  for ( k = 0; (secs = k * step) <= duration * (1.0 + 1e-9); k++ )
+    {
+      x = x0 + (int) lround (secs / duration * (w - 1));
+      fillrect (img, x, y0, 1, 4, black);
+
+      snprintf (label, sizeof(label), "%g", secs);
+      labelw = (int) strlen (label) * 6 - 1;
+      x -= labelw / 2;
+      if ( x < 0 ) x = 0;
+      if ( x + labelw > img->width ) x = img->width - labelw;
+      drawtext (img, x, y0 + 6, 1, label, black);
+    }
+}  /* End of drawtimeaxis() */
+
+
+/***************************************************************************
+ * fft:
+ * In place iterative radix-2 FFT, n must be a power of two.
+ ***************************************************************************/
+static void
+fft (double *re, double *im, int n)
+{
+  double wr, wi, ur, ui, tr, ti, angle, tmp;
+  int i, j, k, len, half;
+
+  /* Bit reversal permutation */
+  for ( i = 1, j = 0; i < n; i++ )
+    {
+      k = n >> 1;
+      for ( ; j & k; k >>= 1 )
+	j ^= k;
+      j |= k;
+
+      if ( i < j )
+	{
+	  tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+	  tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+	}
+    }
+
+  for ( len = 2; len <= n; len <<= 1 )
+    {
+      half = len >> 1;
+      angle = -2.0 * M_PI / len;
+
+      for ( k = 0; k < half; k++ )
+	{
+	  wr = cos (angle * k);
+	  wi = sin (angle * k);
+
+	  for ( i = k; i < n; i += len )
+	    {
+	      j = i + half;
+	      ur = re[i];
+	      ui = im[i];
+	      tr = re[j] * wr - im[j] * wi;
+	      ti = re[j] * wi + im[j] * wr;
+	      re[i] = ur + tr;
+	      im[i] = ui + ti;
+	      re[j] = ur - tr;
+	      im[j] = ui - ti;
+	    }
+	}
+    }
+}  /* End of fft() */
+
+
+/***************************************************************************
+ * jet:
+ * Map a value between 0 and 1 to the jet color map, blue to red.
+ ***************************************************************************/
+static void
+jet (double t, unsigned char *rgb)
+{
+  double c[3];
+  int idx;
+
+  if ( t < 0.0 ) t = 0.0;
+  if ( t > 1.0 ) t = 1.0;
+
+  c[0] = 1.5 - fabs (4.0 * t - 3.0);
+  c[1] = 1.5 - fabs (4.0 * t - 2.0);
+  c[2] = 1.5 - fabs (4.0 * t - 1.0);
+
+  for ( idx = 0; idx < 3; idx++ )
+    {
+      if ( c[idx] < 0.0 ) c[idx] = 0.0;
+      if ( c[idx] > 1.0 ) c[idx] = 1.0;
+      rgb[idx] = (unsigned char) lround (c[idx] * 255.0);
+    }
+}  /* End of jet() */
@@ -0,0 +1,46 @@
+/***************************************************************************
+ * render.h
+ *
+ * Drawing of trigger snapshots: the waveform of a stream with the
+ * trigger on and off markers over its spectrogram.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef RENDER_H
+#define RENDER_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RD_TITLELEN 64
+
+/* An RGB image, 3 bytes per pixel, rows top to bottom */
+typedef struct Image_s {
+  int            width;
+  int            height;
+  unsigned char *pixels;
+}
+Image;
+
+/* The samples of a stream and the trigger to draw over them */
+typedef struct Snapshot_s {
+  char     title[RD_TITLELEN];
+  double   samprate;            /* Samples per second */
+  double   on;                  /* Trigger on, seconds after the first sample */
+  double   off;                 /* Trigger off, seconds after the first sample */
+  double  *samples;
+  long     count;
+}
+Snapshot;
+
+extern int  rd_alloc (Image *img, int width, int height);
+extern void rd_free (Image *img);
+extern int  rd_snapshot (const Snapshot *snap, Image *img);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RENDER_H */
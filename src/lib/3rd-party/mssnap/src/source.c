@@ -0,0 +1,152 @@
+/***************************************************************************
+ * source.c
+ *
+ * Reading of snapshot samples from Mini-SEED files.
+ *
+ * Detection runs record the files holding the data of each triggered
+ * stream instead of drawing it.  The records of the stream overlapping
+ * the window are decoded and their samples placed by time, so the
+ * files may hold other streams, overlap each other or be given in any
+ * order.  Samples missing from the files are left as NaN.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libmseed.h>
+
+#include "source.h"
+
+#define MAXSAMPLES 100000000L   /* Longest window in samples */
+
+
+/***************************************************************************
+ * src_read:
+ * Read the samples of a stream (NET.STA.LOC.CHA) from start to end
+ * (epoch seconds, both included) into a snapshot, leading and trailing
+ * missing samples are dropped and the trigger times are shifted
+ * accordingly.
+ *
+ * Returns 0 on success, and -1 on failure
+ ***************************************************************************/
+int
+src_read (char **files, int filecount, const char *stream,
+	  double start, double end, Snapshot *snap, int verbose)
+{
+  MSFileParam *msfp = 0;
+  MSRecord *msr = 0;
+  MSRecord *umsr = 0;
+  char codes[4][11];
+  hptime_t hstart = MS_EPOCH2HPTIME ((start));
+  hptime_t hend = MS_EPOCH2HPTIME ((end));
+  double *samples = 0;
+  double offset, value;
+  long count = 0;
+  long first, last;
+  long idx, pos;
+  int retcode;
+  int fidx;
+
+  if ( sscanf (stream, "%10[^.].%10[^.].%10[^.].%10s", codes[0], codes[1], codes[2], codes[3]) != 4 )
+    {
+      /* Empty location code */
+      codes[2][0] = '\0';
+      if ( sscanf (stream, "%10[^.].%10[^.]..%10s", codes[0], codes[1], codes[3]) != 3 )
+	{
+	  fprintf (stderr, "Invalid stream: %s\n", stream);
+	  return -1;
+	}
+    }
+
+  snap->samprate = 0.0;
+
+  for ( fidx = 0; fidx < filecount; fidx++ )
+    {
+      while ( (retcode = ms_readmsr_r (&msfp, &msr, files[fidx], 0, NULL, NULL,
+				       1, 0, verbose - 1)) == MS_NOERROR )
+	{
+	  if ( strcmp (msr->network, codes[0]) || strcmp (msr->station, codes[1]) ||
+	       strcmp (msr->location, codes[2]) || strcmp (msr->channel, codes[3]) )
+	    continue;
+
+	  if ( msr->samprate <= 0.0 || msr->starttime > hend || msr_endtime (msr) < hstart )
+	    continue;
+
+	  if ( ! samples )
+	    {
+	      snap->samprate = msr->samprate;
+	      count = (long) floor ((end - start) * snap->samprate + 0.5) + 1;
+
+	      if ( count < 1 || count > MAXSAMPLES ||
+		   (samples = (double *) malloc (sizeof(double) * count)) == NULL )
+		{
+		  fprintf (stderr, "%s: cannot allocate %ld samples\n", stream, count);
+		  ms_readmsr_r (&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+		  return -1;
+		}
+
+	      for ( idx = 0; idx < count; idx++ )
+		samples[idx] = NAN;
+	    }
+	  else if ( fabs (msr->samprate - snap->samprate) > 1e-4 * snap->samprate )
+	    continue;
+
+	  if ( msr_unpack (msr->record, msr->reclen, &umsr, 1, verbose - 1) != MS_NOERROR )
+	    {
+	      fprintf (stderr, "%s: cannot decode a record of %s\n", stream, files[fidx]);
+	      continue;
+	    }
+
+	  offset = (double) (umsr->starttime - hstart) / HPTMODULUS * snap->samprate;
+
+	  for ( idx = 0; idx < umsr->numsamples; idx++ )
+	    {
+	      pos = lround (offset + idx);
+	      if ( pos < 0 || pos >= count )
+		continue;
+
+	      switch ( umsr->sampletype )
+		{
+		case 'i': value = ((int32_t *) umsr->datasamples)[idx]; break;
+		case 'f': value = ((float *) umsr->datasamples)[idx]; break;
+		case 'd': value = ((double *) umsr->datasamples)[idx]; break;
+		default: value = NAN; break;
+		}
+
+	      samples[pos] = value;
+	    }
+	}
+
+      ms_readmsr_r (&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+
+      if ( retcode != MS_ENDOFFILE )
+	fprintf (stderr, "Error reading %s: %s\n", files[fidx], ms_errorstr (retcode));
+    }
+
+  if ( umsr )
+    msr_free (&umsr);
+
+  for ( first = 0; first < count && ! isfinite (samples[first]); first++ );
+  for ( last = count - 1; last >= first && ! isfinite (samples[last]); last-- );
+
+  if ( first > last )
+    {
+      fprintf (stderr, "%s: no data from %.6f to %.6f\n", stream, start, end);
+      free (samples);
+      return -1;
+    }
+
+  if ( first > 0 )
+    memmove (samples, samples + first, sizeof(double) * (last - first + 1));
+
+  snap->samples = samples;
+  snap->count = last - first + 1;
+  snap->on -= first / snap->samprate;
+  snap->off -= first / snap->samprate;
+
+  return 0;
+}  /* End of src_read() */
@@ -0,0 +1,25 @@
+/***************************************************************************
+ * source.h
+ *
+ * Reading of snapshot samples from Mini-SEED files.
+ *
+ * modified 2026.292
+ ***************************************************************************/
+
+#ifndef SOURCE_H
+#define SOURCE_H 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "render.h"
+
+extern int src_read (char **files, int filecount, const char *stream,
+		     double start, double end, Snapshot *snap, int verbose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOURCE_H */
@@ -0,0 +1,668 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/archiveindex.h>
+#include <sdp/gui/datamodel/job.h>
+#include <sdp/gui/datamodel/logger.h>
+#include <sdp/gui/datamodel/macros.h>
+#include "../../../3rd-party/libmseed/libmseed.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QPair>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtConcurrentMap>
+#include <algorithm>
+
+
+namespace {
+
+using namespace SDP::Qt4;
+
+typedef ArchiveIndex::Span Span;
+typedef ArchiveIndex::SpanList SpanList;
+typedef ArchiveIndex::StreamEntry StreamEntry;
+typedef ArchiveIndex::FileEntry FileEntry;
+typedef ArchiveIndex::FileEntryList FileEntryList;
+typedef QPair<QString, FileEntry> ScannedFile;
+
+static QString const IndexFileName = ".sdp.index";
+static quint32 const IndexMagic = 0x53445049;
+static qint32 const IndexVersion = 1;
+
+/**
+ * @brief A file of the archive to be read. When offset is set, previous
+ *        holds what was indexed from the first offset bytes of the file.
+ */
+struct ScanTask {
+		ScanTask() :
+				size(0), modified(0), offset(0) {}
+		QString path;
+		QString filepath;
+		qint64 size;
+		qint64 modified;
+		qint64 offset;
+		FileEntry previous;
+};
+
+
+bool spanLessThan(const Span& a, const Span& b) {
+	return a.start < b.start;
+}
+
+
+//! Half a sample period, the time tolerance between contiguous records
+qint64 timeTolerance(const double& samplingRate) {
+	return ( samplingRate > .0 ) ? (qint64) (HPTMODULUS / samplingRate / 2.) : 0;
+}
+
+
+//! Sorts spans and merges the ones overlapping or contiguous within tolerance
+void mergeSpans(SpanList& spans, const qint64& tolerance) {
+
+	if ( spans.size() < 2 ) return;
+
+	std::sort(spans.begin(), spans.end(), spanLessThan);
+
+	int last = 0;
+	for (int i = 1; i < spans.size(); ++i) {
+		if ( spans.at(i).start <= spans.at(last).end + tolerance ) {
+			if ( spans.at(i).end > spans.at(last).end )
+			    spans[last].end = spans.at(i).end;
+		}
+		else
+			spans[++last] = spans.at(i);
+	}
+	spans.resize(last + 1);
+}
+
+
+/**
+ * @brief Reads the records of a file from the task offset onward and
+ *        appends their time spans to the streams of the previous entry.
+ *        Samples are not decoded. This function runs in the thread pool.
+ */
+ScannedFile scanFile(const ScanTask& task) {
+
+	FileEntry entry;
+	if ( task.offset > 0 )
+	    entry = task.previous;
+	entry.size = task.size;
+	entry.modified = task.modified;
+
+	QHash<QString, int> streamIdx;
+	for (int i = 0; i < entry.streams.size(); ++i)
+		streamIdx.insert(entry.streams.at(i).stream, i);
+
+	const QByteArray filename = QFile::encodeName(task.filepath);
+	MSFileParam* msfp = NULL;
+	MSRecord* msr = NULL;
+
+	//! A negative file position makes libmseed seek to it before reading
+	off_t fpos = -task.offset;
+	int retcode;
+	while ( (retcode = ms_readmsr_r(&msfp, &msr, filename.constData(), 0,
+	    &fpos, NULL, 1, 0, 0)) == MS_NOERROR ) {
+
+		++entry.records;
+		if ( msr->samplecnt <= 0 ) continue;
+
+		const QString stream = QString("%1.%2.%3.%4").arg(msr->network)
+		    .arg(msr->station).arg(msr->location).arg(msr->channel);
+
+		QHash<QString, int>::const_iterator it = streamIdx.constFind(stream);
+		if ( it == streamIdx.constEnd() ) {
+			StreamEntry se;
+			se.stream = stream;
+			se.samplingRate = msr_samprate(msr);
+			it = streamIdx.insert(stream, entry.streams.size());
+			entry.streams << se;
+		}
+
+		StreamEntry& se = entry.streams[it.value()];
+		const double rate = msr_samprate(msr);
+		const qint64 period = ( rate > .0 ) ? (qint64) (HPTMODULUS / rate + .5) : 0;
+		const qint64 start = msr_starttime(msr);
+		const qint64 end = msr_endtime(msr) + period;
+		const qint64 tolerance = period / 2;
+
+		//! Records are mostly in time order, extend the last span if possible
+		if ( !se.spans.isEmpty() && start >= se.spans.last().end - tolerance
+		    && start <= se.spans.last().end + tolerance )
+			se.spans.last().end = end;
+		else
+			se.spans << Span(start, end);
+	}
+
+	if ( retcode != MS_ENDOFFILE )
+	    ++entry.errors;
+
+	//! Close the file and release the record
+	ms_readmsr_r(&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+
+	for (int i = 0; i < entry.streams.size(); ++i)
+		mergeSpans(entry.streams[i].spans, timeTolerance(entry.streams.at(i).samplingRate));
+
+	return ScannedFile(task.path, entry);
+}
+
+
+/**
+ * @brief Walks the archive and reads the files which are not in previous
+ *        or changed since. Files are read in parallel by the thread pool.
+ *        Hidden files (index, manifest and libmseed sidecar indexes) are
+ *        skipped.
+ */
+FileEntryList scanArchive(const QString& archive, const FileEntryList& previous) {
+
+	FileEntryList files;
+	QList<ScanTask> tasks;
+	const QDir root(archive);
+
+	QDirIterator it(archive, QDir::Files | QDir::NoDotAndDotDot,
+	    QDirIterator::Subdirectories);
+	while ( it.hasNext() ) {
+
+		it.next();
+		const QFileInfo info = it.fileInfo();
+		const QString path = root.relativeFilePath(info.filePath());
+		const qint64 size = info.size();
+		const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+		FileEntryList::const_iterator prev = previous.constFind(path);
+		if ( prev != previous.constEnd() && prev->size == size
+		    && prev->modified == modified ) {
+			files.insert(path, prev.value());
+			continue;
+		}
+
+		ScanTask task;
+		task.path = path;
+		task.filepath = info.filePath();
+		task.size = size;
+		task.modified = modified;
+
+		//! Records are only appended to archive files, read the new ones
+		if ( prev != previous.constEnd() && prev->errors == 0
+		    && size > prev->size && prev->size > 0 ) {
+			task.offset = prev->size;
+			task.previous = prev.value();
+		}
+
+		tasks << task;
+	}
+
+	const QList<ScannedFile> scanned =
+	    QtConcurrent::blockingMapped<QList<ScannedFile> >(tasks, scanFile);
+
+	for (int i = 0; i < scanned.size(); ++i)
+		files.insert(scanned.at(i).first, scanned.at(i).second);
+
+	return files;
+}
+
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+double ArchiveIndex::Coverage::ratio(const QDateTime& start,
+                                     const QDateTime& end) const {
+
+	const qint64 length = ArchiveIndex::toTime(end) - ArchiveIndex::toTime(start);
+	return ( length > 0 ) ? (double) covered / length : .0;
+}
+
+
+ArchiveIndex::ArchiveIndex(QObject* parent) :
+		QObject(parent), __watcher(new QFutureWatcher<FileEntryList>(this)),
+		__maxFileSpan(0), __pending(false), __generation(0),
+		__scanGeneration(0) {
+
+	connect(__watcher, SIGNAL(finished()), this, SLOT(scanFinished()));
+}
+
+
+ArchiveIndex::~ArchiveIndex() {
+	__watcher->waitForFinished();
+}
+
+
+bool ArchiveIndex::setArchive(const QString& dir) {
+
+	SDPASSERT(Logger::instancePtr());
+
+	const QString archive = QDir::cleanPath(dir);
+	if ( archive == __archive ) return true;
+
+	//! A running scan of the previous archive is left to finish in the
+	//! thread pool, its result is discarded by scanFinished()
+	++__generation;
+	__pending = false;
+
+	__archive = archive;
+	__indexFile = archive + QDir::separator() + IndexFileName;
+	__files.clear();
+	__lastUpdate = QDateTime();
+
+	if ( !QDir(archive).exists() ) {
+		buildStreams();
+		emit updated();
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "SDS archive " + archive + " does not exist");
+		return false;
+	}
+
+	load();
+	buildStreams();
+	emit updated();
+
+	return true;
+}
+
+
+const QString& ArchiveIndex::archive() const {
+	return __archive;
+}
+
+
+bool ArchiveIndex::isUpdating() const {
+	return __watcher->isRunning();
+}
+
+
+int ArchiveIndex::fileCount() const {
+	return __files.size();
+}
+
+
+int ArchiveIndex::streamCount() const {
+	return __streams.size();
+}
+
+
+QStringList ArchiveIndex::streams() const {
+	QStringList list = __streams.keys();
+	list.sort();
+	return list;
+}
+
+
+const QDateTime& ArchiveIndex::lastUpdate() const {
+	return __lastUpdate;
+}
+
+
+ArchiveIndex::CoverageList
+ArchiveIndex::coverage(const QStringList& stations, const QDateTime& start,
+                       const QDateTime& end) const {
+
+	CoverageList list;
+
+	const qint64 t1 = toTime(start);
+	const qint64 t2 = toTime(end);
+	if ( t2 <= t1 ) return list;
+
+	QStringList found;
+	QStringList names = __streams.keys();
+	names.sort();
+
+	for (int n = 0; n < names.size(); ++n) {
+
+		const QString station = names.at(n).section('.', 0, 1);
+		if ( !stations.isEmpty() && !stations.contains(station) ) continue;
+		found << station;
+
+		Coverage cov;
+		cov.stream = names.at(n);
+		qint64 tolerance = 0;
+
+		//! Files starting before t1 may still hold data after it, go back
+		//! as far as the longest span held in a single file
+		const FileTimeMap& map = __streams[names.at(n)];
+		for (FileTimeMap::const_iterator it = map.lowerBound(t1 - __maxFileSpan);
+		        it != map.constEnd() && it.key() < t2; ++it) {
+
+			FileEntryList::const_iterator file = __files.constFind(it.value());
+			if ( file == __files.constEnd() ) continue;
+
+			bool used = false;
+			for (int i = 0; i < file->streams.size(); ++i) {
+				const StreamEntry& se = file->streams.at(i);
+				if ( se.stream != cov.stream ) continue;
+				tolerance = qMax(tolerance, timeTolerance(se.samplingRate));
+				for (int j = 0; j < se.spans.size(); ++j) {
+					if ( se.spans.at(j).end <= t1 || se.spans.at(j).start >= t2 )
+					    continue;
+					cov.spans << Span(qMax(se.spans.at(j).start, t1),
+					    qMin(se.spans.at(j).end, t2));
+					used = true;
+				}
+			}
+			if ( used ) ++cov.files;
+		}
+
+		mergeSpans(cov.spans, tolerance);
+
+		qint64 cursor = t1;
+		for (int i = 0; i < cov.spans.size(); ++i) {
+			if ( cov.spans.at(i).start > cursor + tolerance )
+			    cov.gaps << Span(cursor, cov.spans.at(i).start);
+			cov.covered += cov.spans.at(i).end - cov.spans.at(i).start;
+			cursor = qMax(cursor, cov.spans.at(i).end);
+		}
+		if ( cursor + tolerance < t2 )
+		    cov.gaps << Span(cursor, t2);
+
+		list << cov;
+	}
+
+	//! Stations without any stream in the archive are missing altogether
+	for (int i = 0; i < stations.size(); ++i) {
+		if ( found.contains(stations.at(i)) ) continue;
+		Coverage cov;
+		cov.stream = stations.at(i);
+		cov.gaps << Span(t1, t2);
+		list << cov;
+	}
+
+	return list;
+}
+
+
+ArchiveIndex::StreamEntryList
+ArchiveIndex::scanFiles(const QStringList& files, QStringList* failed) {
+
+	QList<ScanTask> tasks;
+	for (int i = 0; i < files.size(); ++i) {
+		const QFileInfo info(files.at(i));
+		ScanTask task;
+		task.path = files.at(i);
+		task.filepath = info.filePath();
+		task.size = info.size();
+		task.modified = info.lastModified().toMSecsSinceEpoch();
+		tasks << task;
+	}
+
+	const QList<ScannedFile> scanned =
+	    QtConcurrent::blockingMapped<QList<ScannedFile> >(tasks, scanFile);
+
+	QMap<QString, StreamEntry> streams;
+	for (int i = 0; i < scanned.size(); ++i) {
+
+		const FileEntry& entry = scanned.at(i).second;
+		if ( entry.errors && failed )
+		    *failed << scanned.at(i).first;
+
+		for (int j = 0; j < entry.streams.size(); ++j) {
+			const StreamEntry& se = entry.streams.at(j);
+			QMap<QString, StreamEntry>::iterator it = streams.find(se.stream);
+			if ( it == streams.end() )
+				streams.insert(se.stream, se);
+			else
+				it->spans += se.spans;
+		}
+	}
+
+	for (QMap<QString, StreamEntry>::iterator it = streams.begin();
+	        it != streams.end(); ++it)
+		mergeSpans(it->spans, timeTolerance(it->samplingRate));
+
+	return streams.values();
+}
+
+
+qint64 ArchiveIndex::toTime(const QDateTime& dt) {
+	//! Date and time are read as UTC, whatever their time spec
+	return QDateTime(dt.date(), dt.time(), Qt::UTC).toMSecsSinceEpoch()
+	    * (HPTMODULUS / 1000);
+}
+
+
+QDateTime ArchiveIndex::fromTime(const qint64& t) {
+	return QDateTime::fromMSecsSinceEpoch(t / (HPTMODULUS / 1000)).toUTC();
+}
+
+
+void ArchiveIndex::update() {
+
+	SDPASSERT(Logger::instancePtr());
+
+	if ( __archive.isEmpty() ) return;
+
+	//! Run again once the current scan is done, files may have changed
+	if ( isUpdating() ) {
+		__pending = true;
+		return;
+	}
+
+	if ( !QDir(__archive).exists() ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "SDS archive " + __archive + " does not exist");
+		return;
+	}
+
+	Logger::instancePtr()->addMessage(Logger::INFO, __func__,
+	    "Updating index of SDS archive " + __archive);
+
+	__scanTime.start();
+	__scanGeneration = __generation;
+	__watcher->setFuture(QtConcurrent::run(scanArchive, __archive, __files));
+	emit updateStarted();
+}
+
+
+void ArchiveIndex::dispatchJobTerminated(DispatchJob* job) {
+
+	if ( !job || __archive.isEmpty() ) return;
+
+	if ( QDir(job->sdsDir()).canonicalPath() == QDir(__archive).canonicalPath() )
+	    update();
+}
+
+
+void ArchiveIndex::scanFinished() {
+
+	SDPASSERT(Logger::instancePtr());
+
+	//! Scan of a previous archive, run the one requested meanwhile for
+	//! the current archive
+	if ( __scanGeneration != __generation ) {
+		if ( __pending ) {
+			__pending = false;
+			update();
+		}
+		else
+			emit updated();
+		return;
+	}
+
+	const FileEntryList files = __watcher->result();
+
+	int changed = 0;
+	int errors = 0;
+	for (FileEntryList::const_iterator it = files.constBegin();
+	        it != files.constEnd(); ++it) {
+		FileEntryList::const_iterator prev = __files.constFind(it.key());
+		if ( prev == __files.constEnd() || prev->size != it->size
+		    || prev->modified != it->modified )
+		    ++changed;
+		if ( it->errors ) ++errors;
+	}
+
+	__files = files;
+	__lastUpdate = QDateTime::currentDateTime();
+	buildStreams();
+	save();
+
+	Logger::instancePtr()->addMessage(Logger::INFO, __func__,
+	    QString("Indexed %1 file(s) of SDS archive %2 in %3 ms: %4 read, %5 stream(s)")
+	        .arg(__files.size()).arg(__archive).arg(__scanTime.elapsed())
+	        .arg(changed).arg(__streams.size()));
+
+	if ( errors )
+	    Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+	        QString("%1 file(s) of SDS archive %2 could not be fully read")
+	            .arg(errors).arg(__archive));
+
+	emit updated();
+
+	if ( __pending ) {
+		__pending = false;
+		update();
+	}
+}
+
+
+bool ArchiveIndex::load() {
+
+	SDPASSERT(Logger::instancePtr());
+
+	QFile file(__indexFile);
+	if ( !file.exists() ) return false;
+
+	if ( !file.open(QIODevice::ReadOnly) ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Failed to open archive index " + __indexFile);
+		return false;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_4_6);
+
+	quint32 magic;
+	qint32 version;
+	in >> magic >> version;
+	if ( magic != IndexMagic || version != IndexVersion ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Ignoring archive index " + __indexFile + " of unknown format");
+		return false;
+	}
+
+	qint32 fileCount;
+	in >> __lastUpdate >> fileCount;
+	for (qint32 i = 0; i < fileCount && in.status() == QDataStream::Ok; ++i) {
+		QString path;
+		FileEntry entry;
+		qint32 streamCount;
+		in >> path >> entry.size >> entry.modified >> entry.records
+		    >> entry.errors >> streamCount;
+		for (qint32 j = 0; j < streamCount && in.status() == QDataStream::Ok; ++j) {
+			StreamEntry se;
+			qint32 spanCount;
+			in >> se.stream >> se.samplingRate >> spanCount;
+			se.spans.reserve(spanCount);
+			for (qint32 k = 0; k < spanCount && in.status() == QDataStream::Ok; ++k) {
+				Span span;
+				in >> span.start >> span.end;
+				se.spans << span;
+			}
+			entry.streams << se;
+		}
+		__files.insert(path, entry);
+	}
+
+	if ( in.status() != QDataStream::Ok ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Archive index " + __indexFile + " is truncated, it will be rebuilt");
+		__files.clear();
+		__lastUpdate = QDateTime();
+		return false;
+	}
+
+	Logger::instancePtr()->addMessage(Logger::INFO, __func__,
+	    QString("Loaded archive index %1 (%2 files)").arg(__indexFile).arg(__files.size()));
+
+	return true;
+}
+
+
+bool ArchiveIndex::save() {
+
+	SDPASSERT(Logger::instancePtr());
+
+	//! Write a new file and swap it in so that readers never see a partial
+	//! index
+	const QString tmpFile = __indexFile + ".tmp";
+	QFile file(tmpFile);
+	if ( !file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Failed to write archive index " + tmpFile);
+		return false;
+	}
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_4_6);
+	out << IndexMagic << IndexVersion << __lastUpdate << (qint32) __files.size();
+
+	for (FileEntryList::const_iterator it = __files.constBegin();
+	        it != __files.constEnd(); ++it) {
+		out << it.key() << it->size << it->modified << it->records << it->errors
+		    << (qint32) it->streams.size();
+		for (int j = 0; j < it->streams.size(); ++j) {
+			const StreamEntry& se = it->streams.at(j);
+			out << se.stream << se.samplingRate << (qint32) se.spans.size();
+			for (int k = 0; k < se.spans.size(); ++k)
+				out << se.spans.at(k).start << se.spans.at(k).end;
+		}
+	}
+	file.close();
+
+	QFile::remove(__indexFile);
+	if ( out.status() != QDataStream::Ok || !QFile::rename(tmpFile, __indexFile) ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Failed to write archive index " + __indexFile);
+		QFile::remove(tmpFile);
+		return false;
+	}
+
+	return true;
+}
+
+
+void ArchiveIndex::buildStreams() {
+
+	__streams.clear();
+	__maxFileSpan = 0;
+
+	for (FileEntryList::const_iterator it = __files.constBegin();
+	        it != __files.constEnd(); ++it) {
+		for (int i = 0; i < it->streams.size(); ++i) {
+			const StreamEntry& se = it->streams.at(i);
+			if ( se.spans.isEmpty() ) continue;
+			__streams[se.stream].insert(se.spans.first().start, it.key());
+			__maxFileSpan = qMax(__maxFileSpan, se.spans.last().end - se.spans.first().start);
+		}
+	}
+}
+
+
+} // namespace Qt4
+} // namespace SDP
@@ -0,0 +1,207 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_ARCHIVEINDEX_H__
+#define __SDP_QT4_DATAMODEL_ARCHIVEINDEX_H__
+
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QVector>
+#include <QDateTime>
+#include <QTime>
+#include <sdp/gui/datamodel/singleton.h>
+
+
+template<typename T> class QFutureWatcher;
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+class DispatchJob;
+
+/**
+ * @class ArchiveIndex
+ * @brief This class implements an inventory of the miniSEED files of a
+ *        SeisComP Data Structure archive. For every file of the archive, it
+ *        keeps the streams (NET.STA.LOC.CHA) found inside and the time spans
+ *        covered by their records, so that coverage and gaps of any set of
+ *        stations over a time window are answered without reading data.
+ * @info  The archive is scanned in a thread pool, only new files or files
+ *        whose size or modification time changed are read. Files which
+ *        only grew since the last scan (msrouter and msmod append records
+ *        to day files) are read from their previous size onward.
+ *        The index is stored in the archive directory as '.sdp.index'.
+ */
+class ArchiveIndex : public QObject, public Singleton<ArchiveIndex> {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		//! Time span in microseconds since epoch, end is exclusive
+		struct Span {
+				Span() :
+						start(0), end(0) {}
+				Span(const qint64& s, const qint64& e) :
+						start(s), end(e) {}
+				qint64 start;
+				qint64 end;
+		};
+		typedef QVector<Span> SpanList;
+
+		struct StreamEntry {
+				StreamEntry() :
+						samplingRate(.0) {}
+				//! Breaks between the spans of the stream
+				int gaps() const {
+					return spans.isEmpty() ? 0 : spans.size() - 1;
+				}
+				QString stream;
+				double samplingRate;
+				SpanList spans;
+		};
+		typedef QList<StreamEntry> StreamEntryList;
+
+		struct FileEntry {
+				FileEntry() :
+						size(0), modified(0), records(0), errors(0) {}
+				qint64 size;
+				qint64 modified;
+				qint64 records;
+				int errors;
+				StreamEntryList streams;
+		};
+		typedef QHash<QString, FileEntry> FileEntryList;
+
+		struct Coverage {
+				Coverage() :
+						covered(0), files(0) {}
+				double ratio(const QDateTime& start, const QDateTime& end) const;
+				QString stream;
+				qint64 covered;
+				int files;
+				SpanList spans;
+				SpanList gaps;
+		};
+		typedef QList<Coverage> CoverageList;
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit ArchiveIndex(QObject* = NULL);
+		~ArchiveIndex();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		bool setArchive(const QString&);
+		const QString& archive() const;
+		bool isUpdating() const;
+		int fileCount() const;
+		int streamCount() const;
+		QStringList streams() const;
+		const QDateTime& lastUpdate() const;
+
+		//! Returns the coverage of the streams of the stations ('NET.STA'
+		//! codes, all stations when empty) between start and end (UTC).
+		CoverageList coverage(const QStringList& stations,
+		                      const QDateTime& start,
+		                      const QDateTime& end) const;
+
+		//! Reads the record headers of any miniSEED files in the thread pool
+		//! and returns their streams sorted by code, the spans of a stream
+		//! split over several files being merged. Files which could not be
+		//! read to their end are appended to failed.
+		static StreamEntryList scanFiles(const QStringList& files,
+		                                 QStringList* failed = NULL);
+
+		static qint64 toTime(const QDateTime&);
+		static QDateTime fromTime(const qint64&);
+
+	public Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Public Qt interface
+		// ------------------------------------------------------------------
+		void update();
+		void dispatchJobTerminated(DispatchJob*);
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void scanFinished();
+
+	Q_SIGNALS:
+		// ------------------------------------------------------------------
+		//  Qt signals
+		// ------------------------------------------------------------------
+		void updateStarted();
+		void updated();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		bool load();
+		bool save();
+		void buildStreams();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		typedef QMultiMap<qint64, QString> FileTimeMap;
+
+		QFutureWatcher<FileEntryList>* __watcher;
+		QString __archive;
+		QString __indexFile;
+		QDateTime __lastUpdate;
+		QTime __scanTime;
+		FileEntryList __files;
+		//! Files of every stream by first sample time
+		QHash<QString, FileTimeMap> __streams;
+		//! Longest time span of a stream in a single file
+		qint64 __maxFileSpan;
+		bool __pending;
+		//! Incremented when the archive changes, a scan started for an
+		//! older generation is of a previous archive and its result ignored
+		quint32 __generation;
+		quint32 __scanGeneration;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
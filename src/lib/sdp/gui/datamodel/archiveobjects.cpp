@@ -26,10 +26,12 @@
 #include <sdp/gui/datamodel/logger.h>
 #include <sdp/gui/datamodel/macros.h>
 #include <sdp/gui/datamodel/parametermanager.h>
+#include <sdp/gui/datamodel/snapshots.h>
 #include <sdp/gui/datamodel/utils.h>
 #include <QDir>
-#include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
+#include <QSet>
 
 
 namespace SDP {
@@ -100,21 +102,30 @@ ArchivedOrigin::~ArchivedOrigin() {
 
 
 ArchivedOrigin* ArchivedOrigin::load(ArchivedRun* parent, const QString& path,
-                                     const QString& id) {
+                                     const QStringList& ids) {
 
 	SDPASSERT(ParameterManager::instancePtr());
+	SDPASSERT(Snapshots::instancePtr());
+
+	if ( ids.isEmpty() ) return NULL;
 
 	ParameterManager* pm = ParameterManager::instancePtr();
+	const QString& id = ids.first();
 
+	//! Locate snapshots drawn by the run or recorded to be drawn when first
+	//! viewed, there should be one by station for the origin we're creating.
+	//! Merged triggers contribute the stations the earliest one misses...
 	QStringList stations;
-	QDirIterator files(path, QDir::Files | QDir::NoSymLinks | QDir::NoDotAndDotDot);
-
-	//! Locate files with extension '.png', there should be one by station for
-	//! the origin we're creating...
-	while ( files.hasNext() ) {
-		files.next();
-		if ( files.fileName().contains(id) && files.fileName().contains(".png") )
-		    stations << files.fileName();
+	QSet<QString> streams;
+	for (int i = 0; i < ids.size(); ++i) {
+		const QStringList images = Snapshots::instancePtr()->files(path, ids.at(i));
+		for (int j = 0; j < images.size(); ++j) {
+			const QString name = QFileInfo(images.at(j)).fileName();
+			const QString stream = name.mid(ids.at(i).size());
+			if ( streams.contains(stream) ) continue;
+			streams.insert(stream);
+			stations << name;
+		}
 	}
 
 	if ( stations.isEmpty() ) return NULL;
@@ -200,17 +211,7 @@ ArchivedRun* ArchivedRun::loadRun(const Job* job) {
 		return NULL;
 	}
 
-	QStringList triggers;
-	QFile inputFile(trigFile);
-	if ( inputFile.open(QIODevice::ReadOnly) ) {
-		QTextStream in(&inputFile);
-		while ( !in.atEnd() ) {
-			QString line = in.readLine();
-			if ( !triggers.contains(line) )
-			    triggers << line;
-		}
-	}
-	inputFile.close();
+	const QStringList triggers = Utils::getFileContentList(trigFile);
 
 	if ( triggers.isEmpty() ) {
 		log->addMessage(Logger::DEBUG, __func__, "Path: " + job->runDir() + " is empty.", false);
@@ -226,7 +227,7 @@ ArchivedRun* ArchivedRun::loadRun(const Job* job) {
 	QString script;
 	QFile inputScript(sfile);
 	if ( inputScript.open(QIODevice::ReadOnly) ) {
-		QTextStream in(&inputFile);
+		QTextStream in(&inputScript);
 		while ( !in.atEnd() )
 			script.append(in.readLine());
 	}
@@ -237,10 +238,12 @@ ArchivedRun* ArchivedRun::loadRun(const Job* job) {
 	run->__tw.end = QDateTime::fromString(l.at(2), "yyyyMMddHHmmss");
 	run->__script = script;
 
-	//! Read various origins times and associated stations
-	for (QStringList::const_iterator it = triggers.constBegin();
-	        it != triggers.constEnd(); ++it) {
-		ArchivedOrigin* o = ArchivedOrigin::load(run, job->runDir(), (*it));
+	//! Read various origins times and associated stations, triggers reported
+	//! more than once by overlapping windows are merged as the run panel does
+	const QList<QStringList> clusters = Utils::clusterTriggerTimes(triggers,
+	    pm->parameter("TRIGGER_MERGE_TOLERANCE").toDouble());
+	for (int i = 0; i < clusters.size(); ++i) {
+		ArchivedOrigin* o = ArchivedOrigin::load(run, job->runDir(), clusters.at(i));
 		run->appendOrigin(o);
 	}
 
@@ -110,7 +110,7 @@ class ArchivedOrigin {
 		// ------------------------------------------------------------------
 		//  Public interface
 		// ------------------------------------------------------------------
-		static ArchivedOrigin* load(ArchivedRun*, const QString&, const QString&);
+		static ArchivedOrigin* load(ArchivedRun*, const QString&, const QStringList&);
 
 		ArchivedRun* run();
 		const QDateTime& time() const;
@@ -0,0 +1,313 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/commitpipeline.h>
+#include <sdp/gui/datamodel/logger.h>
+#include <sdp/gui/datamodel/macros.h>
+#include <sdp/gui/datamodel/parametermanager.h>
+#include <sdp/gui/datamodel/trigger.h>
+#include <sdp/gui/datamodel/utils.h>
+#include <QFile>
+#include <QStringList>
+#include <QTimerEvent>
+
+
+namespace {
+
+//! Delay in seconds before the first retry of a dispatcher, doubled by retry
+static int const RetryDelay = 2;
+
+//! Time in seconds after which a dispatcher is killed and retried
+static int const DispatchTimeout = 120;
+
+//! Exit code of a command whose failure is temporary (EX_TEMPFAIL)
+static int const TempFailCode = 75;
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+CommitPipeline::CommitPipeline(QObject* parent) :
+		QObject(parent), __counts(cpSTATUSCOUNT, 0), __connections(1),
+		__retries(0), __mergeRetries(false), __started(false), __finished(false) {
+
+	SDPASSERT(ParameterManager::instancePtr());
+	ParameterManager* pm = ParameterManager::instancePtr();
+
+	__shell = pm->parameter("BASH_BIN").toString();
+
+	__command = pm->parameter("COMMIT_COMMAND").toString().trimmed();
+	if ( __command.isEmpty() )
+		__command = pm->parameter("SEISCOMP_BIN").toString()
+		    + " exec scdispatch -O @OPERATION@ -i @FILE@ "
+		    + pm->parameter("SC_DISPATCH_EXTRA_ARG").toString();
+
+	//! A dispatcher that failed or was killed may have sent the trigger,
+	//! only commands told to merge on retries can be retried on any failure
+	__mergeRetries = __command.contains("@OPERATION@");
+
+	__connections = qMax(1, pm->parameter("COMMIT_CONNECTIONS").toInt());
+	__retries = qMax(0, pm->parameter("COMMIT_RETRIES").toInt());
+}
+
+
+CommitPipeline::~CommitPipeline() {
+
+	//! Dispatchers are killed by their destructor, make sure they don't call
+	//! us back while we're gone
+	for (QHash<QProcess*, int>::const_iterator it = __running.constBegin();
+	        it != __running.constEnd(); ++it)
+		it.key()->disconnect(this);
+}
+
+
+void CommitPipeline::append(Trigger* trigger, const QString& file) {
+
+	if ( !trigger || __started ) return;
+
+	Item item;
+	item.trigger = trigger;
+	item.file = file;
+	item.status = cpPENDING;
+	item.attempts = 0;
+	__items << item;
+	++__counts[cpPENDING];
+}
+
+
+void CommitPipeline::start() {
+
+	if ( __started ) return;
+	__started = true;
+
+	for (int i = 0; i < __items.size(); ++i)
+		__queue.enqueue(i);
+
+	__timer.start(1000, this);
+	dispatch();
+}
+
+
+void CommitPipeline::abort() {
+
+	if ( !__started || __finished ) return;
+
+	for (QHash<QProcess*, int>::const_iterator it = __running.constBegin();
+	        it != __running.constEnd(); ++it) {
+		it.key()->disconnect(this);
+		it.key()->kill();
+		it.key()->deleteLater();
+		setStatus(it.value(), cpFAILED, "Cancelled");
+	}
+	__running.clear();
+
+	while ( !__queue.isEmpty() )
+		setStatus(__queue.dequeue(), cpFAILED, "Cancelled");
+
+	for (QMultiMap<QDateTime, int>::const_iterator it = __delayed.constBegin();
+	        it != __delayed.constEnd(); ++it)
+		setStatus(it.value(), cpFAILED, "Cancelled");
+	__delayed.clear();
+
+	checkFinished();
+}
+
+
+bool CommitPipeline::isFinished() const {
+	return __finished;
+}
+
+
+int CommitPipeline::count() const {
+	return __items.size();
+}
+
+
+int CommitPipeline::count(const Status& status) const {
+	return __counts.value(status);
+}
+
+
+QList<Trigger*> CommitPipeline::triggers(const Status& status) const {
+
+	QList<Trigger*> list;
+	for (int i = 0; i < __items.size(); ++i)
+		if ( __items.at(i).status == status )
+		    list << __items.at(i).trigger;
+
+	return list;
+}
+
+
+void CommitPipeline::timerEvent(QTimerEvent* event) {
+
+	if ( event->timerId() != __timer.timerId() ) {
+		QObject::timerEvent(event);
+		return;
+	}
+
+	const QDateTime now = QDateTime::currentDateTime();
+
+	//! Hung dispatchers are killed, they're handled as crashed ones
+	for (QHash<QProcess*, int>::const_iterator it = __running.constBegin();
+	        it != __running.constEnd(); ++it)
+		if ( __items.at(it.value()).started.secsTo(now) > DispatchTimeout )
+		    it.key()->kill();
+
+	//! Queue the retries whose delay has expired
+	while ( !__delayed.isEmpty() && __delayed.begin().key() <= now ) {
+		QMultiMap<QDateTime, int>::iterator it = __delayed.begin();
+		__queue.enqueue(it.value());
+		__delayed.erase(it);
+	}
+
+	dispatch();
+}
+
+
+void CommitPipeline::processFinished(int code, QProcess::ExitStatus status) {
+
+	QProcess* proc = qobject_cast<QProcess*>(sender());
+	if ( !proc || !__running.contains(proc) ) return;
+
+	const int item = __running.take(proc);
+	const QString output = QString::fromLocal8Bit(proc->readAll()).trimmed();
+	proc->deleteLater();
+
+	if ( status == QProcess::NormalExit && code == 0 )
+		setStatus(item, cpCOMMITTED, output.isEmpty() ? "Committed" : "Committed: " + output);
+	else {
+		QString reason = (status == QProcess::NormalExit) ?
+		    QString("Dispatcher exited with code %1").arg(code) :
+		    QString("Dispatcher crashed or timed out");
+		if ( !output.isEmpty() ) reason += ": " + output;
+		if ( __mergeRetries || (status == QProcess::NormalExit && code == TempFailCode) )
+			retry(item, reason);
+		else
+			setStatus(item, cpFAILED, reason);
+	}
+
+	dispatch();
+}
+
+
+void CommitPipeline::processError(QProcess::ProcessError error) {
+
+	//! Other errors are followed by finished()
+	if ( error != QProcess::FailedToStart ) return;
+
+	QProcess* proc = qobject_cast<QProcess*>(sender());
+	if ( !proc || !__running.contains(proc) ) return;
+
+	const int item = __running.take(proc);
+	proc->deleteLater();
+
+	setStatus(item, cpFAILED, "Failed to start " + __shell);
+
+	dispatch();
+}
+
+
+void CommitPipeline::dispatch() {
+
+	while ( !__queue.isEmpty() && __running.size() < __connections ) {
+
+		const int item = __queue.dequeue();
+		Item& it = __items[item];
+
+		if ( !QFile::exists(it.file) ) {
+			setStatus(item, cpFAILED, "SC3ML file " + it.file + " not found");
+			continue;
+		}
+
+		QProcess* proc = new QProcess(this);
+		proc->setProcessChannelMode(QProcess::MergedChannels);
+		connect(proc, SIGNAL(finished(int, QProcess::ExitStatus)),
+		    this, SLOT(processFinished(int, QProcess::ExitStatus)));
+		connect(proc, SIGNAL(error(QProcess::ProcessError)),
+		    this, SLOT(processError(QProcess::ProcessError)));
+
+		++it.attempts;
+		it.started = QDateTime::currentDateTime();
+		__running.insert(proc, item);
+		setStatus(item, cpRUNNING, QString("Dispatching %1 (attempt %2)").arg(it.file).arg(it.attempts));
+
+		//! Retries merge the trigger in case a previous attempt added it
+		QString command = __command;
+		command.replace("@OPERATION@", (it.attempts > 1) ? "merge" : "add");
+		command.replace("@FILE@", Utils::shellQuote(it.file));
+		proc->start(__shell, QStringList() << "-c" << command);
+	}
+
+	checkFinished();
+}
+
+
+void CommitPipeline::setStatus(const int& item, const Status& status,
+                               const QString& message) {
+
+	Item& it = __items[item];
+	--__counts[it.status];
+	++__counts[status];
+	it.status = status;
+
+	if ( status == cpFAILED && Logger::instancePtr() )
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Failed to commit trigger " + it.trigger->id() + ": " + message);
+
+	emit statusChanged(it.trigger, static_cast<int>(status), message);
+}
+
+
+void CommitPipeline::retry(const int& item, const QString& reason) {
+
+	const Item& it = __items.at(item);
+	if ( it.attempts > __retries ) {
+		setStatus(item, cpFAILED, reason);
+		return;
+	}
+
+	const int delay = RetryDelay << (it.attempts - 1);
+	__delayed.insert(QDateTime::currentDateTime().addSecs(delay), item);
+	setStatus(item, cpRETRYING, reason + QString(", retrying in %1 s").arg(delay));
+}
+
+
+void CommitPipeline::checkFinished() {
+
+	if ( !__started || __finished ) return;
+	if ( !__queue.isEmpty() || !__delayed.isEmpty() || !__running.isEmpty() )
+	    return;
+
+	__finished = true;
+	__timer.stop();
+
+	emit finished();
+}
+
+
+} // namespace Qt4
+} // namespace SDP
@@ -0,0 +1,154 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_COMMITPIPELINE_H__
+#define __SDP_QT4_DATAMODEL_COMMITPIPELINE_H__
+
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QQueue>
+#include <QMultiMap>
+#include <QDateTime>
+#include <QBasicTimer>
+#include <QProcess>
+
+
+namespace SDP {
+namespace Qt4 {
+
+class Trigger;
+
+
+/**
+ * @class CommitPipeline
+ * @brief This class commits the SC3ML files of accepted triggers into
+ *        SeisComP with a bounded number of dispatchers running at once
+ *        (COMMIT_CONNECTIONS), each trigger being dispatched and tracked on
+ *        its own so that one failure doesn't fail the others.
+ * @info  Triggers are dispatched by scdispatch unless a stand-in command is
+ *        set (COMMIT_COMMAND, @FILE@ being replaced with the SC3ML file),
+ *        commands are run by the shell (BASH_BIN). Dispatchers that fail or
+ *        don't end in time are retried with an increasing delay, up to
+ *        COMMIT_RETRIES times, those that can't be started fail right away.
+ *        @OPERATION@ is replaced with 'add' on the first attempt and with
+ *        'merge' on retries so a trigger sent by a failed attempt is not
+ *        duplicated; commands without it are only retried when they exit
+ *        with code 75 (EX_TEMPFAIL).
+ */
+class CommitPipeline : public QObject {
+
+	Q_OBJECT
+
+	public:
+		enum Status {
+			cpPENDING, cpRUNNING, cpRETRYING, cpCOMMITTED, cpFAILED, cpSTATUSCOUNT
+		};
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit CommitPipeline(QObject* = NULL);
+		~CommitPipeline();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		void append(Trigger*, const QString& file);
+		void start();
+
+		//! Kills running dispatchers, the triggers not committed yet fail
+		void abort();
+
+		bool isFinished() const;
+		int count() const;
+		int count(const Status&) const;
+		QList<Trigger*> triggers(const Status&) const;
+
+	Q_SIGNALS:
+		// ------------------------------------------------------------------
+		//  Qt signals
+		// ------------------------------------------------------------------
+		void statusChanged(Trigger*, int status, const QString& message);
+		void finished();
+
+	protected:
+		// ------------------------------------------------------------------
+		//  Protected interface
+		// ------------------------------------------------------------------
+		void timerEvent(QTimerEvent*);
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void processFinished(int, QProcess::ExitStatus);
+		void processError(QProcess::ProcessError);
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		void dispatch();
+		void setStatus(const int& item, const Status&, const QString& message);
+		void retry(const int& item, const QString& reason);
+		void checkFinished();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		struct Item {
+				Trigger* trigger;
+				QString file;
+				Status status;
+				int attempts;
+				QDateTime started;
+		};
+
+		QList<Item> __items;
+		QQueue<int> __queue;
+		QMultiMap<QDateTime, int> __delayed;
+		QHash<QProcess*, int> __running;
+		QVector<int> __counts;
+		QBasicTimer __timer;
+		QString __shell;
+		QString __command;
+		int __connections;
+		int __retries;
+		bool __mergeRetries;
+		bool __started;
+		bool __finished;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
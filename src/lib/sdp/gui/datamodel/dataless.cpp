@@ -0,0 +1,453 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/dataless.h>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+#include <QtConcurrentMap>
+
+
+namespace {
+
+using namespace SDP::Qt4;
+
+typedef Dataless::Channel Channel;
+typedef Dataless::Result Result;
+
+//! Logical record length of SEED volumes without a volume identifier
+static int const DefaultRecordLength = 4096;
+
+struct ReadTask {
+		QString file;
+		Dataless::Format format;
+};
+
+
+/**
+ * @brief Returns the variable length field starting at pos, terminated by
+ *        a tilde, and moves pos past it.
+ */
+QByteArray variableField(const QByteArray& b, int& pos) {
+
+	const int end = b.indexOf('~', pos);
+	if ( end < 0 ) {
+		const QByteArray field = b.mid(pos);
+		pos = b.size();
+		return field;
+	}
+
+	const QByteArray field = b.mid(pos, end - pos);
+	pos = end + 1;
+
+	return field;
+}
+
+
+double decimalField(const QByteArray& b, const int& pos, const int& size,
+                    bool* ok = NULL) {
+	return b.mid(pos, size).trimmed().toDouble(ok);
+}
+
+
+//! Blank or out of range coordinates are unknown, not 0,0
+bool validLocation(const bool& latOk, const double& lat, const bool& lonOk,
+                   const double& lon) {
+	return latOk && lonOk && lat >= -90. && lat <= 90. && lon >= -180. && lon <= 180.;
+}
+
+
+/**
+ * @brief Reads the blockettes of the control headers of a station, the
+ *        blockette 50 giving the station and each blockette 52 one of its
+ *        channels.
+ */
+void readStation(const QByteArray& headers, Result& result) {
+
+	Channel station;
+	bool hasStation = false;
+	bool hasChannels = false;
+
+	int pos = 0;
+	while ( pos + 7 <= headers.size() ) {
+
+		bool ok;
+		const int type = headers.mid(pos, 3).trimmed().toInt(&ok);
+		//! Padding of the last record
+		if ( !ok ) break;
+
+		const int length = headers.mid(pos + 3, 4).trimmed().toInt(&ok);
+		if ( !ok || length < 7 || pos + length > headers.size() ) {
+			++result.errors;
+			break;
+		}
+
+		const QByteArray b = headers.mid(pos, length);
+		pos += length;
+
+		if ( type == 50 ) {
+
+			if ( hasStation && !hasChannels )
+			    result.channels << station;
+
+			station = Channel();
+			station.station = b.mid(7, 5).trimmed();
+			bool lat, lon;
+			station.latitude = decimalField(b, 12, 10, &lat);
+			station.longitude = decimalField(b, 22, 11, &lon);
+			station.elevation = decimalField(b, 33, 7);
+			station.located = validLocation(lat, station.latitude, lon, station.longitude);
+			if ( !station.located )
+			    station.latitude = station.longitude = .0;
+
+			//! Site name, then network identifier and word orders
+			int p = 47;
+			variableField(b, p);
+			p += 9;
+			station.start = Dataless::seedTime(variableField(b, p));
+			station.end = Dataless::seedTime(variableField(b, p));
+			//! Update flag
+			p += 1;
+			station.network = b.mid(p, 2).trimmed();
+
+			hasStation = true;
+			hasChannels = false;
+		}
+		else if ( type == 52 ) {
+
+			if ( !hasStation ) {
+				++result.errors;
+				continue;
+			}
+
+			Channel c = station;
+			c.location = b.mid(7, 2).trimmed();
+			c.channel = b.mid(9, 3).trimmed();
+
+			//! Optional comment, then signal and calibration units
+			int p = 19;
+			variableField(b, p);
+			p += 6;
+
+			//! Channels without coordinates keep the ones of the station
+			bool lat, lon, elev;
+			const double latitude = decimalField(b, p, 10, &lat);
+			const double longitude = decimalField(b, p + 10, 11, &lon);
+			const double elevation = decimalField(b, p + 21, 7, &elev);
+			if ( validLocation(lat, latitude, lon, longitude) ) {
+				c.latitude = latitude;
+				c.longitude = longitude;
+				c.located = true;
+				if ( elev ) c.elevation = elevation;
+			}
+
+			//! Depth, azimuth, dip, data format, record length, sample rate,
+			//! clock drift and number of comments, then channel flags
+			p += 73;
+			variableField(b, p);
+			c.start = Dataless::seedTime(variableField(b, p));
+			c.end = Dataless::seedTime(variableField(b, p));
+
+			result.channels << c;
+			hasChannels = true;
+		}
+	}
+
+	if ( hasStation && !hasChannels )
+	    result.channels << station;
+}
+
+
+bool readSEED(const QString& file, Result& result) {
+
+	QFile f(file);
+	if ( !f.open(QIODevice::ReadOnly) ) return false;
+
+	const QByteArray data = f.readAll();
+	f.close();
+
+	if ( data.size() < 8 ) return false;
+
+	//! The record length is given by the volume identifier (blockette 10)
+	int reclen = DefaultRecordLength;
+	if ( data.at(6) == 'V' && data.mid(8, 3) == "010" ) {
+		bool ok;
+		const int exponent = data.mid(19, 2).trimmed().toInt(&ok);
+		if ( ok && exponent >= 8 && exponent <= 16 )
+		    reclen = 1 << exponent;
+	}
+	else if ( data.at(6) != 'A' && data.at(6) != 'S' )
+	    return false;
+
+	//! Control headers of a station start a new record, blockettes go on in
+	//! the following records flagged as continuations
+	QByteArray headers;
+	for (int pos = 0; pos + 8 <= data.size(); pos += reclen) {
+
+		const char type = data.at(pos + 6);
+		if ( type == 'S' && data.at(pos + 7) == '*' && !headers.isEmpty() ) {
+			headers.append(data.mid(pos + 8, reclen - 8));
+			continue;
+		}
+
+		if ( !headers.isEmpty() ) {
+			readStation(headers, result);
+			headers.clear();
+		}
+
+		if ( type == 'S' )
+			headers = data.mid(pos + 8, reclen - 8);
+		else if ( type != 'V' && type != 'A' )
+		    break;
+	}
+
+	if ( !headers.isEmpty() )
+	    readStation(headers, result);
+
+	return true;
+}
+
+
+/**
+ * @brief Splits a line on blanks, quoted text being a single field.
+ */
+QStringList summaryFields(const QString& line) {
+
+	QStringList fields;
+	QString field;
+	bool quoted = false;
+	bool pending = false;
+
+	for (int i = 0; i < line.size(); ++i) {
+		const QChar c = line.at(i);
+		if ( c == '"' ) {
+			quoted = !quoted;
+			pending = true;
+		}
+		else if ( c.isSpace() && !quoted ) {
+			if ( pending ) fields << field;
+			field.clear();
+			pending = false;
+		}
+		else {
+			field += c;
+			pending = true;
+		}
+	}
+	if ( pending ) fields << field;
+
+	return fields;
+}
+
+
+//! Custom lines, 14 fields delimited by comma, three channels with their
+//! location code:
+//! ZU,CAPH,19.7355,-72.1883,17.0,2013-08-2T00:00:00,2013-10-10T23:59:00,HHZ, ,HHN, ,HHE, ,
+bool readCustomLine(const QString& line, Result& result) {
+
+	const QStringList fields = line.split(',');
+	if ( fields.size() != 14 ) return false;
+
+	Channel s;
+	s.network = fields.at(0).trimmed();
+	s.station = fields.at(1).trimmed();
+	bool lat, lon;
+	s.latitude = fields.at(2).toDouble(&lat);
+	s.longitude = fields.at(3).toDouble(&lon);
+	s.elevation = fields.at(4).toDouble();
+	s.located = validLocation(lat, s.latitude, lon, s.longitude);
+	if ( !s.located )
+	    s.latitude = s.longitude = .0;
+	s.start = QDateTime::fromString(fields.at(5).trimmed(), Qt::ISODate);
+	s.end = QDateTime::fromString(fields.at(6).trimmed(), Qt::ISODate);
+
+	for (int i = 7; i < 13; i += 2) {
+		Channel c = s;
+		c.channel = fields.at(i).trimmed();
+		c.location = fields.at(i + 1).trimmed();
+		result.channels << c;
+	}
+
+	return true;
+}
+
+
+//! rdseed station summary lines (rdseed -S):
+//! STA NET LAT LON ELEV "CHANNELS" "SITE" START END
+bool readRdseedLine(const QString& line, Result& result) {
+
+	const QStringList fields = summaryFields(line);
+	if ( fields.size() < 5 ) return false;
+
+	Channel s;
+	s.station = fields.at(0);
+	s.network = fields.at(1);
+
+	bool lat, lon, elev;
+	s.latitude = fields.at(2).toDouble(&lat);
+	s.longitude = fields.at(3).toDouble(&lon);
+	s.elevation = fields.at(4).toDouble(&elev);
+	if ( !lat || !lon || !elev ) return false;
+	s.located = validLocation(lat, s.latitude, lon, s.longitude);
+
+	if ( fields.size() >= 9 ) {
+		s.start = Dataless::seedTime(fields.at(7).toLatin1());
+		s.end = Dataless::seedTime(fields.at(8).toLatin1());
+	}
+
+	const QStringList channels = (fields.size() >= 6) ?
+	    fields.at(5).split(' ', QString::SkipEmptyParts) : QStringList();
+	if ( channels.isEmpty() )
+	    result.channels << s;
+	for (int i = 0; i < channels.size(); ++i) {
+		Channel c = s;
+		c.channel = channels.at(i);
+		result.channels << c;
+	}
+
+	return true;
+}
+
+
+bool readSummary(const QString& file, Result& result) {
+
+	QFile f(file);
+	if ( !f.open(QIODevice::ReadOnly | QIODevice::Text) ) return false;
+
+	QTextStream in(&f);
+	while ( !in.atEnd() ) {
+
+		const QString line = in.readLine();
+		if ( line.trimmed().isEmpty() ) continue;
+
+		const bool ok = ( line.count(',') == 13 ) ?
+		    readCustomLine(line, result) : readRdseedLine(line, result);
+		if ( !ok ) ++result.errors;
+	}
+
+	return true;
+}
+
+
+/**
+ * @brief Reads the channels of a file. This function runs in the thread pool.
+ */
+Result readFile(const ReadTask& task) {
+
+	Result result;
+	bool ok = false;
+
+	switch ( task.format ) {
+		case Dataless::SEED:
+			ok = readSEED(task.file, result);
+			break;
+		case Dataless::StationSummary:
+			ok = readSummary(task.file, result);
+			break;
+	}
+
+	if ( !ok ) result.failed << task.file;
+
+	return result;
+}
+
+
+QString channelKey(const Channel& c) {
+	return c.network + "." + c.station + "." + c.location + "." + c.channel
+	    + "|" + QString::number(c.start.isValid() ? c.start.toMSecsSinceEpoch() : -1)
+	    + "|" + QString::number(c.end.isValid() ? c.end.toMSecsSinceEpoch() : -1);
+}
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+Dataless::Result Dataless::read(const QStringList& files, const Format& format) {
+
+	QList<ReadTask> tasks;
+	for (int i = 0; i < files.size(); ++i) {
+		ReadTask task;
+		task.file = files.at(i);
+		task.format = format;
+		tasks << task;
+	}
+
+	const QList<Result> results = QtConcurrent::blockingMapped<QList<Result> >(tasks, readFile);
+
+	//! Channel epochs read more than once, within a file or across files
+	//! (a station in several volumes), are dropped
+	Result total;
+	QSet<QString> keys;
+	for (int i = 0; i < results.size(); ++i) {
+
+		const Result& r = results.at(i);
+		total.errors += r.errors;
+		total.failed << r.failed;
+
+		for (int j = 0; j < r.channels.size(); ++j) {
+			const QString key = channelKey(r.channels.at(j));
+			if ( keys.contains(key) ) {
+				++total.duplicates;
+				continue;
+			}
+			keys.insert(key);
+			total.channels << r.channels.at(j);
+		}
+	}
+
+	return total;
+}
+
+
+QDateTime Dataless::seedTime(const QByteArray& str) {
+
+	const QList<QByteArray> date = str.trimmed().split(',');
+	if ( date.size() < 2 || date.at(0).isEmpty() ) return QDateTime();
+
+	bool ok;
+	const int year = date.at(0).toInt(&ok);
+	if ( !ok ) return QDateTime();
+	const int day = date.at(1).toInt(&ok);
+	if ( !ok ) return QDateTime();
+
+	QTime time(0, 0);
+	if ( date.size() > 2 ) {
+		const QList<QByteArray> hms = date.at(2).split(':');
+		const int hours = hms.at(0).toInt();
+		const int minutes = (hms.size() > 1) ? hms.at(1).toInt() : 0;
+		const double seconds = (hms.size() > 2) ? hms.at(2).toDouble() : .0;
+		time = QTime(hours, minutes).addMSecs(qRound(seconds * 1000.));
+	}
+
+	const QDate d = QDate(year, 1, 1).addDays(day - 1);
+	if ( !d.isValid() || !time.isValid() ) return QDateTime();
+
+	return QDateTime(d, time, Qt::UTC);
+}
+
+
+} // namespace Qt4
+} // namespace SDP
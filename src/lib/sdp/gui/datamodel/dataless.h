@@ -0,0 +1,111 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_DATALESS_H__
+#define __SDP_QT4_DATAMODEL_DATALESS_H__
+
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QDateTime>
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+/**
+ * @class Dataless
+ * @brief This class reads the channels of station inventories from binary
+ *        dataless SEED volumes (station and channel identifier blockettes 50
+ *        and 52) and from station summaries, whose lines are either rdseed
+ *        station summary lines or the comma separated format of the
+ *        inventory panel.
+ * @info  Files are read in a thread pool, a channel epoch found more than
+ *        once (same NET.STA.LOC.CHA, start and end) is kept once. Only the
+ *        station control headers of SEED volumes are read, the reading stops
+ *        at the first data record.
+ */
+class Dataless {
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		enum Format {
+			SEED, StationSummary
+		};
+
+		//! A channel epoch, formats without channels give one by station
+		//! with empty location and channel codes
+		struct Channel {
+				Channel() :
+						latitude(.0), longitude(.0), elevation(.0), located(false) {}
+				QString network;
+				QString station;
+				QString location;
+				QString channel;
+				double latitude;
+				double longitude;
+				double elevation;
+				//! Whether latitude and longitude were read, they are zero
+				//! otherwise
+				bool located;
+				QDateTime start;
+				QDateTime end;
+		};
+		typedef QList<Channel> ChannelList;
+
+		struct Result {
+				Result() :
+						duplicates(0), errors(0) {}
+				ChannelList channels;
+				//! Channel epochs dropped as already read
+				int duplicates;
+				//! Malformed lines or blockettes skipped
+				int errors;
+				//! Files which could not be read
+				QStringList failed;
+		};
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		//! Reads files, blocking until they're all read. Channels are given
+		//! in the order of the files.
+		static Result read(const QStringList& files, const Format&);
+
+		//! Parses a SEED time (YYYY,DDD,HH:MM:SS.FFFF, trailing parts are
+		//! optional), returns an invalid time when empty
+		static QDateTime seedTime(const QByteArray&);
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
@@ -33,6 +33,7 @@
 
 #include <QProcess>
 #include <QDir>
+#include <cstdio>
 
 
 namespace SDP {
@@ -53,13 +54,13 @@ const JobStatusValue& operator*(JobStatus js) {
 
 
 Job::Job(QObject* parent) :
-		QObject(parent), __process(NULL), __tableWidget(NULL), __type(Unknown),
+		QObject(parent), __process(NULL), __type(Unknown),
 		__status(Pending), __creationTime(QDateTime::currentDateTime()),
 		__retCode(-2) {}
 
 
 Job::Job(const JobType& t, QObject* parent) :
-		QObject(parent), __process(NULL), __tableWidget(NULL), __type(t),
+		QObject(parent), __process(NULL), __type(t),
 		__status(Pending), __creationTime(QDateTime::currentDateTime()),
 		__retCode(-2) {}
 
@@ -250,13 +251,8 @@ const int& Job::runExitCode() const {
 }
 
 
-void Job::setTableWidget(void* tw) {
-	__tableWidget = tw;
-}
-
-
-void* Job::tableWidget() {
-	return __tableWidget;
+const Job::Progress& Job::progress() const {
+	return __progress;
 }
 
 
@@ -364,6 +360,8 @@ void Job::stop() {
 
 void Job::starting() {
 	__stdOutput.clear();
+	__stdOutRemainder.clear();
+	__progress = Progress();
 	__status = Running;
 	emit started();
 }
@@ -371,15 +369,49 @@ void Job::starting() {
 
 void Job::readProcStdOut() {
 
-	QByteArray stdout = __process->readAllStandardOutput();
-	QList<QByteArray> output = stdout.split('\n');
-	for (QList<QByteArray>::iterator it = output.begin();
-	        it != output.end(); ++it) {
+	//! Output may be read in the middle of a line, only complete lines
+	//! are handled and the rest is kept until the next read
+	__stdOutRemainder.append(__process->readAllStandardOutput());
+	const int end = __stdOutRemainder.lastIndexOf('\n');
+	if ( end < 0 ) return;
+
+	const QList<QByteArray> output = __stdOutRemainder.left(end).split('\n');
+	__stdOutRemainder.remove(0, end + 1);
+	addStdOutLines(output);
+}
+
+
+void Job::addStdOutLines(const QList<QByteArray>& output) {
+
+	bool hasMessages = false;
+	bool hasProgress = false;
+	for (QList<QByteArray>::const_iterator it = output.constBegin();
+	        it != output.constEnd(); ++it) {
 		if ( it->isEmpty() ) continue;
+
+		//! Progress lines are kept as counts, not as output:
+		//! PROGRESS files=<read>/<total> records=<read>
+		if ( it->startsWith("PROGRESS ") ) {
+			int done = 0, total = 0;
+			long long records = 0;
+			if ( sscanf(it->constData(), "PROGRESS files=%d/%d records=%lld",
+			    &done, &total, &records) == 3 ) {
+				__progress.filesDone = done;
+				__progress.filesTotal = total;
+				__progress.records = records;
+				hasProgress = true;
+				continue;
+			}
+		}
+
 		__stdOutput << OutputEntry(Info, (*it).constData());
+		hasMessages = true;
 	}
 
-	emit newStdMsg();
+	if ( hasProgress )
+	    emit progressChanged();
+	if ( hasMessages )
+	    emit newStdMsg();
 }
 
 
@@ -402,6 +434,14 @@ void Job::procTerminated(int retCode) {
 	//! @info Deleting the process here will result in segmentation fault...
 
 	__retCode = retCode;
+
+	//! The last line of the output may not end with a newline
+	readProcStdOut();
+	if ( !__stdOutRemainder.isEmpty() ) {
+		addStdOutLines(QList<QByteArray>() << __stdOutRemainder);
+		__stdOutRemainder.clear();
+	}
+
 	disconnect(__process);
 
 	if ( __status != Stopped )
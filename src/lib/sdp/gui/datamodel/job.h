@@ -29,6 +29,7 @@
 #include <QPair>
 #include <QList>
 #include <QString>
+#include <QByteArray>
 #include <QHash>
 #include <QVariant>
 #include <QDateTime>
@@ -96,6 +97,18 @@ class Job : public QObject {
 		typedef QList<OutputEntry> StandardOutput;
 		typedef QHash<QString, QVariant> Profile;
 
+		/**
+		 * @brief Counts reported by dispatch tools with 'PROGRESS' lines
+		 *        on their standard output (see msrouter -P).
+		 */
+		struct Progress {
+				Progress() :
+						filesDone(0), filesTotal(0), records(0) {}
+				int filesDone;
+				int filesTotal;
+				qint64 records;
+		};
+
 	public:
 		// ------------------------------------------------------------------
 		//  Instruction
@@ -139,9 +152,7 @@ class Job : public QObject {
 		void setScriptData(const QVariant& d);
 		const QVariant& scriptData() const;
 		const int& runExitCode() const;
-		void setTableWidget(void* tw);
-
-		void* tableWidget();
+		const Progress& progress() const;
 
 	public Q_SLOTS:
 		// ------------------------------------------------------------------
@@ -168,14 +179,20 @@ class Job : public QObject {
 		void stopped();
 		void terminated();
 		void newStdMsg();
+		void progressChanged();
 		void errorMessage(QString);
 
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		void addStdOutLines(const QList<QByteArray>&);
+
 	private:
 		// ------------------------------------------------------------------
 		//  Members
 		// ------------------------------------------------------------------
 		QProcess* __process;
-		void* __tableWidget;
 		JobType __type;
 		JobStatus __status;
 		QDateTime __creationTime;
@@ -188,7 +205,10 @@ class Job : public QObject {
 		QString __runDir;
 		QString __customRunDir;
 		StandardOutput __stdOutput;
+		//! Standard output received after the last complete line
+		QByteArray __stdOutRemainder;
 		Profile __profile;
+		Progress __progress;
 		int __retCode;
 };
 
@@ -25,6 +25,9 @@
 
 #include <sdp/gui/datamodel/mainframe.h>
 #include <sdp/gui/datamodel/cache.h>
+#include <sdp/gui/datamodel/archiveindex.h>
+#include <sdp/gui/datamodel/snapshots.h>
+#include <sdp/gui/datamodel/thumbnails.h>
 #include <sdp/gui/datamodel/progress.h>
 #include <sdp/gui/datamodel/config.h>
 #include <sdp/gui/datamodel/parametermanager.h>
@@ -51,7 +54,8 @@ MainFrame::Session::Session() :
 MainFrame::MainFrame(QWidget* parent) :
 		QWidget(parent), __ui(new Ui::MainFrame),
 		__parameterMgr(new ParameterManager), __env(new Environment),
-		__cache(new Cache) {
+		__cache(new Cache), __archiveIndex(new ArchiveIndex),
+		__snapshots(new Snapshots), __thumbnails(new Thumbnails) {
 
 	setObjectName("SDP-MainFrame");
 
@@ -229,6 +233,7 @@ MainFrame::MainFrame(QWidget* parent) :
 	connect(__activity, SIGNAL(detectionJobTerminated(DetectionJob*)), __trigger, SLOT(createTrigger(DetectionJob*)));
 	connect(__activity, SIGNAL(editDetectionJob(DetectionJob*)), __detection, SLOT(load(DetectionJob*)));
 	connect(__activity, SIGNAL(editDispatchJob(DispatchJob*)), __dispatch, SLOT(load(DispatchJob*)));
+	connect(__activity, SIGNAL(dispatchJobTerminated(DispatchJob*)), __archiveIndex.data(), SLOT(dispatchJobTerminated(DispatchJob*)));
 	connect(__trigger, SIGNAL(triggerStatusModified(int, QList<QString>)), __recent, SLOT(triggerStatusModified(int, QList<QString>)));
 	connect(__trigger, SIGNAL(newDetectionTriggers(QString, QList<QString>)), __recent, SLOT(addDetectionTriggers(QString, QList<QString>)));
 
@@ -348,8 +353,7 @@ void MainFrame::loadInventory() {
 	DatabaseManager::TriggerList tl = __dbMgr->unreviewedTriggers();
 	log->addMessage(Logger::DEBUG, __func__, QString("Found %1 un-reviewed trigger(s) inside database.")
 	    .arg(QString::number(tl.size())), true);
-	for (int i = 0; i < tl.size(); ++i)
-		__trigger->loadTrigger(tl.at(i));
+	__trigger->loadTriggers(tl);
 }
 
 
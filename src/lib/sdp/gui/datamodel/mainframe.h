@@ -61,6 +61,9 @@ class Config;
 class DatabaseManager;
 class Environment;
 class Cache;
+class ArchiveIndex;
+class Snapshots;
+class Thumbnails;
 
 
 /**
@@ -155,6 +158,9 @@ class MainFrame : public QWidget, public Singleton<MainFrame> {
 		QScopedPointer<DatabaseManager> __dbMgr;
 		QScopedPointer<Environment> __env;
 		QScopedPointer<Cache> __cache;
+		QScopedPointer<ArchiveIndex> __archiveIndex;
+		QScopedPointer<Snapshots> __snapshots;
+		QScopedPointer<Thumbnails> __thumbnails;
 		FancyButton* __configButton;
 		FancyButton* __recentButton;
 		FancyButton* __activityButton;
@@ -28,9 +28,14 @@
 #include <sdp/gui/datamodel/archiveobjects.h>
 #include <sdp/gui/datamodel/job.h>
 #include <sdp/gui/datamodel/trigger.h>
+#include <sdp/gui/datamodel/triggermodel.h>
+#include <sdp/gui/datamodel/commitpipeline.h>
 #include <sdp/gui/datamodel/cache.h>
 #include <sdp/gui/datamodel/macros.h>
 #include <sdp/gui/datamodel/progress.h>
+#include <sdp/gui/datamodel/snapshots.h>
+#include <sdp/gui/datamodel/thumbnails.h>
+#include <sdp/gui/datamodel/waveformview.h>
 #include <sdp/gui/datamodel/mainframe.h>
 #include <sdp/gui/datamodel/parametermanager.h>
 #include <sdp/gui/datamodel/databasemanager.h>
@@ -101,21 +106,10 @@ int getHeaderPosition(const enum RecentTableHeaders& e) {
 
 
 
-enum TriggerTableHeaders {
-	tCTIME, tTTIME, tSTATUS, tSITES, tID
-};
+//! In the order of TriggerModel::Column
 const char* TriggerTableHeaders[] = { "Creation time", "Trigger time", "Status", "Sites", "ID" };
 const std::vector<const char*> TriggerHeadersString(TriggerTableHeaders,
     TriggerTableHeaders + sizeof(TriggerTableHeaders) / sizeof(TriggerTableHeaders[0]));
-int getHeaderPosition(const enum TriggerTableHeaders& e) {
-	char* str;
-	for (size_t i = 0; i < TriggerHeadersString.size(); ++i) {
-		str = (char*) TriggerHeadersString.at(i);
-		if ( str == TriggerTableHeaders[e] )
-		    return (int) i;
-	}
-	return -1;
-}
 
 enum ActivityTableHeaders {
 	aCTIME, aTYPE, aINFO, aCOMMENT, aSTATUS, aID
@@ -140,6 +134,16 @@ static QString const ENDL = "\n";
 static QString const TAB = "    ";
 static QString const xmlTAB = "  ";
 
+//! Rows around the displayed trigger whose snapshots are drawn ahead
+static int const SnapshotPrefetchRows = 2;
+
+//! Snapshots shown by history tooltips and their width
+static int const TooltipSnapshots = 3;
+static int const TooltipWidth = 300;
+
+//! Width of the snapshots of the trigger preview
+static int const PreviewWidth = 500;
+
 
 /**
  * @brief Translates generic return codes into string (text) equivalent.
@@ -353,10 +357,22 @@ void SettingsPanel::init() {
 	    "settings.bin.msmod",
 	    tr("The msmod bin location which is mandatory for performing "
 		    "customized dispatch operations (retagging data headers)"));
+	__vars << EntityVariable("MSFETCH_BIN", EntityVariable::evBIN,
+	    QString("%1%2%3").arg(e->binDir()).arg(QDir::separator()).arg("msfetch"),
+	    "settings.bin.msfetch",
+	    tr("The msfetch bin location which is used by detection scripts to "
+		    "fetch stations from an Arclink server with concurrent requests. "
+		    "Scripts request stations one by one when it is not available"));
+	__vars << EntityVariable("MSSNAP_BIN", EntityVariable::evBIN,
+	    QString("%1%2%3").arg(e->binDir()).arg(QDir::separator()).arg("mssnap"),
+	    "settings.bin.mssnap",
+	    tr("The mssnap bin location which is used to draw trigger snapshots "
+		    "from the data recorded by detection scripts when they are first "
+		    "viewed. Scripts draw them with matplotlib when it is not available"));
 	__vars << EntityVariable("RDSEED_BIN", EntityVariable::evBIN, "Unknown rdseed binary",
 	    "settings.bin.rdseed",
-	    tr("The rdseed bin which is recommended when the user wants to use a "
-		    "binary dataless for loading stations in detection's inventory."));
+	    tr("The rdseed bin. Binary dataless files loaded in detection's "
+		    "inventory are read without it."));
 	__vars << EntityVariable("TRIGGER_FILE", EntityVariable::evSTRING,
 	    QString("@JOB_RUN_DIR@%1triggers.txt").arg(QDir::separator()), "",
 	    tr("The file in which detection run trigger(s) will be stored. "
@@ -367,6 +383,11 @@ void SettingsPanel::init() {
 	    "", tr("The file in which detection run trigger(s) information will be stored. "
 		    "(@JOB_RUN_DIR@ and @TRIGGER_DATETIME@ will be replaced at runtime "
 		    "with run director and trigger time of the detection of interest)"));
+	__vars << EntityVariable("TRIGGER_MERGE_TOLERANCE", EntityVariable::evSTRING, "2",
+	    "settings.triggerMergeTolerance",
+	    tr("The time in seconds within which triggers reported by overlapping "
+		    "analysis windows are merged into a single trigger holding all "
+		    "their stations. Use 0 to only merge identical trigger times"));
 	__vars << EntityVariable("LOC_METHOD_ID", EntityVariable::evSTRING, "sdp", "settings.loc.methodID",
 	    tr("Location method ID that will be added inside SC3ML file"));
 	__vars << EntityVariable("LOC_EARTH_MODEL_ID", EntityVariable::evSTRING, "@EVENT_SCODE@", "",
@@ -374,9 +395,41 @@ void SettingsPanel::init() {
 	__vars << EntityVariable("AGENCY", EntityVariable::evSTRING, "Unknown", "settings.loc.agency", tr("The name of your agency"));
 	__vars << EntityVariable("AUTHOR", EntityVariable::evSTRING, "Unknown", "settings.loc.author", tr("The author of the detection(s)"));
 	__vars << EntityVariable("SC_DISPATCH_EXTRA_ARG", EntityVariable::evSTRING, "", "settings.scdispatchArguments", tr("Extra arguments to pass to scdispatch when importing triggers"));
+	__vars << EntityVariable("COMMIT_COMMAND", EntityVariable::evSTRING, "", "settings.commit.command",
+	    tr("The command committing a trigger instead of scdispatch, e.g. a stand-in "
+		    "for testing (@FILE@ will be replaced at runtime with the SC3ML file "
+		    "of the trigger, @OPERATION@ with 'add' on the first attempt and "
+		    "'merge' on retries). Commands without @OPERATION@ are only retried "
+		    "when they exit with code 75. Leave empty to use scdispatch"));
+	__vars << EntityVariable("COMMIT_CONNECTIONS", EntityVariable::evSTRING, "4", "settings.commit.connections",
+	    tr("The number of triggers committed at once"));
+	__vars << EntityVariable("COMMIT_RETRIES", EntityVariable::evSTRING, "3", "settings.commit.retries",
+	    tr("The number of times a trigger which failed to be committed is tried "
+		    "again, after an increasing delay"));
 	__vars << EntityVariable("TRIGGER_PREFIX", EntityVariable::evSTRING, "trigger-", "settings.triggerPrefix", tr("The default trigger prefix when stored in run folder"));
 	__vars << EntityVariable("ARCLINK_USER", EntityVariable::evSTRING, "script@sdp", "settings.arclink.user", tr("The arclink user"));
 	__vars << EntityVariable("ARCLINK_PASSWORD", EntityVariable::evSTRING, "", "settings.arclink.password", tr("The arclink user's password"));
+	__vars << EntityVariable("FETCH_CONNECTIONS", EntityVariable::evSTRING, "4", "settings.arclink.connections", tr("The number of concurrent Arclink requests of detection scripts"));
+	__vars << EntityVariable("FETCH_CACHE_DIR", EntityVariable::evPATH,
+	    QString("%1%2%3").arg(e->shareDir()).arg(QDir::separator()).arg("cache"),
+	    "settings.arclink.cache",
+	    tr("The directory in which data fetched from Arclink servers is cached "
+		    "and shared by detection runs. Runs link the cached data instead of "
+		    "copying it. Leave empty to disable the cache"));
+	__vars << EntityVariable("FETCH_CACHE_SIZE", EntityVariable::evSTRING, "2048", "settings.arclink.cacheSize",
+	    tr("The size limit of the Arclink data cache in megabytes, the least "
+		    "recently used data is removed first"));
+	__vars << EntityVariable("THUMBNAIL_DIR", EntityVariable::evPATH,
+	    QString("%1%2%3").arg(e->shareDir()).arg(QDir::separator()).arg("thumbnails"),
+	    "settings.thumbnails",
+	    tr("The directory in which the scaled down trigger snapshots shown by "
+		    "tooltips and previews are stored"));
+	__vars << EntityVariable("THUMBNAIL_CACHE_SIZE", EntityVariable::evSTRING, "256", "settings.thumbnailsSize",
+	    tr("The size limit of the thumbnail directory in megabytes, the least "
+		    "recently used thumbnails are removed first. Use 0 for no limit"));
+	__vars << EntityVariable("THUMBNAIL_CACHE_AGE", EntityVariable::evSTRING, "30", "settings.thumbnailsAge",
+	    tr("The number of days after which an unused thumbnail is removed. "
+		    "Use 0 to keep thumbnails until the size limit is reached"));
 
 	//! Populate the table with variables and values, also, register them
 	//! in the mean time...
@@ -768,6 +821,42 @@ void InteractiveTable::keyPressEvent(QKeyEvent* event) {
 }
 
 
+InteractiveTableView::InteractiveTableView(QWidget* parent) :
+		QTableView(parent) {}
+
+
+InteractiveTableView::~InteractiveTableView() {}
+
+
+void InteractiveTableView::keyPressEvent(QKeyEvent* event) {
+
+	if ( !model() ) return;
+
+	const int tmpCol = qMax(0, currentIndex().column());
+	int tmpRow = currentIndex().row();
+
+	if ( event->key() == Qt::Key_Up ) {
+		tmpRow = qMax(0, tmpRow - 1);
+		clearSelection();
+		setCurrentIndex(model()->index(tmpRow, tmpCol));
+		emit clicked(currentIndex());
+	}
+
+	if ( event->key() == Qt::Key_Down ) {
+		//! Rows past the last one fetched are asked for
+		if ( tmpRow + 1 >= model()->rowCount() && model()->canFetchMore(QModelIndex()) )
+		    model()->fetchMore(QModelIndex());
+		tmpRow = qMin(model()->rowCount() - 1, tmpRow + 1);
+		clearSelection();
+		setCurrentIndex(model()->index(tmpRow, tmpCol));
+		emit clicked(currentIndex());
+	}
+
+	if ( event->key() == Qt::Key_Delete )
+	    emit deleteSelected();
+}
+
+
 RecentPanel::RecentPanel(QWidget* parent) :
 		PanelWidget(parent), __ui(new Ui::RecentPanel), __jobSelected(NULL) {
 
@@ -778,6 +867,16 @@ RecentPanel::RecentPanel(QWidget* parent) :
 
 	initInteractiveTree();
 
+	//! Tooltips of triggers are shown once their snapshots are drawn and
+	//! scaled down
+	SDPASSERT(Snapshots::instancePtr());
+	SDPASSERT(Thumbnails::instancePtr());
+	__tree->viewport()->installEventFilter(this);
+	connect(Snapshots::instancePtr(), SIGNAL(rendered(const QStringList&)),
+	    this, SLOT(snapshotsRendered(const QStringList&)));
+	connect(Thumbnails::instancePtr(), SIGNAL(ready(const QString&)),
+	    this, SLOT(thumbnailReady(const QString&)));
+
 	QFont tf(__ui->textEditObjects->font());
 #ifdef Q_OS_MAC
 	tf.setFamily("Monaco");
@@ -960,28 +1059,13 @@ void RecentPanel::addTriggerRow(Job* job, Trigger* trig) {
 	QTreeWidgetItem* rejected = __parents.value(job->id()).rejectedItem;
 	QTreeWidgetItem* committed = __parents.value(job->id()).committedItem;
 
-	QString ttip;
-	ttip += "<p><div id=\"picture\">";
-
-	bool showAllTriggers =
-	    (trig->stations().size() < 3) ? true : false;
+	QStringList snapshots;
 	QString stations;
 	for (int j = 0; j < trig->stations().size(); ++j) {
 		stations.append(trig->stations().at(j).networkCode + "."
 		    + trig->stations().at(j).code + ", ");
-		if ( showAllTriggers ) {
-			ttip += QString("<a><img src=\"%1\" title=\"trigger\" alt=\"trigger\" width=\"300\" border=\"0\" /></a><br />")
-			    .arg(trig->stations().at(j).snapshotFile);
-		}
-		else {
-			if ( j < 3 )
-				ttip += QString("<a><img src=\"%1\" title=\"trigger\" alt=\"trigger\" width=\"300\" border=\"0\" /></a><br />")
-				    .arg(trig->stations().at(j).snapshotFile);
-			else if ( j < 4 )
-			    ttip += "<a><b>Select origin to display more triggers...</b></a>";
-		}
+		snapshots << trig->stations().at(j).snapshotFile;
 	}
-	ttip += "</div></p>";
 
 	QTreeWidgetItem* row = NULL;
 	switch ( trig->status() ) {
@@ -1021,9 +1105,8 @@ void RecentPanel::addTriggerRow(Job* job, Trigger* trig) {
 	    Utils::VariantPtr<Trigger>::asQVariant(trig));
 	row->setText(getHeaderPosition(thID), trig->id());
 	row->setText(getHeaderPosition(thINFORMATION), stations);
-
-	for (int j = 0; j < __tree->columnCount(); ++j)
-		row->setToolTip(j, ttip);
+	//! The tooltip is made of thumbnails of the snapshots when it is shown
+	row->setData(getHeaderPosition(thINFORMATION), Qt::UserRole, snapshots);
 }
 
 
@@ -1086,28 +1169,13 @@ void RecentPanel::loadJobFromRunDir(Job* job) {
 
 	for (int i = 0; i < run->origins().size(); ++i) {
 
-		QString ttip;
-		ttip += "<p><div id=\"picture\">";
-
-		bool showAllTriggers =
-		    (run->origins().at(i)->stations().size() < 3) ? true : false;
+		QStringList snapshots;
 		QString stations;
 		for (int j = 0; j < run->origins().at(i)->stations().size(); ++j) {
 			stations.append(run->origins().at(i)->stations().at(j)->network() + "."
 			    + run->origins().at(i)->stations().at(j)->code() + ", ");
-			if ( showAllTriggers ) {
-				ttip += QString("<a><img src=\"%1\" title=\"trigger\" alt=\"trigger\" width=\"300\" border=\"0\" /></a><br />")
-				    .arg(run->origins().at(i)->stations().at(j)->pixmap());
-			}
-			else {
-				if ( j < 3 )
-					ttip += QString("<a><img src=\"%1\" title=\"trigger\" alt=\"trigger\" width=\"300\" border=\"0\" /></a><br />")
-					    .arg(run->origins().at(i)->stations().at(j)->pixmap());
-				else if ( j < 4 )
-				    ttip += "<a><b>Select origin to display more triggers...</b></a>";
-			}
+			snapshots << run->origins().at(i)->stations().at(j)->pixmap();
 		}
-		ttip += "</div></p>";
 
 		QTreeWidgetItem* row = new QTreeWidgetItem(th);
 
@@ -1122,9 +1190,8 @@ void RecentPanel::loadJobFromRunDir(Job* job) {
 		    Utils::VariantPtr<ArchivedOrigin>::asQVariant(run->origins().at(i)));
 		row->setText(getHeaderPosition(thID), "OT" + run->origins().at(i)->time().toString(Qt::ISODate));
 		row->setText(getHeaderPosition(thINFORMATION), stations);
-
-		for (int j = 0; j < __tree->columnCount(); ++j)
-			row->setToolTip(j, ttip);
+		//! The tooltip is made of thumbnails of the snapshots when it is shown
+		row->setData(getHeaderPosition(thINFORMATION), Qt::UserRole, snapshots);
 
 		th->addChild(row);
 	}
@@ -1415,6 +1482,108 @@ void RecentPanel::objectSelected(QTreeWidgetItem* item, const int&) {
 }
 
 
+bool RecentPanel::eventFilter(QObject* obj, QEvent* event) {
+
+	if ( obj != __tree->viewport() || event->type() != QEvent::ToolTip )
+	    return PanelWidget::eventFilter(obj, event);
+
+	QHelpEvent* help = static_cast<QHelpEvent*>(event);
+	__tooltipSnapshots.clear();
+
+	if ( showSnapshotTooltip(__tree->itemAt(help->pos()), help->globalPos(), true) )
+	    return true;
+
+	return PanelWidget::eventFilter(obj, event);
+}
+
+
+bool RecentPanel::showSnapshotTooltip(QTreeWidgetItem* item, const QPoint& pos,
+                                      const bool& draw) {
+
+	if ( !item ) return false;
+
+	QStringList snapshots = item->data(getHeaderPosition(thINFORMATION), Qt::UserRole).toStringList();
+	if ( snapshots.isEmpty() ) return false;
+
+	const bool more = snapshots.size() > TooltipSnapshots;
+	snapshots = snapshots.mid(0, TooltipSnapshots);
+	__tooltipSnapshots = snapshots;
+
+	//! Hold the tooltip until its snapshots are drawn and scaled down, the
+	//! GUI thread only reads thumbnails
+	const QStringList missing = Snapshots::instancePtr()->missing(snapshots);
+	if ( draw && !missing.isEmpty() ) {
+		Snapshots::instancePtr()->render(missing);
+		return true;
+	}
+
+	QString ttip;
+	bool scaling = false;
+	ttip += "<p><div id=\"picture\">";
+	for (int i = 0; i < snapshots.size(); ++i) {
+		if ( missing.contains(snapshots.at(i)) ) continue;
+		const QString thumbnail = Thumbnails::instancePtr()->file(snapshots.at(i), TooltipWidth);
+		scaling |= thumbnail.isEmpty();
+		ttip += QString("<a><img src=\"%1\" title=\"trigger\" alt=\"trigger\" width=\"%2\" border=\"0\" /></a><br />")
+		    .arg(thumbnail).arg(TooltipWidth);
+	}
+	if ( more )
+	    ttip += "<a><b>Select origin to display more triggers...</b></a>";
+	ttip += "</div></p>";
+
+	if ( scaling ) return true;
+
+	__tooltipSnapshots.clear();
+	QToolTip::showText(pos, ttip, __tree->viewport());
+
+	return true;
+}
+
+
+void RecentPanel::snapshotsRendered(const QStringList& images) {
+
+	for (int i = 0; i < images.size(); ++i)
+		if ( __shownSnapshots.contains(images.at(i)) ) {
+			__ui->webViewObjects->reload();
+			break;
+		}
+
+	for (int i = 0; i < images.size(); ++i)
+		if ( __tooltipSnapshots.contains(images.at(i)) ) {
+			showPendingTooltip();
+			break;
+		}
+}
+
+
+void RecentPanel::thumbnailReady(const QString& image) {
+
+	if ( __tooltipSnapshots.contains(image) )
+	    showPendingTooltip();
+}
+
+
+void RecentPanel::showPendingTooltip() {
+
+	//! Snapshots which could not be drawn are left out
+	if ( Snapshots::instancePtr()->pending(__tooltipSnapshots) )
+	    return;
+
+	//! Only if the pointer is still over the row
+	const QPoint pos = __tree->viewport()->mapFromGlobal(QCursor::pos());
+	QTreeWidgetItem* item = __tree->viewport()->rect().contains(pos) ? __tree->itemAt(pos) : NULL;
+	const QStringList snapshots = item ?
+	    item->data(getHeaderPosition(thINFORMATION), Qt::UserRole).toStringList().mid(0, TooltipSnapshots) : QStringList();
+
+	if ( snapshots.isEmpty() || snapshots != __tooltipSnapshots ) {
+		__tooltipSnapshots.clear();
+		return;
+	}
+
+	showSnapshotTooltip(item, QCursor::pos(), false);
+}
+
+
 void RecentPanel::initInteractiveTree() {
 
 	QFont f;
@@ -1549,6 +1718,11 @@ void RecentPanel::displayTriggerInformation(Trigger* trig) {
 
 	if ( !job ) return;
 
+	__shownSnapshots.clear();
+	for (int i = 0; i < trig->stations().size(); ++i)
+		__shownSnapshots << trig->stations().at(i).snapshotFile;
+	Snapshots::instancePtr()->render(__shownSnapshots);
+
 	__ui->splitterInformation->setSizes(QList<int>() << 0 << 3 << 1);
 	__ui->webViewObjects->load(QUrl::fromLocalFile(trig->resumePage()));
 	__ui->textEditObjects->clear();
@@ -1574,6 +1748,11 @@ void RecentPanel::displayTriggerInformation(Trigger* trig) {
 
 void RecentPanel::displayOriginOutput(ArchivedOrigin* o) {
 
+	__shownSnapshots.clear();
+	for (int i = 0; i < o->stations().size(); ++i)
+		__shownSnapshots << o->stations().at(i)->pixmap();
+	Snapshots::instancePtr()->render(__shownSnapshots);
+
 	__ui->webViewObjects->load(QUrl::fromLocalFile(o->webpage()));
 	__ui->textEditObjects->clear();
 	__ui->labelObjectName->setText(QString("Origin %1").arg(o->time().toString(Qt::ISODate)));
@@ -1694,9 +1873,6 @@ void ActivityPanel::addJob(Job* j) {
 
 	//! Assign the new job pointer to the TableItem object
 	TableItem* itm = new TableItem(j->creationTime().toString("yyyy-MM-dd HH:mm:ss.zzz"), (void*) j);
-	//! Vice-versa, [...] this small hack will be useful whenever we need to
-	//! retrieve one from the other...
-	j->setTableWidget((void*) itm);
 
 	QTableWidgetItem* typeItm = new QTableWidgetItem((*j->type()).string);
 	QTableWidgetItem* statusItm = new QTableWidgetItem((*j->status()).string);
@@ -1734,6 +1910,7 @@ void ActivityPanel::addJob(Job* j) {
 
 	connect(j, SIGNAL(started()), this, SLOT(jobStarted()));
 	connect(j, SIGNAL(terminated()), this, SLOT(jobTerminated()));
+	connect(j, SIGNAL(progressChanged()), this, SLOT(jobProgress()));
 
 	//! Visual trick... instantiate some blinker from the mainframe ;)
 	SDPASSERT(MainFrame::instancePtr());
@@ -1920,6 +2097,18 @@ JobItems ActivityPanel::selectedJobs() {
 }
 
 
+TableItem* ActivityPanel::jobItem(Job* job) {
+
+	for (int i = 0; i < __table->rowCount(); ++i) {
+		TableItem* itm = dynamic_cast<TableItem*>(__table->item(i, 0));
+		if ( itm && reinterpret_cast<Job*>(itm->object) == job )
+		    return itm;
+	}
+
+	return NULL;
+}
+
+
 JobItems ActivityPanel::allJobs() {
 
 	JobItems items;
@@ -2374,8 +2563,16 @@ void ActivityPanel::jobTerminated() {
 	}
 
 	else if ( job->type() == Dispatch ) {
-		//! Check out the result of the operation : see if anything went well,
-		//! how many files has been processed and so on...
+		//! Report the counts of the dispatch tool, if any were received
+		const Job::Progress& p = job->progress();
+		SDPASSERT(Logger::instancePtr());
+		if ( p.filesTotal > 0 )
+		    Logger::instancePtr()->addMessage(Logger::INFO, __func__,
+		        QString("Job %1 dispatched %2/%3 file(s), %4 record(s)")
+		            .arg(job->id()).arg(p.filesDone).arg(p.filesTotal)
+		            .arg(p.records));
+		if ( DispatchJob* dj = dynamic_cast<DispatchJob*>(job) )
+		    emit dispatchJobTerminated(dj);
 	}
 
 	if ( __jobSelected == job ) {
@@ -2399,6 +2596,30 @@ void ActivityPanel::jobTerminated() {
 }
 
 
+void ActivityPanel::jobProgress() {
+
+	QObject* sender = QObject::sender();
+
+	Job* job = qobject_cast<Job*>(sender);
+	if ( !job || job->status() != Running ) return;
+
+	TableItem* itm = jobItem(job);
+	if ( !itm ) return;
+
+	const Job::Progress& p = job->progress();
+	const QString msg = QString("Running %1/%2 files").arg(p.filesDone).arg(p.filesTotal);
+
+	//! Update the running animation text instead of replacing the widget
+	QWidget* w = __table->cellWidget(itm->row(), getHeaderPosition(aSTATUS));
+	if ( AnimInfoWidget* aw = dynamic_cast<AnimInfoWidget*>(w) ) {
+		aw->setInfoText(msg);
+		aw->setToolTip(QString("%1 record(s) read").arg(p.records));
+	}
+	else
+		updateJobStatus(job, jqsCustom, msg);
+}
+
+
 void ActivityPanel::incomingStdMsg() {
 
 	QObject* sender = QObject::sender();
@@ -2551,7 +2772,7 @@ void ActivityPanel::updateJobStatus(Job* job, JobQueueStatus jqs,
 
 	if ( !job ) return;
 
-	TableItem* itm = reinterpret_cast<TableItem*>(job->tableWidget());
+	TableItem* itm = jobItem(job);
 	if ( !itm ) return;
 
 	QTableWidgetItem* status = __table->item(itm->row(), getHeaderPosition(aSTATUS));
@@ -2626,27 +2847,24 @@ void ActivityPanel::checkDetectionOutput(DetectionJob* job) {
 }
 
 
-CommitDialog::CommitDialog(const QString& file, QWidget* parent) :
-		QDialog(parent), __ui(new Ui::CommitDialog), __retCode(cdUNKNOWN) {
+CommitDialog::CommitDialog(CommitPipeline* pipeline, QWidget* parent) :
+		QDialog(parent), __ui(new Ui::CommitDialog), __pipeline(pipeline),
+		__retCode(cdUNKNOWN) {
+
+	SDPASSERT(__pipeline);
 
 	__ui->setupUi(this);
 	__ui->labelStatus->setAutoFillBackground(true);
-	__ui->labelInfo->setText("Committing triggers in file " + file);
-
-	connect(__ui->pushButton, SIGNAL(clicked()), this, SLOT(close()));
-
-	SDPASSERT(Logger::instancePtr());
-	SDPASSERT(ParameterManager::instancePtr());
-	ParameterManager* pm = ParameterManager::instancePtr();
+	__ui->labelInfo->setText(QString("Committing %1 trigger(s)").arg(__pipeline->count()));
+	__ui->pushButton->setText(tr("Cancel"));
 
-	QProcess* proc = new QProcess(this);
-	connect(proc, SIGNAL(finished(int)), this, SLOT(processTerminated(int)));
+	connect(__ui->pushButton, SIGNAL(clicked()), this, SLOT(buttonClicked()));
+	connect(__pipeline, SIGNAL(statusChanged(Trigger*, int, const QString&)),
+	    this, SLOT(triggerStatusChanged(Trigger*, int, const QString&)));
+	connect(__pipeline, SIGNAL(finished()), this, SLOT(pipelineFinished()));
 
-	proc->start(QString("%1 %2").arg(pm->parameter("BASH_BIN").toString()).arg(file));
-	if ( !proc->waitForStarted() ) {
-		Logger::instancePtr()->addMessage(Logger::CRITICAL, __func__, "Failed to start commit operation");
-		QMessageBox::critical(this, tr("Error"), tr("Failed to start commit operation!"));
-	}
+	updateStatus();
+	__pipeline->start();
 }
 
 
@@ -2658,23 +2876,43 @@ CommitDialog::ReturnCode CommitDialog::commitReturnCode() {
 }
 
 
-void CommitDialog::processTerminated(int retcode) {
+void CommitDialog::reject() {
+	//! Closing the dialog cancels the triggers not committed yet
+	__pipeline->abort();
+	QDialog::reject();
+}
 
-	QObject* sender = QObject::sender();
-	SDPASSERT(sender);
 
-	QProcess* proc = qobject_cast<QProcess*>(sender);
-	if ( !proc ) return;
+void CommitDialog::buttonClicked() {
+	if ( __pipeline->isFinished() )
+		accept();
+	else
+		__pipeline->abort();
+}
+
+
+void CommitDialog::triggerStatusChanged(Trigger* trigger, int,
+                                        const QString& message) {
+	__ui->textEdit->append(trigger->id() + ": " + message);
+	updateStatus();
+}
+
+
+void CommitDialog::pipelineFinished() {
+
+	const int failed = __pipeline->count(CommitPipeline::cpFAILED);
 
 	QColor c;
-	if ( retcode ) {
+	if ( failed ) {
 		__retCode = cdFAILED;
-		__ui->labelStatus->setText("Program did not executed successfully.");
+		__ui->labelStatus->setText(QString("%1 trigger(s) committed, %2 failed.")
+		    .arg(__pipeline->count(CommitPipeline::cpCOMMITTED)).arg(failed));
 		c = QColor(228, 59, 54);
 	}
 	else {
 		__retCode = cdSUCCESS;
-		__ui->labelStatus->setText("Program executed successfully.");
+		__ui->labelStatus->setText(QString("%1 trigger(s) committed successfully.")
+		    .arg(__pipeline->count(CommitPipeline::cpCOMMITTED)));
 		c = QColor(99, 229, 99);
 	}
 
@@ -2682,17 +2920,21 @@ void CommitDialog::processTerminated(int retcode) {
 	p.setColor(QPalette::Background, c);
 	__ui->labelStatus->setPalette(p);
 
-	__ui->textEdit->clear();
-	QByteArray out = proc->readAll();
-	QList<QByteArray> output = out.split('\n');
-	for (QList<QByteArray>::iterator it = output.begin();
-	        it != output.end(); ++it) {
-		if ( it->isEmpty() ) continue;
-		__ui->textEdit->append((*it).constData());
-	}
+	__ui->pushButton->setText(tr("Okay"));
+}
 
-	//! TODO: see if this doesn't provoque a crash
-	proc->deleteLater();
+
+void CommitDialog::updateStatus() {
+
+	if ( __pipeline->isFinished() ) return;
+
+	__ui->labelStatus->setText(QString("%1 committed, %2 running, %3 waiting for retry, "
+	    "%4 failed, %5 pending.")
+	    .arg(__pipeline->count(CommitPipeline::cpCOMMITTED))
+	    .arg(__pipeline->count(CommitPipeline::cpRUNNING))
+	    .arg(__pipeline->count(CommitPipeline::cpRETRYING))
+	    .arg(__pipeline->count(CommitPipeline::cpFAILED))
+	    .arg(__pipeline->count(CommitPipeline::cpPENDING)));
 }
 
 
@@ -2709,6 +2951,17 @@ TriggerPanel::TriggerPanel(QWidget* parent) :
 	//! Re-organize splitter so that the view get initialized half by half
 	__ui->splitterMain->setSizes(QList<int>() << 3 << 1);
 
+	//! The waveforms of the trigger are decoded from the data recorded by
+	//! its run, snapshots are only drawn when their tab is shown
+	__previewTabs = new QTabWidget(__ui->splitterInfo);
+	__waveforms = new WaveformView(__previewTabs);
+	__waveforms->setToolTip(tr("Wheel: zoom, drag: pan, double click: whole window, "
+	    "shift + wheel: scroll channels"));
+	__previewTabs->addTab(__waveforms, tr("Waveforms"));
+	__previewTabs->addTab(__ui->webView, tr("Snapshots"));
+	__ui->splitterInfo->insertWidget(0, __previewTabs);
+	connect(__previewTabs, SIGNAL(currentChanged(int)), this, SLOT(previewTabChanged(int)));
+
 	QVBoxLayout* l = new QVBoxLayout(__ui->widgetToolbar);
 	l->setContentsMargins(0, 0, 0, 4);
 	FancyPanel* toolbar = new FancyPanel(this, FancyPanel::Horizontal, 65, FancyPanel::Gray);
@@ -2764,6 +3017,13 @@ TriggerPanel::TriggerPanel(QWidget* parent) :
 	__removeButton->setEnabled(false);
 	__commitButton->setEnabled(false);
 	__resetButton->setEnabled(false);
+
+	SDPASSERT(Snapshots::instancePtr());
+	SDPASSERT(Thumbnails::instancePtr());
+	connect(Snapshots::instancePtr(), SIGNAL(rendered(const QStringList&)),
+	    this, SLOT(snapshotsRendered(const QStringList&)));
+	connect(Thumbnails::instancePtr(), SIGNAL(ready(const QString&)),
+	    this, SLOT(thumbnailReady(const QString&)));
 }
 
 
@@ -2777,96 +3037,25 @@ bool TriggerPanel::saveParameters() {
 }
 
 
-void TriggerPanel::loadTrigger(Trigger* trig) {
-
-	if ( !trig ) return;
-
-	if ( !__triggers.contains(trig) )
-	    __triggers << trig;
-
-	QFont f(__table->font());
-	f.setBold(true);
-
-	//! Assign the new job pointer to the TableItem object
-	TableItem* ctime = new TableItem(trig->creationTime().toString("yyyy-MM-dd HH:mm:ss.zzz"), (void*) trig);
-	//! Vice-versa, [...] this small hack will be useful whenever we need to
-	//! retrieve one from the other...
-	trig->setTableWidget((void*) ctime);
-
-	QTableWidgetItem* otime = new QTableWidgetItem(trig->originTime().toString("yyyy-MM-dd HH:mm:ss.zzz"));
-	QTableWidgetItem* status = new QTableWidgetItem((*(trig->status())).string);
-
-	int idx = 0;
-	QString stations = "[" + QString::number(trig->stations().size()) + "] : ";
-
-	for (int i = 0; i < trig->stations().size(); ++i, ++idx)
-		if ( idx != trig->stations().size() - 1 )
-			stations += trig->stations().at(i).networkCode + "." + trig->stations().at(i).code + ", ";
-		else
-			stations += trig->stations().at(i).networkCode + "." + trig->stations().at(i).code;
-
-	QTableWidgetItem* sites = new QTableWidgetItem(stations);
-	QTableWidgetItem* tid = new QTableWidgetItem(trig->id());
-
-	ctime->setTextAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-	otime->setTextAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-	status->setTextAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-	tid->setTextAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
-	status->setFont(f);
-
-	QString tooltip;
-	tooltip += "<div><p>";
-	tooltip += "<b>Job</b>: " + trig->jobID() + "<br />";
-	tooltip += "<b>Creation time</b>: " + trig->creationTime().toString("yyyy-MM-dd HH:mm:ss.zzz") + "<br />";
-	tooltip += "<b>Trigger time</b>: " + trig->originTime().toString("yyyy-MM-dd HH:mm:ss.zzz") + "<br />";
-	tooltip += "<b>Stations</b>: " + stations + "<br />";
-	tooltip += "<b>Resume</b>: " + trig->resumePage() + "<br />";
-	tooltip += "</p></div>";
-
-	QList<QTableWidgetItem*> l;
-	l << ctime;
-	l << otime;
-	l << status;
-	l << sites;
-	l << tid;
-
-	__table->insertRow(__table->rowCount());
-	for (int i = 0; i < __table->columnCount(); ++i) {
-		l.at(i)->setToolTip(tooltip);
-		__table->setItem(__table->rowCount() - 1, i, l.at(i));
-	}
-
-	__table->resizeColumnsToContents();
-	__table->resizeRowsToContents();
+void TriggerPanel::loadTriggers(const QList<Trigger*>& list) {
+	__model->addTriggers(list);
 }
 
 
 void TriggerPanel::removeTriggers(const QString& jobID) {
 
 	SDPASSERT(Logger::instancePtr());
-	SDPASSERT(Cache::instancePtr());
 	Logger* log = Logger::instancePtr();
 
-	QList<TableItem*> items;
 	QList<Trigger*> triggers;
-	for (int i = 0; i < __table->rowCount(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(__table->item(i, 0));
-		if ( !itm ) continue;
-		Trigger* trig = reinterpret_cast<Trigger*>(itm->object);
-		if ( !trig ) continue;
-		if ( trig->jobID() == jobID ) {
-			triggers << trig;
-			items << itm;
-		}
-	}
+	for (int i = 0; i < __model->triggers().size(); ++i)
+		if ( __model->triggers().at(i)->jobID() == jobID )
+		    triggers << __model->triggers().at(i);
 
 	log->addMessage(Logger::DEBUG, __func__, QString("Removing %1 trigger(s) linked to Job %2")
 	    .arg(triggers.size()).arg(jobID));
 
-	for (int i = 0; i < triggers.size(); ++i)
-		removeTrigger(triggers.at(i));
-
-	removeTableRow(__table, items);
+	dropTriggers(triggers);
 }
 
 
@@ -2893,8 +3082,20 @@ void TriggerPanel::initInteractiveTable() {
 		__actions.append(PairedAction(static_cast<int>(i), a));
 	}
 
-	__table = new InteractiveTable(__ui->widgetTable);
-	__table->setObjectName(QString::fromUtf8("tableWidgetTriggers"));
+	QLineEdit* filter = new QLineEdit(__ui->widgetTable);
+	filter->setFont(font);
+	filter->setToolTip(tr("Shows only the triggers with a column containing this text"));
+#if QT_VERSION >= 0x040700
+	filter->setPlaceholderText(tr("Filter triggers"));
+#endif
+	connect(filter, SIGNAL(textChanged(const QString&)), this, SLOT(filterTriggers(const QString&)));
+
+	//! Rows are made by the model when they are shown, the view being given
+	//! more of them as it is scrolled down
+	__model = new TriggerModel(headers, this);
+
+	__table = new InteractiveTableView(__ui->widgetTable);
+	__table->setObjectName(QString::fromUtf8("tableViewTriggers"));
 	__table->setMinimumSize(QSize(0, 0));
 	__table->setMaximumSize(QSize(16777215, 16777215));
 	__table->setFont(font);
@@ -2902,22 +3103,23 @@ void TriggerPanel::initInteractiveTable() {
 	__table->setEditTriggers(QAbstractItemView::NoEditTriggers);
 	__table->setSelectionBehavior(QAbstractItemView::SelectRows);
 	__table->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+	__table->setModel(__model);
 	__table->setSortingEnabled(true);
 	__table->verticalHeader()->setVisible(false);
-	__table->setColumnCount(headers.size());
-	__table->setHorizontalHeaderLabels(headers);
+	__table->verticalHeader()->setResizeMode(QHeaderView::Fixed);
+	__table->verticalHeader()->setDefaultSectionSize(QFontMetrics(font).height() + 6);
 	__table->setStyleSheet("QTableView {selection-background-color: rgb(0,0,0,100);}");
 	__table->horizontalHeader()->setResizeMode(QHeaderView::Stretch);
-	__table->resizeColumnsToContents();
 
 	__table->horizontalHeader()->setContextMenuPolicy(Qt::CustomContextMenu);
 	connect(__table->horizontalHeader(), SIGNAL(customContextMenuRequested(const QPoint&)),
 	    this, SLOT(headerMenu(const QPoint&)));
-	connect(__table, SIGNAL(cellClicked(int, int)), this, SLOT(showTriggerOutput(const int&, const int&)));
+	connect(__table, SIGNAL(clicked(const QModelIndex&)), this, SLOT(showTriggerOutput(const QModelIndex&)));
 	connect(__table->selectionModel(), SIGNAL(selectionChanged(const QItemSelection&, const QItemSelection&)),
 	    this, SLOT(triggerSelectionChanged(const QItemSelection&, const QItemSelection&)));
 	connect(__table, SIGNAL(deleteSelected()), this, SLOT(removeTriggers()));
 
+	l->addWidget(filter);
 	l->addWidget(__table);
 }
 
@@ -2926,13 +3128,73 @@ void TriggerPanel::displayTriggerOutput(Trigger* trig) {
 
 	if ( !trig ) return;
 
-	__ui->webView->load(QUrl::fromLocalFile(trig->resumePage()));
+	__shownSnapshots.clear();
+	for (int i = 0; i < trig->stations().size(); ++i)
+		__shownSnapshots << trig->stations().at(i).snapshotFile;
+
+	WaveformView::ChannelList channels;
+	for (int i = 0; i < __shownSnapshots.size(); ++i) {
+		Snapshots::Reference ref;
+		if ( !Snapshots::instancePtr()->reference(__shownSnapshots.at(i), ref) ) continue;
+		WaveformView::Channel channel;
+		channel.stream = ref.stream;
+		channel.files = ref.files;
+		channel.start = ref.start;
+		channel.end = ref.end;
+		channel.on = ref.on;
+		channel.off = ref.off;
+		channels << channel;
+	}
+	__waveforms->setMessage(tr("The run of this trigger did not record its data, "
+	    "see its snapshots."));
+	__waveforms->setChannels(channels);
+
+	if ( __previewTabs->currentWidget() == __ui->webView )
+	    Snapshots::instancePtr()->render(__shownSnapshots);
+
+	showSnapshots();
 	__ui->textEdit->clear();
 	__ui->textEdit->setText(trig->information());
 	__ui->labelTriggerID->setText(trig->originTime().toString("yyyy-MM-dd hh:mm:ss.zzz"));
 }
 
 
+void TriggerPanel::showSnapshots() {
+
+	SDPASSERT(Thumbnails::instancePtr());
+
+	if ( __shownSnapshots.isEmpty() ) {
+		__ui->webView->setHtml(QString());
+		return;
+	}
+
+	//! The preview shows thumbnails of the snapshots, the ones still being
+	//! drawn or scaled down are added as soon as they are ready
+	QString html;
+	html += "<html>" + ENDL;
+	html += "<body>" + ENDL;
+	for (int i = 0; i < __shownSnapshots.size(); ++i) {
+		const QString thumbnail = QFile::exists(__shownSnapshots.at(i)) ?
+		    Thumbnails::instancePtr()->file(__shownSnapshots.at(i), PreviewWidth) : QString();
+		html += TAB + "<div id=\"pic" + QString::number(i) + "\">" + ENDL;
+		html += TAB + TAB + "<p>" + ENDL;
+		if ( thumbnail.isEmpty() )
+			html += TAB + TAB + TAB + "<i>" + QFileInfo(__shownSnapshots.at(i)).fileName() + "</i>" + ENDL;
+		else
+			html += TAB + TAB + TAB + "<a><img src=\"" + QUrl::fromLocalFile(thumbnail).toString()
+			    + "\" title=\"trigger\" alt=\"trigger\" width=\"" + QString::number(PreviewWidth)
+			    + "\" border=\"0\" /></a>" + ENDL;
+		html += TAB + TAB + "</p><br />" + ENDL;
+		html += TAB + "</div>" + ENDL;
+	}
+	html += "</body>" + ENDL;
+	html += "</html>";
+
+	__ui->webView->setHtml(html, QUrl::fromLocalFile(QFileInfo(__shownSnapshots.first()).absolutePath()
+	    + QDir::separator()));
+}
+
+
 const QString TriggerPanel::generateSC3ML(Trigger* trig) {
 
 	SDPASSERT(ParameterManager::instancePtr());
@@ -3037,30 +3299,49 @@ void TriggerPanel::updateButtons() {
 }
 
 
-TriggerItems TriggerPanel::tableSelection() {
+QList<Trigger*> TriggerPanel::tableSelection() {
 
-	QList<QTableWidgetItem*> l = __table->selectedItems();
+	QList<Trigger*> list;
+	const QModelIndexList rows = __table->selectionModel()->selectedRows();
+	for (int i = 0; i < rows.size(); ++i)
+		if ( Trigger* trig = __model->trigger(rows.at(i)) )
+		    list << trig;
 
-	if ( l.size() == 0 ) return TriggerItems();
+	return list;
+}
 
-	QList<TableItem*> sel;
-	for (int i = 0; i < l.size(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(l.at(i));
-		if ( !itm ) continue;
-		sel << itm;
-	}
 
-	TriggerItems itms;
-	for (int i = 0; i < sel.size(); ++i) {
-		Trigger* trig = reinterpret_cast<Trigger*>(sel.at(i)->object);
-		if ( !trig ) continue;
-		TriggerItem t;
-		t.item = sel[i];
-		t.trigger = trig;
-		itms << t;
+void TriggerPanel::dropTriggers(const QList<Trigger*>& list) {
+
+	SDPASSERT(Cache::instancePtr());
+	SDPASSERT(DatabaseManager::instancePtr());
+
+	QList<Trigger*> triggers;
+	QSet<Trigger*> removed;
+	QStringList ids;
+	for (int i = 0; i < list.size(); ++i)
+		if ( list.at(i) && __model->contains(list.at(i)) && !removed.contains(list.at(i)) ) {
+			removed.insert(list.at(i));
+			triggers << list.at(i);
+			ids << list.at(i)->id();
+		}
+
+	if ( triggers.isEmpty() ) return;
+
+	__model->removeTriggers(triggers);
+
+	for (int i = __commitables.size() - 1; i >= 0; --i)
+		if ( removed.contains(__commitables.at(i).object) )
+		    __commitables.removeAt(i);
+
+	emit triggerStatusModified(static_cast<int>(tmDeleted), ids);
+
+	for (int i = 0; i < triggers.size(); ++i) {
+		DatabaseManager::instancePtr()->removeTrigger(triggers.at(i));
+		Cache::instancePtr()->removeObject(ids.at(i), false, false);
 	}
 
-	return itms;
+	updateButtons();
 }
 
 
@@ -3073,9 +3354,10 @@ void TriggerPanel::commitTriggersIntoDB() {
 
 	//! Store triggers only if their parents (jobs) are also in database
 	int count = 0;
-	for (int i = 0; i < __triggers.size(); ++i)
-		if ( db->detectionExists(__triggers.at(i)->jobID()) )
-		    db->commitTrigger(__triggers.at(i)), ++count;
+	const QList<Trigger*>& triggers = __model->triggers();
+	for (int i = 0; i < triggers.size(); ++i)
+		if ( db->detectionExists(triggers.at(i)->jobID()) )
+		    db->commitTrigger(triggers.at(i)), ++count;
 
 	Logger::instancePtr()->addMessage(Logger::DEBUG, __func__,
 	    QString("Triggers stored in database: %1.").arg(count), true);
@@ -3144,46 +3426,65 @@ void TriggerPanel::createTrigger(DetectionJob* job) {
 		return;
 	}
 
+	//! Overlapping windows may also report the same event a few samples
+	//! apart, those are merged into the earliest trigger of their cluster
+	const QList<QStringList> clusters = Utils::clusterTriggerTimes(trigFileContent,
+	    pm->parameter("TRIGGER_MERGE_TOLERANCE").toDouble());
+
 	log->addMessage(Logger::DEBUG, __func__, "Job with id " + job->id()
 	    + " has terminated and reported " + QString::number(trigFileContent.count())
-	    + " trigger(s).");
+	    + " trigger(s), " + QString::number(clusters.count()) + " after merging.");
 
 	//! Generate triggers
 	QList<Trigger*> triggers;
 	QStringList list;
-	for (int i = 0; i < trigFileContent.count(); ++i) {
+	for (int i = 0; i < clusters.count(); ++i) {
+
+		const QStringList& members = clusters.at(i);
+		const QString& trigTime = members.first();
 
-		QDateTime dt = QDateTime::fromString(trigFileContent.at(i), Qt::ISODate);
+		QDateTime dt = QDateTime::fromString(trigTime, Qt::ISODate);
 		if ( !dt.isValid() ) {
-			log->addMessage(Logger::WARNING, __func__, "Wrong datetime format " + trigFileContent.at(i));
+			log->addMessage(Logger::WARNING, __func__, "Wrong datetime format " + trigTime);
 			continue;
 		}
 
+		//! Snapshots drawn by the run or recorded to be drawn on first view,
+		//! a station reported by several members keeps its earliest snapshot
 		Trigger::StationList stList;
-		QStringList pics = Utils::getFileList(job->runDir(), ".png", trigFileContent.at(i));
-
-		log->addMessage(Logger::DEBUG, __func__, QString::number(pics.size()) +
-		    " snapshot(s) found for trigger " + trigFileContent.at(i) +
-		    " originated from job " + job->id());
-
-		for (int j = 0; j < pics.size(); ++j) {
-
-			const QString pic = QString(pics.at(j)).remove(job->runDir());
-			QStringList tokens = pic.split('-');
-			if ( tokens.size() < 3 ) continue;
-
-			// 2015-05-14T14:17:49.030000Z-WI-MAGL.png (old)
-			// 2015-07-21T21:21:09.750000Z-MQ-FDF-00-HHZ.png (new)
-			Trigger::Station st;
-			st.networkCode = tokens[tokens.size() - 4];
-			st.code = tokens[tokens.size() - 3];
-			st.locationCode = tokens[tokens.size() - 2];
-			st.channelCode = tokens[tokens.size() - 1].split('.')[0];
-//			st.networkCode = tokens[tokens.size() - 2]; // (old)
-//			st.code = tokens[tokens.size() - 1].split('.')[0]; // (old)
-			st.snapshotFile = pics.at(j);
-
-			stList << st;
+		QSet<QString> streams;
+		for (int m = 0; m < members.size(); ++m) {
+
+			QStringList pics = Snapshots::instancePtr()->files(job->runDir(), members.at(m));
+
+			log->addMessage(Logger::DEBUG, __func__, QString::number(pics.size()) +
+			    " snapshot(s) found for trigger " + members.at(m) +
+			    " originated from job " + job->id());
+
+			for (int j = 0; j < pics.size(); ++j) {
+
+				const QString pic = QString(pics.at(j)).remove(job->runDir());
+				QStringList tokens = pic.split('-');
+				if ( tokens.size() < 3 ) continue;
+
+				// 2015-05-14T14:17:49.030000Z-WI-MAGL.png (old)
+				// 2015-07-21T21:21:09.750000Z-MQ-FDF-00-HHZ.png (new)
+				Trigger::Station st;
+				st.networkCode = tokens[tokens.size() - 4];
+				st.code = tokens[tokens.size() - 3];
+				st.locationCode = tokens[tokens.size() - 2];
+				st.channelCode = tokens[tokens.size() - 1].split('.')[0];
+//				st.networkCode = tokens[tokens.size() - 2]; // (old)
+//				st.code = tokens[tokens.size() - 1].split('.')[0]; // (old)
+				st.snapshotFile = pics.at(j);
+
+				const QString stream = st.networkCode + "." + st.code + "."
+				    + st.locationCode + "." + st.channelCode;
+				if ( streams.contains(stream) ) continue;
+				streams.insert(stream);
+
+				stList << st;
+			}
 		}
 
 		QString webContent;
@@ -3207,7 +3508,7 @@ void TriggerPanel::createTrigger(DetectionJob* job) {
 		webContent += "</html>";
 
 		const QString webFile = job->runDir() + QDir::separator() + pm->parameter("TRIGGER_PREFIX").toString()
-		    + trigFileContent.at(i) + ".htm";
+		    + trigTime + ".htm";
 
 		if ( !Utils::writeScript(webFile, webContent) ) {
 			log->addMessage(Logger::WARNING, __func__, "Failed to create HTML file " + webFile);
@@ -3216,14 +3517,17 @@ void TriggerPanel::createTrigger(DetectionJob* job) {
 		else
 			log->addMessage(Logger::DEBUG, __func__, "Generated HTML file " + webFile);
 
-		const QString infoFile = job->runDir() + QDir::separator() + pm->parameter("TRIGGER_PREFIX").toString()
-		    + trigFileContent.at(i) + ".txt";
-
 		QString trigInfo;
-		if ( Utils::fileExists(infoFile) )
-			trigInfo = Utils::getFileContentString(infoFile, "");
-		else
-			log->addMessage(Logger::WARNING, __func__, "Failed to read trigger information file " + infoFile);
+		for (int m = 0; m < members.size(); ++m) {
+
+			const QString infoFile = job->runDir() + QDir::separator() + pm->parameter("TRIGGER_PREFIX").toString()
+			    + members.at(m) + ".txt";
+
+			if ( Utils::fileExists(infoFile) )
+				trigInfo += Utils::getFileContentString(infoFile, "");
+			else if ( m == 0 )
+				log->addMessage(Logger::WARNING, __func__, "Failed to read trigger information file " + infoFile);
+		}
 
 		Trigger* trig = Trigger::create(job->id());
 		if ( trig ) {
@@ -3241,10 +3545,7 @@ void TriggerPanel::createTrigger(DetectionJob* job) {
 
 	if ( triggers.isEmpty() ) return;
 
-	for (QList<Trigger*>::iterator it = triggers.begin();
-	        it != triggers.end(); ++it) {
-		loadTrigger((*it));
-	}
+	loadTriggers(triggers);
 
 	emit newDetectionTriggers(job->id(), list);
 
@@ -3254,41 +3555,16 @@ void TriggerPanel::createTrigger(DetectionJob* job) {
 
 
 void TriggerPanel::removeTrigger(Trigger* t) {
-
-	if ( !t ) return;
-
-	SDPASSERT(Cache::instancePtr());
-	SDPASSERT(DatabaseManager::instancePtr());
-
-	for (int i = 0; i < __commitables.size(); ++i)
-		if ( __commitables.at(i).object == t )
-		    __commitables.removeAt(i);
-
-	if ( !__triggers.contains(t) ) return;
-
-	emit triggerStatusModified(static_cast<int>(tmDeleted), QStringList() << t->id());
-
-	__triggers.removeOne(t);
-	DatabaseManager::instancePtr()->removeTrigger(t);
-	Cache::instancePtr()->removeObject(t->id(), false, false);
+	dropTriggers(QList<Trigger*>() << t);
 }
 
 
 void TriggerPanel::rejectTriggers() {
 
-	QList<QTableWidgetItem*> l = __table->selectedItems();
-
 	//! Reject only selected triggers
-	if ( l.size() == 0 ) return;
+	const QList<Trigger*> sel = tableSelection();
+	if ( sel.size() == 0 ) return;
 
-	QList<TableItem*> sel;
-	for (int i = 0; i < l.size(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(l.at(i));
-		if ( !itm ) continue;
-		sel << itm;
-	}
-
-	QList<TableItem*> parents;
 	bool yesToAll = false;
 	bool noToAll = false;
 	QStringList files;
@@ -3296,8 +3572,7 @@ void TriggerPanel::rejectTriggers() {
 
 	for (int i = 0; i < sel.size(); ++i) {
 
-		Trigger* trig = reinterpret_cast<Trigger*>(sel.at(i)->object);
-		if ( !trig ) continue;
+		Trigger* trig = sel.at(i);
 
 		if ( !yesToAll && !noToAll ) {
 			QMessageBox::StandardButton b =
@@ -3340,14 +3615,7 @@ void TriggerPanel::rejectTriggers() {
 		}
 	}
 
-	for (int i = 0; i < __table->rowCount(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(__table->item(i, 0));
-		QTableWidgetItem* status = __table->item(i, 2);
-		if ( !itm || !status ) continue;
-		Trigger* trig = reinterpret_cast<Trigger*>(itm->object);
-		if ( !trig ) continue;
-		status->setText((*trig->status()).string);
-	}
+	__model->updateTriggers(sel);
 
 	for (int i = 0; i < files.size(); ++i) {
 		QFile::remove(files.at(i));
@@ -3373,24 +3641,14 @@ void TriggerPanel::acceptTriggers() {
 	ParameterManager* pm = ParameterManager::instancePtr();
 	Logger* log = Logger::instancePtr();
 
-	QList<QTableWidgetItem*> l = __table->selectedItems();
-
 	//! Accept only selected triggers
-	if ( l.size() == 0 ) return;
-
-	QList<TableItem*> sel;
-	for (int i = 0; i < l.size(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(l.at(i));
-		if ( !itm ) continue;
-		sel << itm;
-	}
+	const QList<Trigger*> sel = tableSelection();
+	if ( sel.size() == 0 ) return;
 
 	QStringList acceptedList;
 	QList<Trigger*> accepted;
-	QList<TableItem*> parents;
 	for (int i = 0; i < sel.size(); ++i) {
-		Trigger* trig = reinterpret_cast<Trigger*>(sel.at(i)->object);
-		if ( !trig ) continue;
+		Trigger* trig = sel.at(i);
 		if ( QMessageBox::question(this, tr("Confirmation"),
 		    QString("Are you sure about accepting trigger %1 ?").arg(trig->id()),
 		    QMessageBox::Yes | QMessageBox::Cancel) == QMessageBox::Cancel )
@@ -3401,15 +3659,7 @@ void TriggerPanel::acceptTriggers() {
 		acceptedList << trig->id();
 	}
 
-	for (int i = 0; i < __table->rowCount(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(__table->item(i, 0));
-		QTableWidgetItem* status = __table->item(i, 2);
-		if ( !itm || !status ) continue;
-		Trigger* trig = reinterpret_cast<Trigger*>(itm->object);
-		if ( !trig ) continue;
-
-		status->setText((*trig->status()).string);
-	}
+	__model->updateTriggers(accepted);
 
 	if ( !Utils::dirExists(pm->parameter("XML_ARCHIVE_DIR").toString()) )
 	    if ( !Utils::mkdir(pm->parameter("XML_ARCHIVE_DIR").toString()) )
@@ -3440,38 +3690,15 @@ void TriggerPanel::acceptTriggers() {
 
 void TriggerPanel::removeTriggers() {
 
-	QList<QTableWidgetItem*> l = __table->selectedItems();
-
 	//! Remove only selected triggers
-	if ( l.size() == 0 ) return;
-
-	QList<TableItem*> sel;
-	for (int i = 0; i < l.size(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(l.at(i));
-		if ( !itm ) continue;
-		sel << itm;
-	}
-
-	QList<TableItem*> parents;
-	for (int i = 0; i < sel.size(); ++i) {
-
-		Trigger* trig = reinterpret_cast<Trigger*>(sel.at(i)->object);
-		if ( !trig ) continue;
-
-		removeTrigger(trig);
-		parents << sel.at(i);
-	}
-
-	removeTableRow(__table, parents);
+	dropTriggers(tableSelection());
 }
 
 
 void TriggerPanel::commitTriggers() {
 
-	SDPASSERT(ParameterManager::instancePtr());
 	SDPASSERT(Logger::instancePtr());
 
-	ParameterManager* pm = ParameterManager::instancePtr();
 	Logger* log = Logger::instancePtr();
 
 	//! Commit only reviewed triggers a.k.a. accepted triggers
@@ -3488,61 +3715,45 @@ void TriggerPanel::commitTriggers() {
 	    == QMessageBox::Cancel )
 	    return;
 
-	QString script;
-	script += "#!" + pm->parameter("BASH_BIN").toString() + ENDL;
+	//! Each trigger is dispatched on its own so that it can be retried and
+	//! reported without holding back the others
+	CommitPipeline pipeline;
 	for (int i = 0; i < __commitables.size(); ++i)
-		script += pm->parameter("SEISCOMP_BIN").toString() + " exec scdispatch -O add -i "
-		    + __commitables.at(i).objectFile + " " + pm->parameter("SC_DISPATCH_EXTRA_ARG").toString() + ENDL;
-	script += ENDL;
-
-	const QString commitFile = pm->parameter("XML_ARCHIVE_DIR").toString()
-	    + QDir::separator() + "commit.sh";
-	if ( !Utils::writeScript(commitFile, script) ) {
-		log->addMessage(Logger::WARNING, __func__, "Failed to generate commit script " + commitFile);
-		return;
-	}
+		pipeline.append(__commitables.at(i).object, __commitables.at(i).objectFile);
 
-	CommitDialog d(commitFile, this);
+	CommitDialog d(&pipeline, this);
 	d.exec();
 
-	if ( d.commitReturnCode() == CommitDialog::cdSUCCESS ) {
-
-		QStringList committed;
-		for (int i = 0; i < __commitables.size(); ++i) {
-
-			TableItem* itm = reinterpret_cast<TableItem*>(__commitables.at(i).object->tableWidget());
-			if ( !itm ) continue;
-
-			QTableWidgetItem* ti = __table->item(itm->row(), getHeaderPosition(tSTATUS));
-			if ( !ti ) return;
-
-			__commitables.at(i).object->setStatus(Committed);
-			ti->setText((*__commitables.at(i).object->status()).string);
-			committed << __commitables.at(i).object->id();
-		}
+	log->addMessage(Logger::DEBUG, __func__, QString("%1 trigger(s) committed, %2 failed.")
+	    .arg(pipeline.count(CommitPipeline::cpCOMMITTED))
+	    .arg(pipeline.count(CommitPipeline::cpFAILED)));
 
-		//! Clear the list of triggers to commit after the run
-		__commitables.clear();
-		if ( !committed.isEmpty() ) {
-			emit triggerStatusModified(static_cast<int>(tmCommitted), committed);
-			if ( __autocleanButton->isChecked() )
-			    autocleanTriggers();
-		}
+	//! Committed triggers leave the commit list, the others stay in it so
+	//! that they can be committed again
+	const QList<Trigger*> triggers = pipeline.triggers(CommitPipeline::cpCOMMITTED);
+	const QSet<Trigger*> done = triggers.toSet();
+	QStringList committed;
+	for (int i = 0; i < triggers.size(); ++i) {
+		triggers.at(i)->setStatus(Committed);
+		committed << triggers.at(i)->id();
 	}
 
-	else {
+	for (int i = __commitables.size() - 1; i >= 0; --i)
+		if ( done.contains(__commitables.at(i).object) )
+		    __commitables.removeAt(i);
 
-		for (int i = 0; i < __commitables.size(); ++i) {
+	__model->updateTriggers(triggers);
 
-			TableItem* itm = reinterpret_cast<TableItem*>(__commitables.at(i).object->tableWidget());
-			if ( !itm ) continue;
+	const QList<Trigger*> failed = pipeline.triggers(CommitPipeline::cpFAILED);
+	if ( !failed.isEmpty() )
+	    __model->setNote(failed, " (commit failed)");
 
-			QTableWidgetItem* ti = __table->item(itm->row(), getHeaderPosition(tSTATUS));
-			if ( !ti ) continue;
+	updateButtons();
 
-			ti->setText(QString("%1 (commit failed)")
-			    .arg((*__commitables.at(i).object->status()).string));
-		}
+	if ( !committed.isEmpty() ) {
+		emit triggerStatusModified(static_cast<int>(tmCommitted), committed);
+		if ( __autocleanButton->isChecked() )
+		    autocleanTriggers();
 	}
 }
 
@@ -3552,13 +3763,13 @@ void TriggerPanel::resetTriggers() {
 	SDPASSERT(Logger::instancePtr());
 
 	QStringList reseted;
-	TriggerItems itms = tableSelection();
-	for (TriggerItems::iterator it = itms.begin(); it != itms.end(); ++it) {
-		(*it).trigger->setStatus(WaitingForRevision);
-		(*it).item->setText((*(*it).trigger->status()).string);
-		reseted << (*it).trigger->id();
-		Logger::instancePtr()->addMessage(Logger::INFO, __func__, "Reseted trigger with id " + (*it).trigger->id());
+	const QList<Trigger*> itms = tableSelection();
+	for (int i = 0; i < itms.size(); ++i) {
+		itms.at(i)->setStatus(WaitingForRevision);
+		reseted << itms.at(i)->id();
+		Logger::instancePtr()->addMessage(Logger::INFO, __func__, "Reseted trigger with id " + itms.at(i)->id());
 	}
+	__model->updateTriggers(itms);
 
 	if ( !reseted.isEmpty() )
 	    emit triggerStatusModified(static_cast<int>(tmAwaiting), reseted);
@@ -3566,19 +3777,8 @@ void TriggerPanel::resetTriggers() {
 
 
 void TriggerPanel::autocleanTriggers() {
-
-	QList<TableItem*> items;
-	for (int i = 0; i < __table->rowCount(); ++i) {
-		TableItem* itm = dynamic_cast<TableItem*>(__table->item(i, getHeaderPosition(tCTIME)));
-		QTableWidgetItem* status = __table->item(i, getHeaderPosition(tSTATUS));
-		if ( !itm || !status ) continue;
-		Trigger* trig = reinterpret_cast<Trigger*>(itm->object);
-		if ( !trig ) continue;
-		if ( trig->status() == Committed )
-		    items << itm;
-	}
-
-	removeTableRow(__table, items);
+	//! Committed triggers are kept (and stored) but no longer listed
+	__model->setHideCommitted(__autocleanButton->isChecked());
 }
 
 
@@ -3586,7 +3786,7 @@ void TriggerPanel::triggerSelectionChanged(const QItemSelection& selected,
                                            const QItemSelection&) {
 
 	if ( selected.size() != 0 ) {
-		__ui->webView->show();
+		__previewTabs->show();
 		__acceptButton->setEnabled(true);
 		__rejectButton->setEnabled(true);
 		__removeButton->setEnabled(true);
@@ -3594,7 +3794,8 @@ void TriggerPanel::triggerSelectionChanged(const QItemSelection& selected,
 	else {
 		__ui->textEdit->clear();
 		__ui->labelTriggerID->setText("-");
-		__ui->webView->hide();
+		__waveforms->clear();
+		__previewTabs->hide();
 		__acceptButton->setEnabled(false);
 		__rejectButton->setEnabled(false);
 		__removeButton->setEnabled(false);
@@ -3604,16 +3805,60 @@ void TriggerPanel::triggerSelectionChanged(const QItemSelection& selected,
 }
 
 
-void TriggerPanel::showTriggerOutput(const int& row, const int& col) {
+void TriggerPanel::showTriggerOutput(const QModelIndex& index) {
 
-	Q_UNUSED(col);
-	TableItem* itm = dynamic_cast<TableItem*>(__table->item(row, 0));
-	if ( !itm ) return;
-
-	Trigger* trig = reinterpret_cast<Trigger*>(itm->object);
+	Trigger* trig = __model->trigger(index);
 	if ( !trig ) return;
 
+	const int row = index.row();
+
 	displayTriggerOutput(trig);
+
+	if ( __previewTabs->currentWidget() != __ui->webView ) return;
+
+	//! Draw the snapshots of the next triggers the user is likely to review
+	QStringList snapshots;
+	for (int i = row - SnapshotPrefetchRows; i <= row + SnapshotPrefetchRows; ++i) {
+		Trigger* t = (i != row) ? __model->trigger(__model->index(i, 0)) : NULL;
+		if ( !t ) continue;
+		for (int j = 0; j < t->stations().size(); ++j)
+			snapshots << t->stations().at(j).snapshotFile;
+	}
+	Snapshots::instancePtr()->render(snapshots, true);
+	for (int i = 0; i < snapshots.size(); ++i)
+		if ( QFile::exists(snapshots.at(i)) )
+		    Thumbnails::instancePtr()->file(snapshots.at(i), PreviewWidth);
+}
+
+
+void TriggerPanel::filterTriggers(const QString& text) {
+	__model->setFilter(text);
+}
+
+
+void TriggerPanel::previewTabChanged(int) {
+
+	if ( __previewTabs->currentWidget() != __ui->webView ) return;
+
+	Snapshots::instancePtr()->render(__shownSnapshots);
+	showSnapshots();
+}
+
+
+void TriggerPanel::snapshotsRendered(const QStringList& images) {
+
+	for (int i = 0; i < images.size(); ++i)
+		if ( __shownSnapshots.contains(images.at(i)) ) {
+			showSnapshots();
+			return;
+		}
+}
+
+
+void TriggerPanel::thumbnailReady(const QString& image) {
+
+	if ( __shownSnapshots.contains(image) )
+	    showSnapshots();
 }
 
 
@@ -3656,9 +3901,10 @@ DetectionPanel::DetectionPanel(QWidget* parent) :
 	__tw = new TimeWindowSubPanel(this);
 	__trig = new TriggerSubPanel(this);
 	__stream = new StreamSubPanel(this);
+	__coverage = new CoverageSubPanel(this);
 	__scriptEditor = new ScriptEditor(10, this);
 
-	__widgets << __dataSrc << __inventory << __tw << __trig << __stream;
+	__widgets << __dataSrc << __inventory << __tw << __trig << __stream << __coverage;
 
 	QFrame** line = new QFrame*[__widgets.count() - 1];
 	for (int i = 0; i < __widgets.count() - 1; ++i) {
@@ -3679,6 +3925,8 @@ DetectionPanel::DetectionPanel(QWidget* parent) :
 	l0->addWidget(__trig);
 	l0->addWidget(line[i++]);
 	l0->addWidget(__inventory);
+	l0->addWidget(line[i++]);
+	l0->addWidget(__coverage);
 
 	QVBoxLayout* l1 = new QVBoxLayout(__ui->widgetScript);
 	l1->setMargin(0);
@@ -3801,7 +4049,7 @@ void DetectionPanel::generateScript() {
 
 	//! Add the trigger info dynamically
 	QString trigInfoFile = w->parameter("TRIGGER_INFO_FILE").toString();
-	trigInfoFile.replace("@TRIGGER_DATETIME@", "\" + str(trig[it]['time']) + \"");
+	trigInfoFile.replace("@TRIGGER_DATETIME@", "\" + str(trigTime) + \"");
 
 	//! At the time of this version of ObsPy, it is said that the coincidence
 	//! trigger is to be used for stations from a sole network (the API is
@@ -3832,8 +4080,12 @@ void DetectionPanel::generateScript() {
 	script += "from obspy.core import UTCDateTime, Stream, read" + ENDL;
 	script += "from obspy.arclink import Client" + ENDL;
 	script += "from obspy.signal import coincidenceTrigger" + ENDL;
-	script += "import matplotlib.pyplot as plt" + ENDL;
-	script += "import datetime" + ENDL;
+	if ( w->parameter("dataSourceArchive").toBool() ) {
+		script += "from io import BytesIO" + ENDL;
+		script += "import glob, re, struct" + ENDL;
+	}
+	script += "import os, subprocess" + ENDL;
+	script += "import datetime, bisect" + ENDL;
 	script += ENDL;
 	script += "\"\"\" Setup script locale \"\"\"" + ENDL;
 	script += "locale.setlocale(locale.LC_ALL, 'en_US.UTF-8')" + ENDL;
@@ -3852,6 +4104,72 @@ void DetectionPanel::generateScript() {
 	script += "tmpDataDir = \"@JOB_RUN_DIR@\"" + ENDL;
 	script += "logFile = tmpDataDir + \"detect.log\"" + ENDL;
 	script += "orgExportFile = tmpDataDir + \"triggers.txt\"" + ENDL;
+	script += ENDL;
+	//! Filters mssnap applies like the detection does, others are drawn right away
+	QString snapFilter = "none";
+	if ( w->parameter("Config-Filter-Enabled").toBool() ) {
+		const QString name = w->parameter("Config-Filter-Name").toString();
+		const QString fmin = QString::number(w->parameter("Config-Filter-FreqMin").toDouble());
+		const QString fmax = QString::number(w->parameter("Config-Filter-FreqMax").toDouble());
+		if ( name == "bandpass" )
+			snapFilter = QString("bandpass:%1:%2").arg(fmin).arg(fmax);
+		else if ( name == "lowpass" || name == "highpass" )
+			snapFilter = QString("%1:%2").arg(name).arg(fmin);
+		else
+			snapFilter.clear();
+	}
+
+	script += "\"\"\" Trigger snapshots are drawn by mssnap when they are first viewed, the" + ENDL;
+	script += "    run only records the data they are drawn from. Without mssnap they are" + ENDL;
+	script += "    drawn right away with matplotlib. \"\"\"" + ENDL;
+	script += "snapBin = \"" + w->parameter("MSSNAP_BIN").toString() + "\"" + ENDL;
+	script += "snapIndex = tmpDataDir + \"snapshots.ref\"" + ENDL;
+	script += "snapFilter = \"" + snapFilter + "\"" + ENDL;
+	script += "lazySnapshots = bool(snapFilter) and os.access(snapBin, os.X_OK)" + ENDL;
+	script += "if not lazySnapshots:" + ENDL;
+	script += TAB + "import matplotlib.pyplot as plt" + ENDL;
+	script += ENDL;
+	script += "def snapshot(tr, on, off, pltName):" + ENDL;
+	script += TAB + "title = tr.stats.network + \"-\" + tr.stats.station + \"-\" + tr.stats.location + \"-\" + tr.stats.channel" + ENDL;
+	script += TAB + "if lazySnapshots:" + ENDL;
+	script += TAB + TAB + "# REF start end on off NET.STA.LOC.CHA filter image file [file ...]" + ENDL;
+	script += TAB + TAB + "files = dataFiles(tr)" + ENDL;
+	script += TAB + TAB + "if not files:" + ENDL;
+	script += TAB + TAB + TAB + "error(\" No data file to draw trigger snapshot \" + pltName + \" from\")" + ENDL;
+	script += TAB + TAB + TAB + "return" + ENDL;
+	script += TAB + TAB + "fields = [\"REF\", \"%.6f\" % tr.stats.starttime.timestamp, \"%.6f\" % tr.stats.endtime.timestamp," + ENDL;
+	script += TAB + TAB + "          \"%.6f\" % on, \"%.6f\" % off, tr.id, snapFilter, pltName] + files" + ENDL;
+	script += TAB + TAB + "try:" + ENDL;
+	script += TAB + TAB + TAB + "with open(snapIndex, \"a\") as f:" + ENDL;
+	script += TAB + TAB + TAB + TAB + "f.write(\"\\t\".join(fields) + \"\\n\")" + ENDL;
+	script += TAB + TAB + TAB + "debug(\" Recorded trigger snapshot \" + pltName)" + ENDL;
+	script += TAB + TAB + "except Exception as e:" + ENDL;
+	script += TAB + TAB + TAB + "error(\" Failed to record trigger snapshot \" + pltName + \" - \" + str(e))" + ENDL;
+	script += TAB + TAB + "return" + ENDL;
+	script += ENDL;
+	script += TAB + "# Stream sampling rate" + ENDL;
+	script += TAB + "df = tr.stats.sampling_rate" + ENDL;
+	script += ENDL;
+	script += TAB + "# Add raw spectrograph" + ENDL;
+	script += TAB + "first = plt.subplot(211)" + ENDL;
+	script += TAB + "first.set_title(title)" + ENDL;
+	script += TAB + "plt.plot(tr.data, 'k')" + ENDL;
+	script += TAB + "ymin, ymax = first.get_ylim()" + ENDL;
+	script += TAB + "plt.vlines(on * df, ymin, ymax, color='r', linewidth=2)" + ENDL;
+	script += TAB + "plt.vlines(off * df, ymin, ymax, color='b', linewidth=2)" + ENDL;
+	script += TAB + "plt.axis('tight')" + ENDL;
+	script += ENDL;
+	script += TAB + "# Add raw spectrogram" + ENDL;
+	script += TAB + "second = plt.subplot(212)" + ENDL;
+	script += TAB + "plt.specgram(tr.data)" + ENDL;
+	script += TAB + "plt.axis('tight')" + ENDL;
+	script += ENDL;
+	script += TAB + "plt.savefig(pltName, bbox_inches='tight', pad_inches=0)" + ENDL;
+	script += TAB + "debug(\" Created trigger snapshot \" + pltName)" + ENDL;
+	script += ENDL;
+	script += TAB + "# Clear the current figure so that it will not be pasted" + ENDL;
+	script += TAB + "# to the next one" + ENDL;
+	script += TAB + "plt.clf()" + ENDL;
 
 	if ( w->parameter("dataSourceFile").toBool() ) {
 
@@ -3861,6 +4179,10 @@ void DetectionPanel::generateScript() {
 		script += ENDL;
 		script += "st = read(filename)" + ENDL;
 		script += ENDL;
+		script += "def dataFiles(tr):" + ENDL;
+		script += TAB + "\"\"\" Files holding the data of a trace \"\"\"" + ENDL;
+		script += TAB + "return [os.path.abspath(filename)]" + ENDL;
+		script += ENDL;
 		script += "# List of stations and corresponding networks" + ENDL;
 		script += __inventory->pythonStations("networkCodes", "stationCodes");
 		script += ENDL;
@@ -3885,6 +4207,188 @@ void DetectionPanel::generateScript() {
 	}
 
 
+	else if ( w->parameter("dataSourceArchive").toBool() ) {
+
+		QStringList chanList = chans.split(',');
+		QString channelCodes;
+		for (int j = 0; j < chanList.size(); ++j)
+			channelCodes += QString((j == 0) ? "" : ", ") + "\"" + chanList.at(j).trimmed() + "\"";
+
+		script += ENDL;
+		script += "\"\"\" The SDS archive to be analyzed \"\"\"" + ENDL;
+		script += "archiveDir = \"" + w->parameter("dataSourceArchiveDir").toString() + "\"" + ENDL;
+		script += "archivePattern = \"" + w->parameter("dataSourceArchivePattern").toString() + "\"" + ENDL;
+		script += "useSidecar = " + QString(w->parameter("dataSourceArchiveSidecar").toBool() ? "True" : "False") + ENDL;
+		script += ENDL;
+		script += "# The stream's start and end times" + ENDL;
+		script += "streamStart = UTCDateTime(\"" + w->parameter("streamStartTime").toString() + "\")" + ENDL;
+		script += "streamEnd = UTCDateTime(\"" + w->parameter("streamEndTime").toString() + "\")" + ENDL;
+		script += ENDL;
+		script += "# The length per sample to be analyzed" + ENDL;
+		script += "period = " + w->parameter("streamSampleDuration").toString() + ENDL;
+		script += ENDL;
+		script += "# List of stations and corresponding networks" + ENDL;
+		script += __inventory->pythonStations("networkCodes", "stationCodes");
+		script += "channelCodes = [ " + channelCodes + " ]" + ENDL;
+		script += ENDL;
+		script += ENDL;
+		script += "def archiveFiles(netCode, staCode, chanCode, start, end):" + ENDL;
+		script += TAB + "\"\"\" Files of the archive layout that may hold data from start to end." + ENDL;
+		script += TAB + "    Records are filed by start time, the file preceding start is looked" + ENDL;
+		script += TAB + "    up for a record overlapping it. \"\"\"" + ENDL;
+		script += TAB + "step = 3600 if re.search(\"[%#]H\", archivePattern) else 86400" + ENDL;
+		script += TAB + "t = UTCDateTime(int((start.timestamp - 3600) // step) * step)" + ENDL;
+		script += TAB + "files = []" + ENDL;
+		script += TAB + "while t <= end:" + ENDL;
+		script += TAB + TAB + "values = { \"n\": netCode, \"s\": staCode, \"l\": \"*\", \"c\": chanCode," + ENDL;
+		script += TAB + TAB + "           \"Y\": \"%04d\" % t.year, \"y\": \"%02d\" % (t.year % 100)," + ENDL;
+		script += TAB + TAB + "           \"j\": \"%03d\" % t.julday, \"H\": \"%02d\" % t.hour, \"%\": \"%\" }" + ENDL;
+		script += TAB + TAB + "path = re.sub(\"[%#](.)\", lambda m: values.get(m.group(1), \"*\"), archivePattern)" + ENDL;
+		script += TAB + TAB + "for f in sorted(glob.glob(os.path.join(archiveDir, path))):" + ENDL;
+		script += TAB + TAB + TAB + "if f not in files:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "files.append(f)" + ENDL;
+		script += TAB + TAB + "t += step" + ENDL;
+		script += TAB + "return files" + ENDL;
+		script += ENDL;
+		script += "# Sidecar indexes and whole streams of the archive files in use" + ENDL;
+		script += "sidecars = {}" + ENDL;
+		script += "fileStreams = {}" + ENDL;
+		script += ENDL;
+		script += "def sidecarIndex(path):" + ENDL;
+		script += TAB + "\"\"\" Records of path from the libmseed sidecar index (.<file>.msidx) written" + ENDL;
+		script += TAB + "    by msi -wi and msmod -wi, loaded once per size and modification time of" + ENDL;
+		script += TAB + "    the file. Per stream the record start times, the running maximum of the" + ENDL;
+		script += TAB + "    end times and the (offset, length, end) of each record, in start time" + ENDL;
+		script += TAB + "    order. Returns None if there is no current index. \"\"\"" + ENDL;
+		script += TAB + "try:" + ENDL;
+		script += TAB + TAB + "info = os.stat(path)" + ENDL;
+		script += TAB + "except OSError:" + ENDL;
+		script += TAB + TAB + "return None" + ENDL;
+		script += TAB + "key = (info.st_size, getattr(info, \"st_mtime_ns\", info.st_mtime))" + ENDL;
+		script += TAB + "cached = sidecars.get(path)" + ENDL;
+		script += TAB + "if cached is not None and cached[0] == key:" + ENDL;
+		script += TAB + TAB + "return cached[1]" + ENDL;
+		script += TAB + "index = os.path.join(os.path.dirname(path), \".\" + os.path.basename(path) + \".msidx\")" + ENDL;
+		script += TAB + "streams = None" + ENDL;
+		script += TAB + "try:" + ENDL;
+		script += TAB + TAB + "with open(index, \"rb\") as f:" + ENDL;
+		script += TAB + TAB + TAB + "magic, order, count, size, mtime, total = struct.unpack(\"=8sIiqqq\", f.read(40))" + ENDL;
+		script += TAB + TAB + TAB + "if magic == b\"MSFIDX01\" and order == 0x01020304 and size == info.st_size \\" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "and mtime // 1000000000 == int(info.st_mtime) and mtime == getattr(info, \"st_mtime_ns\", mtime):" + ENDL;
+		script += TAB + TAB + TAB + TAB + "counts = [struct.unpack(\"=48sq\", f.read(56))[1] for i in range(count)]" + ENDL;
+		script += TAB + TAB + TAB + TAB + "data = f.read(total * 40)" + ENDL;
+		script += TAB + TAB + TAB + TAB + "if sum(counts) == total and len(data) == total * 40:" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "streams = []" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "i = 0" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "for n in counts:" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "starts, maxEnds, records = [], [], []" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "for j in range(i, i + n):" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + TAB + "offset, rstart, rend, samples, reclen, reserved = struct.unpack_from(\"=qqqqii\", data, j * 40)" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + TAB + "starts.append(rstart)" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + TAB + "maxEnds.append(max(rend, maxEnds[-1]) if maxEnds else rend)" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + TAB + "records.append((offset, reclen, rend))" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "streams.append((starts, maxEnds, records))" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "i += n" + ENDL;
+		script += TAB + "except (IOError, OSError, struct.error):" + ENDL;
+		script += TAB + TAB + "streams = None" + ENDL;
+		script += TAB + "sidecars[path] = (key, streams)" + ENDL;
+		script += TAB + "return streams" + ENDL;
+		script += ENDL;
+		script += "def sidecarRecords(path, start, end):" + ENDL;
+		script += TAB + "\"\"\" Offsets and lengths of the records of path overlapping start to end," + ENDL;
+		script += TAB + "    bisected out of its sidecar index. Returns None if there is no current" + ENDL;
+		script += TAB + "    index. \"\"\"" + ENDL;
+		script += TAB + "streams = sidecarIndex(path)" + ENDL;
+		script += TAB + "if streams is None:" + ENDL;
+		script += TAB + TAB + "return None" + ENDL;
+		script += TAB + "t1 = int(round(start.timestamp * 1000000))" + ENDL;
+		script += TAB + "t2 = int(round(end.timestamp * 1000000))" + ENDL;
+		script += TAB + "records = []" + ENDL;
+		script += TAB + "for starts, maxEnds, entries in streams:" + ENDL;
+		script += TAB + TAB + "for i in range(bisect.bisect_left(maxEnds, t1), bisect.bisect_right(starts, t2)):" + ENDL;
+		script += TAB + TAB + TAB + "if entries[i][2] >= t1:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "records.append(entries[i][:2])" + ENDL;
+		script += TAB + "records.sort()" + ENDL;
+		script += TAB + "return records" + ENDL;
+		script += ENDL;
+		script += "def fileStream(path):" + ENDL;
+		script += TAB + "\"\"\" The whole content of path, read once per size and modification time of" + ENDL;
+		script += TAB + "    the file and sliced by the analysis windows. \"\"\"" + ENDL;
+		script += TAB + "info = os.stat(path)" + ENDL;
+		script += TAB + "key = (info.st_size, getattr(info, \"st_mtime_ns\", info.st_mtime))" + ENDL;
+		script += TAB + "cached = fileStreams.get(path)" + ENDL;
+		script += TAB + "if cached is None or cached[0] != key:" + ENDL;
+		script += TAB + TAB + "cached = (key, read(path, format=\"MSEED\"))" + ENDL;
+		script += TAB + TAB + "fileStreams[path] = cached" + ENDL;
+		script += TAB + "return cached[1]" + ENDL;
+		script += ENDL;
+		script += "def dataFiles(tr):" + ENDL;
+		script += TAB + "\"\"\" Files holding the data of a trace \"\"\"" + ENDL;
+		script += TAB + "return [os.path.abspath(f) for f in archiveFiles(tr.stats.network, tr.stats.station," + ENDL;
+		script += TAB + "        tr.stats.channel, tr.stats.starttime, tr.stats.endtime)]" + ENDL;
+		script += ENDL;
+		script += "def readArchive(start, end):" + ENDL;
+		script += TAB + "\"\"\" Reads the records of the stations overlapping start to end straight" + ENDL;
+		script += TAB + "    from the archive files. \"\"\"" + ENDL;
+		script += TAB + "files = []" + ENDL;
+		script += TAB + "for netCode, staCode in zip(networkCodes, stationCodes):" + ENDL;
+		script += TAB + TAB + "for chanCode in channelCodes:" + ENDL;
+		script += TAB + TAB + TAB + "for f in archiveFiles(netCode, staCode, chanCode, start, end):" + ENDL;
+		script += TAB + TAB + TAB + TAB + "if f not in files:" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "files.append(f)" + ENDL;
+		script += TAB + "# Windows move forward, files left behind are not read again" + ENDL;
+		script += TAB + "for cache in (sidecars, fileStreams):" + ENDL;
+		script += TAB + TAB + "for path in list(cache.keys()):" + ENDL;
+		script += TAB + TAB + TAB + "if path not in files:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "del cache[path]" + ENDL;
+		script += TAB + "st = Stream()" + ENDL;
+		script += TAB + "for path in files:" + ENDL;
+		script += TAB + TAB + "records = sidecarRecords(path, start, end) if useSidecar else None" + ENDL;
+		script += TAB + TAB + "try:" + ENDL;
+		script += TAB + TAB + TAB + "if records is None:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "st += fileStream(path).slice(start, end).copy()" + ENDL;
+		script += TAB + TAB + TAB + "elif records:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "buf = BytesIO()" + ENDL;
+		script += TAB + TAB + TAB + TAB + "with open(path, \"rb\") as f:" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + "for offset, length in records:" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "f.seek(offset)" + ENDL;
+		script += TAB + TAB + TAB + TAB + TAB + TAB + "buf.write(f.read(length))" + ENDL;
+		script += TAB + TAB + TAB + TAB + "buf.seek(0)" + ENDL;
+		script += TAB + TAB + TAB + TAB + "st += read(buf, format=\"MSEED\", starttime=start, endtime=end)" + ENDL;
+		script += TAB + TAB + "except Exception as e:" + ENDL;
+		script += TAB + TAB + TAB + "error(\"    Failed: \" + path + \" - \" + str(e))" + ENDL;
+		script += TAB + "# Join the pieces of a stream read from consecutive files" + ENDL;
+		script += TAB + "try:" + ENDL;
+		script += TAB + TAB + "st.merge(method=-1)" + ENDL;
+		script += TAB + "except Exception:" + ENDL;
+		script += TAB + TAB + "pass" + ENDL;
+		script += TAB + "return st" + ENDL;
+		script += ENDL;
+		script += ENDL;
+		script += "debug(\"===================================================================\")" + ENDL;
+		script += "debug(\"Reading data from \" + str(streamStart) + \" to \" + str(streamEnd) + \" in \" + archiveDir)" + ENDL;
+		script += ENDL;
+		script += "hasStream = False" + ENDL;
+		script += "for netCode, staCode in zip(networkCodes, stationCodes):" + ENDL;
+		script += TAB + "for chanCode in channelCodes:" + ENDL;
+		script += TAB + TAB + "if archiveFiles(netCode, staCode, chanCode, streamStart, streamEnd):" + ENDL;
+		script += TAB + TAB + TAB + "hasStream = True" + ENDL;
+		script += ENDL;
+		script += "if not hasStream:" + ENDL;
+		script += TAB + "error(\"===================================================================\")" + ENDL;
+		script += TAB + "error(\"No archive file found for the stations, exiting script...\")" + ENDL;
+		script += TAB + "error(\"===================================================================\")" + ENDL;
+		script += TAB + "sys.exit(1)" + ENDL;
+		script += ENDL;
+		script += ENDL;
+		script += "\"\"\"" + ENDL;
+		script += TAB + "Analyze archive data window by window with the coincidence trigger and" + ENDL;
+		script += TAB + "output anything that come close to an origin into a origin file. This" + ENDL;
+		script += TAB + "file will be validated by the user afterwards." + ENDL;
+		script += "\"\"\"" + ENDL;
+	}
+
+
 	else {
 
 		script += "filename = tmpDataDir + \"data.mseed\"" + ENDL;
@@ -3920,29 +4424,92 @@ void DetectionPanel::generateScript() {
 		script += __inventory->pythonStations("networkCodes", "stationCodes");
 		script += ENDL;
 		script += ENDL;
-		script += "# Establish connection to Arclink server" + ENDL;
-		script += "client = Client(host=serverAddress, port=serverPort, user=\"script@sdp\")" + ENDL;
+		script += "# Fetcher running concurrent requests, stations are read as soon" + ENDL;
+		script += "# as they are fetched while the others are still being requested" + ENDL;
+		script += "fetchBin = \"" + w->parameter("MSFETCH_BIN").toString() + "\"" + ENDL;
+		script += "fetchConnections = " + w->parameter("FETCH_CONNECTIONS").toString() + ENDL;
+		script += "fetchUser = \"" + w->parameter("ARCLINK_USER").toString() + "\"" + ENDL;
+		script += "fetchPassword = \"" + w->parameter("ARCLINK_PASSWORD").toString() + "\"" + ENDL;
+		script += "fetchCacheDir = \"" + w->parameter("FETCH_CACHE_DIR").toString() + "\"" + ENDL;
+		script += "fetchCacheSize = " + w->parameter("FETCH_CACHE_SIZE").toString() + ENDL;
+		script += "fetched = False" + ENDL;
+		script += "fetchedFiles = {}" + ENDL;
+		script += ENDL;
+		script += "def dataFiles(tr):" + ENDL;
+		script += TAB + "\"\"\" Files holding the data of a trace \"\"\"" + ENDL;
+		script += TAB + "if fetched:" + ENDL;
+		script += TAB + TAB + "return fetchedFiles.get(tr.stats.network + \".\" + tr.stats.station, [])" + ENDL;
+		script += TAB + "return [os.path.abspath(filename)]" + ENDL;
 		script += ENDL;
 		script += "debug(\"===================================================================\")" + ENDL;
 		script += "debug(\"Preparing to fetch data from \" + str(streamStart) + \" to \" + str(streamEnd))" + ENDL;
 		script += ENDL;
-		script += "if not client:" + ENDL;
-		script += TAB + "error(\"Connection to Arclink server'\" + serverAddress +" + ENDL;
-		script += "                     \":\" + str(serverPort) + \"' could not be established\")" + ENDL;
-		script += TAB + "sys.exit(errno.EACCES)" + ENDL;
+		script += "if os.access(fetchBin, os.X_OK):" + ENDL;
+		script += TAB + "fetchDir = tmpDataDir + \"fetch\"" + ENDL;
+		script += TAB + "if not os.path.isdir(fetchDir):" + ENDL;
+		script += TAB + TAB + "os.makedirs(fetchDir)" + ENDL;
 		script += ENDL;
-		script += "debug(\"Sent request to Arclink server, now awaiting data...\")" + ENDL;
-		script += "debug(\"-------------------------------------------------------------------\")" + ENDL;
+		script += TAB + "args = [fetchBin, \"-S\", serverAddress + \":\" + str(serverPort)," + ENDL;
+		script += TAB + "        \"-u\", fetchUser, \"-j\", str(fetchConnections), \"-C\", \"" + chans + "\"," + ENDL;
+		script += TAB + "        \"-ts\", streamStart.strftime(\"%Y-%m-%dT%H:%M:%S\")," + ENDL;
+		script += TAB + "        \"-te\", streamEnd.strftime(\"%Y-%m-%dT%H:%M:%S\"), \"-o\", fetchDir]" + ENDL;
+		script += TAB + "if fetchPassword:" + ENDL;
+		script += TAB + TAB + "args += [\"-p\", fetchPassword]" + ENDL;
+		script += TAB + "# Cached data is linked into the fetch dir instead of being requested" + ENDL;
+		script += TAB + "if fetchCacheDir:" + ENDL;
+		script += TAB + TAB + "args += [\"-c\", fetchCacheDir, \"-cs\", str(fetchCacheSize)]" + ENDL;
+		script += TAB + "for netCode, staCode in zip(networkCodes, stationCodes):" + ENDL;
+		script += TAB + TAB + "args += [\"-s\", netCode + \".\" + staCode]" + ENDL;
 		script += ENDL;
-		script += "for netCode, staCode in zip(networkCodes, stationCodes):" + ENDL;
+		script += TAB + "debug(\"Sent requests to Arclink server, now awaiting data...\")" + ENDL;
+		script += TAB + "debug(\"-------------------------------------------------------------------\")" + ENDL;
+		script += ENDL;
+		script += TAB + "# One line per station: OK|NODATA|FAILED NET.STA records file [file ...]" + ENDL;
+		script += TAB + "fetcher = subprocess.Popen(args, stdout=subprocess.PIPE)" + ENDL;
+		script += TAB + "for line in iter(fetcher.stdout.readline, b\"\"):" + ENDL;
+		script += TAB + TAB + "fields = line.decode().split()" + ENDL;
+		script += TAB + TAB + "if len(fields) < 4:" + ENDL;
+		script += TAB + TAB + TAB + "continue" + ENDL;
+		script += TAB + TAB + "if fields[0] != \"OK\":" + ENDL;
+		script += TAB + TAB + TAB + "error(\"Failed: \" + fields[1] + \" - \" + fields[0])" + ENDL;
+		script += TAB + TAB + TAB + "continue" + ENDL;
+		script += TAB + TAB + "try:" + ENDL;
+		script += TAB + TAB + TAB + "debug(\"Received \" + fields[2] + \" records for \" + fields[1])" + ENDL;
+		script += TAB + TAB + TAB + "for path in fields[3:]:" + ENDL;
+		script += TAB + TAB + TAB + TAB + "st += read(path, format=\"MSEED\")" + ENDL;
+		script += TAB + TAB + TAB + "fetchedFiles[fields[1]] = [os.path.abspath(path) for path in fields[3:]]" + ENDL;
+		script += TAB + TAB + "except Exception as e:" + ENDL;
+		script += TAB + TAB + TAB + "error(\"Failed: \" + fields[1] + \" - \" + str(e))" + ENDL;
+		script += TAB + "fetcher.wait()" + ENDL;
+		script += ENDL;
+		script += TAB + "# Cached chunks of consecutive hours share the records across them" + ENDL;
+		script += TAB + "try:" + ENDL;
+		script += TAB + TAB + "st.merge(method=-1)" + ENDL;
+		script += TAB + "except Exception as e:" + ENDL;
+		script += TAB + TAB + "error(\"Failed to merge fetched streams - \" + str(e))" + ENDL;
+		script += TAB + "fetched = True" + ENDL;
+		script += ENDL;
+		script += "else:" + ENDL;
+		script += TAB + "# Establish connection to Arclink server" + ENDL;
+		script += TAB + "client = Client(host=serverAddress, port=serverPort, user=\"script@sdp\")" + ENDL;
+		script += ENDL;
+		script += TAB + "if not client:" + ENDL;
+		script += TAB + TAB + "error(\"Connection to Arclink server'\" + serverAddress +" + ENDL;
+		script += TAB + "                     \":\" + str(serverPort) + \"' could not be established\")" + ENDL;
+		script += TAB + TAB + "sys.exit(errno.EACCES)" + ENDL;
+		script += ENDL;
+		script += TAB + "debug(\"Sent request to Arclink server, now awaiting data...\")" + ENDL;
+		script += TAB + "debug(\"-------------------------------------------------------------------\")" + ENDL;
+		script += ENDL;
+		script += TAB + "for netCode, staCode in zip(networkCodes, stationCodes):" + ENDL;
 
 		QStringList chanList = chans.split(',');
 		for (int j = 0; j < chanList.size(); ++j) {
-			script += TAB + "try:" + ENDL;
-			script += TAB + TAB + "debug(\"Requesting data for \" + netCode + \"/\" + staCode)" + ENDL;
-			script += TAB + TAB + "st += client.getWaveform(netCode, staCode, \"*\", \"" + chanList.at(j) + "\", streamStart, streamEnd, route=False)" + ENDL;
-			script += TAB + "except Exception as e:" + ENDL;
-			script += TAB + TAB + "error(\"Failed: \" + netCode + \"/\" + staCode + \" - \" + str(e))" + ENDL;
+			script += TAB + TAB + "try:" + ENDL;
+			script += TAB + TAB + TAB + "debug(\"Requesting data for \" + netCode + \"/\" + staCode)" + ENDL;
+			script += TAB + TAB + TAB + "st += client.getWaveform(netCode, staCode, \"*\", \"" + chanList.at(j) + "\", streamStart, streamEnd, route=False)" + ENDL;
+			script += TAB + TAB + "except Exception as e:" + ENDL;
+			script += TAB + TAB + TAB + "error(\"Failed: \" + netCode + \"/\" + staCode + \" - \" + str(e))" + ENDL;
 			script += ENDL;
 		}
 		script += ENDL;
@@ -3955,10 +4522,12 @@ void DetectionPanel::generateScript() {
 		script += TAB + "  data. See if we've got something to sink our teeth in!" + ENDL;
 		script += "\"\"\"" + ENDL;
 		script += ENDL;
+		script += "# Data fetched with msfetch is already in the fetch dir" + ENDL;
 		script += "if st.count() > 0:" + ENDL;
-		script += TAB + "debug(\"-------------------------------------------------------------------\")" + ENDL;
-		script += TAB + "debug(\"Writing down temp data to \" + filename)" + ENDL;
-		script += TAB + "st.write(filename, format='MSEED')" + ENDL;
+		script += TAB + "if not fetched:" + ENDL;
+		script += TAB + TAB + "debug(\"-------------------------------------------------------------------\")" + ENDL;
+		script += TAB + TAB + "debug(\"Writing down temp data to \" + filename)" + ENDL;
+		script += TAB + TAB + "st.write(filename, format='MSEED')" + ENDL;
 		script += TAB + "hasStream = True" + ENDL;
 		script += ENDL;
 		script += ENDL;
@@ -3984,6 +4553,19 @@ void DetectionPanel::generateScript() {
 	script += "tStart = streamStart" + ENDL;
 	script += "trigTotal = 0" + ENDL;
 	script += ENDL;
+	script += "\"\"\" Overlapping windows report an event more than once, a trigger within" + ENDL;
+	script += "    mergeTolerance seconds of a reported one is merged into it. Reported" + ENDL;
+	script += "    times are kept sorted so that each lookup is a binary search. \"\"\"" + ENDL;
+	script += "mergeTolerance = " + QString::number(w->parameter("TRIGGER_MERGE_TOLERANCE").toDouble()) + ENDL;
+	script += "reportedTimes = []" + ENDL;
+	script += "reportedStreams = {}" + ENDL;
+	script += ENDL;
+	script += "def reportedTrigger(time):" + ENDL;
+	script += TAB + "idx = bisect.bisect_left(reportedTimes, time - mergeTolerance)" + ENDL;
+	script += TAB + "if idx < len(reportedTimes) and reportedTimes[idx] - time <= mergeTolerance:" + ENDL;
+	script += TAB + TAB + "return reportedTimes[idx]" + ENDL;
+	script += TAB + "return None" + ENDL;
+	script += ENDL;
 	script += ENDL;
 	script += "debug(\"-------------------------------------------------------------------\")" + ENDL;
 	script += "debug(\"Iterations will run from \" + str(streamStart) + \" to \" + str(streamEnd))" + ENDL;
@@ -4008,15 +4590,39 @@ void DetectionPanel::generateScript() {
 	script += TAB + "debug(\"[\" + str(loopCount) + \"] Analysis from \" + str(nstart) + \" to \" + str(nend))" + ENDL;
 	script += ENDL;
 	script += TAB + "trace = Stream()" + ENDL;
-	script += TAB + "try:" + ENDL;
-	script += TAB + TAB + "trace = read(filename, starttime=nstart, endtime=nend)" + ENDL;
-	script += TAB + "except Exception as e:" + ENDL;
-	script += TAB + TAB + "error(\"    Failed: \" + str(e))" + ENDL;
-	script += ENDL;
-	script += TAB + "if not trace:" + ENDL;
-	script += TAB + TAB + "error(\"Datafile \" + filename + \" is not readable\")" + ENDL;
-	script += TAB + TAB + "sys.exit(errno.EACCES)" + ENDL;
-	script += ENDL;
+	if ( w->parameter("dataSourceArchive").toBool() ) {
+		//! A window without data in the archive is a gap, not an error
+		script += TAB + "trace = readArchive(nstart, nend)" + ENDL;
+		script += ENDL;
+		script += TAB + "if not trace:" + ENDL;
+		script += TAB + TAB + "debug(\" No data in archive for this window\")" + ENDL;
+		script += TAB + TAB + "tStart += period" + ENDL;
+		script += TAB + TAB + "loopCount += 1" + ENDL;
+		script += TAB + TAB + "continue" + ENDL;
+		script += ENDL;
+	}
+	else if ( !w->parameter("dataSourceFile").toBool() ) {
+		//! Arclink data is kept in memory, windows are not read back
+		script += TAB + "trace = st.slice(nstart, nend).copy()" + ENDL;
+		script += ENDL;
+		script += TAB + "if not trace:" + ENDL;
+		script += TAB + TAB + "debug(\" No data for this window\")" + ENDL;
+		script += TAB + TAB + "tStart += period" + ENDL;
+		script += TAB + TAB + "loopCount += 1" + ENDL;
+		script += TAB + TAB + "continue" + ENDL;
+		script += ENDL;
+	}
+	else {
+		script += TAB + "try:" + ENDL;
+		script += TAB + TAB + "trace = read(filename, starttime=nstart, endtime=nend)" + ENDL;
+		script += TAB + "except Exception as e:" + ENDL;
+		script += TAB + TAB + "error(\"    Failed: \" + str(e))" + ENDL;
+		script += ENDL;
+		script += TAB + "if not trace:" + ENDL;
+		script += TAB + TAB + "error(\"Datafile \" + filename + \" is not readable\")" + ENDL;
+		script += TAB + TAB + "sys.exit(errno.EACCES)" + ENDL;
+		script += ENDL;
+	}
 	script += TAB + "fsel = trace.select(channel=\"" + chans + "\")" + ENDL;
 	script += TAB + "debug(\" \" + str(fsel.count()) + \" stream(s) to be checked out\")" + ENDL;
 	script += ENDL;
@@ -4064,17 +4670,27 @@ void DetectionPanel::generateScript() {
 	script += ENDL;
 	script += TAB + TAB + "for it in range(0, trigCount):" + ENDL;
 	script += ENDL;
-	script += TAB + TAB + TAB + "trigTotal += 1" + ENDL;
 	script += TAB + TAB + TAB + "debug(\" Possible event at \" + str(trig[it]['time']))" + ENDL;
 	script += TAB + TAB + TAB + "debug(\" stations = \" + str(trig[it]['stations']))" + ENDL;
 	script += ENDL;
-	script += TAB + TAB + TAB + "# Add new origin line into run trigger file" + ENDL;
-	script += TAB + TAB + TAB + "with open(orgExportFile, \"a\") as ofile:" + ENDL;
-	script += TAB + TAB + TAB + TAB + "ofile.write(\"%s\\n\" % str(trig[it]['time']))" + ENDL;
-	script += TAB + TAB + TAB + TAB + "debug(\" Added record of trigger at \" + str(trig[it]['time']) + \" into trigger file.\")" + ENDL;
+	script += TAB + TAB + TAB + "trigTime = reportedTrigger(trig[it]['time'])" + ENDL;
+	script += TAB + TAB + TAB + "if trigTime is None:" + ENDL;
+	script += TAB + TAB + TAB + TAB + "trigTotal += 1" + ENDL;
+	script += TAB + TAB + TAB + TAB + "trigTime = trig[it]['time']" + ENDL;
+	script += TAB + TAB + TAB + TAB + "bisect.insort(reportedTimes, trigTime)" + ENDL;
+	script += TAB + TAB + TAB + TAB + "reportedStreams[str(trigTime)] = set()" + ENDL;
+	script += TAB + TAB + TAB + TAB + "infoMode = \"w\"" + ENDL;
+	script += ENDL;
+	script += TAB + TAB + TAB + TAB + "# Add new origin line into run trigger file" + ENDL;
+	script += TAB + TAB + TAB + TAB + "with open(orgExportFile, \"a\") as ofile:" + ENDL;
+	script += TAB + TAB + TAB + TAB + TAB + "ofile.write(\"%s\\n\" % str(trigTime))" + ENDL;
+	script += TAB + TAB + TAB + TAB + TAB + "debug(\" Added record of trigger at \" + str(trigTime) + \" into trigger file.\")" + ENDL;
+	script += TAB + TAB + TAB + "else:" + ENDL;
+	script += TAB + TAB + TAB + TAB + "infoMode = \"a\"" + ENDL;
+	script += TAB + TAB + TAB + TAB + "debug(\" Merged into trigger at \" + str(trigTime))" + ENDL;
 	script += ENDL;
 	script += TAB + TAB + TAB + "# Add trigger information in custom trigger file" + ENDL;
-	script += TAB + TAB + TAB + "with open(\"" + trigInfoFile + "\", \"w\") as tfile:" + ENDL;
+	script += TAB + TAB + TAB + "with open(\"" + trigInfoFile + "\", infoMode) as tfile:" + ENDL;
 	script += TAB + TAB + TAB + TAB + "tfile.write(\"%s\\n\" % str(trig[it]))" + ENDL;
 	script += TAB + TAB + TAB + TAB + "debug(\" Added record of trigger information to file\")" + ENDL;
 	script += ENDL;
@@ -4095,6 +4711,11 @@ void DetectionPanel::generateScript() {
 	script += TAB + TAB + TAB + TAB + "if not stationStream:" + ENDL;
 	script += TAB + TAB + TAB + TAB + TAB + "continue" + ENDL;
 	script += ENDL;
+	script += TAB + TAB + TAB + TAB + "# Streams already drawn for a merged trigger are skipped" + ENDL;
+	script += TAB + TAB + TAB + TAB + "if stationStream.id in reportedStreams[str(trigTime)]:" + ENDL;
+	script += TAB + TAB + TAB + TAB + TAB + "continue" + ENDL;
+	script += TAB + TAB + TAB + TAB + "reportedStreams[str(trigTime)].add(stationStream.id)" + ENDL;
+	script += ENDL;
 
 	if ( w->parameter("Config-Filter-Enabled").toBool() ) {
 		QString properties;
@@ -4110,33 +4731,10 @@ void DetectionPanel::generateScript() {
 		script += ENDL;
 	}
 
-	script += TAB + TAB + TAB + TAB + "# Stream sampling rate" + ENDL;
-	script += TAB + TAB + TAB + TAB + "df = stationStream.stats.sampling_rate" + ENDL;
-	script += ENDL;
-	script += TAB + TAB + TAB + TAB + "# Add raw spectrograph" + ENDL;
-	script += TAB + TAB + TAB + TAB + "first = plt.subplot(211)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "# filteredTr = stationStream.filter(\"highpass\", freq=1.0)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "first.set_title(stationStream.stats.network + \"-\" + stationStream.stats.station + \"-\" + stationStream.stats.location + \"-\" + stationStream.stats.channel)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.plot(stationStream.data, 'k')" + ENDL;
-	script += TAB + TAB + TAB + TAB + "ymin, ymax = first.get_ylim()" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.vlines((trig[it]['time'] - stationStream.stats.starttime) * df, ymin, ymax, color='r', linewidth=2)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.vlines((trig[it]['time'] + trig[it]['duration'] - stationStream.stats.starttime) * df, ymin, ymax, color='b', linewidth=2)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.axis('tight')" + ENDL;
-	script += ENDL;
-	script += TAB + TAB + TAB + TAB + "# Add raw spectrogram" + ENDL;
-	script += TAB + TAB + TAB + TAB + "second = plt.subplot(212)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.specgram(stationStream.data)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.axis('tight')" + ENDL;
-	script += ENDL;
-	script += TAB + TAB + TAB + TAB + "# plt.show()" + ENDL;
 	script += TAB + TAB + TAB + TAB + "# Save the new trigger figure" + ENDL;
-	script += TAB + TAB + TAB + TAB + "pltName = tmpDataDir + str(trig[it]['time']) + \"-\" + stationStream.stats.network + \"-\" + stationStream.stats.station + \"-\" + stationStream.stats.location + \"-\" + stationStream.stats.channel + \".png\"" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.savefig(pltName, bbox_inches='tight', pad_inches=0)" + ENDL;
-	script += TAB + TAB + TAB + TAB + "debug(\" Created trigger snapshot \" + pltName)" + ENDL;
-	script += ENDL;
-	script += TAB + TAB + TAB + TAB + "# Clear the current figure so that it will not be pasted" + ENDL;
-	script += TAB + TAB + TAB + TAB + "# to the next one" + ENDL;
-	script += TAB + TAB + TAB + TAB + "plt.clf()" + ENDL;
+	script += TAB + TAB + TAB + TAB + "pltName = tmpDataDir + str(trigTime) + \"-\" + stationStream.stats.network + \"-\" + stationStream.stats.station + \"-\" + stationStream.stats.location + \"-\" + stationStream.stats.channel + \".png\"" + ENDL;
+	script += TAB + TAB + TAB + TAB + "snapshot(stationStream, trig[it]['time'] - stationStream.stats.starttime," + ENDL;
+	script += TAB + TAB + TAB + TAB + TAB + "trig[it]['time'] + trig[it]['duration'] - stationStream.stats.starttime, pltName)" + ENDL;
 	script += TAB + TAB + TAB + TAB + "i += 1" + ENDL;
 	script += TAB + TAB + TAB + "it += 1" + ENDL;
 	script += TAB + "else:" + ENDL;
@@ -4288,6 +4886,8 @@ DispatchPanel::DispatchPanel(QWidget* parent) :
 	__ui->radioButtonCustomParameters->setChecked(true);
 	__ui->lineEditArguments->hide();
 	__ui->widgetOptions->hide();
+	__ui->checkBoxIncremental->setChecked(true);
+	__ui->checkBoxUniqueRecords->setChecked(false);
 
 	connect(__ui->pushButtonApply, SIGNAL(clicked()), this, SLOT(generateScript()));
 	connect(__ui->toolButtonDataDir, SIGNAL(clicked()), this, SLOT(selectDataDir()));
@@ -4307,8 +4907,11 @@ DispatchPanel::DispatchPanel(QWidget* parent) :
 	ParameterManager::instancePtr()->registerParameter("Dispatch-DataPattern");
 	ParameterManager::instancePtr()->registerParameter("Dispatch-SDSDir");
 	ParameterManager::instancePtr()->registerParameter("Dispatch-SDSPattern");
+	ParameterManager::instancePtr()->registerParameter("Dispatch-Incremental");
+	ParameterManager::instancePtr()->registerParameter("Dispatch-UniqueRecords");
 
 	loadConfiguration();
+	showHideMsModOptions();
 }
 
 
@@ -4327,6 +4930,10 @@ bool DispatchPanel::saveParameters() {
 	p->setParameter("Dispatch-DataPattern", QVariant::fromValue(__ui->lineEditDataPattern->text()));
 	p->setParameter("Dispatch-SDSDir", QVariant::fromValue(__ui->lineEditSDSDir->text()));
 	p->setParameter("Dispatch-SDSPattern", QVariant::fromValue(__ui->lineEditSDSPattern->text()));
+	//! Skipping dispatched files and duplicate records are msrouter options
+	const bool msrouter = __ui->radioButtonMsrouter->isChecked();
+	p->setParameter("Dispatch-Incremental", QVariant::fromValue(msrouter && __ui->checkBoxIncremental->isChecked()));
+	p->setParameter("Dispatch-UniqueRecords", QVariant::fromValue(msrouter && __ui->checkBoxUniqueRecords->isChecked()));
 
 	return true;
 }
@@ -4360,6 +4967,14 @@ bool DispatchPanel::loadConfiguration() {
 	try {
 		__ui->lineEditArguments->setText(cfg->getString("dispatch.msmod.customArguments"));
 	} catch ( ... ) {}
+	try {
+		__ui->checkBoxIncremental->setChecked(cfg->getBool("dispatch.msrouter.incremental"));
+	} catch ( ... ) {}
+	try {
+		__ui->checkBoxUniqueRecords->setChecked(cfg->getBool("dispatch.msrouter.uniqueRecords"));
+	} catch ( ... ) {}
+
+	showHideMsModOptions();
 
 	return true;
 }
@@ -4386,25 +5001,25 @@ void DispatchPanel::generateScript() {
 			args = __ui->lineEditArguments->text();
 		else {
 			if ( __ui->checkBoxApplyTimecorr->isChecked() )
-			    args += "--applytimecorr " + __ui->lineEditApplyTimecorr->text() + " ";
+			    args += "--applytimecorr " + Utils::shellQuote(__ui->lineEditApplyTimecorr->text()) + " ";
 			if ( __ui->checkBoxChanCode->isChecked() )
-			    args += "--chan " + __ui->lineEditChanCode->text() + " ";
+			    args += "--chan " + Utils::shellQuote(__ui->lineEditChanCode->text()) + " ";
 			if ( __ui->checkBoxLocCode->isChecked() )
-			    args += "--loc " + __ui->lineEditLocCode->text() + " ";
+			    args += "--loc " + Utils::shellQuote(__ui->lineEditLocCode->text()) + " ";
 			if ( __ui->checkBoxNetCode->isChecked() )
-			    args += "--net " + __ui->lineEditNetCode->text() + " ";
+			    args += "--net " + Utils::shellQuote(__ui->lineEditNetCode->text()) + " ";
 			if ( __ui->checkBoxQuality->isChecked() )
-			    args += "--quality " + __ui->lineEditQuality->text() + " ";
+			    args += "--quality " + Utils::shellQuote(__ui->lineEditQuality->text()) + " ";
 			if ( __ui->checkBoxSamplerate->isChecked() )
-			    args += "--samprate " + __ui->lineEditSamplerate->text() + " ";
+			    args += "--samprate " + Utils::shellQuote(__ui->lineEditSamplerate->text()) + " ";
 			if ( __ui->checkBoxStaCode->isChecked() )
-			    args += "--sta " + __ui->lineEditStaCode->text() + " ";
+			    args += "--sta " + Utils::shellQuote(__ui->lineEditStaCode->text()) + " ";
 			if ( __ui->checkBoxTimecorr->isChecked() )
-			    args += "--timecorr " + __ui->lineEditTimecorr->text() + " ";
+			    args += "--timecorr " + Utils::shellQuote(__ui->lineEditTimecorr->text()) + " ";
 			if ( __ui->checkBoxTimecorrval->isChecked() )
-			    args += "--timecorrval " + __ui->lineEditTimecorrval->text() + " ";
+			    args += "--timecorrval " + Utils::shellQuote(__ui->lineEditTimecorrval->text()) + " ";
 			if ( __ui->checkBoxTimeshift->isChecked() )
-			    args += "--timeshift " + __ui->lineEditTimeshift->text() + " ";
+			    args += "--timeshift " + Utils::shellQuote(__ui->lineEditTimeshift->text()) + " ";
 		}
 	}
 
@@ -4419,58 +5034,55 @@ void DispatchPanel::generateScript() {
 	script += "############################################################" + ENDL;
 	script += ENDL;
 	script += ENDL;
-	script += "MSEEDDIR=" + p->parameter("Dispatch-SDSDir").toString() + ENDL;
-	script += "MSEEDTMPDIR=${MSEEDDIR}/tmp/" + ENDL;
+	script += "MSEEDDIR=" + Utils::shellQuote(p->parameter("Dispatch-SDSDir").toString()) + ENDL;
+	script += "DATADIR=" + Utils::shellQuote(p->parameter("Dispatch-DataDir").toString()) + ENDL;
+	script += "DATAMATCH=\"*.m*\"" + ENDL;
+	script += "MANIFEST=\"${MSEEDDIR}/.dispatch.manifest\"" + ENDL;
 	if ( p->parameter("Dispatch-Msrouter").toBool() )
-		script += "DISPATCHTOOL=" + p->parameter("MSROUTER_BIN").toString() + ENDL;
+		script += "DISPATCHTOOL=" + Utils::shellQuote(p->parameter("MSROUTER_BIN").toString()) + ENDL;
 	else
-		script += "DISPATCHTOOL=" + p->parameter("MSMOD_BIN").toString() + ENDL;
+		script += "DISPATCHTOOL=" + Utils::shellQuote(p->parameter("MSMOD_BIN").toString()) + ENDL;
 	script += ENDL;
-	script += "LOGDIR=" + env->shareDir() + "/dispatch" + ENDL;
-	script += "STDOUTLOG=${LOGDIR}/out.log" + ENDL;
+	script += "LOGDIR=" + Utils::shellQuote(env->shareDir() + "/dispatch") + ENDL;
+	script += "STDOUTLOG=\"${LOGDIR}/out.log\"" + ENDL;
 	script += ENDL;
 	script += "STARTDATE=$(date +\"%s\")" + ENDL;
 	script += ENDL;
 	script += "echo \"`date +%Y.%m.%d-%I.%M.%S` -- Dispatcher ready to operate and fill '${MSEEDDIR}' SDS archive\"" + ENDL;
-	script += "mkdir -p ${LOGDIR}" + ENDL;
-	script += "touch ${STDOUTLOG}" + ENDL;
-	script += ENDL;
-	script += "# Count the number of subfolders in current directory, ignore symlinks and" + ENDL;
-	script += "# folders starting with '.' (hence the -2)" + ENDL;
-	script += "DNB=$((`ls -l | grep -v ^l | wc -l`-2))" + ENDL;
-	script += "didx=0" + ENDL;
+	script += "mkdir -p \"${LOGDIR}\"" + ENDL;
+	script += "touch \"${STDOUTLOG}\"" + ENDL;
 	script += ENDL;
-	script += "CFOLDER=`pwd`" + ENDL;
-	script += "fcount=0" + ENDL;
-	script += "for j in `ls 2>/dev/null`" + ENDL;
-	script += "do" + ENDL;
-	script += "    cd ${CFOLDER}/${j} 2>/dev/null # ignore subfolder parsing msg" + ENDL;
-	script += "    FNB=$((`ls -l | grep -v ^l | wc -l`-2))" + ENDL;
-	script += "    fidx=0" + ENDL;
-	script += "    for i in `ls *.m* 2>/dev/null`" + ENDL;
-	script += "    do" + ENDL;
-	script += "	if test -f \"$i\"" + ENDL;
-	script += "	then" + ENDL;
-	if ( p->parameter("Dispatch-Msrouter").toBool() )
-		script += "	    ${DISPATCHTOOL} -A $MSEEDDIR/" + p->parameter("Dispatch-SDSPattern").toString() + " $i &>${STDOUTLOG}" + ENDL;
-	else
-		script += "	    ${DISPATCHTOOL} " + args + " -A $MSEEDDIR/" + p->parameter("Dispatch-SDSPattern").toString() + " $i &>${STDOUTLOG}" + ENDL;
-	script += "	    echo -n \"`date +%Y.%m.%d-%I.%M.%S` -- [$((${didx}*100/${DNB}))%] ";
-	script += "[$((${fidx}*100/${FNB}))%] Dispatching file ${i} [$((DNB-didx))/$((FNB-fidx)) ";
-	script += "files remaining]\"" + ENDL;
-	script += "	    echo -n R | tr 'R' '\r'" + ENDL;
-	script += "	    ((fcount+=1))" + ENDL;
-	script += "	fi" + ENDL;
-	script += "	((fidx+=1))" + ENDL;
-	script += "    done" + ENDL;
-	script += "    ((didx+=1))" + ENDL;
-	script += "done" + ENDL;
+	if ( p->parameter("Dispatch-Msrouter").toBool() ) {
+		script += "# Route every file of the data directory tree with a single process and" + ENDL;
+		script += "# one set of open archive files. Progress counts are reported on stdout," + ENDL;
+		script += "# errors are appended to the log." + ENDL;
+		QString options;
+		if ( p->parameter("Dispatch-Incremental").toBool() ) {
+			script += "# Files listed in the archive manifest are skipped, routed files are added." + ENDL;
+			options += "-M \"${MANIFEST}\" ";
+		}
+		if ( p->parameter("Dispatch-UniqueRecords").toBool() ) {
+			script += "# Records already in the archive files are not appended again." + ENDL;
+			options += "-U ";
+		}
+		script += "\"${DISPATCHTOOL}\" -P " + options + "-d \"${DATADIR}\" -m \"${DATAMATCH}\" -A \"${MSEEDDIR}/\""
+		    + Utils::shellQuote(p->parameter("Dispatch-SDSPattern").toString()) + " 2> >(tee -a \"${STDOUTLOG}\" >&2)" + ENDL;
+	}
+	else {
+		script += "# Pass the files of the data directory tree to as few processes as possible," + ENDL;
+		script += "# hidden files and folders are ignored. Errors are appended to the log." + ENDL;
+		script += "find \"${DATADIR}\" -type f -name \"${DATAMATCH}\" ! -path '*/.*' -print0 | sort -z | ";
+		script += "xargs -0 -r \"${DISPATCHTOOL}\" " + args + "-A \"${MSEEDDIR}/\""
+		    + Utils::shellQuote(p->parameter("Dispatch-SDSPattern").toString()) + " 2> >(tee -a \"${STDOUTLOG}\" >&2)" + ENDL;
+	}
+	script += "RETCODE=$?" + ENDL;
 	script += ENDL;
 	script += ENDL;
 	script += "ENDDATE=$(date +\"%s\")" + ENDL;
 	script += "DIFF=$(($ENDDATE-$STARTDATE))" + ENDL;
-	script += "echo \"Displatched ${fcount} file(s) from ${didx} folder(s) in ";
-	script += "$((${DIFF} / 3600)) hour(s) $((${DIFF} / 60)) minute(s) and $((${DIFF} % 60)) second(s).\"" + ENDL;
+	script += "echo \"Dispatched files from '${DATADIR}' in ";
+	script += "$((${DIFF} / 3600)) hour(s) $(((${DIFF} % 3600) / 60)) minute(s) and $((${DIFF} % 60)) second(s).\"" + ENDL;
+	script += "exit ${RETCODE}" + ENDL;
 
 	__scriptEditor->clear();
 	__scriptEditor->insertPlainText(script);
@@ -4513,6 +5125,8 @@ void DispatchPanel::enqueueJob() {
 
 void DispatchPanel::showHideMsModOptions() {
 	__ui->widgetOptions->setVisible(__ui->radioButtonMsmod->isChecked());
+	__ui->widgetMsrouterOptions->setVisible(__ui->radioButtonMsrouter->isChecked());
+	__ui->widgetMsrouterOptions->setEnabled(__ui->radioButtonMsrouter->isChecked());
 }
 
 
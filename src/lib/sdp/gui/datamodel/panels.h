@@ -36,6 +36,7 @@
 #include <QScopedPointer>
 #include <QBasicTimer>
 #include <QTableWidgetItem>
+#include <QTableView>
 #include <QTreeWidgetItem>
 #include <sdp/gui/datamodel/singleton.h>
 
@@ -58,6 +59,7 @@ class DispatchPanel;
 QT_FORWARD_DECLARE_CLASS(QTimer);
 QT_FORWARD_DECLARE_CLASS(QWebView);
 QT_FORWARD_DECLARE_CLASS(QAction);
+QT_FORWARD_DECLARE_CLASS(QTabWidget);
 
 class QRoundProgressBar;
 
@@ -69,12 +71,16 @@ class Job;
 class DetectionJob;
 class DispatchJob;
 class Trigger;
+class TriggerModel;
+class CommitPipeline;
+class WaveformView;
 
 class DataSourceSubPanel;
 class InventorySubPanel;
 class TimeWindowSubPanel;
 class TriggerSubPanel;
 class StreamSubPanel;
+class CoverageSubPanel;
 class SubPanelWidget;
 typedef QList<SubPanelWidget*> SubPanelList;
 
@@ -82,12 +88,6 @@ typedef QPair<int, QAction*> PairedAction;
 typedef QList<PairedAction> HeaderActions;
 
 class TableItem;
-struct TriggerItem {
-		TableItem* item;
-		Trigger* trigger;
-};
-typedef QList<TriggerItem> TriggerItems;
-
 struct JobItem {
 		TableItem* item;
 		Job* job;
@@ -282,6 +282,35 @@ class InteractiveTable : public QTableWidget {
 };
 
 
+/**
+ * @brief The QTableView counterpart of InteractiveTable, for tables backed
+ *        by a model.
+ */
+class InteractiveTableView : public QTableView {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit InteractiveTableView(QWidget* parent = NULL);
+		~InteractiveTableView();
+
+	protected:
+		// ------------------------------------------------------------------
+		//  Protected Qt interace
+		// ------------------------------------------------------------------
+		void keyPressEvent(QKeyEvent*);
+
+	Q_SIGNALS:
+		// ------------------------------------------------------------------
+		//  Qt signals
+		// ------------------------------------------------------------------
+		void deleteSelected();
+};
+
+
 class ArchivedRun;
 class ArchivedOrigin;
 typedef QList<ArchivedRun*> RunList;
@@ -330,6 +359,14 @@ class RecentPanel : public PanelWidget, public Singleton<RecentPanel> {
 		void showHideHeaderItems();
 		void objectSelectionChanged();
 		void objectSelected(QTreeWidgetItem*, const int&);
+		void snapshotsRendered(const QStringList&);
+		void thumbnailReady(const QString&);
+
+	protected:
+		// ------------------------------------------------------------------
+		//  Protected interface
+		// ------------------------------------------------------------------
+		bool eventFilter(QObject*, QEvent*);
 
 	private:
 		// ------------------------------------------------------------------
@@ -341,6 +378,8 @@ class RecentPanel : public PanelWidget, public Singleton<RecentPanel> {
 		void displayJobOutput(Job*);
 		void displayTriggerInformation(Trigger*);
 		void displayOriginOutput(ArchivedOrigin*);
+		bool showSnapshotTooltip(QTreeWidgetItem*, const QPoint&, const bool&);
+		void showPendingTooltip();
 
 	private:
 		// ------------------------------------------------------------------
@@ -353,6 +392,9 @@ class RecentPanel : public PanelWidget, public Singleton<RecentPanel> {
 		InteractiveTree* __tree;
 		RunList __runs;
 		HeaderActions __actions;
+		//! Snapshots of the object displayed and of the tooltip awaiting them
+		QStringList __shownSnapshots;
+		QStringList __tooltipSnapshots;
 		struct Family {
 				Family(QTreeWidgetItem* o1 = NULL, QTreeWidgetItem* o2 = NULL,
 				       QTreeWidgetItem* o3 = NULL, QTreeWidgetItem* o4 = NULL,
@@ -424,6 +466,8 @@ class ActivityPanel : public PanelWidget, public Singleton<ActivityPanel> {
 		void initInteractiveTable();
 		JobItems selectedJobs();
 		JobItems allJobs();
+		//! Item of the row of a job, the queue holds a few jobs
+		TableItem* jobItem(Job*);
 
 	public Q_SLOTS:
 		// ------------------------------------------------------------------
@@ -455,6 +499,7 @@ class ActivityPanel : public PanelWidget, public Singleton<ActivityPanel> {
 		//! Bunch of slots in response of signals fired by jobs
 		void jobStarted();
 		void jobTerminated();
+		void jobProgress();
 		void incomingStdMsg();
 
 		void jobSelectionChanged(const QItemSelection&, const QItemSelection&);
@@ -467,6 +512,7 @@ class ActivityPanel : public PanelWidget, public Singleton<ActivityPanel> {
 		//  Qt signals
 		// ------------------------------------------------------------------
 		void detectionJobTerminated(DetectionJob*);
+		void dispatchJobTerminated(DispatchJob*);
 		void jobReseted(int, QList<QString>);
 		void editDetectionJob(DetectionJob*);
 		void editDispatchJob(DispatchJob*);
@@ -518,23 +564,38 @@ class CommitDialog : public QDialog {
 		// ------------------------------------------------------------------
 		//  Instruction
 		// ------------------------------------------------------------------
-		explicit CommitDialog(const QString&, QWidget* = NULL);
+		explicit CommitDialog(CommitPipeline*, QWidget* = NULL);
 		~CommitDialog();
 
 	public:
 		ReturnCode commitReturnCode();
 
+	public Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Public Qt interface
+		// ------------------------------------------------------------------
+		void reject();
+
 	private Q_SLOTS:
 		// ------------------------------------------------------------------
 		//  Private Qt interface
 		// ------------------------------------------------------------------
-		void processTerminated(int);
+		void triggerStatusChanged(Trigger*, int, const QString&);
+		void pipelineFinished();
+		void buttonClicked();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		void updateStatus();
 
 	private:
 		// ------------------------------------------------------------------
 		//  Members
 		// ------------------------------------------------------------------
 		QScopedPointer<Ui::CommitDialog> __ui;
+		CommitPipeline* __pipeline;
 		ReturnCode __retCode;
 };
 
@@ -555,7 +616,7 @@ class TriggerPanel : public PanelWidget, public Singleton<TriggerPanel> {
 		//  Public interface
 		// ------------------------------------------------------------------
 		bool saveParameters();
-		void loadTrigger(Trigger*);
+		void loadTriggers(const QList<Trigger*>&);
 		void removeTriggers(const QString& jobID);
 
 	private:
@@ -564,9 +625,11 @@ class TriggerPanel : public PanelWidget, public Singleton<TriggerPanel> {
 		// ------------------------------------------------------------------
 		void initInteractiveTable();
 		void displayTriggerOutput(Trigger*);
+		void showSnapshots();
 		const QString generateSC3ML(Trigger*);
 		void updateButtons();
-		TriggerItems tableSelection();
+		QList<Trigger*> tableSelection();
+		void dropTriggers(const QList<Trigger*>&);
 
 	public Q_SLOTS:
 		// ------------------------------------------------------------------
@@ -590,7 +653,11 @@ class TriggerPanel : public PanelWidget, public Singleton<TriggerPanel> {
 		void autocleanTriggers();
 
 		void triggerSelectionChanged(const QItemSelection&, const QItemSelection&);
-		void showTriggerOutput(const int&, const int&);
+		void showTriggerOutput(const QModelIndex&);
+		void filterTriggers(const QString&);
+		void previewTabChanged(int);
+		void snapshotsRendered(const QStringList&);
+		void thumbnailReady(const QString&);
 
 	Q_SIGNALS:
 		void triggerStatusModified(int, QList<QString>);
@@ -600,17 +667,19 @@ class TriggerPanel : public PanelWidget, public Singleton<TriggerPanel> {
 		// ------------------------------------------------------------------
 		//  Members
 		// ------------------------------------------------------------------
-		typedef QList<Trigger*> TriggerList;
 		QScopedPointer<Ui::TriggerPanel> __ui;
-		InteractiveTable* __table;
+		InteractiveTableView* __table;
+		TriggerModel* __model;
 		FancyButton* __acceptButton;
 		FancyButton* __rejectButton;
 		FancyButton* __removeButton;
 		FancyButton* __commitButton;
 		FancyButton* __resetButton;
 		FancyButton* __autocleanButton;
-		TriggerList __triggers;
+		QTabWidget* __previewTabs;
+		WaveformView* __waveforms;
 		HeaderActions __actions;
+		QStringList __shownSnapshots;
 
 		struct Commitable {
 				bool operator==(Commitable& c) {
@@ -705,6 +774,7 @@ class DetectionPanel : public PanelWidget {
 		TimeWindowSubPanel* __tw;
 		TriggerSubPanel* __trig;
 		StreamSubPanel* __stream;
+		CoverageSubPanel* __coverage;
 		ScriptEditor* __scriptEditor;
 		SubPanelList __widgets;
 };
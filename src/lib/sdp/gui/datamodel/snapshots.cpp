@@ -0,0 +1,322 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/snapshots.h>
+#include <sdp/gui/datamodel/logger.h>
+#include <sdp/gui/datamodel/macros.h>
+#include <sdp/gui/datamodel/parametermanager.h>
+#include <sdp/gui/datamodel/utils.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+
+
+namespace {
+
+static QString const IndexFileName = "snapshots.ref";
+static QString const RequestTag = "REF";
+
+//! Fields of a request line
+static int const StartField = 1;
+static int const EndField = 2;
+static int const OnField = 3;
+static int const OffField = 4;
+static int const StreamField = 5;
+static int const FilterField = 6;
+static int const ImageField = 7;
+
+//! Images drawn by a single mssnap process
+static int const BatchSize = 32;
+
+//! Seconds a directory listing must follow the last change of the
+//! directory to be trusted, modification times being coarse
+static int const ListingDelay = 2;
+
+
+//! Trigger id of an image, the time its name starts with
+//! (2015-07-21T21:21:09.750000Z-MQ-FDF-00-HHZ.png)
+QString imageId(const QString& image) {
+	const QString name = QFileInfo(image).fileName();
+	const int end = name.indexOf("Z-");
+	return ( end < 0 ) ? QString() : name.left(end + 1);
+}
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+Snapshots::Snapshots(QObject* parent) :
+		QObject(parent), __process(new QProcess(this)) {
+
+	connect(__process, SIGNAL(finished(int, QProcess::ExitStatus)),
+	    this, SLOT(processFinished(int, QProcess::ExitStatus)));
+	connect(__process, SIGNAL(error(QProcess::ProcessError)),
+	    this, SLOT(processError(QProcess::ProcessError)));
+}
+
+
+Snapshots::~Snapshots() {
+
+	if ( __process->state() != QProcess::NotRunning ) {
+		__process->kill();
+		__process->waitForFinished();
+	}
+}
+
+
+const Snapshots::Index& Snapshots::runIndex(const QString& runDir) {
+
+	const QString dir = QDir::cleanPath(QDir(runDir).absolutePath());
+	const QFileInfo info(dir + QDir::separator() + IndexFileName);
+
+	Index& index = __indexes[dir];
+
+	if ( !info.exists() ) {
+		index = Index();
+		return index;
+	}
+
+	//! The index only changes while the run is going on
+	if ( info.size() == index.size && info.lastModified() == index.modified )
+	    return index;
+
+	index = Index();
+	index.size = info.size();
+	index.modified = info.lastModified();
+
+	QFile file(info.filePath());
+	if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
+		Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+		    "Failed to read snapshot index " + info.filePath());
+		return index;
+	}
+
+	//! Images are looked up in the run directory, wherever the run was
+	//! located when the index was written
+	QTextStream in(&file);
+	while ( !in.atEnd() ) {
+		QStringList fields = in.readLine().split('\t');
+		if ( fields.size() <= ImageField + 1 || fields.at(0) != RequestTag )
+		    continue;
+
+		fields[ImageField] = dir + QDir::separator() + QFileInfo(fields.at(ImageField)).fileName();
+		if ( !index.references.contains(fields.at(ImageField)) )
+		    index.images.insert(imageId(fields.at(ImageField)), fields.at(ImageField));
+		index.references.insert(fields.at(ImageField), fields.join("\t"));
+	}
+
+	return index;
+}
+
+
+const Snapshots::ReferenceList& Snapshots::references(const QString& runDir) {
+	return runIndex(runDir).references;
+}
+
+
+const Snapshots::ImageList& Snapshots::drawn(const QString& runDir) {
+
+	const QString dir = QDir::cleanPath(QDir(runDir).absolutePath());
+	const QDateTime modified = QFileInfo(dir).lastModified();
+
+	Listing& listing = __listings[dir];
+
+	if ( modified == listing.modified && listing.modified.secsTo(listing.listed) >= ListingDelay )
+	    return listing.images;
+
+	listing = Listing();
+	listing.modified = modified;
+	listing.listed = QDateTime::currentDateTime();
+
+	const QStringList list = Utils::getFileList(dir, ".png", QString());
+	for (int i = 0; i < list.size(); ++i) {
+		const QString id = imageId(list.at(i));
+		if ( !id.isEmpty() )
+		    listing.images.insert(id, list.at(i));
+	}
+
+	return listing.images;
+}
+
+
+QStringList Snapshots::files(const QString& runDir, const QString& id) {
+
+	QStringList list = drawn(runDir).values(id);
+	QSet<QString> found = list.toSet();
+
+	const ImageList& recorded = runIndex(runDir).images;
+	for (ImageList::const_iterator it = recorded.constFind(id);
+	        it != recorded.constEnd() && it.key() == id; ++it) {
+		if ( found.contains(it.value()) ) continue;
+		found.insert(it.value());
+		list << it.value();
+	}
+
+	list.sort();
+
+	return list;
+}
+
+
+QStringList Snapshots::missing(const QStringList& images) {
+
+	QStringList list;
+	for (int i = 0; i < images.size(); ++i) {
+		if ( QFile::exists(images.at(i)) ) continue;
+		if ( references(QFileInfo(images.at(i)).absolutePath()).contains(images.at(i)) )
+		    list << images.at(i);
+	}
+
+	return list;
+}
+
+
+bool Snapshots::pending(const QStringList& images) const {
+
+	for (int i = 0; i < images.size(); ++i)
+		if ( __running.contains(images.at(i)) || __urgent.contains(images.at(i))
+		    || __prefetch.contains(images.at(i)) )
+		    return true;
+
+	return false;
+}
+
+
+bool Snapshots::reference(const QString& image, Reference& ref) {
+
+	const ReferenceList& refs = references(QFileInfo(image).absolutePath());
+
+	ReferenceList::const_iterator it = refs.constFind(image);
+	if ( it == refs.constEnd() ) return false;
+
+	const QStringList fields = it.value().split('\t');
+	bool ok[4];
+
+	ref = Reference();
+	ref.start = fields.at(StartField).toDouble(&ok[0]);
+	ref.end = fields.at(EndField).toDouble(&ok[1]);
+	ref.on = fields.at(OnField).toDouble(&ok[2]);
+	ref.off = fields.at(OffField).toDouble(&ok[3]);
+	ref.stream = fields.at(StreamField);
+	ref.filter = fields.at(FilterField);
+	for (int i = ImageField + 1; i < fields.size(); ++i)
+		if ( !fields.at(i).isEmpty() )
+		    ref.files << fields.at(i);
+
+	return ok[0] && ok[1] && ok[2] && ok[3] && ref.end > ref.start && !ref.files.isEmpty();
+}
+
+
+void Snapshots::render(const QStringList& images, bool prefetch) {
+
+	const QStringList list = missing(images);
+
+	for (int i = 0; i < list.size(); ++i) {
+
+		if ( __running.contains(list.at(i)) ) continue;
+
+		if ( prefetch ) {
+			if ( !__urgent.contains(list.at(i)) && !__prefetch.contains(list.at(i)) )
+			    __prefetch << list.at(i);
+		}
+		else if ( !__urgent.contains(list.at(i)) ) {
+			__prefetch.removeAll(list.at(i));
+			__urgent << list.at(i);
+		}
+	}
+
+	start();
+}
+
+
+void Snapshots::start() {
+
+	SDPASSERT(ParameterManager::instancePtr());
+
+	if ( __process->state() != QProcess::NotRunning || !__running.isEmpty() )
+	    return;
+
+	QString requests;
+	while ( __running.size() < BatchSize && (!__urgent.isEmpty() || !__prefetch.isEmpty()) ) {
+
+		const QString image = !__urgent.isEmpty() ? __urgent.takeFirst() : __prefetch.takeFirst();
+		const ReferenceList& refs = references(QFileInfo(image).absolutePath());
+
+		//! Drawn meanwhile or run removed
+		if ( QFile::exists(image) || !refs.contains(image) ) continue;
+
+		requests += refs.value(image) + "\n";
+		__running << image;
+	}
+
+	if ( __running.isEmpty() ) return;
+
+	//! Images drawn since they were requested are skipped by mssnap
+	__process->start(ParameterManager::instancePtr()->parameter("MSSNAP_BIN").toString(),
+	    QStringList() << "-n");
+	__process->write(requests.toUtf8());
+	__process->closeWriteChannel();
+}
+
+
+void Snapshots::processFinished(int code, QProcess::ExitStatus status) {
+
+	if ( status != QProcess::NormalExit || code != 0 )
+	    Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+	        "Some trigger snapshots could not be drawn: "
+	        + QString::fromLocal8Bit(__process->readAllStandardError()).trimmed());
+
+	const QStringList list = __running;
+	__running.clear();
+
+	emit rendered(list);
+
+	start();
+}
+
+
+void Snapshots::processError(QProcess::ProcessError error) {
+
+	//! Other errors are followed by finished()
+	if ( error != QProcess::FailedToStart ) return;
+
+	Logger::instancePtr()->addMessage(Logger::WARNING, __func__,
+	    "Failed to start mssnap to draw trigger snapshots: " + __process->errorString());
+
+	//! Snapshots can not be drawn until mssnap is installed
+	const QStringList list = __running + __urgent + __prefetch;
+	__running.clear();
+	__urgent.clear();
+	__prefetch.clear();
+
+	emit rendered(list);
+}
+
+
+} // namespace Qt4
+} // namespace SDP
@@ -0,0 +1,168 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_SNAPSHOTS_H__
+#define __SDP_QT4_DATAMODEL_SNAPSHOTS_H__
+
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QDateTime>
+#include <QProcess>
+#include <sdp/gui/datamodel/singleton.h>
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+/**
+ * @class Snapshots
+ * @brief This class implements the drawing of trigger snapshots on demand.
+ *        Detection runs with mssnap available do not draw the snapshots of
+ *        their triggers, they record in the run directory the data each
+ *        snapshot is drawn from ('snapshots.ref'). Images are drawn by mssnap
+ *        the first time they are shown and stay in the run directory.
+ * @info  Requests are drawn by a single mssnap process at a time, images
+ *        being displayed are drawn before the ones which are prefetched.
+ */
+class Snapshots : public QObject, public Singleton<Snapshots> {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit Snapshots(QObject* = NULL);
+		~Snapshots();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		//! Data a snapshot is drawn from
+		struct Reference {
+				Reference() :
+						start(.0), end(.0), on(.0), off(.0) {}
+				//! NET.STA.LOC.CHA
+				QString stream;
+				//! Window, epoch seconds
+				double start;
+				double end;
+				//! Trigger on and off, seconds after the start of the window
+				double on;
+				double off;
+				QString filter;
+				//! Mini-SEED files holding the stream
+				QStringList files;
+		};
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		//! Returns the snapshot images of the trigger id of a run, whether
+		//! they have been drawn or not.
+		QStringList files(const QString& runDir, const QString& id);
+
+		//! Returns the images of the list which are not drawn yet but can be.
+		QStringList missing(const QStringList&);
+
+		//! Returns whether images of the list are queued or being drawn.
+		bool pending(const QStringList&) const;
+
+		//! Reads the data reference of an image recorded by its run. Returns
+		//! false when the run did not record one.
+		bool reference(const QString& image, Reference&);
+
+	public Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Public Qt interface
+		// ------------------------------------------------------------------
+		void render(const QStringList&, bool prefetch = false);
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void processFinished(int, QProcess::ExitStatus);
+		void processError(QProcess::ProcessError);
+
+	Q_SIGNALS:
+		// ------------------------------------------------------------------
+		//  Qt signals
+		// ------------------------------------------------------------------
+		//! Emitted once mssnap is done with images, drawn or not
+		void rendered(const QStringList&);
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		typedef QHash<QString, QString> ReferenceList;
+		typedef QMultiHash<QString, QString> ImageList;
+
+		struct Index {
+				Index() :
+						size(-1) {}
+				qint64 size;
+				QDateTime modified;
+				//! Request line of every image
+				ReferenceList references;
+				//! Images of every trigger id
+				ImageList images;
+		};
+
+		//! Images drawn in a run directory, listed again once it changes
+		struct Listing {
+				QDateTime modified;
+				QDateTime listed;
+				ImageList images;
+		};
+
+		const Index& runIndex(const QString& runDir);
+		const ReferenceList& references(const QString& runDir);
+		const ImageList& drawn(const QString& runDir);
+		void start();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		QHash<QString, Index> __indexes;
+		QHash<QString, Listing> __listings;
+		QStringList __urgent;
+		QStringList __prefetch;
+		QStringList __running;
+		QProcess* __process;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
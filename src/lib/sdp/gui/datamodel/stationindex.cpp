@@ -0,0 +1,346 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/stationindex.h>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+using namespace SDP::Qt4;
+
+typedef StationIndex::Hit Hit;
+typedef StationIndex::Location Location;
+
+//! Mean radius of the Earth in kilometers
+static double const EarthRadius = 6371.;
+static double const Pi = 3.14159265358979323846;
+static double const DegToRad = Pi / 180.;
+
+
+void toUnitSphere(const Location& l, double* xyz) {
+	const double lat = l.latitude * DegToRad;
+	const double lon = l.longitude * DegToRad;
+	xyz[0] = std::cos(lat) * std::cos(lon);
+	xyz[1] = std::cos(lat) * std::sin(lon);
+	xyz[2] = std::sin(lat);
+}
+
+
+//! Great circle distance in kilometers of a squared chord of the unit sphere
+double chordDistance(const double& chord2) {
+	return 2. * EarthRadius * std::asin(std::min(1., std::sqrt(chord2) / 2.));
+}
+
+
+bool hitLessThan(const Hit& a, const Hit& b) {
+	if ( a.distance != b.distance )
+	    return a.distance < b.distance;
+	return a.index < b.index;
+}
+
+
+struct AxisLess {
+		AxisLess(const double* xyz, const int& axis) :
+				xyz(xyz), axis(axis) {}
+		bool operator()(const int& a, const int& b) const {
+			return xyz[3 * a + axis] < xyz[3 * b + axis];
+		}
+		const double* xyz;
+		int axis;
+};
+
+
+struct LatitudeLess {
+		explicit LatitudeLess(const Location* l) :
+				locations(l) {}
+		bool operator()(const int& a, const int& b) const {
+			return locations[a].latitude < locations[b].latitude;
+		}
+		const Location* locations;
+};
+
+
+struct LatitudeBelow {
+		explicit LatitudeBelow(const Location* l) :
+				locations(l) {}
+		bool operator()(const int& a, const double& latitude) const {
+			return locations[a].latitude < latitude;
+		}
+		const Location* locations;
+};
+
+}
+// <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+StationIndex::StationIndex() {}
+
+
+StationIndex::~StationIndex() {}
+
+
+void StationIndex::build(const LocationList& locations) {
+
+	clear();
+
+	const int n = locations.size();
+	__locations = locations;
+	__xyz.resize(3 * n);
+	__tree.resize(n);
+	__axis.resize(n);
+	__byLatitude.resize(n);
+
+	for (int i = 0; i < n; ++i) {
+		toUnitSphere(locations.at(i), __xyz.data() + 3 * i);
+		__tree[i] = i;
+		__byLatitude[i] = i;
+	}
+
+	buildNode(0, n);
+	std::sort(__byLatitude.begin(), __byLatitude.end(),
+	    LatitudeLess(__locations.constData()));
+}
+
+
+void StationIndex::clear() {
+	__locations.clear();
+	__xyz.clear();
+	__tree.clear();
+	__axis.clear();
+	__byLatitude.clear();
+}
+
+
+int StationIndex::size() const {
+	return __locations.size();
+}
+
+
+const StationIndex::Location& StationIndex::location(const int& index) const {
+	return __locations.at(index);
+}
+
+
+StationIndex::HitList
+StationIndex::radius(const Location& point, const double& radius) const {
+
+	HitList hits;
+	if ( __tree.isEmpty() || radius < .0 ) return hits;
+
+	double q[3];
+	toUnitSphere(point, q);
+
+	const double chord = 2. * std::sin(std::min(radius / EarthRadius, Pi) / 2.);
+	searchRadius(0, __tree.size(), q, chord * chord, hits);
+
+	for (int i = 0; i < hits.size(); ++i)
+		hits[i].distance = chordDistance(hits.at(i).distance);
+	std::sort(hits.begin(), hits.end(), hitLessThan);
+
+	return hits;
+}
+
+
+StationIndex::HitList
+StationIndex::nearest(const Location& point, const int& count) const {
+
+	HitList hits;
+	if ( __tree.isEmpty() || count <= 0 ) return hits;
+
+	double q[3];
+	toUnitSphere(point, q);
+
+	//! Max-heap of the closest stations found, by squared chord
+	QVector<Hit> heap;
+	heap.reserve(std::min(count, __tree.size()));
+	searchNearest(0, __tree.size(), q, count, heap);
+	std::sort_heap(heap.begin(), heap.end(), hitLessThan);
+
+	for (int i = 0; i < heap.size(); ++i)
+		hits << Hit(heap.at(i).index, chordDistance(heap.at(i).distance));
+
+	return hits;
+}
+
+
+StationIndex::HitList
+StationIndex::box(const double& minLatitude, const double& maxLatitude,
+                  const double& minLongitude, const double& maxLongitude) const {
+
+	HitList hits;
+	if ( minLatitude > maxLatitude ) return hits;
+
+	const bool wraps = minLongitude > maxLongitude;
+	double centerLongitude = (minLongitude + maxLongitude) / 2.;
+	if ( wraps ) {
+		centerLongitude += 180.;
+		if ( centerLongitude > 180. )
+		    centerLongitude -= 360.;
+	}
+	const Location center((minLatitude + maxLatitude) / 2., centerLongitude);
+
+	QVector<int>::const_iterator it = std::lower_bound(__byLatitude.constBegin(),
+	    __byLatitude.constEnd(), minLatitude, LatitudeBelow(__locations.constData()));
+	for (; it != __byLatitude.constEnd(); ++it) {
+
+		const Location& l = __locations.at(*it);
+		if ( l.latitude > maxLatitude ) break;
+
+		const bool inside = wraps ?
+		    l.longitude >= minLongitude || l.longitude <= maxLongitude :
+		    l.longitude >= minLongitude && l.longitude <= maxLongitude;
+		if ( inside )
+		    hits << Hit(*it, distance(center, l));
+	}
+
+	std::sort(hits.begin(), hits.end(), hitLessThan);
+
+	return hits;
+}
+
+
+double StationIndex::distance(const Location& a, const Location& b) {
+
+	const double lat1 = a.latitude * DegToRad;
+	const double lat2 = b.latitude * DegToRad;
+	const double dlat = std::sin((lat2 - lat1) / 2.);
+	const double dlon = std::sin((b.longitude - a.longitude) * DegToRad / 2.);
+	const double h = dlat * dlat + std::cos(lat1) * std::cos(lat2) * dlon * dlon;
+
+	return 2. * EarthRadius * std::asin(std::min(1., std::sqrt(h)));
+}
+
+
+void StationIndex::buildNode(const int& lo, const int& hi) {
+
+	if ( hi <= lo ) return;
+
+	//! Ranges are split at their median along their widest axis
+	double lower[3] = { 2., 2., 2. };
+	double upper[3] = { -2., -2., -2. };
+	for (int i = lo; i < hi; ++i) {
+		const double* p = __xyz.constData() + 3 * __tree.at(i);
+		for (int a = 0; a < 3; ++a) {
+			lower[a] = std::min(lower[a], p[a]);
+			upper[a] = std::max(upper[a], p[a]);
+		}
+	}
+
+	int axis = 0;
+	for (int a = 1; a < 3; ++a)
+		if ( upper[a] - lower[a] > upper[axis] - lower[axis] )
+		    axis = a;
+
+	const int mid = lo + (hi - lo) / 2;
+	std::nth_element(__tree.begin() + lo, __tree.begin() + mid,
+	    __tree.begin() + hi, AxisLess(__xyz.constData(), axis));
+	__axis[mid] = (char) axis;
+
+	buildNode(lo, mid);
+	buildNode(mid + 1, hi);
+}
+
+
+void StationIndex::searchRadius(const int& lo, const int& hi, const double* q,
+                                const double& limit, HitList& hits) const {
+
+	if ( hi <= lo ) return;
+
+	const int mid = lo + (hi - lo) / 2;
+	const int idx = __tree.at(mid);
+	const double d2 = squaredChord(idx, q);
+	if ( d2 <= limit )
+	    hits << Hit(idx, d2);
+
+	const int axis = __axis.at(mid);
+	const double diff = q[axis] - __xyz.at(3 * idx + axis);
+	if ( diff <= .0 ) {
+		searchRadius(lo, mid, q, limit, hits);
+		if ( diff * diff <= limit )
+		    searchRadius(mid + 1, hi, q, limit, hits);
+	}
+	else {
+		searchRadius(mid + 1, hi, q, limit, hits);
+		if ( diff * diff <= limit )
+		    searchRadius(lo, mid, q, limit, hits);
+	}
+}
+
+
+void StationIndex::searchNearest(const int& lo, const int& hi, const double* q,
+                                 const int& count, QVector<Hit>& heap) const {
+
+	if ( hi <= lo ) return;
+
+	const int mid = lo + (hi - lo) / 2;
+	const int idx = __tree.at(mid);
+	const Hit hit(idx, squaredChord(idx, q));
+
+	if ( heap.size() < count ) {
+		heap << hit;
+		std::push_heap(heap.begin(), heap.end(), hitLessThan);
+	}
+	else if ( hitLessThan(hit, heap.first()) ) {
+		std::pop_heap(heap.begin(), heap.end(), hitLessThan);
+		heap.last() = hit;
+		std::push_heap(heap.begin(), heap.end(), hitLessThan);
+	}
+
+	const int axis = __axis.at(mid);
+	const double diff = q[axis] - __xyz.at(3 * idx + axis);
+	const bool left = diff <= .0;
+
+	if ( left )
+		searchNearest(lo, mid, q, count, heap);
+	else
+		searchNearest(mid + 1, hi, q, count, heap);
+
+	//! The other side may only hold closer stations than the farthest kept
+	//! when the splitting plane is closer than it
+	if ( heap.size() < count || diff * diff < heap.first().distance ) {
+		if ( left )
+			searchNearest(mid + 1, hi, q, count, heap);
+		else
+			searchNearest(lo, mid, q, count, heap);
+	}
+}
+
+
+double StationIndex::squaredChord(const int& index, const double* q) const {
+	const double* p = __xyz.constData() + 3 * index;
+	const double dx = p[0] - q[0];
+	const double dy = p[1] - q[1];
+	const double dz = p[2] - q[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+
+} // namespace Qt4
+} // namespace SDP
@@ -0,0 +1,138 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_STATIONINDEX_H__
+#define __SDP_QT4_DATAMODEL_STATIONINDEX_H__
+
+
+#include <QList>
+#include <QVector>
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+/**
+ * @class StationIndex
+ * @brief This class implements a spatial index over station coordinates.
+ *        It answers radius, bounding box and nearest stations queries
+ *        around a point, hits being sorted by great circle distance.
+ * @info  Stations are placed on the unit sphere and kept in a k-d tree,
+ *        the chord between two points grows with their great circle
+ *        distance so queries need no special care at the poles or across
+ *        the antimeridian. Bounding boxes are answered from the stations
+ *        sorted by latitude. The index is static, it is built again when
+ *        stations change.
+ */
+class StationIndex {
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		//! Coordinates in degrees
+		struct Location {
+				Location() :
+						latitude(.0), longitude(.0) {}
+				Location(const double& lat, const double& lon) :
+						latitude(lat), longitude(lon) {}
+				double latitude;
+				double longitude;
+		};
+		typedef QVector<Location> LocationList;
+
+		struct Hit {
+				Hit() :
+						index(-1), distance(.0) {}
+				Hit(const int& i, const double& d) :
+						index(i), distance(d) {}
+				//! Position of the station in the indexed locations
+				int index;
+				//! Great circle distance to the query point in kilometers
+				double distance;
+		};
+		typedef QList<Hit> HitList;
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		StationIndex();
+		~StationIndex();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		void build(const LocationList&);
+		void clear();
+		int size() const;
+		const Location& location(const int& index) const;
+
+		//! Stations within radius kilometers of the point
+		HitList radius(const Location&, const double& radius) const;
+
+		//! The count stations closest to the point
+		HitList nearest(const Location&, const int& count) const;
+
+		//! Stations inside the box, sorted by distance to its center. The
+		//! box crosses the antimeridian when minLongitude > maxLongitude.
+		HitList box(const double& minLatitude, const double& maxLatitude,
+		            const double& minLongitude, const double& maxLongitude) const;
+
+		//! Great circle distance in kilometers
+		static double distance(const Location&, const Location&);
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		void buildNode(const int& lo, const int& hi);
+		void searchRadius(const int& lo, const int& hi, const double* q,
+		                  const double& limit, HitList& hits) const;
+		void searchNearest(const int& lo, const int& hi, const double* q,
+		                   const int& count, QVector<Hit>& heap) const;
+		double squaredChord(const int& index, const double* q) const;
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		LocationList __locations;
+		//! Unit sphere coordinates, three by station
+		QVector<double> __xyz;
+		//! Implicit k-d tree, the median of a range is its node
+		QVector<int> __tree;
+		//! Split axis of the node at the same position in the tree
+		QVector<char> __axis;
+		//! Stations by ascending latitude
+		QVector<int> __byLatitude;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
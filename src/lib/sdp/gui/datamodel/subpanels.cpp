@@ -30,6 +30,7 @@
 #include <sdp/gui/datamodel/logger.h>
 #include <sdp/gui/datamodel/progress.h>
 #include <sdp/gui/datamodel/utils.h>
+#include <sdp/gui/datamodel/archiveindex.h>
 
 #include "ui_datasourcesubpanel.h"
 #include "ui_inventorysubpanel.h"
@@ -37,9 +38,13 @@
 #include "ui_entity.h"
 #include "ui_streamsubpanel.h"
 #include "ui_triggersubpanel.h"
+#include "ui_coveragesubpanel.h"
 
 #include <QtGui>
 #include <QtConcurrentRun>
+#include <QFutureWatcher>
+#include <algorithm>
+#include <limits>
 
 
 // >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
@@ -86,6 +91,159 @@ int getHeaderPosition(const enum StationTableHeaders& e) {
 static QString const ENDL = "\n";
 static QString const TAB = "    ";
 
+/** @brief Coverage table headers */
+const char* CoverageTableHeaders[] = { "Stream", "Coverage", "Gaps", "Files" };
+
+/**
+ * @brief  Formats a time span of the archive index (microseconds)
+ * @return The span as 'Nd HH:mm:ss.zzz', days being omitted when null
+ */
+QString spanDuration(const qint64& us) {
+	const qint64 ms = us / 1000;
+	const qint64 days = ms / 86400000;
+	const QTime t = QTime(0, 0).addMSecs(ms % 86400000);
+	return ( days ? QString("%1d ").arg(days) : QString() ) + t.toString("HH:mm:ss.zzz");
+}
+
+
+using SDP::Qt4::StationIndex;
+
+/**
+ * @brief Asks for a location query over the loaded stations: the ones
+ *        within a radius or the nearest ones around a point, or the ones
+ *        inside a latitude/longitude box.
+ */
+class LocationQueryDialog : public QDialog {
+
+	public:
+		enum Mode {
+			Radius, Nearest, Box
+		};
+
+		LocationQueryDialog(const StationIndex::Location& point, QWidget* parent) :
+				QDialog(parent) {
+
+			setWindowTitle(tr("Select stations by location"));
+
+			__latitude = coordinateBox(90., point.latitude);
+			__longitude = coordinateBox(180., point.longitude);
+			__mode = new QComboBox(this);
+			__mode->addItem(tr("Stations within a radius"));
+			__mode->addItem(tr("Nearest stations"));
+			__mode->addItem(tr("Stations inside a box"));
+
+			QFormLayout* form = new QFormLayout;
+			form->addRow(tr("Latitude"), __latitude);
+			form->addRow(tr("Longitude"), __longitude);
+			form->addRow(tr("Selection"), __mode);
+			__latitude->setToolTip(tr("Stations are ordered by their distance to this point"));
+			__longitude->setToolTip(__latitude->toolTip());
+
+			__radius = new QDoubleSpinBox(this);
+			__radius->setRange(.0, 20038.);
+			__radius->setDecimals(1);
+			__radius->setSuffix(" km");
+			__radius->setValue(100.);
+			QWidget* radiusPage = new QWidget(this);
+			QFormLayout* radiusForm = new QFormLayout(radiusPage);
+			radiusForm->addRow(tr("Radius"), __radius);
+
+			__count = new QSpinBox(this);
+			__count->setRange(1, std::numeric_limits<int>::max());
+			__count->setValue(10);
+			QWidget* nearestPage = new QWidget(this);
+			QFormLayout* nearestForm = new QFormLayout(nearestPage);
+			nearestForm->addRow(tr("Stations"), __count);
+
+			__minLatitude = coordinateBox(90., std::max(-90., point.latitude - 1.));
+			__maxLatitude = coordinateBox(90., std::min(90., point.latitude + 1.));
+			__minLongitude = coordinateBox(180., std::max(-180., point.longitude - 1.));
+			__maxLongitude = coordinateBox(180., std::min(180., point.longitude + 1.));
+			__minLongitude->setToolTip(tr("The box crosses the antimeridian when "
+			    "the minimum longitude is greater than the maximum one"));
+			QWidget* boxPage = new QWidget(this);
+			QFormLayout* boxForm = new QFormLayout(boxPage);
+			boxForm->addRow(tr("Minimum latitude"), __minLatitude);
+			boxForm->addRow(tr("Maximum latitude"), __maxLatitude);
+			boxForm->addRow(tr("Minimum longitude"), __minLongitude);
+			boxForm->addRow(tr("Maximum longitude"), __maxLongitude);
+
+			QStackedWidget* pages = new QStackedWidget(this);
+			pages->addWidget(radiusPage);
+			pages->addWidget(nearestPage);
+			pages->addWidget(boxPage);
+			connect(__mode, SIGNAL(currentIndexChanged(int)), pages, SLOT(setCurrentIndex(int)));
+
+			__replace = new QCheckBox(tr("Replace the stations of the inventory"), this);
+			__replace->setChecked(true);
+
+			QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok
+			    | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+			connect(buttons, SIGNAL(accepted()), this, SLOT(accept()));
+			connect(buttons, SIGNAL(rejected()), this, SLOT(reject()));
+
+			QVBoxLayout* layout = new QVBoxLayout(this);
+			layout->addLayout(form);
+			layout->addWidget(pages);
+			layout->addWidget(__replace);
+			layout->addWidget(buttons);
+		}
+
+		Mode mode() const {
+			return static_cast<Mode>(__mode->currentIndex());
+		}
+		StationIndex::Location point() const {
+			return StationIndex::Location(__latitude->value(), __longitude->value());
+		}
+		double radius() const {
+			return __radius->value();
+		}
+		int count() const {
+			return __count->value();
+		}
+		double minLatitude() const {
+			return __minLatitude->value();
+		}
+		double maxLatitude() const {
+			return __maxLatitude->value();
+		}
+		double minLongitude() const {
+			return __minLongitude->value();
+		}
+		double maxLongitude() const {
+			return __maxLongitude->value();
+		}
+		bool replace() const {
+			return __replace->isChecked();
+		}
+
+	private:
+		QDoubleSpinBox* coordinateBox(const double& range, const double& value) {
+			QDoubleSpinBox* box = new QDoubleSpinBox(this);
+			box->setRange(-range, range);
+			box->setDecimals(4);
+			box->setValue(value);
+			return box;
+		}
+
+		QDoubleSpinBox* __latitude;
+		QDoubleSpinBox* __longitude;
+		QComboBox* __mode;
+		QDoubleSpinBox* __radius;
+		QSpinBox* __count;
+		QDoubleSpinBox* __minLatitude;
+		QDoubleSpinBox* __maxLatitude;
+		QDoubleSpinBox* __minLongitude;
+		QDoubleSpinBox* __maxLongitude;
+		QCheckBox* __replace;
+};
+
+
+bool distanceLessThan(const QPair<double, SDP::Qt4::InventorySubPanel::Entity*>& a,
+                      const QPair<double, SDP::Qt4::InventorySubPanel::Entity*>& b) {
+	return a.first < b.first;
+}
+
 }
 // <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
@@ -95,20 +253,26 @@ namespace SDP {
 namespace Qt4 {
 
 DataSourceSubPanel::DataSourceSubPanel(QWidget* parent) :
-		QWidget(parent), __ui(new Ui::DataSource) {
+		QWidget(parent), __ui(new Ui::DataSource),
+		__scanner(new QFutureWatcher<ArchiveIndex::StreamEntryList>(this)) {
 
 	__ui->setupUi(this);
 	__ui->frameFile->hide();
+	__ui->frameArchive->hide();
 
 	QButtonGroup* source = new QButtonGroup(this);
 	source->addButton(__ui->radioButtonFile);
 	source->addButton(__ui->radioButtonArclinkServer);
+	source->addButton(__ui->radioButtonArchive);
 
 	connect(__ui->radioButtonFile, SIGNAL(toggled(bool)), __ui->frameFile, SLOT(setVisible(bool)));
 	connect(__ui->radioButtonFile, SIGNAL(toggled(bool)), this, SIGNAL(setTimeWindowAccessible(bool)));
 	connect(__ui->radioButtonArclinkServer, SIGNAL(toggled(bool)), __ui->frameArcServer, SLOT(setVisible(bool)));
 	connect(__ui->radioButtonFileInventory, SIGNAL(toggled(bool)), this, SLOT(readFileInventory(bool)));
 	connect(__ui->toolButtonFile, SIGNAL(clicked()), this, SLOT(selectDataFile()));
+	connect(__ui->radioButtonArchive, SIGNAL(toggled(bool)), __ui->frameArchive, SLOT(setVisible(bool)));
+	connect(__ui->toolButtonArchiveDir, SIGNAL(clicked()), this, SLOT(selectArchiveDir()));
+	connect(__scanner, SIGNAL(finished()), this, SLOT(streamInventoryRead()));
 
 	__ui->radioButtonArclinkServer->setChecked(true);
 	__ui->radioButtonCustomInventory->setChecked(true);
@@ -131,6 +295,10 @@ DataSourceSubPanel::DataSourceSubPanel(QWidget* parent) :
 	pm->registerParameter("dataSourceArcserverUser");
 	pm->registerParameter("dataSourceArcserverPassword");
 	pm->registerParameter("dataSourceArcserverInstitution");
+	pm->registerParameter("dataSourceArchive");
+	pm->registerParameter("dataSourceArchiveDir");
+	pm->registerParameter("dataSourceArchivePattern");
+	pm->registerParameter("dataSourceArchiveSidecar");
 
 	//! Job parameters
 	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceFile");
@@ -142,10 +310,17 @@ DataSourceSubPanel::DataSourceSubPanel(QWidget* parent) :
 	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArcserverUser");
 	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArcserverPassword");
 	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArcserverInstitution");
+	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArchive");
+	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArchiveDir");
+	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArchivePattern");
+	pm->registerObjectParameter("DataSourceSubPanel", "dataSourceArchiveSidecar");
 }
 
 
-DataSourceSubPanel::~DataSourceSubPanel() {}
+DataSourceSubPanel::~DataSourceSubPanel() {
+	//! The running scan reports failures into this panel
+	__scanner->waitForFinished();
+}
 
 
 bool DataSourceSubPanel::saveParameters() {
@@ -162,6 +337,10 @@ bool DataSourceSubPanel::saveParameters() {
 	w->setParameter("dataSourceArcserverUser", QVariant::fromValue(__ui->lineEditArclinkServerUser->text()));
 	w->setParameter("dataSourceArcserverPassword", QVariant::fromValue(__ui->lineEditArclinkServerPassword->text()));
 	w->setParameter("dataSourceArcserverInstitution", QVariant::fromValue(__ui->lineEditArclnkServerInstitution->text()));
+	w->setParameter("dataSourceArchive", QVariant::fromValue(__ui->radioButtonArchive->isChecked()));
+	w->setParameter("dataSourceArchiveDir", QVariant::fromValue(__ui->lineEditArchiveDir->text()));
+	w->setParameter("dataSourceArchivePattern", QVariant::fromValue(__ui->lineEditArchivePattern->text()));
+	w->setParameter("dataSourceArchiveSidecar", QVariant::fromValue(__ui->checkBoxArchiveIndex->isChecked()));
 
 	w->setObjectParameter("DataSourceSubPanel", "dataSourceFile", QVariant::fromValue(__ui->radioButtonFile->isChecked()));
 	w->setObjectParameter("DataSourceSubPanel", "dataSourceFilepath", QVariant::fromValue(__ui->lineEditFile->text()));
@@ -171,6 +350,10 @@ bool DataSourceSubPanel::saveParameters() {
 	w->setObjectParameter("DataSourceSubPanel", "dataSourceArcserverUser", QVariant::fromValue(__ui->lineEditArclinkServerUser->text()));
 	w->setObjectParameter("DataSourceSubPanel", "dataSourceArcserverPassword", QVariant::fromValue(__ui->lineEditArclinkServerPassword->text()));
 	w->setObjectParameter("DataSourceSubPanel", "dataSourceArcserverInstitution", QVariant::fromValue(__ui->lineEditArclnkServerInstitution->text()));
+	w->setObjectParameter("DataSourceSubPanel", "dataSourceArchive", QVariant::fromValue(__ui->radioButtonArchive->isChecked()));
+	w->setObjectParameter("DataSourceSubPanel", "dataSourceArchiveDir", QVariant::fromValue(__ui->lineEditArchiveDir->text()));
+	w->setObjectParameter("DataSourceSubPanel", "dataSourceArchivePattern", QVariant::fromValue(__ui->lineEditArchivePattern->text()));
+	w->setObjectParameter("DataSourceSubPanel", "dataSourceArchiveSidecar", QVariant::fromValue(__ui->checkBoxArchiveIndex->isChecked()));
 
 	return true;
 }
@@ -189,6 +372,11 @@ bool DataSourceSubPanel::loadParameters() {
 	__ui->lineEditArclinkServerUser->setText(w->objectParameter("DataSourceSubPanel", "dataSourceArcserverUser").toString());
 	__ui->lineEditArclinkServerPassword->setText(w->objectParameter("DataSourceSubPanel", "dataSourceArcserverPassword").toString());
 	__ui->lineEditArclnkServerInstitution->setText(w->objectParameter("DataSourceSubPanel", "dataSourceArcserverInstitution").toString());
+	__ui->radioButtonArchive->setChecked(w->objectParameter("DataSourceSubPanel", "dataSourceArchive").toBool());
+	__ui->lineEditArchiveDir->setText(w->objectParameter("DataSourceSubPanel", "dataSourceArchiveDir").toString());
+	if ( !w->objectParameter("DataSourceSubPanel", "dataSourceArchivePattern").toString().isEmpty() )
+	    __ui->lineEditArchivePattern->setText(w->objectParameter("DataSourceSubPanel", "dataSourceArchivePattern").toString());
+	__ui->checkBoxArchiveIndex->setChecked(w->objectParameter("DataSourceSubPanel", "dataSourceArchiveSidecar").toBool());
 
 	return true;
 }
@@ -236,6 +424,9 @@ bool DataSourceSubPanel::loadConfiguration() {
 			try {
 				p.arclinkTimeout = cfg->getInt("dataSource.preset." + p.name + ".arclinkTimeout");
 			} catch ( ... ) {}
+			try {
+				p.archivePattern = cfg->getString("dataSource.preset." + p.name + ".pattern");
+			} catch ( ... ) {}
 
 			__presets << p;
 		}
@@ -246,6 +437,16 @@ bool DataSourceSubPanel::loadConfiguration() {
 	for (int i = 0; i < __presets.size(); ++i)
 		__ui->comboBoxPreset->insertItem(i + 1, __presets.at(i).name);
 
+	//! The SDS archive defaults to the one the dispatch tools fill
+	try {
+		__ui->lineEditArchiveDir->setText(cfg->getString("dispatch.sds.folder"));
+	} catch ( ... ) {}
+	try {
+		const QString pattern = cfg->getString("dispatch.sds.pattern");
+		if ( !pattern.isEmpty() )
+		    __ui->lineEditArchivePattern->setText(pattern);
+	} catch ( ... ) {}
+
 	return true;
 }
 
@@ -261,6 +462,24 @@ bool DataSourceSubPanel::sourceIsOkay() {
 		return false;
 	}
 
+	if ( __ui->radioButtonArchive->isChecked()
+	    && !QDir(__ui->lineEditArchiveDir->text()).exists() ) {
+		QMessageBox::critical(this, tr("Data source error"),
+		    tr("You have specified that the source should be an SDS archive, "
+			    "but the archive directory doesn't exist!"));
+		__ui->lineEditArchiveDir->setFocus();
+		return false;
+	}
+
+	if ( __ui->radioButtonArchive->isChecked()
+	    && __ui->lineEditArchivePattern->text().isEmpty() ) {
+		QMessageBox::critical(this, tr("Data source error"),
+		    tr("You have specified that the source should be an SDS archive, "
+			    "but yet you haven't specified the layout of its files!"));
+		__ui->lineEditArchivePattern->setFocus();
+		return false;
+	}
+
 	return true;
 }
 
@@ -288,6 +507,12 @@ void DataSourceSubPanel::loadPreset(int idx) {
 				__ui->radioButtonFile->setChecked(true);
 				__ui->lineEditFile->setText(__presets.at(i).sourceAddress);
 			}
+			else if ( __presets.at(i).sourceType.contains("sds") ) {
+				__ui->radioButtonArchive->setChecked(true);
+				__ui->lineEditArchiveDir->setText(__presets.at(i).sourceAddress);
+				if ( !__presets.at(i).archivePattern.isEmpty() )
+				    __ui->lineEditArchivePattern->setText(__presets.at(i).archivePattern);
+			}
 		}
 	}
 }
@@ -303,6 +528,15 @@ void DataSourceSubPanel::selectDataFile() {
 }
 
 
+void DataSourceSubPanel::selectArchiveDir() {
+
+	QString dir = QFileDialog::getExistingDirectory(this, tr("Select SDS directory"));
+	if ( dir.isEmpty() ) return;
+
+	__ui->lineEditArchiveDir->setText(dir);
+}
+
+
 void DataSourceSubPanel::readFileInventory(bool checked) {
 
 	/*
@@ -322,108 +556,99 @@ void DataSourceSubPanel::readFileInventory(bool checked) {
 
 void DataSourceSubPanel::readSEEDInventory() {
 
-	//! TODO: Find a way to verify that the file specified is a legti miniSEED
-	//! file, otherwise, this all operation could go boom...
+	SDPASSERT(Logger::instancePtr());
+	Logger* log = Logger::instancePtr();
+
+	if ( __scanner->isRunning() ) return;
+
+	//! The file may be a pattern of files, as understood by ObsPy's read
+	const QFileInfo info(__ui->lineEditFile->text());
+	QStringList files;
+	if ( info.fileName().contains(QRegExp("[*?\\[]")) ) {
+		const QDir dir = info.dir();
+		const QStringList names = dir.entryList(QStringList() << info.fileName(),
+		    QDir::Files, QDir::Name);
+		for (int i = 0; i < names.size(); ++i)
+			files << dir.filePath(names.at(i));
+	}
+	else if ( info.isFile() )
+	    files << info.filePath();
+
+	if ( files.isEmpty() ) {
+		log->addMessage(Logger::WARNING, __func__,
+		    "No miniSEED file matches " + __ui->lineEditFile->text());
+		return;
+	}
+
+	__scanFiles = files;
+	__scanFailed.clear();
+	__ui->radioButtonFileInventory->setEnabled(false);
+
+	//! Only record headers are read, files are spread over the thread pool
+	__scanner->setFuture(QtConcurrent::run(&ArchiveIndex::scanFiles,
+	    __scanFiles, &__scanFailed));
+
+	log->addMessage(Logger::DEBUG, __func__,
+	    QString("Reading streams of %1 miniSEED file(s)").arg(files.size()));
+}
+
+
+void DataSourceSubPanel::streamInventoryRead() {
 
-	SDPASSERT(ParameterManager::instancePtr());
 	SDPASSERT(Logger::instancePtr());
 	SDPASSERT(InventorySubPanel::instancePtr());
 
-	ParameterManager* pm = ParameterManager::instancePtr();
 	Logger* log = Logger::instancePtr();
 	InventorySubPanel* inv = InventorySubPanel::instancePtr();
-	Progress prog(this, Qt::FramelessWindowHint);
-
-	const QString inventory = pm->parameter("DATA_DIR").toString() + QDir::separator() + "streams.list";
-	QString script;
-	script += "#!" + pm->parameter("ENV_BIN").toString() + " python" + ENDL;
-	script += ENDL;
-	script += "\"\"\"" + ENDL;
-	script += "############################################################" + ENDL;
-	script += TAB + PROJECT_NAME + "-" + PROJECT_VERSION + ENDL;
-	script += TAB + "File type: stream list script." + ENDL;
-	script += TAB + "Datetime: " + QDateTime::currentDateTime().toString() + ENDL;
-	script += "############################################################" + ENDL;
-	script += "\"\"\"" + ENDL;
-	script += ENDL;
-	script += "from obspy import read" + ENDL;
-	script += "st = read(\"" + __ui->lineEditFile->text() + "\")" + ENDL;
-	script += "with open(\"" + inventory + "\", \"w\") as inventory:" + ENDL;
-	script += TAB + "inventory.write(\"%s\" % st)" + ENDL;
-	script += ENDL;
-
-	const QString scriptFile = pm->parameter("DATA_DIR").toString() + QDir::separator() + "liststreams.py";
-
-	if ( !Utils::writeScript(scriptFile, script) ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to write script "
-		    + scriptFile + " for inventory identification from stream");
-		return;
-	}
-	if ( !Utils::fileExists(scriptFile) ) {
-		log->addMessage(Logger::CRITICAL, __func__,
-		    "Didn't find written python script " + scriptFile + " for inventory identification");
-		return;
-	}
 
-	prog.show("Loading inventory from miniSEED file");
+	__ui->radioButtonFileInventory->setEnabled(true);
 
-	QProcess proc(this);
-	proc.setWorkingDirectory(pm->parameter("DATA_DIR").toString());
-	proc.start(QString("%1 -u %2")
-	    .arg(pm->parameter("PYTHON_BIN").toString())
-	    .arg(scriptFile), QProcess::Unbuffered | QProcess::ReadOnly);
-	if ( !proc.waitForStarted() ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to wait for python process to start");
-		prog.hide();
-		return;
-	}
+	for (int i = 0; i < __scanFailed.size(); ++i)
+		log->addMessage(Logger::WARNING, __func__, "Failed to read miniSEED file " + __scanFailed.at(i));
 
-	if ( !proc.waitForFinished() ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to wait python process to terminate");
-		prog.hide();
-		return;
-	}
+	//! Channels of a station are gathered, its location is the first one read
+	const ArchiveIndex::StreamEntryList streams = __scanner->result();
+	QMap<QString, InventorySubPanel::PairedString> stations;
+	for (int i = 0; i < streams.size(); ++i) {
 
-	if ( !Utils::fileExists(inventory) ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to read python generated output " + inventory);
-		prog.hide();
-		return;
-	}
+		const ArchiveIndex::StreamEntry& se = streams.at(i);
+		const QStringList codes = se.stream.split('.');
+		if ( codes.size() != 4 || se.spans.isEmpty() ) continue;
 
+		log->addMessage(Logger::DEBUG, __func__, QString("%1 from %2 to %3 at %4 Hz, %5 gap(s)")
+		    .arg(se.stream)
+		    .arg(ArchiveIndex::fromTime(se.spans.first().start).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+		    .arg(ArchiveIndex::fromTime(se.spans.last().end).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+		    .arg(se.samplingRate).arg(se.gaps()), false);
 
-	QFile file(inventory);
-	if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
-		log->addMessage(Logger::WARNING, __func__,
-		    "Failed to open inventory file " + inventory);
-		prog.hide();
-		return;
+		const QString key = codes.at(0) + "." + codes.at(1);
+		QMap<QString, InventorySubPanel::PairedString>::iterator it = stations.find(key);
+		if ( it == stations.end() )
+			stations.insert(key, InventorySubPanel::PairedString(codes.at(3), codes.at(2)));
+		else if ( !it->first.split(", ").contains(codes.at(3)) )
+		    it->first += ", " + codes.at(3);
 	}
 
-	QTextStream in(&file);
-	while ( !in.atEnd() ) {
-		QString line = in.readLine();
-		if ( line.isEmpty() ) continue;
-		if ( !line.contains('|') ) continue;
-		QStringList list = line.split('|');
-		if ( list.size() != 3 ) continue;
+	int added = 0;
+	for (QMap<QString, InventorySubPanel::PairedString>::const_iterator it = stations.constBegin();
+	        it != stations.constEnd(); ++it) {
 
-		QStringList data = list[0].trimmed().split('.');
-		if ( data.size() < 2 ) {
-			log->addMessage(Logger::WARNING, __func__,
-			    "Wrong inventory net+sta+loc+chan (" + line + ")");
-			continue;
-		}
-		inv->addNetwork(data.at(0));
-		inv->addStation(data.at(0), data.at(1),
-		    data.size() == 4 ? data.at(2) : "",
-		    data.size() == 4 ? data.at(3) : "");
+		const QString net = it.key().section('.', 0, 0);
+		const QString sta = it.key().section('.', 1, 1);
+		if ( inv->getStation(net, sta) ) continue;
+
+		if ( !inv->getNetwork(net) )
+		    inv->addNetwork(net);
+		inv->addStation(net, sta, it->second, it->first);
+		++added;
 	}
-	file.close();
 
-	prog.hide();
+	log->addMessage(Logger::DEBUG, __func__, QString("Read %1 stream(s) from %2 miniSEED file(s), "
+	    "%3 new station(s) added to inventory").arg(streams.size()).arg(__scanFiles.size()).arg(added));
 
 	QMessageBox::information(this, tr("Populate inventory"),
-	    QString("Inventory has been fed with %1 entities").arg(inv->entities().size()));
+	    QString("Inventory has been fed with %1 station(s) from %2 stream(s)")
+	        .arg(added).arg(streams.size()));
 }
 
 
@@ -736,7 +961,8 @@ InventorySubPanel::Entity::Entity::~Entity() {
 
 
 InventorySubPanel::InventorySubPanel(QWidget* parent) :
-		QWidget(parent), __ui(new Ui::Inventory), __selectedEntity(NULL) {
+		QWidget(parent), __ui(new Ui::Inventory), __selectedEntity(NULL),
+		__loader(new QFutureWatcher<Dataless::Result>(this)), __hasOrigin(false) {
 
 	__ui->setupUi(this);
 
@@ -755,6 +981,7 @@ InventorySubPanel::InventorySubPanel(QWidget* parent) :
 	connect(__ui->radioButtonUseDataless, SIGNAL(toggled(bool)), __ui->toolButton, SLOT(setEnabled(bool)));
 	connect(__ui->radioButtonUseStationsSummary, SIGNAL(toggled(bool)), __ui->toolButton, SLOT(setEnabled(bool)));
 	connect(__ui->toolButton, SIGNAL(clicked()), this, SLOT(loadInventoryFromFile()));
+	connect(__loader, SIGNAL(finished()), this, SLOT(inventoryFileLoaded()));
 
 	__ui->lineEdit->setEnabled(false);
 	__ui->toolButton->setEnabled(false);
@@ -781,25 +1008,8 @@ bool InventorySubPanel::saveParameters() {
 
 bool InventorySubPanel::loadParameters() {
 
-	//! Clean up entities in list
-	QList<Entity*> children;
-	for (int i = 0; i < __entities.size(); ++i)
-		if ( __entities.at(i)->parent )
-		    children << __entities.at(i);
-
-	for (int i = 0; i < children.size(); ++i)
-		removeStation(children.at(i)->parent->name, children.at(i)->name);
-
-	for (int i = 0; i < __entities.size(); ++i)
-		if ( !__entities.at(i)->parent )
-		    delete __entities.takeAt(i);
-
-	__entities.clear();
-
-	//! Clean up entities in tree
-	__ui->treeWidgetInventory->clear();
-
-
+	clearEntities();
+	__hasOrigin = false;
 
 	return true;
 }
@@ -807,28 +1017,14 @@ bool InventorySubPanel::loadParameters() {
 
 InventorySubPanel::Entity*
 InventorySubPanel::getNetwork(const QString& code) {
-
-	for (EntityList::const_iterator it = __entities.constBegin();
-	        it != __entities.constEnd(); ++it)
-		if ( (*it)->name == code && !(*it)->parent )
-		    return (*it);
-
-	return NULL;
+	return __index.value(code, NULL);
 }
 
 
 InventorySubPanel::Entity*
 InventorySubPanel::getStation(const QString& networkCode,
                               const QString& stationCode) {
-
-	for (EntityList::const_iterator it = __entities.constBegin();
-	        it != __entities.constEnd(); ++it) {
-		if ( !(*it)->parent ) continue;
-		if ( (*it)->parent->name == networkCode && (*it)->name == stationCode )
-		    return (*it);
-	}
-
-	return NULL;
+	return __index.value(networkCode + "." + stationCode, NULL);
 }
 
 
@@ -844,6 +1040,7 @@ void InventorySubPanel::removeNetwork(const QString& code) {
 	for (int i = 0; i < children.size(); ++i)
 		removeStation(children.at(i)->parent->name, children.at(i)->name);
 
+	__index.remove(code);
 	for (int i = 0; i < __entities.size(); ++i) {
 		if ( __entities.at(i)->name == code && !__entities.at(i)->parent )
 		    delete __entities.takeAt(i);
@@ -854,6 +1051,7 @@ void InventorySubPanel::removeNetwork(const QString& code) {
 void InventorySubPanel::removeStation(const QString& networkCode,
                                       const QString& stationCode) {
 
+	__index.remove(networkCode + "." + stationCode);
 	for (int i = 0; i < __entities.size(); ++i) {
 		if ( __entities.at(i)->parent )
 		    if ( __entities.at(i)->parent->name == networkCode
@@ -866,30 +1064,33 @@ void InventorySubPanel::removeStation(const QString& networkCode,
 QString InventorySubPanel::pythonStations(const QString& netVar,
                                           const QString& staVar) {
 
-	bool isFirstItem = true;
-	QString script = netVar + " = [ ";
+	//! Stations are ordered by distance to the point of the last location
+	//! query, the ones without known coordinates come last
+	QList<QPair<double, Entity*> > stations;
 	for (int i = 0; i < __entities.size(); ++i) {
 		if ( !__entities.at(i)->parent ) continue;
-		if ( isFirstItem ) {
-			script += "\"" + __entities.at(i)->parent->name + "\"";
-			isFirstItem = false;
+		double distance = .0;
+		if ( __hasOrigin ) {
+			const int idx = __stationIndex.value(__entities.at(i)->parent->name
+			    + "." + __entities.at(i)->name, -1);
+			distance = ( idx < 0 || !__stations.at(idx).located ) ?
+			    std::numeric_limits<double>::max() :
+			    StationIndex::distance(__origin, StationIndex::Location(
+			        __stations.at(idx).latitude, __stations.at(idx).longitude));
 		}
-		else
-			script += ", \"" + __entities.at(i)->parent->name + "\"";
+		stations << qMakePair(distance, __entities.at(i));
 	}
+	if ( __hasOrigin )
+	    std::stable_sort(stations.begin(), stations.end(), distanceLessThan);
+
+	QString script = netVar + " = [ ";
+	for (int i = 0; i < stations.size(); ++i)
+		script += ( i ? ", \"" : "\"" ) + stations.at(i).second->parent->name + "\"";
 	script += " ]" + ENDL;
 
-	isFirstItem = true;
 	script += staVar + " = [ ";
-	for (int i = 0; i < __entities.size(); ++i) {
-		if ( !__entities.at(i)->parent ) continue;
-		if ( isFirstItem ) {
-			script += "\"" + __entities.at(i)->name + "\"";
-			isFirstItem = false;
-		}
-		else
-			script += ", \"" + __entities.at(i)->name + "\"";
-	}
+	for (int i = 0; i < stations.size(); ++i)
+		script += ( i ? ", \"" : "\"" ) + stations.at(i).second->name + "\"";
 	script += " ]" + ENDL;
 
 	return script;
@@ -920,151 +1121,70 @@ int InventorySubPanel::stationCount() {
 }
 
 
-void InventorySubPanel::loadASCIIDataless(const QString& filename,
-                                          ASCIIDatalessFormat f) {
-
-	SDPASSERT(Logger::instancePtr());
-	Logger* log = Logger::instancePtr();
-
-	QFile file(filename);
-	if ( !file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
-		log->addMessage(Logger::WARNING, __func__, "Failed to open response station file " + filename);
-		return;
-	}
-
-	QTextStream in(&file);
-	while ( !in.atEnd() ) {
-
-		QString line = in.readLine();
-
-		if ( line.isEmpty() ) continue;
-
-		if ( f == Custom ) {
+void InventorySubPanel::feedStations(const Dataless::ChannelList& channels) {
 
-			//! This small hack is to make sure the file format is as we'd like
-			//! it to be : 14 fields delimited by comma. The said format should
-			//! be like this :
-			//! ZU,CAPH,19.7355,-72.1883,17.0,2013-08-2T00:00:00,2013-10-10T23:59:00,HHZ, ,HHN, ,HHE, ,
-			//! Although I don't recall this being a famous format, that's at
-			//! the moment the only material we can sink our teeth into.
-			//! TODO: Make this way more configurable in the future, and if
-			//! possible, eventually read pure dataless binary files...
+	//! Channels of a station are gathered, its coordinates are the ones of
+	//! the first channel read which has some
+	for (int i = 0; i < channels.size(); ++i) {
 
-			QStringList xline = line.split(',');
-			if ( xline.size() != 14 ) continue;
+		const Dataless::Channel& c = channels.at(i);
+		const QString key = c.network + "." + c.station;
 
+		QHash<QString, int>::const_iterator it = __stationIndex.constFind(key);
+		if ( it == __stationIndex.constEnd() ) {
 			RespStation s;
-			s.network = xline.at(0).trimmed();
-			s.code = xline.at(1).trimmed();
-			s.latitude = xline.at(2).toDouble();
-			s.longitude = xline.at(3).toDouble();
-			s.elevation = xline.at(4).toDouble();
-			s.start = QDateTime::fromString(xline.at(5).trimmed(), Qt::ISODate);
-			s.end = QDateTime::fromString(xline.at(6).trimmed(), Qt::ISODate);
-			s.locchan.push_back(PairedString(xline.at(7).trimmed(), xline.at(8).trimmed()));
-			s.locchan.push_back(PairedString(xline.at(9).trimmed(), xline.at(10).trimmed()));
-			s.locchan.push_back(PairedString(xline.at(11).trimmed(), xline.at(12).trimmed()));
-
-			if ( __stations.contains(s) ) continue;
-
+			s.network = c.network;
+			s.code = c.station;
+			s.latitude = c.latitude;
+			s.longitude = c.longitude;
+			s.elevation = c.elevation;
+			s.located = c.located;
+			s.start = c.start;
+			s.end = c.end;
+			it = __stationIndex.insert(key, __stations.size());
 			__stations << s;
-			log->addMessage(Logger::DEBUG, __func__,
-			    "Fed inventory with station " + s.code + " from network " + s.network, false);
 		}
-		else if ( f == RdseedStationSummary ) {
-
-			//! Only read first 44 chars
-			if ( line.size() < 45 ) continue;
-			QString formatted = line.replace(" ", ",");
-			QStringList xline = line.left(44).split(",");
+		else if ( c.located && !__stations.at(it.value()).located ) {
+			RespStation& s = __stations[it.value()];
+			s.latitude = c.latitude;
+			s.longitude = c.longitude;
+			s.elevation = c.elevation;
+			s.located = true;
+		}
 
-			RespStation s;
-			s.network = xline.at(1).trimmed();
-			s.code = xline.at(0).trimmed();
-			s.latitude = xline.at(2).toDouble();
-			s.longitude = xline.at(3).toDouble();
-			s.elevation = xline.at(4).toDouble();
-//			s.start = QDateTime::fromString(xline.at(5).trimmed(), Qt::ISODate);
-//			s.end = QDateTime::fromString(xline.at(6).trimmed(), Qt::ISODate);
-//			s.locchan.push_back(PairedString(xline.at(7).trimmed(), xline.at(8).trimmed()));
-//			s.locchan.push_back(PairedString(xline.at(9).trimmed(), xline.at(10).trimmed()));
-//			s.locchan.push_back(PairedString(xline.at(11).trimmed(), xline.at(12).trimmed()));
-
-			if ( __stations.contains(s) ) continue;
+		if ( c.channel.isEmpty() ) continue;
 
-			__stations << s;
-			log->addMessage(Logger::DEBUG, __func__,
-			    "Fed inventory with station " + s.code + " from network " + s.network, false);
-		}
+		const PairedString lc(c.channel, c.location);
+		RespStation& s = __stations[it.value()];
+		if ( !s.locchan.contains(lc) )
+		    s.locchan << lc;
 	}
-
-	file.close();
 }
 
 
-void InventorySubPanel::loadBinaryDataless(const QString& filename) {
+void InventorySubPanel::addRespStation(const RespStation& s) {
 
-	SDPASSERT(ParameterManager::instancePtr());
-	SDPASSERT(Logger::instancePtr());
-//	SDPASSERT(Progress::instancePtr());
-
-	ParameterManager* pm = ParameterManager::instancePtr();
-	Logger* log = Logger::instancePtr();
-	Progress prog(this, Qt::FramelessWindowHint);
-
-	if ( !Utils::fileExists(pm->parameter("RDSEED_BIN").toString()) ) {
-		QMessageBox::critical(this, tr("rdseed error"),
-		    QString("This operation requires rdseed, please verify that you've "
-			    "correctly specified its location. (User param: %1)")
-		        .arg(pm->parameter("RDSEED_BIN").toString()));
-		return;
-	}
+	if ( !getNetwork(s.network) )
+	    addNetwork(s.network);
 
-	//! Generate stations summary info
-	QString scriptData = "#!" + pm->parameter("BASH_BIN").toString() + "\n";
-	scriptData += pm->parameter("RDSEED_BIN").toString() + " -Sf " + filename
-	    + " -q " + pm->parameter("DATA_DIR").toString() + QDir::separator() + "\n";
-	const QString scriptFile = pm->parameter("DATA_DIR").toString() + QDir::separator() + "convertdataless.sh";
+	QString chans;
+	for (int j = 0; j < s.locchan.size(); ++j)
+		chans += (j ? ", " : "") + s.locchan.at(j).first;
 
-	if ( !Utils::writeScript(scriptFile, scriptData) ) {
-		log->addMessage(Logger::CRITICAL, __func__,
-		    "Failed to write rdseed script for file " + filename);
-		return;
-	}
-	if ( !Utils::fileExists(scriptFile) ) {
-		log->addMessage(Logger::CRITICAL, __func__,
-		    "Didn't find written rdseed script " + scriptFile + " for file " + filename);
-		return;
-	}
-
-	prog.show("Loading binary dataless");
-
-	QProcess proc(this);
-	proc.setWorkingDirectory(pm->parameter("DATA_DIR").toString());
-	proc.start(QString("%1 %2")
-	    .arg(pm->parameter("BASH_BIN").toString())
-	    .arg(scriptFile), QProcess::Unbuffered | QProcess::ReadOnly);
-	if ( !proc.waitForStarted() ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to wait for rdseed process to start");
-		prog.hide();
-		return;
-	}
+	if ( s.locchan.size() != 0 )
+		addStation(s.network, s.code, s.locchan.at(0).second, chans);
+	else
+		addStation(s.network, s.code, "", "");
+}
 
-	if ( !proc.waitForFinished() ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to wait rdseed process to terminate");
-		prog.hide();
-		return;
-	}
 
-	const QString output = pm->parameter("DATA_DIR").toString() + QDir::separator() + "rdseed.stations";
-	if ( !Utils::fileExists(output) ) {
-		log->addMessage(Logger::CRITICAL, __func__, "Failed to read rdseed generated output " + output);
-		prog.hide();
-		return;
-	}
+void InventorySubPanel::clearEntities() {
 
-	loadASCIIDataless(output, RdseedStationSummary);
-	prog.hide();
+	__ui->treeWidgetInventory->clear();
+	qDeleteAll(__entities);
+	__entities.clear();
+	__index.clear();
+	__selectedEntity = NULL;
 }
 
 
@@ -1094,6 +1214,7 @@ void InventorySubPanel::addNetwork(const QString& code) {
 
 	Entity* ent = new Entity(code);
 	__entities << ent;
+	__index.insert(code, ent);
 
 	QTreeWidgetItem* obj = new QTreeWidgetItem(__ui->treeWidgetInventory);
 	obj->setText(getHeaderPosition(thNAME), code);
@@ -1140,6 +1261,7 @@ void InventorySubPanel::addStation(const QString& networkCode,
 	ent->channelCode = channelCode;
 
 	__entities << ent;
+	__index.insert(networkCode + "." + stationCode, ent);
 	QTreeWidgetItem* obj = new QTreeWidgetItem;
 	obj->setData(getHeaderPosition(thNAME), Qt::UserRole, Utils::VariantPtr<
 	        Entity>::asQVariant(parent));
@@ -1182,6 +1304,8 @@ void InventorySubPanel::editStation(const QString& networkCode,
 
 	QTreeWidgetItem* itm = __ui->treeWidgetInventory->currentItem();
 	if ( itm ) {
+		__index.remove(networkCode + "." + oldStationCode);
+		__index.insert(networkCode + "." + stationCode, station);
 		station->name = stationCode;
 		itm->setText(getHeaderPosition(thSTATIONCODE), stationCode);
 		itm->setText(getHeaderPosition(thLOCATIONCODE), locationCode);
@@ -1228,57 +1352,146 @@ void InventorySubPanel::showContextMenu(const QPoint& pos) {
 		}
 	}
 
+	menu->addSeparator();
+	QAction* locAction = menu->addAction(QIcon(":images/station.png"),
+	    tr("Select stations by location"), this, SLOT(selectStationsByLocation()));
+	locAction->setEnabled(__spatialIndex.size() != 0);
+
 	menu->exec(QCursor::pos());
 }
 
 
+void InventorySubPanel::selectStationsByLocation() {
+
+	SDPASSERT(Logger::instancePtr());
+
+	//! Queries start around the station under the cursor when it is known
+	StationIndex::Location point = __origin;
+	QTreeWidgetItem* itm = __ui->treeWidgetInventory->currentItem();
+	if ( itm && itm->parent() ) {
+		const int idx = __stationIndex.value(itm->parent()->text(getHeaderPosition(thNAME))
+		    + "." + itm->text(getHeaderPosition(thSTATIONCODE)), -1);
+		if ( idx >= 0 && __stations.at(idx).located )
+		    point = StationIndex::Location(__stations.at(idx).latitude, __stations.at(idx).longitude);
+	}
+
+	LocationQueryDialog dialog(point, this);
+	if ( dialog.exec() != QDialog::Accepted ) return;
+
+	QTime timer;
+	timer.start();
+
+	StationIndex::HitList hits;
+	switch ( dialog.mode() ) {
+		case LocationQueryDialog::Radius:
+			hits = __spatialIndex.radius(dialog.point(), dialog.radius());
+			break;
+		case LocationQueryDialog::Nearest:
+			hits = __spatialIndex.nearest(dialog.point(), dialog.count());
+			break;
+		case LocationQueryDialog::Box:
+			hits = __spatialIndex.box(dialog.minLatitude(), dialog.maxLatitude(),
+			    dialog.minLongitude(), dialog.maxLongitude());
+			break;
+	}
+
+	const int elapsed = timer.elapsed();
+
+	__ui->treeWidgetInventory->setUpdatesEnabled(false);
+
+	if ( dialog.replace() )
+	    clearEntities();
+
+	int added = 0;
+	for (int i = 0; i < hits.size(); ++i) {
+		const RespStation& s = __stations.at(__located.at(hits.at(i).index));
+		if ( getStation(s.network, s.code) ) continue;
+		addRespStation(s);
+		++added;
+	}
+
+	__origin = dialog.point();
+	__hasOrigin = true;
+
+	__ui->treeWidgetInventory->expandAll();
+	__ui->treeWidgetInventory->setUpdatesEnabled(true);
+
+	Logger::instancePtr()->addMessage(Logger::DEBUG, __func__,
+	    QString("%1 of %2 station(s) matched the location query in %3 ms, %4 added to inventory")
+	        .arg(hits.size()).arg(__spatialIndex.size()).arg(elapsed).arg(added));
+}
+
+
 void InventorySubPanel::loadInventoryFromFile() {
 
+	if ( __loader->isRunning() ) return;
+
+	const QStringList files = QFileDialog::getOpenFileNames(this, tr("Select dataless files directory"));
+	if ( files.isEmpty() ) return;
+
+	const Dataless::Format format = __ui->radioButtonUseDataless->isChecked() ?
+	    Dataless::SEED : Dataless::StationSummary;
+
+	//! Files are read in the thread pool, the tree is fed once they're done
+	__loadedFiles = files;
+	__ui->toolButton->setEnabled(false);
+	__loader->setFuture(QtConcurrent::run(Dataless::read, files, format));
+}
+
+
+void InventorySubPanel::inventoryFileLoaded() {
+
 	SDPASSERT(Logger::instancePtr());
-	QStringList files = QFileDialog::getOpenFileNames(this, tr("Select dataless files directory"));
+	Logger* log = Logger::instancePtr();
 
-	QApplication::processEvents();
+	__ui->toolButton->setEnabled(__ui->radioButtonUseDataless->isChecked()
+	    || __ui->radioButtonUseStationsSummary->isChecked());
 
-	for (int i = 0; i < files.count(); ++i) {
+	const Dataless::Result result = __loader->result();
+	for (int i = 0; i < result.failed.size(); ++i)
+		log->addMessage(Logger::WARNING, __func__, "Failed to read inventory file " + result.failed.at(i));
 
-		if ( __ui->radioButtonUseDataless->isChecked() )
-			loadBinaryDataless(files.at(i));
-		else if ( __ui->radioButtonUseStationsSummary->isChecked() )
-		    loadASCIIDataless(files.at(i));
+	const int previous = __stations.size();
+	feedStations(result.channels);
+
+	//! Stations without coordinates are left out of location queries
+	StationIndex::LocationList locations;
+	locations.reserve(__stations.size());
+	__located.clear();
+	for (int i = 0; i < __stations.size(); ++i) {
+		if ( !__stations.at(i).located ) continue;
+		locations << StationIndex::Location(__stations.at(i).latitude, __stations.at(i).longitude);
+		__located << i;
 	}
+	__spatialIndex.build(locations);
+
+	log->addMessage(Logger::DEBUG, __func__, QString("Read %1 channel epoch(s) from %2 file(s): "
+	    "%3 new station(s), %4 duplicate(s) and %5 malformed entry(ies) skipped.")
+	    .arg(result.channels.size()).arg(__loadedFiles.size())
+	    .arg(__stations.size() - previous).arg(result.duplicates).arg(result.errors));
 
 	if ( __stations.count() == 0 ) {
-		Logger::instancePtr()->addMessage(Logger::DEBUG, __func__, "No station added into inventory.");
+		log->addMessage(Logger::DEBUG, __func__, "No station added into inventory.");
 		return;
 	}
 
-	for (int i = 0; i < __stations.size(); ++i) {
-
-		addNetwork(__stations.at(i).network);
+	__ui->treeWidgetInventory->setUpdatesEnabled(false);
 
-		QString chans;
-		int idx = 0;
-		for (PairedStringList::const_iterator it = __stations.at(i).locchan.constBegin();
-		        it != __stations.at(i).locchan.constEnd(); ++it, ++idx) {
-			if ( idx != __stations.at(i).locchan.size() - 1 )
-				chans += (*it).first + ", ";
-			else
-				chans += (*it).first;
-		}
+	//! Stations removed from the tree since they were loaded are added back
+	for (int i = 0; i < __stations.size(); ++i) {
 
-		if ( __stations.at(i).locchan.size() != 0 )
-			addStation(__stations.at(i).network, __stations.at(i).code,
-			    __stations.at(i).locchan[0].second, chans);
-		else
-			addStation(__stations.at(i).network, __stations.at(i).code, "", "");
+		const RespStation& s = __stations.at(i);
+		if ( !getStation(s.network, s.code) )
+		    addRespStation(s);
 	}
 
 	__ui->treeWidgetInventory->expandAll();
+	__ui->treeWidgetInventory->setUpdatesEnabled(true);
 
-	if ( files.size() == 1 )
-		__ui->lineEdit->setText(files.at(0));
-	else if ( files.size() > 1 )
-	    __ui->lineEdit->setText(files.at(0) + "+");
+	if ( __loadedFiles.size() == 1 )
+		__ui->lineEdit->setText(__loadedFiles.at(0));
+	else if ( __loadedFiles.size() > 1 )
+	    __ui->lineEdit->setText(__loadedFiles.at(0) + "+");
 }
 
 
@@ -1838,6 +2051,217 @@ void TriggerSubPanel::loadPreset(int idx) {
 	}
 }
 
+
+CoverageSubPanel::CoverageSubPanel(QWidget* parent) :
+		QWidget(parent), __ui(new Ui::Coverage) {
+
+	__ui->setupUi(this);
+
+	QStringList headers;
+	for (size_t i = 0; i < sizeof(CoverageTableHeaders) / sizeof(CoverageTableHeaders[0]); ++i)
+		headers << CoverageTableHeaders[i];
+	__ui->treeWidgetCoverage->setColumnCount(headers.size());
+	__ui->treeWidgetCoverage->setHeaderLabels(headers);
+
+	SDPASSERT(ArchiveIndex::instancePtr());
+	ArchiveIndex* index = ArchiveIndex::instancePtr();
+
+	connect(__ui->toolButtonArchive, SIGNAL(clicked()), this, SLOT(selectArchive()));
+	connect(__ui->lineEditArchive, SIGNAL(editingFinished()), this, SLOT(setArchive()));
+	connect(__ui->pushButtonUpdate, SIGNAL(clicked()), this, SLOT(updateIndex()));
+	connect(__ui->pushButtonCheck, SIGNAL(clicked()), this, SLOT(checkCoverage()));
+	connect(index, SIGNAL(updateStarted()), this, SLOT(indexUpdateStarted()));
+	connect(index, SIGNAL(updated()), this, SLOT(indexUpdated()));
+
+	SDPASSERT(ParameterManager::instancePtr());
+	ParameterManager* pm = ParameterManager::instancePtr();
+	pm->registerParameter("coverageArchive");
+	pm->registerObjectParameter("CoverageSubPanel", "coverageArchive");
+
+	loadConfiguration();
+}
+
+
+CoverageSubPanel::~CoverageSubPanel() {}
+
+
+bool CoverageSubPanel::saveParameters() {
+
+	SDPASSERT(ParameterManager::instancePtr());
+
+	ParameterManager* m = ParameterManager::instancePtr();
+	m->setParameter("coverageArchive", QVariant::fromValue(__ui->lineEditArchive->text()));
+	m->setObjectParameter("CoverageSubPanel", "coverageArchive", QVariant::fromValue(__ui->lineEditArchive->text()));
+
+	return true;
+}
+
+
+bool CoverageSubPanel::loadParameters() {
+
+	SDPASSERT(ParameterManager::instancePtr());
+
+	ParameterManager* m = ParameterManager::instancePtr();
+	__ui->lineEditArchive->setText(m->objectParameter("CoverageSubPanel", "coverageArchive").toString());
+	setArchive();
+
+	return true;
+}
+
+
+bool CoverageSubPanel::loadConfiguration() {
+
+	SDPASSERT(MainFrame::instancePtr());
+
+	Config* cfg = MainFrame::instancePtr()->config();
+
+	//! The archive filled by the dispatch tools is indexed by default
+	QString archive;
+	try {
+		archive = cfg->getString("coverage.archive");
+	}
+	catch ( ... ) {}
+
+	if ( archive.isEmpty() ) {
+		try {
+			archive = cfg->getString("dispatch.sds.folder");
+		}
+		catch ( ... ) {}
+	}
+
+	bool update = false;
+	try {
+		update = cfg->getBool("coverage.updateOnStartup");
+	}
+	catch ( ... ) {}
+
+	__ui->lineEditArchive->setText(archive);
+	setArchive();
+
+	if ( update )
+	    updateIndex();
+
+	return true;
+}
+
+
+void CoverageSubPanel::checkCoverage() {
+
+	SDPASSERT(ArchiveIndex::instancePtr());
+	SDPASSERT(InventorySubPanel::instancePtr());
+	SDPASSERT(TimeWindowSubPanel::instancePtr());
+	SDPASSERT(ParameterManager::instancePtr());
+
+	setArchive();
+
+	ArchiveIndex* index = ArchiveIndex::instancePtr();
+	if ( index->archive().isEmpty() ) {
+		QMessageBox::warning(this, tr("Archive coverage"),
+		    tr("The SDS archive directory is not set."));
+		return;
+	}
+
+	//! Stations of the inventory, every stream of the archive otherwise
+	QStringList stations;
+	const InventorySubPanel::EntityList& entities = InventorySubPanel::instancePtr()->entities();
+	for (int i = 0; i < entities.size(); ++i)
+		if ( entities.at(i)->parent )
+		    stations << entities.at(i)->parent->name + "." + entities.at(i)->name;
+
+	if ( !TimeWindowSubPanel::instancePtr()->timeWindowIsOkay() ) return;
+	TimeWindowSubPanel::instancePtr()->saveParameters();
+
+	ParameterManager* pm = ParameterManager::instancePtr();
+	const QDateTime start = pm->parameter("streamStartTime").toDateTime();
+	const QDateTime end = pm->parameter("streamEndTime").toDateTime();
+
+	QTime timer;
+	timer.start();
+	const ArchiveIndex::CoverageList list = index->coverage(stations, start, end);
+	const int elapsed = timer.elapsed();
+
+	__ui->treeWidgetCoverage->clear();
+	int complete = 0;
+	for (int i = 0; i < list.size(); ++i) {
+
+		const ArchiveIndex::Coverage& cov = list.at(i);
+		const double ratio = cov.ratio(start, end);
+
+		QTreeWidgetItem* item = new QTreeWidgetItem(__ui->treeWidgetCoverage);
+		item->setText(0, cov.stream);
+		item->setText(1, QString("%1 %").arg(ratio * 100., 0, 'f', 2));
+		item->setText(2, QString::number(cov.gaps.size()));
+		item->setText(3, QString::number(cov.files));
+		item->setToolTip(1, spanDuration(cov.covered));
+
+		if ( cov.gaps.isEmpty() )
+			++complete;
+		else
+			item->setForeground(1, QBrush(Qt::darkRed));
+
+		for (int j = 0; j < cov.gaps.size(); ++j) {
+			QTreeWidgetItem* gap = new QTreeWidgetItem(item);
+			gap->setText(0, ArchiveIndex::fromTime(cov.gaps.at(j).start).toString("yyyy-MM-dd HH:mm:ss.zzz"));
+			gap->setText(1, ArchiveIndex::fromTime(cov.gaps.at(j).end).toString("yyyy-MM-dd HH:mm:ss.zzz"));
+			gap->setText(2, spanDuration(cov.gaps.at(j).end - cov.gaps.at(j).start));
+		}
+	}
+
+	for (int i = 0; i < __ui->treeWidgetCoverage->columnCount(); ++i)
+		__ui->treeWidgetCoverage->resizeColumnToContents(i);
+
+	__ui->labelIndex->setText(QString("%1/%2 stream(s) complete (%3 ms)")
+	    .arg(complete).arg(list.size()).arg(elapsed));
+}
+
+
+void CoverageSubPanel::selectArchive() {
+	QString dir = QFileDialog::getExistingDirectory(this, tr("Select SDS directory"));
+	if ( dir.isEmpty() ) return;
+	__ui->lineEditArchive->setText(dir);
+	setArchive();
+}
+
+
+void CoverageSubPanel::setArchive() {
+
+	SDPASSERT(ArchiveIndex::instancePtr());
+
+	if ( __ui->lineEditArchive->text().isEmpty() ) return;
+	ArchiveIndex::instancePtr()->setArchive(__ui->lineEditArchive->text());
+}
+
+
+void CoverageSubPanel::updateIndex() {
+
+	SDPASSERT(ArchiveIndex::instancePtr());
+
+	setArchive();
+	ArchiveIndex::instancePtr()->update();
+}
+
+
+void CoverageSubPanel::indexUpdateStarted() {
+	__ui->pushButtonUpdate->setEnabled(false);
+	__ui->labelIndex->setText(tr("Updating index..."));
+}
+
+
+void CoverageSubPanel::indexUpdated() {
+
+	SDPASSERT(ArchiveIndex::instancePtr());
+
+	ArchiveIndex* index = ArchiveIndex::instancePtr();
+	__ui->pushButtonUpdate->setEnabled(!index->isUpdating());
+
+	if ( index->lastUpdate().isValid() )
+		__ui->labelIndex->setText(QString("%1 file(s), %2 stream(s), updated %3")
+		    .arg(index->fileCount()).arg(index->streamCount())
+		    .arg(index->lastUpdate().toString("yyyy-MM-dd HH:mm:ss")));
+	else
+		__ui->labelIndex->setText(tr("No archive indexed"));
+}
+
 } // namespace Qt4
 } // namespace SDP
 
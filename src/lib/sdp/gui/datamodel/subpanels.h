@@ -30,7 +30,11 @@
 #include <QDialog>
 #include <QDateTime>
 #include <QScopedPointer>
+#include <QHash>
 #include <sdp/gui/datamodel/singleton.h>
+#include <sdp/gui/datamodel/dataless.h>
+#include <sdp/gui/datamodel/archiveindex.h>
+#include <sdp/gui/datamodel/stationindex.h>
 
 
 namespace Ui {
@@ -41,11 +45,13 @@ class Inventory;
 class TimeWindow;
 class Trigger;
 class Stream;
+class Coverage;
 
 }
 
 
 QT_FORWARD_DECLARE_CLASS(QTreeWidgetItem);
+template<typename T> class QFutureWatcher;
 
 namespace SDP {
 namespace Qt4 {
@@ -106,8 +112,10 @@ class DataSourceSubPanel : public QWidget, public SubPanelWidget,
 		// ------------------------------------------------------------------
 		void loadPreset(int);
 		void selectDataFile();
+		void selectArchiveDir();
 		void readFileInventory(bool);
 		void readSEEDInventory();
+		void streamInventoryRead();
 
 	Q_SIGNALS:
 		// ------------------------------------------------------------------
@@ -129,6 +137,7 @@ class DataSourceSubPanel : public QWidget, public SubPanelWidget,
 				QString arclinkUser;
 				QString arclinkPassword;
 				QString arclinkInstitution;
+				QString archivePattern;
 				int idx;
 				int arclinkPort;
 				int arclinkTimeout;
@@ -137,6 +146,10 @@ class DataSourceSubPanel : public QWidget, public SubPanelWidget,
 
 		QScopedPointer<Ui::DataSource> __ui;
 		PresetList __presets;
+		QFutureWatcher<ArchiveIndex::StreamEntryList>* __scanner;
+		//! Files of the running scan, the ones it failed to read
+		QStringList __scanFiles;
+		QStringList __scanFailed;
 };
 
 
@@ -276,6 +289,7 @@ class InventorySubPanel : public QWidget, public Singleton<InventorySubPanel>,
 					latitude = 0.0;
 					longitude = 0.0;
 					elevation = 0.0;
+					located = false;
 				}
 				bool operator==(const RespStation& r) {
 					return this->network == r.network && this->code == r.code;
@@ -285,17 +299,14 @@ class InventorySubPanel : public QWidget, public Singleton<InventorySubPanel>,
 				double latitude;
 				double longitude;
 				double elevation;
+				//! Whether the coordinates are known
+				bool located;
 				QDateTime start;
 				QDateTime end;
 				PairedStringList locchan;
 		};
 		typedef QList<RespStation> RespStationsList;
 
-		enum ASCIIDatalessFormat {
-			RdseedStationSummary,
-			Custom
-		};
-
 	public:
 		// ------------------------------------------------------------------
 		//  Instruction
@@ -329,8 +340,9 @@ class InventorySubPanel : public QWidget, public Singleton<InventorySubPanel>,
 		// ------------------------------------------------------------------
 		//  Private interface
 		// ------------------------------------------------------------------
-		void loadASCIIDataless(const QString&, ASCIIDatalessFormat = Custom);
-		void loadBinaryDataless(const QString&);
+		void feedStations(const Dataless::ChannelList&);
+		void addRespStation(const RespStation&);
+		void clearEntities();
 
 	public Q_SLOTS:
 		// ------------------------------------------------------------------
@@ -349,6 +361,8 @@ class InventorySubPanel : public QWidget, public Singleton<InventorySubPanel>,
 		// ------------------------------------------------------------------
 		void showContextMenu(const QPoint&);
 		void loadInventoryFromFile();
+		void inventoryFileLoaded();
+		void selectStationsByLocation();
 		void addNetwork();
 		void addStation();
 		void removeEntity();
@@ -362,7 +376,21 @@ class InventorySubPanel : public QWidget, public Singleton<InventorySubPanel>,
 		Entity* __selectedEntity;
 		QString __currentEntity;
 		EntityList __entities;
+		//! Entities by network code and by NET.STA code
+		QHash<QString, Entity*> __index;
 		RespStationsList __stations;
+		//! Stations by NET.STA code
+		QHash<QString, int> __stationIndex;
+		QFutureWatcher<Dataless::Result>* __loader;
+		QStringList __loadedFiles;
+		//! Coordinates of the loaded stations which have some, and their
+		//! position in __stations
+		StationIndex __spatialIndex;
+		QVector<int> __located;
+		//! Point of the last location query, stations are ordered by their
+		//! distance to it
+		StationIndex::Location __origin;
+		bool __hasOrigin;
 };
 
 
@@ -479,6 +507,56 @@ class TriggerSubPanel : public QWidget, public SubPanelWidget,
 		PresetList __presets;
 };
 
+
+/**
+ * @class CoverageSubPanel
+ * @brief Lists the coverage and gaps of the inventory stations over the
+ *        time window, as found in the index of an SDS archive.
+ * @see   ArchiveIndex
+ */
+class CoverageSubPanel : public QWidget, public SubPanelWidget,
+                         public Singleton<CoverageSubPanel> {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit CoverageSubPanel(QWidget* = NULL);
+		~CoverageSubPanel();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		bool saveParameters();
+		bool loadParameters();
+		bool loadConfiguration();
+
+	public Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Public Qt interface
+		// ------------------------------------------------------------------
+		void checkCoverage();
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void selectArchive();
+		void setArchive();
+		void updateIndex();
+		void indexUpdateStarted();
+		void indexUpdated();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		QScopedPointer<Ui::Coverage> __ui;
+};
+
 } // namespace Qt4
 } // namespace SDP
 
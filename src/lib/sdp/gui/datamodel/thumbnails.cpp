@@ -0,0 +1,247 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/thumbnails.h>
+#include <sdp/gui/datamodel/macros.h>
+#include <sdp/gui/datamodel/parametermanager.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QSet>
+#include <utime.h>
+
+
+namespace {
+
+//! Thumbnails remembered in memory
+static int const RecentCount = 1024;
+
+//! Thumbnails made between two prunings of the directory
+static int const PruneInterval = 64;
+
+/**
+ * @brief Reads an image scaled down to width and writes it to file. The
+ *        thumbnail is written under a temporary name and renamed when
+ *        complete, so that a thumbnail is never read while it is written.
+ */
+bool makeThumbnail(const QString& image, const QString& file, const int& width) {
+
+	QImageReader reader(image);
+	const QSize size = reader.size();
+
+	if ( size.isValid() && size.width() > width )
+	    reader.setScaledSize(QSize(width, qMax(1, size.height() * width / size.width())));
+
+	const QImage thumbnail = reader.read();
+	if ( thumbnail.isNull() ) return false;
+
+	QDir().mkpath(QFileInfo(file).absolutePath());
+
+	const QString tmp = file + ".tmp";
+	if ( !thumbnail.save(tmp, "PNG") ) {
+		QFile::remove(tmp);
+		return false;
+	}
+
+	QFile::remove(file);
+
+	return QFile::rename(tmp, file);
+}
+
+
+/**
+ * @brief Removes the thumbnails of dir unused for more than maxAge days,
+ *        then the least recently used ones until the others fit in maxSize
+ *        bytes, a limit of 0 being no limit. Thumbnails are stamped when
+ *        used, the oldest modification times go first. Returns the removed
+ *        files. This function runs in the thread pool.
+ */
+QStringList evict(const QString& dir, const qint64& maxSize, const int& maxAge) {
+
+	QStringList removed;
+
+	const QFileInfoList files = QDir(dir).entryInfoList(QStringList() << "*.png",
+	    QDir::Files, QDir::Time);
+	const QDateTime limit = QDateTime::currentDateTime().addDays(-maxAge);
+
+	qint64 size = 0;
+	for (int i = 0; i < files.size(); ++i) {
+
+		const QFileInfo& f = files.at(i);
+		const bool old = maxAge > 0 && f.lastModified() < limit;
+
+		if ( !old && (maxSize <= 0 || size + f.size() <= maxSize) ) {
+			size += f.size();
+			continue;
+		}
+
+		if ( QFile::remove(f.absoluteFilePath()) )
+			removed << f.absoluteFilePath();
+		else
+			size += f.size();
+	}
+
+	return removed;
+}
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+Thumbnails::Thumbnails(QObject* parent) :
+		QObject(parent), __recent(RecentCount),
+		__pruner(new QFutureWatcher<QStringList>(this)), __made(-1) {
+
+	connect(__pruner, SIGNAL(finished()), this, SLOT(pruned()));
+}
+
+
+Thumbnails::~Thumbnails() {
+
+	for (QHash<QFutureWatcher<bool>*, Request>::iterator it = __pending.begin();
+	        it != __pending.end(); ++it)
+		it.key()->waitForFinished();
+
+	__pruner->waitForFinished();
+}
+
+
+QString Thumbnails::file(const QString& image, const int& width) {
+
+	SDPASSERT(ParameterManager::instancePtr());
+
+	const QString dir = ParameterManager::instancePtr()->parameter("THUMBNAIL_DIR").toString();
+	const QFileInfo info(image);
+	if ( !info.exists() || dir.isEmpty() ) return image;
+
+	if ( __made < 0 )
+	    prune();
+
+	const QString key = QString("%1|%2").arg(info.absoluteFilePath()).arg(width);
+
+	Entry* entry = __recent.object(key);
+	if ( entry && entry->modified == info.lastModified() )
+	    return entry->file;
+
+	for (QHash<QFutureWatcher<bool>*, Request>::const_iterator it = __pending.constBegin();
+	        it != __pending.constEnd(); ++it)
+		if ( it.value().key == key )
+		    return QString();
+
+	const QByteArray hash = QCryptographicHash::hash(QString("%1|%2|%3")
+	    .arg(key).arg(info.lastModified().toMSecsSinceEpoch()).arg(info.size()).toUtf8(),
+	    QCryptographicHash::Md5).toHex();
+	const QString file = dir + QDir::separator() + QString::fromLatin1(hash) + ".png";
+
+	if ( QFile::exists(file) ) {
+		//! Stamped as used, the directory is pruned by modification time
+		utime(QFile::encodeName(file).constData(), NULL);
+		entry = new Entry;
+		entry->modified = info.lastModified();
+		entry->file = file;
+		__recent.insert(key, entry);
+		return file;
+	}
+
+	Request request;
+	request.image = image;
+	request.file = file;
+	request.key = key;
+	request.modified = info.lastModified();
+
+	QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(thumbnailMade()));
+	__pending.insert(watcher, request);
+	watcher->setFuture(QtConcurrent::run(makeThumbnail, info.absoluteFilePath(), file, width));
+
+	return QString();
+}
+
+
+void Thumbnails::thumbnailMade() {
+
+	QFutureWatcher<bool>* watcher = static_cast<QFutureWatcher<bool>*>(sender());
+	if ( !__pending.contains(watcher) ) return;
+
+	const Request request = __pending.take(watcher);
+	const bool made = watcher->result();
+	watcher->deleteLater();
+
+	//! Images which can not be scaled are shown as they are
+	Entry* entry = new Entry;
+	entry->modified = request.modified;
+	entry->file = made ? request.file : request.image;
+	__recent.insert(request.key, entry);
+
+	if ( made && ++__made >= PruneInterval )
+	    prune();
+
+	emit ready(request.image);
+}
+
+
+void Thumbnails::prune() {
+
+	SDPASSERT(ParameterManager::instancePtr());
+
+	if ( __pruner->isRunning() ) return;
+
+	ParameterManager* pm = ParameterManager::instancePtr();
+	const QString dir = pm->parameter("THUMBNAIL_DIR").toString();
+	const qint64 size = pm->parameter("THUMBNAIL_CACHE_SIZE").toLongLong() * 1024 * 1024;
+	const int age = pm->parameter("THUMBNAIL_CACHE_AGE").toInt();
+
+	__made = 0;
+
+	if ( dir.isEmpty() || (size <= 0 && age <= 0) ) return;
+
+	__pruner->setFuture(QtConcurrent::run(evict, dir, size, age));
+}
+
+
+void Thumbnails::pruned() {
+
+	const QStringList list = __pruner->result();
+	if ( list.isEmpty() ) return;
+
+	//! Remembered thumbnails which have been removed are made again
+	const QSet<QString> removed = list.toSet();
+	const QList<QString> keys = __recent.keys();
+	for (int i = 0; i < keys.size(); ++i) {
+		const Entry* entry = __recent.object(keys.at(i));
+		if ( entry && removed.contains(QFileInfo(entry->file).absoluteFilePath()) )
+		    __recent.remove(keys.at(i));
+	}
+}
+
+
+} // namespace Qt4
+} // namespace SDP
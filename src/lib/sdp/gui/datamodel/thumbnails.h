@@ -0,0 +1,128 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_THUMBNAILS_H__
+#define __SDP_QT4_DATAMODEL_THUMBNAILS_H__
+
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QCache>
+#include <QDateTime>
+#include <sdp/gui/datamodel/singleton.h>
+
+
+template<typename T> class QFutureWatcher;
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+/**
+ * @class Thumbnails
+ * @brief This class implements a cache of scaled down images (trigger
+ *        snapshots) for tooltips and previews, so that full size images are
+ *        not decoded and scaled by the GUI thread each time they are shown.
+ * @info  Thumbnails are stored as PNG images in the thumbnail directory
+ *        (THUMBNAIL_DIR), named after the path, modification time and size of
+ *        the image and the width of the thumbnail. Missing thumbnails are made
+ *        by a thread pool, reading the images with QImageReader at the scaled
+ *        size. The most recently used thumbnails are remembered so that they
+ *        are found without looking up the directory. The directory is pruned
+ *        in the background when thumbnails are first asked for and then every
+ *        few thumbnails made: the ones unused for THUMBNAIL_CACHE_AGE days go
+ *        first, then the least recently used ones until the directory fits in
+ *        THUMBNAIL_CACHE_SIZE megabytes.
+ */
+class Thumbnails : public QObject, public Singleton<Thumbnails> {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit Thumbnails(QObject* = NULL);
+		~Thumbnails();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		//! Returns the file of the thumbnail of an image scaled to width. When
+		//! the thumbnail is not made yet, it is queued and an empty string is
+		//! returned, ready() is emitted once it is done. Images which can not
+		//! be scaled are returned as is.
+		QString file(const QString& image, const int& width);
+
+	Q_SIGNALS:
+		// ------------------------------------------------------------------
+		//  Qt signals
+		// ------------------------------------------------------------------
+		void ready(const QString& image);
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void thumbnailMade();
+		void pruned();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		void prune();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		struct Entry {
+				QDateTime modified;
+				QString file;
+		};
+		struct Request {
+				QString image;
+				QString file;
+				QString key;
+				QDateTime modified;
+		};
+
+		QCache<QString, Entry> __recent;
+		QHash<QFutureWatcher<bool>*, Request> __pending;
+		QFutureWatcher<QStringList>* __pruner;
+		//! Thumbnails made since the directory was last pruned, -1 until it
+		//! is pruned for the first time
+		int __made;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
@@ -48,7 +48,7 @@ QDataStream& operator>>(QDataStream& stream, Trigger::Station& s) {
 
 
 Trigger::Trigger(const QString& jobID, QObject* parent) :
-		QObject(parent), __tableWidget(NULL), __creationTime(QDateTime::currentDateTime()),
+		QObject(parent), __creationTime(QDateTime::currentDateTime()),
 		__jobID(jobID), __status(WaitingForRevision), __retCode(-2) {}
 
 
@@ -134,16 +134,6 @@ const int& Trigger::runExitCode() const {
 }
 
 
-void Trigger::setTableWidget(void* tw) {
-	__tableWidget = tw;
-}
-
-
-void* Trigger::tableWidget() {
-	return __tableWidget;
-}
-
-
 void Trigger::setStations(const StationList& l) {
 	__stations = l;
 }
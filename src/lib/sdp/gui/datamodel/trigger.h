@@ -108,8 +108,6 @@ class Trigger : public QObject {
 		void setOriginTime(const QDateTime& dt);
 		const QDateTime& originTime() const;
 		const int& runExitCode() const;
-		void setTableWidget(void* tw);
-		void* tableWidget();
 		void setStations(const StationList& l);
 		const StationList& stations() const;
 		void setResumePage(const QString& p);
@@ -122,7 +120,6 @@ class Trigger : public QObject {
 		// ------------------------------------------------------------------
 		//  Members
 		// ------------------------------------------------------------------
-		void* __tableWidget;
 		QDateTime __creationTime;
 		QDateTime __originTime;
 		StationList __stations;
@@ -0,0 +1,441 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/triggermodel.h>
+#include <sdp/gui/datamodel/trigger.h>
+#include <QFont>
+#include <QSet>
+#include <QtAlgorithms>
+
+
+namespace {
+
+//! Rows handed over to the view at a time
+static int const FetchBatch = 256;
+
+static QString const DateTimeFormat = "yyyy-MM-dd HH:mm:ss.zzz";
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+struct TriggerModel::Order {
+		explicit Order(const TriggerModel* m) :
+				model(m) {}
+		bool operator()(Trigger* a, Trigger* b) const {
+			return model->lessThan(a, b);
+		}
+		const TriggerModel* model;
+};
+
+
+TriggerModel::TriggerModel(const QStringList& headers, QObject* parent) :
+		QAbstractTableModel(parent), __headers(headers), __fetched(0),
+		__sortColumn(-1), __sortOrder(Qt::AscendingOrder), __hideCommitted(false) {}
+
+
+TriggerModel::~TriggerModel() {}
+
+
+int TriggerModel::rowCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : __fetched;
+}
+
+
+int TriggerModel::columnCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : ColumnCount;
+}
+
+
+QVariant TriggerModel::data(const QModelIndex& index, int role) const {
+
+	Trigger* trig = trigger(index);
+	if ( !trig ) return QVariant();
+
+	switch ( role ) {
+
+		case Qt::DisplayRole:
+			return text(trig, index.column());
+
+		case Qt::TextAlignmentRole:
+			if ( index.column() == Sites ) return QVariant();
+			return static_cast<int>(Qt::AlignHCenter | Qt::AlignVCenter);
+
+		case Qt::FontRole:
+			if ( index.column() == Status ) {
+				QFont f;
+				f.setBold(true);
+				return f;
+			}
+			return QVariant();
+
+		case Qt::ToolTipRole: {
+			QString tooltip;
+			tooltip += "<div><p>";
+			tooltip += "<b>Job</b>: " + trig->jobID() + "<br />";
+			tooltip += "<b>Creation time</b>: " + trig->creationTime().toString(DateTimeFormat) + "<br />";
+			tooltip += "<b>Trigger time</b>: " + trig->originTime().toString(DateTimeFormat) + "<br />";
+			tooltip += "<b>Stations</b>: " + __sites.value(trig) + "<br />";
+			tooltip += "<b>Resume</b>: " + trig->resumePage() + "<br />";
+			tooltip += "</p></div>";
+			return tooltip;
+		}
+
+		default:
+			return QVariant();
+	}
+}
+
+
+QVariant TriggerModel::headerData(int section, Qt::Orientation orientation, int role) const {
+
+	if ( orientation == Qt::Horizontal && role == Qt::DisplayRole
+	    && section >= 0 && section < __headers.size() )
+	    return __headers.at(section);
+
+	return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+
+bool TriggerModel::canFetchMore(const QModelIndex& parent) const {
+	return !parent.isValid() && __fetched < __rows.size();
+}
+
+
+void TriggerModel::fetchMore(const QModelIndex& parent) {
+
+	if ( !canFetchMore(parent) ) return;
+
+	const int count = qMin(FetchBatch, __rows.size() - __fetched);
+	beginInsertRows(QModelIndex(), __fetched, __fetched + count - 1);
+	__fetched += count;
+	endInsertRows();
+}
+
+
+void TriggerModel::sort(int column, Qt::SortOrder order) {
+
+	__sortColumn = column;
+	__sortOrder = order;
+
+	sortRows();
+}
+
+
+void TriggerModel::addTriggers(const TriggerList& list) {
+
+	TriggerList added;
+	for (int i = 0; i < list.size(); ++i) {
+
+		Trigger* trig = list.at(i);
+		if ( !trig || __sites.contains(trig) ) continue;
+
+		QStringList stations;
+		for (int j = 0; j < trig->stations().size(); ++j)
+			stations << trig->stations().at(j).networkCode + "." + trig->stations().at(j).code;
+
+		__triggers << trig;
+		__sites.insert(trig, "[" + QString::number(stations.size()) + "] : " + stations.join(", "));
+
+		if ( accepts(trig) )
+		    added << trig;
+	}
+
+	if ( added.isEmpty() ) return;
+
+	//! New rows are appended where the view has not fetched yet, the first
+	//! batch is handed over right away so that short lists show up at once
+	__rows << added;
+	indexRows();
+
+	const int fetched = qMax(__fetched, qMin(__rows.size(), FetchBatch));
+	if ( fetched > __fetched ) {
+		beginInsertRows(QModelIndex(), __fetched, fetched - 1);
+		__fetched = fetched;
+		endInsertRows();
+	}
+
+	if ( __sortColumn >= 0 )
+	    sortRows();
+}
+
+
+void TriggerModel::removeTriggers(const TriggerList& list) {
+
+	QSet<Trigger*> removed;
+	QList<int> rows;
+	for (int i = 0; i < list.size(); ++i) {
+		Trigger* trig = list.at(i);
+		if ( !trig || !__sites.contains(trig) || removed.contains(trig) ) continue;
+		removed.insert(trig);
+		const int row = __rowOf.value(trig, -1);
+		if ( row >= 0 && row < __fetched )
+		    rows << row;
+	}
+
+	if ( removed.isEmpty() ) return;
+
+	//! Fetched rows are removed by contiguous ranges, from the bottom up so
+	//! that the rows above keep their position
+	qSort(rows);
+	for (int last = rows.size() - 1; last >= 0;) {
+		int first = last;
+		while ( first > 0 && rows.at(first - 1) == rows.at(first) - 1 )
+			--first;
+
+		beginRemoveRows(QModelIndex(), rows.at(first), rows.at(last));
+		for (int r = rows.at(last); r >= rows.at(first); --r)
+			__rows.removeAt(r);
+		__fetched -= rows.at(last) - rows.at(first) + 1;
+		endRemoveRows();
+
+		last = first - 1;
+	}
+
+	//! Rows not fetched yet go without notice
+	TriggerList kept;
+	for (int i = 0; i < __rows.size(); ++i)
+		if ( !removed.contains(__rows.at(i)) )
+		    kept << __rows.at(i);
+	__rows = kept;
+
+	kept.clear();
+	for (int i = 0; i < __triggers.size(); ++i)
+		if ( !removed.contains(__triggers.at(i)) )
+		    kept << __triggers.at(i);
+	__triggers = kept;
+
+	for (QSet<Trigger*>::const_iterator it = removed.constBegin(); it != removed.constEnd(); ++it) {
+		__sites.remove(*it);
+		__notes.remove(*it);
+	}
+
+	indexRows();
+}
+
+
+void TriggerModel::updateTriggers(const TriggerList& list) {
+
+	for (int i = 0; i < list.size(); ++i)
+		__notes.remove(list.at(i));
+
+	emitChanged(list);
+
+	//! Statuses changed, triggers may move or go
+	if ( __hideCommitted )
+		rebuildRows();
+	else if ( __sortColumn == Status )
+	    sortRows();
+}
+
+
+void TriggerModel::setNote(const TriggerList& list, const QString& note) {
+
+	for (int i = 0; i < list.size(); ++i) {
+		if ( !__sites.contains(list.at(i)) ) continue;
+		if ( note.isEmpty() )
+			__notes.remove(list.at(i));
+		else
+			__notes.insert(list.at(i), note);
+	}
+
+	emitChanged(list);
+}
+
+
+void TriggerModel::setFilter(const QString& text) {
+
+	if ( text == __filter ) return;
+
+	__filter = text;
+	rebuildRows();
+}
+
+
+void TriggerModel::setHideCommitted(const bool& hide) {
+
+	if ( hide == __hideCommitted ) return;
+
+	__hideCommitted = hide;
+	rebuildRows();
+}
+
+
+bool TriggerModel::contains(Trigger* trig) const {
+	return __sites.contains(trig);
+}
+
+
+Trigger* TriggerModel::trigger(const QModelIndex& index) const {
+
+	if ( !index.isValid() || index.row() >= __fetched || index.column() >= ColumnCount )
+	    return NULL;
+
+	return __rows.at(index.row());
+}
+
+
+QModelIndex TriggerModel::indexOf(Trigger* trig, const int& column) const {
+
+	const int row = __rowOf.value(trig, -1);
+	if ( row < 0 || row >= __fetched ) return QModelIndex();
+
+	return index(row, column);
+}
+
+
+QString TriggerModel::text(Trigger* trig, const int& column) const {
+
+	switch ( column ) {
+		case CreationTime:
+			return trig->creationTime().toString(DateTimeFormat);
+		case TriggerTime:
+			return trig->originTime().toString(DateTimeFormat);
+		case Status:
+			return QString((*trig->status()).string) + __notes.value(trig);
+		case Sites:
+			return __sites.value(trig);
+		case ID:
+			return trig->id();
+		default:
+			return QString();
+	}
+}
+
+
+bool TriggerModel::accepts(Trigger* trig) const {
+
+	if ( __hideCommitted && trig->status() == Committed )
+	    return false;
+
+	if ( __filter.isEmpty() ) return true;
+
+	for (int i = 0; i < ColumnCount; ++i)
+		if ( text(trig, i).contains(__filter, Qt::CaseInsensitive) )
+		    return true;
+
+	return false;
+}
+
+
+bool TriggerModel::lessThan(Trigger* a, Trigger* b) const {
+
+	if ( __sortOrder == Qt::DescendingOrder )
+	    qSwap(a, b);
+
+	switch ( __sortColumn ) {
+		case CreationTime:
+			return a->creationTime() < b->creationTime();
+		case TriggerTime:
+			return a->originTime() < b->originTime();
+		case Status:
+			return a->status() < b->status();
+		case Sites:
+			return __sites.value(a) < __sites.value(b);
+		case ID:
+			return a->id() < b->id();
+		default:
+			return false;
+	}
+}
+
+
+void TriggerModel::rebuildRows() {
+
+	beginResetModel();
+
+	__rows.clear();
+	for (int i = 0; i < __triggers.size(); ++i)
+		if ( accepts(__triggers.at(i)) )
+		    __rows << __triggers.at(i);
+
+	if ( __sortColumn >= 0 )
+	    qStableSort(__rows.begin(), __rows.end(), Order(this));
+
+	indexRows();
+	__fetched = qMin(__rows.size(), FetchBatch);
+
+	endResetModel();
+}
+
+
+void TriggerModel::indexRows() {
+
+	__rowOf.clear();
+	__rowOf.reserve(__rows.size());
+	for (int i = 0; i < __rows.size(); ++i)
+		__rowOf.insert(__rows.at(i), i);
+}
+
+
+void TriggerModel::sortRows() {
+
+	if ( __sortColumn < 0 ) return;
+
+	emit layoutAboutToBeChanged();
+
+	//! Selected and current rows follow their trigger, rows sorted past the
+	//! fetched ones are dropped from the selection
+	const QModelIndexList from = persistentIndexList();
+	TriggerList followed;
+	for (int i = 0; i < from.size(); ++i)
+		followed << trigger(from.at(i));
+
+	qStableSort(__rows.begin(), __rows.end(), Order(this));
+	indexRows();
+
+	QModelIndexList to;
+	for (int i = 0; i < from.size(); ++i)
+		to << (followed.at(i) ? indexOf(followed.at(i), from.at(i).column()) : QModelIndex());
+	changePersistentIndexList(from, to);
+
+	emit layoutChanged();
+}
+
+
+void TriggerModel::emitChanged(const TriggerList& list) {
+
+	QList<int> rows;
+	for (int i = 0; i < list.size(); ++i) {
+		const int row = __rowOf.value(list.at(i), -1);
+		if ( row >= 0 && row < __fetched )
+		    rows << row;
+	}
+
+	//! One signal per range of contiguous rows
+	qSort(rows);
+	for (int first = 0; first < rows.size();) {
+		int last = first;
+		while ( last + 1 < rows.size() && rows.at(last + 1) <= rows.at(last) + 1 )
+			++last;
+		emit dataChanged(index(rows.at(first), 0), index(rows.at(last), ColumnCount - 1));
+		first = last + 1;
+	}
+}
+
+
+} // namespace Qt4
+} // namespace SDP
@@ -0,0 +1,147 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_TRIGGERMODEL_H__
+#define __SDP_QT4_DATAMODEL_TRIGGERMODEL_H__
+
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+
+
+namespace SDP {
+namespace Qt4 {
+
+class Trigger;
+
+
+/**
+ * @class TriggerModel
+ * @brief This class implements the model of the trigger table. Rows are made
+ *        on demand from the triggers, so that large detection runs do not
+ *        allocate an item per cell.
+ * @info  Triggers passing the filter are kept in sort order, the view being
+ *        handed over rows by batches as it scrolls down (fetchMore). Changes
+ *        of triggers are signaled by ranges of contiguous rows.
+ */
+class TriggerModel : public QAbstractTableModel {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		enum Column {
+			CreationTime, TriggerTime, Status, Sites, ID, ColumnCount
+		};
+		typedef QList<Trigger*> TriggerList;
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit TriggerModel(const QStringList& headers, QObject* = NULL);
+		~TriggerModel();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Model interface
+		// ------------------------------------------------------------------
+		int rowCount(const QModelIndex& = QModelIndex()) const;
+		int columnCount(const QModelIndex& = QModelIndex()) const;
+		QVariant data(const QModelIndex&, int role = Qt::DisplayRole) const;
+		QVariant headerData(int, Qt::Orientation, int role = Qt::DisplayRole) const;
+		bool canFetchMore(const QModelIndex&) const;
+		void fetchMore(const QModelIndex&);
+		void sort(int column, Qt::SortOrder = Qt::AscendingOrder);
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		void addTriggers(const TriggerList&);
+		void removeTriggers(const TriggerList&);
+
+		//! Signals the rows of triggers whose status changed and clears
+		//! their notes
+		void updateTriggers(const TriggerList&);
+
+		//! Sets a note shown after the status of triggers
+		void setNote(const TriggerList&, const QString&);
+
+		//! Shows only triggers with a column containing text
+		void setFilter(const QString& text);
+		void setHideCommitted(const bool&);
+
+		bool contains(Trigger*) const;
+		Trigger* trigger(const QModelIndex&) const;
+		QModelIndex indexOf(Trigger*, const int& column = 0) const;
+
+		//! All the triggers, shown or not
+		const TriggerList& triggers() const {
+			return __triggers;
+		}
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		QString text(Trigger*, const int& column) const;
+		bool accepts(Trigger*) const;
+		bool lessThan(Trigger*, Trigger*) const;
+		void rebuildRows();
+		void indexRows();
+		void sortRows();
+		void emitChanged(const TriggerList&);
+
+		struct Order;
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		QStringList __headers;
+		//! Every trigger, and the ones shown in sort order
+		TriggerList __triggers;
+		TriggerList __rows;
+		QHash<Trigger*, int> __rowOf;
+		QHash<Trigger*, QString> __sites;
+		QHash<Trigger*, QString> __notes;
+		//! Rows handed over to the view
+		int __fetched;
+		int __sortColumn;
+		Qt::SortOrder __sortOrder;
+		QString __filter;
+		bool __hideCommitted;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif
@@ -22,6 +22,9 @@
 
 #include <sdp/gui/datamodel/utils.h>
 #include <QDir>
+#include <QPair>
+#include <QSet>
+#include <QtAlgorithms>
 #include <QTextStream>
 #include <QCoreApplication>
 #include <QDebug>
@@ -102,6 +105,10 @@ bool writeScript(const QString& filepath, const QString& content) {
 	return writeFile(file, content);
 }
 
+QString shellQuote(QString str) {
+	return "'" + str.replace("'", "'\\''") + "'";
+}
+
 QStringList getFileList(const QString& path, const QString& filter,
                         const QString& pattern) {
 
@@ -134,14 +141,17 @@ QStringList getFileContentList(const QString& file,
 
 	QFile f(file);
 	QStringList content;
+	QSet<QString> seen;
 	if ( f.open(QIODevice::ReadOnly | QIODevice::Text) ) {
 		QTextStream in(&f);
 		while ( !in.atEnd() ) {
 			const QString line = in.readLine();
 			if ( line.isEmpty() ) continue;
 			if ( ignoreDuplicate ) {
-				if ( !content.contains(line) )
-				    content << line;
+				if ( !seen.contains(line) ) {
+					seen.insert(line);
+					content << line;
+				}
 			}
 			else
 				content << line;
@@ -173,6 +183,64 @@ QString getFileContentString(const QString& file, const QString& separator,
 	return content;
 }
 
+bool triggerTime(const QString& str, double& epoch) {
+
+	//! ObsPy writes times as 2015-07-21T21:21:09.750000Z, QDateTime doesn't
+	//! keep fractions below the millisecond so they are read separately
+	QDateTime dt = QDateTime::fromString(str.left(19), "yyyy-MM-ddTHH:mm:ss");
+	if ( !dt.isValid() ) return false;
+	dt.setTimeSpec(Qt::UTC);
+
+	double fraction = .0;
+	if ( str.size() > 19 && str.at(19) == '.' ) {
+		QString digits = str.mid(20);
+		if ( digits.endsWith('Z') ) digits.chop(1);
+		bool ok = false;
+		fraction = ("0." + digits).toDouble(&ok);
+		if ( !ok ) return false;
+	}
+
+	epoch = dt.toTime_t() + fraction;
+
+	return true;
+}
+
+QList<QStringList> clusterTriggerTimes(const QStringList& times,
+                                       const double& tolerance) {
+
+	QList<QPair<double, int> > sorted;
+	QList<QStringList> clusters;
+	QStringList invalid;
+
+	for (int i = 0; i < times.size(); ++i) {
+		double epoch;
+		if ( triggerTime(times.at(i), epoch) )
+			sorted << qMakePair(epoch, i);
+		else
+			invalid << times.at(i);
+	}
+
+	qStableSort(sorted);
+
+	//! Clusters are anchored on their earliest time so that a chain of
+	//! close triggers can't drift into a single long event
+	double anchor = .0;
+	for (int i = 0; i < sorted.size(); ++i) {
+		const QString& time = times.at(sorted.at(i).second);
+		if ( clusters.isEmpty() || sorted.at(i).first - anchor > tolerance ) {
+			anchor = sorted.at(i).first;
+			clusters << QStringList(time);
+		}
+		else if ( !clusters.last().contains(time) )
+			clusters.last() << time;
+	}
+
+	for (int i = 0; i < invalid.size(); ++i)
+		clusters << QStringList(invalid.at(i));
+
+	return clusters;
+}
+
 void responsiveDelay(int msec) {
 	QTime dieTime = QTime::currentTime().addMSecs(msec);
 	while ( QTime::currentTime() < dieTime )
@@ -46,6 +46,12 @@ bool writeFile(QFile& file, const QString& content);
 
 bool writeScript(const QString& filepath, const QString& content);
 
+/**
+ * @brief Quotes a string as a single word of a shell command
+ * @param str The string, e.g. a file path
+ */
+QString shellQuote(QString str);
+
 QStringList getFileList(const QString& path, const QString& filter = "*",
                         const QString& pattern = QString());
 
@@ -55,6 +61,25 @@ QStringList getFileContentList(const QString& file,
 QString getFileContentString(const QString& file, const QString& separator,
                              const bool& ignoreDuplicate = true);
 
+/**
+ * @brief Reads a trigger time as written by detection scripts
+ * @param str The time, e.g. 2015-07-21T21:21:09.750000Z
+ * @param epoch The time in seconds since 1970-01-01 UTC
+ * @return true if the time is valid
+ */
+bool triggerTime(const QString& str, double& epoch);
+
+/**
+ * @brief Groups trigger times reported more than once by overlapping
+ *        analysis windows. Times are sorted and each cluster holds the
+ *        times within tolerance seconds of its earliest one, which comes
+ *        first. Times that can't be read are returned as single clusters.
+ * @param times The trigger times
+ * @param tolerance The largest distance in seconds to the earliest time
+ */
+QList<QStringList> clusterTriggerTimes(const QStringList& times,
+                                       const double& tolerance);
+
 /**
  * @brief Wait function that doesn't impact Qt event looper
  * @param msec The time to wait
@@ -0,0 +1,833 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+#include "../api.h"
+#include <sdp/gui/datamodel/waveformview.h>
+#include <QFile>
+#include <QDateTime>
+#include <QPainter>
+#include <QScrollBar>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QWheelEvent>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <qnumeric.h>
+#include <limits>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "../../../3rd-party/libmseed/libmseed.h"
+
+
+namespace {
+
+typedef SDP::Qt4::WaveformView::Channel Channel;
+typedef SDP::Qt4::WaveformView::Extent Extent;
+typedef SDP::Qt4::WaveformView::Trace Trace;
+typedef SDP::Qt4::WaveformView::TracePtr TracePtr;
+typedef SDP::Qt4::WaveformView::ChannelList ChannelList;
+typedef SDP::Qt4::WaveformView::TraceList TraceList;
+
+//! Samples of the first level blocks, and blocks merged by the next levels
+static int const BlockSize = 16;
+static int const Factor = 4;
+
+//! Longest window decoded, in samples
+static qint64 const MaxSamples = 50000000;
+
+//! Shortest time span shown, in seconds
+static double const MinimumSpan = .05;
+
+static int const MinRowHeight = 40;
+static int const AxisHeight = 18;
+static int const MinTickSpacing = 90;
+static double const ZoomStep = 1.25;
+
+static double const TickSteps[] = {
+    .001, .002, .005, .01, .02, .05, .1, .2, .5, 1., 2., 5., 10., 15., 30.,
+    60., 120., 300., 600., 900., 1800., 3600., 7200., 21600., 43200., 86400.
+};
+
+
+inline Extent emptyExtent() {
+	Extent e;
+	e.min = std::numeric_limits<float>::infinity();
+	e.max = -std::numeric_limits<float>::infinity();
+	return e;
+}
+
+
+inline void merge(Extent& e, const Extent& other) {
+	if ( other.min < e.min ) e.min = other.min;
+	if ( other.max > e.max ) e.max = other.max;
+}
+
+
+inline void merge(Extent& e, const float& value) {
+	//! Missing samples (NaN) fail both comparisons
+	if ( value < e.min ) e.min = value;
+	if ( value > e.max ) e.max = value;
+}
+
+
+inline bool isEmpty(const Extent& e) {
+	return e.min > e.max;
+}
+
+
+inline bool cancelled(const QSharedPointer<QAtomicInt>& cancel) {
+	return cancel->fetchAndAddOrdered(0) != 0;
+}
+
+
+/**
+ * @brief Builds the min/max pyramid of the samples of a trace, each level
+ *        holding the extents of blocks Factor times larger than the previous
+ *        one, up to a single block.
+ */
+void buildLevels(Trace& trace) {
+
+	const float* samples = trace.samples.constData();
+	const int count = trace.samples.size();
+
+	QVector<Extent> first((count + BlockSize - 1) / BlockSize, emptyExtent());
+	for (int i = 0; i < count; ++i)
+		merge(first[i / BlockSize], samples[i]);
+	trace.levels << first;
+
+	while ( trace.levels.last().size() > 1 ) {
+		const QVector<Extent> previous = trace.levels.last();
+		QVector<Extent> next((previous.size() + Factor - 1) / Factor, emptyExtent());
+		for (int i = 0; i < previous.size(); ++i)
+			merge(next[i / Factor], previous.at(i));
+		trace.levels << next;
+	}
+}
+
+
+//! Decoding state of a channel, its samples are allocated by the first
+//! record of its stream overlapping the window
+struct Decoder {
+		Decoder() :
+				start(0), end(0), span(.0), samples(NULL), count(0) {}
+		TracePtr trace;
+		hptime_t start;
+		hptime_t end;
+		double span;
+		float* samples;
+		qint64 count;
+};
+
+
+//! Group of channels sharing files, halving the path to its root
+int root(QVector<int>& parent, int i) {
+	while ( parent.at(i) != i )
+		i = parent[i] = parent.at(parent.at(i));
+	return i;
+}
+
+
+/**
+ * @brief Places the samples of a record in the trace of a channel of its
+ *        stream. The record is unpacked into umsr once, by the first channel
+ *        needing its samples, unpacked telling whether this was done (1) or
+ *        failed (-1).
+ */
+void addRecord(Decoder& d, MSRecord* msr, MSRecord** umsr, int& unpacked) {
+
+	Trace& trace = *d.trace;
+
+	if ( !trace.error.isEmpty() || unpacked < 0 )
+	    return;
+
+	if ( msr->samprate <= .0 || msr->starttime > d.end || msr_endtime(msr) < d.start )
+	    return;
+
+	if ( !d.samples ) {
+		trace.samprate = msr->samprate;
+		d.count = (qint64) floor(d.span * trace.samprate + .5) + 1;
+		if ( d.count < 1 || d.count > MaxSamples ) {
+			trace.error = QString("Window of %1 samples is too long").arg(d.count);
+			return;
+		}
+		trace.samples.fill(std::numeric_limits<float>::quiet_NaN(), (int) d.count);
+		d.samples = trace.samples.data();
+	}
+	else if ( fabs(msr->samprate - trace.samprate) > 1e-4 * trace.samprate )
+	    return;
+
+	if ( !unpacked ) {
+		unpacked = (msr_unpack(msr->record, msr->reclen, umsr, 1, 0) == MS_NOERROR) ? 1 : -1;
+		if ( unpacked < 0 ) return;
+	}
+
+	const MSRecord* r = *umsr;
+	const double offset = (double) (r->starttime - d.start) / HPTMODULUS * trace.samprate;
+
+	for (int64_t i = 0; i < r->numsamples; ++i) {
+		const qint64 pos = (qint64) floor(offset + i + .5);
+		if ( pos < 0 || pos >= d.count ) continue;
+
+		switch ( r->sampletype ) {
+			case 'i':
+				d.samples[pos] = ((int32_t*) r->datasamples)[i];
+				break;
+			case 'f':
+				d.samples[pos] = ((float*) r->datasamples)[i];
+				break;
+			case 'd':
+				d.samples[pos] = ((double*) r->datasamples)[i];
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+
+/**
+ * @brief Decodes the samples of channels sharing files and builds their
+ *        pyramids. Each file is read once for all the channels listing it,
+ *        its records being dispatched by stream. When the file has a current
+ *        sidecar index, only the records overlapping the windows are read.
+ *        Records are placed by time, so the files may hold other streams,
+ *        overlap each other or be given in any order. Missing samples are
+ *        left as NaN. This function runs in the thread pool.
+ */
+TraceList decodeTraces(const ChannelList& channels, QSharedPointer<QAtomicInt> cancel) {
+
+	QVector<Decoder> decoders(channels.size());
+	TraceList traces;
+
+	//! Files in the order they are listed, and the channels listing them
+	QStringList files;
+	QHash<QString, QList<int> > fileChannels;
+
+	for (int c = 0; c < channels.size(); ++c) {
+
+		const Channel& channel = channels.at(c);
+		Decoder& d = decoders[c];
+		d.trace = TracePtr(new Trace);
+		d.trace->start = channel.start;
+		d.start = MS_EPOCH2HPTIME(channel.start);
+		d.end = MS_EPOCH2HPTIME(channel.end);
+		d.span = channel.end - channel.start;
+		traces << d.trace;
+
+		if ( channel.stream.split('.').size() != 4 ) {
+			d.trace->error = "Invalid stream " + channel.stream;
+			continue;
+		}
+
+		for (int f = 0; f < channel.files.size(); ++f) {
+			if ( !fileChannels.contains(channel.files.at(f)) )
+			    files << channel.files.at(f);
+			QList<int>& listing = fileChannels[channel.files.at(f)];
+			if ( !listing.contains(c) )
+			    listing << c;
+		}
+	}
+
+	MSRecord* umsr = NULL;
+
+	for (int f = 0; f < files.size() && !cancelled(cancel); ++f) {
+
+		//! Channels of the file by stream, and the span of their windows
+		const QList<int> listing = fileChannels.value(files.at(f));
+		QMultiHash<QByteArray, int> streams;
+		hptime_t start = decoders.at(listing.first()).start;
+		hptime_t end = decoders.at(listing.first()).end;
+		for (int i = 0; i < listing.size(); ++i) {
+			const Decoder& d = decoders.at(listing.at(i));
+			streams.insert(channels.at(listing.at(i)).stream.toLatin1(), listing.at(i));
+			start = qMin(start, d.start);
+			end = qMax(end, d.end);
+		}
+
+		const QByteArray filename = QFile::encodeName(files.at(f));
+		MSFileIndex* index = ms_readfileindex(filename.constData(), 0, 0, 0);
+		if ( index && ms_selectfileindex(index, start, end) < 0 )
+		    ms_freefileindex(&index);
+
+		MSFileParam* msfp = NULL;
+		MSRecord* msr = NULL;
+		char key[48];
+
+		while ( !cancelled(cancel) ) {
+
+			const int retcode = index ? ms_readmsr_fileindex(index, &msr, NULL, 0, 0)
+			    : ms_readmsr_r(&msfp, &msr, filename.constData(), 0, NULL, NULL, 1, 0, 0);
+			if ( retcode != MS_NOERROR )
+			    break;
+
+			snprintf(key, sizeof(key), "%s.%s.%s.%s", msr->network, msr->station,
+			    msr->location, msr->channel);
+
+			int unpacked = 0;
+			const QByteArray stream = QByteArray::fromRawData(key, strlen(key));
+			for (QMultiHash<QByteArray, int>::const_iterator it = streams.constFind(stream);
+			        it != streams.constEnd() && it.key() == stream; ++it)
+				addRecord(decoders[it.value()], msr, &umsr, unpacked);
+		}
+
+		//! Close the file and release the record
+		if ( index ) {
+			msr_free(&msr);
+			ms_freefileindex(&index);
+		}
+		else
+			ms_readmsr_r(&msfp, &msr, NULL, 0, NULL, NULL, 0, 0, 0);
+	}
+
+	if ( umsr )
+	    msr_free(&umsr);
+
+	for (int c = 0; c < decoders.size(); ++c) {
+
+		Trace& trace = *decoders.at(c).trace;
+
+		if ( cancelled(cancel) || !trace.error.isEmpty() )
+		    trace.samples.clear();
+		else if ( trace.samples.isEmpty() )
+		    trace.error = "No data";
+		else
+			buildLevels(trace);
+	}
+
+	return traces;
+}
+
+}
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+WaveformView::WaveformView(QWidget* parent) :
+		QWidget(parent), __cancel(new QAtomicInt(0)),
+		__scrollBar(new QScrollBar(Qt::Vertical, this)), __windowStart(.0),
+		__windowEnd(.0), __viewStart(.0), __viewEnd(.0), __dragging(false),
+		__dragX(0), __dragStart(.0) {
+
+	setFocusPolicy(Qt::StrongFocus);
+	setAttribute(Qt::WA_OpaquePaintEvent);
+
+	__scrollBar->hide();
+	connect(__scrollBar, SIGNAL(valueChanged(int)), this, SLOT(update()));
+}
+
+
+WaveformView::~WaveformView() {
+
+	__cancel->fetchAndStoreOrdered(1);
+
+	for (QHash<QFutureWatcher<TraceList>*, QList<int> >::iterator it = __pending.begin();
+	        it != __pending.end(); ++it)
+		it.key()->waitForFinished();
+}
+
+
+void WaveformView::setChannels(const ChannelList& channels) {
+
+	clear();
+
+	__channels = channels;
+	for (int i = 0; i < __channels.size(); ++i)
+		__traces << TracePtr();
+
+	if ( __channels.isEmpty() ) return;
+
+	__windowStart = __channels.first().start;
+	__windowEnd = __channels.first().end;
+	for (int i = 1; i < __channels.size(); ++i) {
+		__windowStart = qMin(__windowStart, __channels.at(i).start);
+		__windowEnd = qMax(__windowEnd, __channels.at(i).end);
+	}
+
+	//! Channels sharing files are decoded together, so that each file is
+	//! read once. Groups are queued in display order, each one is drawn as
+	//! soon as it is decoded
+	QVector<int> parent(__channels.size());
+	QHash<QString, int> fileChannel;
+	for (int i = 0; i < __channels.size(); ++i) {
+		parent[i] = i;
+		const QStringList& files = __channels.at(i).files;
+		for (int f = 0; f < files.size(); ++f) {
+			if ( fileChannel.contains(files.at(f)) )
+			    parent[root(parent, i)] = root(parent, fileChannel.value(files.at(f)));
+			else
+				fileChannel.insert(files.at(f), i);
+		}
+	}
+
+	QList<QList<int> > groups;
+	QHash<int, int> rootGroup;
+	for (int i = 0; i < __channels.size(); ++i) {
+		const int r = root(parent, i);
+		if ( !rootGroup.contains(r) ) {
+			rootGroup.insert(r, groups.size());
+			groups << QList<int>();
+		}
+		groups[rootGroup.value(r)] << i;
+	}
+
+	for (int g = 0; g < groups.size(); ++g) {
+		ChannelList channels;
+		for (int i = 0; i < groups.at(g).size(); ++i)
+			channels << __channels.at(groups.at(g).at(i));
+
+		QFutureWatcher<TraceList>* watcher = new QFutureWatcher<TraceList>(this);
+		connect(watcher, SIGNAL(finished()), this, SLOT(traceDecoded()));
+		__pending.insert(watcher, groups.at(g));
+		watcher->setFuture(QtConcurrent::run(decodeTraces, channels, __cancel));
+	}
+
+	__scrollBar->setValue(0);
+	resetView();
+	updateScrollBar();
+}
+
+
+void WaveformView::clear() {
+
+	//! Channels still being decoded are dropped, the thread pool stops
+	//! decoding them at the next record
+	__cancel->fetchAndStoreOrdered(1);
+	__cancel = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+
+	for (QHash<QFutureWatcher<TraceList>*, QList<int> >::iterator it = __pending.begin();
+	        it != __pending.end(); ++it) {
+		it.key()->disconnect(this);
+		it.key()->deleteLater();
+	}
+	__pending.clear();
+
+	__channels.clear();
+	__traces.clear();
+	__dragging = false;
+
+	updateScrollBar();
+	update();
+}
+
+
+void WaveformView::setMessage(const QString& message) {
+	__message = message;
+	update();
+}
+
+
+void WaveformView::traceDecoded() {
+
+	QFutureWatcher<TraceList>* watcher = static_cast<QFutureWatcher<TraceList>*>(sender());
+	if ( !__pending.contains(watcher) ) return;
+
+	const QList<int> indexes = __pending.take(watcher);
+	const TraceList traces = watcher->result();
+	watcher->deleteLater();
+
+	const QRect plot = plotRect();
+	const int rh = rowHeight();
+	bool visible = false;
+
+	for (int i = 0; i < indexes.size() && i < traces.size(); ++i) {
+		const int idx = indexes.at(i);
+		if ( idx < 0 || idx >= __traces.size() ) continue;
+
+		__traces[idx] = traces.at(i);
+
+		if ( QRect(plot.left(), plot.top() + idx * rh - __scrollBar->value(), plot.width(), rh).intersects(plot) )
+		    visible = true;
+	}
+
+	if ( visible )
+	    update();
+}
+
+
+int WaveformView::rowHeight() const {
+
+	if ( __channels.isEmpty() ) return MinRowHeight;
+
+	return qMax(MinRowHeight, (height() - AxisHeight) / __channels.size());
+}
+
+
+QRect WaveformView::plotRect() const {
+
+	const int scrollWidth = __scrollBar->isVisible() ? __scrollBar->width() : 0;
+
+	return QRect(0, 0, qMax(0, width() - scrollWidth), qMax(0, height() - AxisHeight));
+}
+
+
+void WaveformView::updateScrollBar() {
+
+	const int available = qMax(0, height() - AxisHeight);
+	const int needed = __channels.size() * rowHeight();
+
+	__scrollBar->setGeometry(width() - __scrollBar->sizeHint().width(), 0,
+	    __scrollBar->sizeHint().width(), available);
+	__scrollBar->setRange(0, qMax(0, needed - available));
+	__scrollBar->setPageStep(available);
+	__scrollBar->setSingleStep(rowHeight());
+	__scrollBar->setVisible(needed > available);
+}
+
+
+void WaveformView::resetView() {
+	setView(__windowStart, __windowEnd);
+}
+
+
+void WaveformView::setView(double start, double end) {
+
+	const double window = __windowEnd - __windowStart;
+	double span = qBound(qMin(MinimumSpan, window), end - start, window);
+
+	if ( start < __windowStart ) start = __windowStart;
+	if ( start + span > __windowEnd ) start = __windowEnd - span;
+
+	__viewStart = start;
+	__viewEnd = start + span;
+
+	update();
+}
+
+
+void WaveformView::zoom(const double& factor, const double& center) {
+
+	setView(center - (center - __viewStart) * factor,
+	    center + (__viewEnd - center) * factor);
+}
+
+
+void WaveformView::pan(const double& seconds) {
+	setView(__viewStart + seconds, __viewEnd + seconds);
+}
+
+
+void WaveformView::resizeEvent(QResizeEvent* event) {
+
+	QWidget::resizeEvent(event);
+	updateScrollBar();
+}
+
+
+void WaveformView::paintEvent(QPaintEvent*) {
+
+	QPainter p(this);
+	p.fillRect(rect(), palette().color(QPalette::Base));
+
+	if ( __channels.isEmpty() ) {
+		p.setPen(palette().color(QPalette::Dark));
+		p.drawText(rect(), Qt::AlignCenter | Qt::TextWordWrap, __message);
+		return;
+	}
+
+	const QRect plot = plotRect();
+	const int rh = rowHeight();
+	const double secondsPerPixel = (__viewEnd - __viewStart) / qMax(1, plot.width());
+
+	drawAxis(p, plot);
+
+	p.setClipRect(plot);
+
+	//! Only the rows in sight are drawn
+	const int first = qMax(0, __scrollBar->value() / rh);
+	for (int i = first; i < __channels.size(); ++i) {
+
+		const QRect row(plot.left(), plot.top() + i * rh - __scrollBar->value(), plot.width(), rh);
+		if ( row.top() > plot.bottom() ) break;
+
+		if ( i % 2 )
+		    p.fillRect(row, palette().color(QPalette::AlternateBase));
+
+		const Channel& channel = __channels.at(i);
+		const TracePtr& trace = __traces.at(i);
+
+		//! Trigger on and off
+		const double on = (channel.start + channel.on - __viewStart) / secondsPerPixel;
+		const double off = (channel.start + channel.off - __viewStart) / secondsPerPixel;
+		p.setPen(QColor(0, 160, 0));
+		p.drawLine(QLineF(row.left() + on, row.top(), row.left() + on, row.bottom()));
+		p.setPen(QColor(200, 0, 0));
+		p.drawLine(QLineF(row.left() + off, row.top(), row.left() + off, row.bottom()));
+
+		QString label = channel.stream;
+		if ( !trace )
+			label += " - " + tr("decoding...");
+		else if ( !trace->error.isEmpty() )
+			label += " - " + trace->error;
+		else
+			drawTrace(p, row, *trace);
+
+		p.setPen(palette().color(QPalette::Text));
+		p.drawText(row.adjusted(4, 2, -4, -2), Qt::AlignLeft | Qt::AlignTop, label);
+
+		p.setPen(palette().color(QPalette::Mid));
+		p.drawLine(row.bottomLeft(), row.bottomRight());
+	}
+}
+
+
+void WaveformView::drawAxis(QPainter& p, const QRect& plot) {
+
+	const double span = __viewEnd - __viewStart;
+	const double secondsPerPixel = span / qMax(1, plot.width());
+
+	double step = TickSteps[sizeof(TickSteps) / sizeof(TickSteps[0]) - 1];
+	for (size_t i = 0; i < sizeof(TickSteps) / sizeof(TickSteps[0]); ++i)
+		if ( TickSteps[i] / secondsPerPixel >= MinTickSpacing ) {
+			step = TickSteps[i];
+			break;
+		}
+
+	const QString format = ( step < 1. ) ? "hh:mm:ss.zzz" : "hh:mm:ss";
+	const QRect axis(plot.left(), plot.bottom() + 1, plot.width(), AxisHeight);
+
+	QFont f(font());
+	f.setPointSize(qMax(6, f.pointSize() - 1));
+	p.setFont(f);
+
+	for (double t = ceil(__viewStart / step) * step; t <= __viewEnd; t += step) {
+
+		const int x = plot.left() + (int) ((t - __viewStart) / secondsPerPixel);
+
+		p.setPen(palette().color(QPalette::Midlight));
+		p.drawLine(x, plot.top(), x, plot.bottom());
+
+		p.setPen(palette().color(QPalette::Text));
+		p.drawLine(x, axis.top(), x, axis.top() + 3);
+		p.drawText(QRect(x - MinTickSpacing / 2, axis.top() + 3, MinTickSpacing, axis.height() - 3),
+		    Qt::AlignHCenter | Qt::AlignTop,
+		    QDateTime::fromMSecsSinceEpoch((qint64) floor(t * 1000. + .5)).toUTC().toString(format));
+	}
+}
+
+
+void WaveformView::drawTrace(QPainter& p, const QRect& row, const Trace& trace) {
+
+	const int width = row.width();
+	const int count = trace.samples.size();
+	if ( width <= 0 || count == 0 ) return;
+
+	const double secondsPerPixel = (__viewEnd - __viewStart) / width;
+	const double samplesPerPixel = secondsPerPixel * trace.samprate;
+	const double firstSample = (__viewStart - trace.start) * trace.samprate;
+	const float* samples = trace.samples.constData();
+
+	Extent range = emptyExtent();
+
+	//! Zoomed in past one sample per pixel, samples are joined by lines
+	if ( samplesPerPixel < 1. ) {
+
+		const int first = qMax(0, (int) floor(firstSample) - 1);
+		const int last = qMin(count - 1, (int) ceil(firstSample + width * samplesPerPixel) + 1);
+		if ( first > last ) return;
+
+		for (int i = first; i <= last; ++i)
+			merge(range, samples[i]);
+		if ( isEmpty(range) ) return;
+
+		const double center = (range.min + range.max) / 2.;
+		const double half = ( range.max > range.min ) ? (range.max - range.min) / 2. : 1.;
+		const double scale = (row.height() / 2. - 2.) / half;
+
+		QVector<QPointF> points;
+		points.reserve(last - first + 1);
+		p.setPen(palette().color(QPalette::WindowText));
+		for (int i = first; i <= last; ++i) {
+			if ( qIsNaN(samples[i]) ) {
+				if ( points.size() > 1 ) p.drawPolyline(points.constData(), points.size());
+				points.clear();
+				continue;
+			}
+			points << QPointF(row.left() + (i - firstSample) / samplesPerPixel,
+			    row.center().y() - (samples[i] - center) * scale);
+		}
+		if ( points.size() > 1 ) p.drawPolyline(points.constData(), points.size());
+
+		return;
+	}
+
+	//! Otherwise each column is drawn from the coarsest level whose blocks
+	//! are not larger than a column, a few blocks per column
+	int level = -1;
+	qint64 blockSize = 1;
+	for (qint64 size = BlockSize; level + 1 < trace.levels.size() && size <= samplesPerPixel; size *= Factor) {
+		++level;
+		blockSize = size;
+	}
+
+	QVector<Extent> columns(width, emptyExtent());
+	for (int x = 0; x < width; ++x) {
+
+		qint64 first = (qint64) floor(firstSample + x * samplesPerPixel);
+		qint64 last = (qint64) floor(firstSample + (x + 1) * samplesPerPixel) - 1;
+		if ( last < first ) last = first;
+		if ( last < 0 || first >= count ) continue;
+		first = qMax<qint64>(0, first);
+		last = qMin<qint64>(count - 1, last);
+
+		Extent& e = columns[x];
+		if ( level < 0 )
+			for (qint64 i = first; i <= last; ++i)
+				merge(e, samples[i]);
+		else {
+			const QVector<Extent>& blocks = trace.levels.at(level);
+			for (qint64 b = first / blockSize; b <= last / blockSize; ++b)
+				merge(e, blocks.at((int) b));
+		}
+
+		if ( !isEmpty(e) ) merge(range, e);
+	}
+
+	if ( isEmpty(range) ) return;
+
+	const double center = (range.min + range.max) / 2.;
+	const double half = ( range.max > range.min ) ? (range.max - range.min) / 2. : 1.;
+	const double scale = (row.height() / 2. - 2.) / half;
+
+	//! Columns overlap their neighbour so that the trace stays continuous
+	QVector<QLineF> lines;
+	lines.reserve(width);
+	for (int x = 0; x < width; ++x) {
+
+		const Extent& e = columns.at(x);
+		if ( isEmpty(e) ) continue;
+
+		float low = e.min;
+		float high = e.max;
+		if ( x > 0 && !isEmpty(columns.at(x - 1)) ) {
+			low = qMin(low, columns.at(x - 1).max);
+			high = qMax(high, columns.at(x - 1).min);
+		}
+
+		const double bottom = row.center().y() - (low - center) * scale;
+		const double top = row.center().y() - (high - center) * scale;
+		lines << QLineF(row.left() + x + .5, bottom, row.left() + x + .5, qMin(top, bottom - 1.));
+	}
+
+	p.setPen(palette().color(QPalette::WindowText));
+	p.drawLines(lines);
+}
+
+
+void WaveformView::wheelEvent(QWheelEvent* event) {
+
+	if ( __channels.isEmpty() ) return;
+
+	//! Shift scrolls channels, the wheel alone zooms around the cursor
+	if ( event->modifiers() & Qt::ShiftModifier ) {
+		__scrollBar->setValue(__scrollBar->value() - event->delta() / 120 * rowHeight());
+		return;
+	}
+
+	const QRect plot = plotRect();
+	const double center = __viewStart + (event->x() - plot.left())
+	    * (__viewEnd - __viewStart) / qMax(1, plot.width());
+
+	zoom(pow(ZoomStep, -event->delta() / 120.), center);
+}
+
+
+void WaveformView::mousePressEvent(QMouseEvent* event) {
+
+	if ( event->button() != Qt::LeftButton || __channels.isEmpty() ) {
+		QWidget::mousePressEvent(event);
+		return;
+	}
+
+	__dragging = true;
+	__dragX = event->x();
+	__dragStart = __viewStart;
+	setCursor(Qt::ClosedHandCursor);
+}
+
+
+void WaveformView::mouseMoveEvent(QMouseEvent* event) {
+
+	if ( !__dragging ) return;
+
+	const double span = __viewEnd - __viewStart;
+	const double start = __dragStart - (event->x() - __dragX) * span / qMax(1, plotRect().width());
+
+	setView(start, start + span);
+}
+
+
+void WaveformView::mouseReleaseEvent(QMouseEvent* event) {
+
+	if ( event->button() != Qt::LeftButton ) return;
+
+	__dragging = false;
+	unsetCursor();
+}
+
+
+void WaveformView::mouseDoubleClickEvent(QMouseEvent*) {
+	resetView();
+}
+
+
+void WaveformView::keyPressEvent(QKeyEvent* event) {
+
+	const double span = __viewEnd - __viewStart;
+	const double center = (__viewStart + __viewEnd) / 2.;
+
+	switch ( event->key() ) {
+		case Qt::Key_Left:
+			pan(-span / 10.);
+			break;
+		case Qt::Key_Right:
+			pan(span / 10.);
+			break;
+		case Qt::Key_Plus:
+		case Qt::Key_Equal:
+			zoom(1. / ZoomStep, center);
+			break;
+		case Qt::Key_Minus:
+			zoom(ZoomStep, center);
+			break;
+		case Qt::Key_Home:
+			resetView();
+			break;
+		case Qt::Key_Up:
+			__scrollBar->triggerAction(QAbstractSlider::SliderSingleStepSub);
+			break;
+		case Qt::Key_Down:
+			__scrollBar->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+			break;
+		default:
+			QWidget::keyPressEvent(event);
+			break;
+	}
+}
+
+
+} // namespace Qt4
+} // namespace SDP
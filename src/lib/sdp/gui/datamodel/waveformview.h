@@ -0,0 +1,184 @@
+/**************************************************************************
+ *                                                                        *
+ *  Copyright (C) 2015 OVSM/IPGP                                          *
+ *                                                                        *
+ *  This file is part of Seismic Data Playback 'SDP'.                     *
+ *                                                                        *
+ *  SDP is free software: you can redistribute it and/or modify           *
+ *  it under the terms of the GNU General Public License as published by  *
+ *  the Free Software Foundation, either version 3 of the License, or     *
+ *  (at your option) any later version.                                   *
+ *                                                                        *
+ *  SDP is distributed in the hope that it will be useful,                *
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *  GNU General Public License for more details.                          *
+ *                                                                        *
+ *  You should have received a copy of the GNU General Public License     *
+ *  along with SDP. If not, see <http://www.gnu.org/licenses/>.           *
+ *                                                                        *
+ **************************************************************************/
+
+
+
+
+#ifndef __SDP_QT4_DATAMODEL_WAVEFORMVIEW_H__
+#define __SDP_QT4_DATAMODEL_WAVEFORMVIEW_H__
+
+
+#include <QWidget>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QSharedPointer>
+#include <QAtomicInt>
+
+
+class QScrollBar;
+template<typename T> class QFutureWatcher;
+
+
+namespace SDP {
+namespace Qt4 {
+
+
+/**
+ * @class WaveformView
+ * @brief This class implements an interactive view of the waveforms of a
+ *        trigger. The samples of each channel are read from the Mini-SEED
+ *        files recorded by the detection run and drawn from a min/max
+ *        pyramid, so that the cost of a frame depends on the width of the
+ *        view and not on the number of samples shown.
+ * @info  Channels are decoded by the thread pool, the ones sharing files
+ *        together so that each file is read once, and drawn as soon as they
+ *        are ready. The wheel zooms around the cursor, dragging pans, double
+ *        click shows the whole window again. Channels which do not fit the
+ *        height of the view are scrolled.
+ */
+class WaveformView : public QWidget {
+
+	Q_OBJECT
+
+	public:
+		// ------------------------------------------------------------------
+		//  Nested types
+		// ------------------------------------------------------------------
+		struct Channel {
+				Channel() :
+						start(.0), end(.0), on(.0), off(.0) {}
+				//! NET.STA.LOC.CHA
+				QString stream;
+				QStringList files;
+				//! Window, epoch seconds
+				double start;
+				double end;
+				//! Trigger on and off, seconds after the start of the window
+				double on;
+				double off;
+		};
+		typedef QList<Channel> ChannelList;
+
+		//! Smallest and largest sample of a block
+		struct Extent {
+				float min;
+				float max;
+		};
+
+		//! Decoded samples of a channel and their pyramid, level i holding
+		//! the extents of blocks of BlockSize * Factor^i samples
+		struct Trace {
+				Trace() :
+						samprate(.0), start(.0) {}
+				double samprate;
+				//! Time of the first sample, epoch seconds
+				double start;
+				QVector<float> samples;
+				QList<QVector<Extent> > levels;
+				QString error;
+		};
+		typedef QSharedPointer<Trace> TracePtr;
+		typedef QList<TracePtr> TraceList;
+
+	public:
+		// ------------------------------------------------------------------
+		//  Instruction
+		// ------------------------------------------------------------------
+		explicit WaveformView(QWidget* = NULL);
+		~WaveformView();
+
+	public:
+		// ------------------------------------------------------------------
+		//  Public interface
+		// ------------------------------------------------------------------
+		//! Shows channels, the ones being decoded for a previous list are
+		//! dropped
+		void setChannels(const ChannelList&);
+		void clear();
+
+		//! Text shown when there are no channels
+		void setMessage(const QString&);
+
+	protected:
+		// ------------------------------------------------------------------
+		//  Protected interface
+		// ------------------------------------------------------------------
+		void paintEvent(QPaintEvent*);
+		void resizeEvent(QResizeEvent*);
+		void wheelEvent(QWheelEvent*);
+		void mousePressEvent(QMouseEvent*);
+		void mouseMoveEvent(QMouseEvent*);
+		void mouseReleaseEvent(QMouseEvent*);
+		void mouseDoubleClickEvent(QMouseEvent*);
+		void keyPressEvent(QKeyEvent*);
+
+	private Q_SLOTS:
+		// ------------------------------------------------------------------
+		//  Private Qt interface
+		// ------------------------------------------------------------------
+		void traceDecoded();
+
+	private:
+		// ------------------------------------------------------------------
+		//  Private interface
+		// ------------------------------------------------------------------
+		int rowHeight() const;
+		QRect plotRect() const;
+		void updateScrollBar();
+		void resetView();
+		void setView(double start, double end);
+		void zoom(const double& factor, const double& center);
+		void pan(const double& seconds);
+		void drawAxis(QPainter&, const QRect&);
+		void drawTrace(QPainter&, const QRect&, const Trace&);
+
+	private:
+		// ------------------------------------------------------------------
+		//  Members
+		// ------------------------------------------------------------------
+		ChannelList __channels;
+		QList<TracePtr> __traces;
+		//! Channels decoded by each pending group
+		QHash<QFutureWatcher<TraceList>*, QList<int> > __pending;
+		//! Raised to stop the decoding of channels no longer shown
+		QSharedPointer<QAtomicInt> __cancel;
+		QScrollBar* __scrollBar;
+		QString __message;
+
+		//! Whole window of the channels and shown part, epoch seconds
+		double __windowStart;
+		double __windowEnd;
+		double __viewStart;
+		double __viewEnd;
+
+		bool __dragging;
+		int __dragX;
+		double __dragStart;
+};
+
+
+} // namespace Qt4
+} // namespace SDP
+
+#endif